@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Neuro.h"
+
+using namespace std;
+using namespace Neuro;
+
+// Timed comparison of host memory manager allocators. Every thread keeps a window of live blocks and keeps replacing random ones,
+// sizes follow what tensors of small and medium networks request (mostly below 64KB with occasional large ones). Each allocator
+// runs on its own fresh memory manager so reserved size reflects fragmentation caused by the workload only.
+class AllocatorBenchmark
+{
+public:
+    void Run()
+    {
+        cout << "Operations per thread: " << OPS_PER_THREAD << ", live blocks per thread: " << LIVE_BLOCKS << endl;
+        cout << setw(14) << "allocator" << setw(10) << "threads" << setw(14) << "time[ms]" << setw(14) << "Mops/s" << setw(14) << "peak[MB]" << setw(14) << "reserved[MB]" << endl;
+
+        for (uint32_t threadsNum : { 1, 2, 4, 8 })
+        {
+            Measure(MEM_ALLOCATOR_BEST_FIT, "best fit", threadsNum);
+            Measure(MEM_ALLOCATOR_SIZE_CLASSES, "size classes", threadsNum);
+        }
+
+        cin.get();
+    }
+
+private:
+    void Measure(EMemAllocator allocator, const string& name, uint32_t threadsNum)
+    {
+        HostMemoryManager manager;
+        manager.SetAllocator(allocator);
+
+        vector<thread> threads;
+        auto start = chrono::steady_clock::now();
+
+        for (uint32_t t = 0; t < threadsNum; ++t)
+            threads.push_back(thread([&, t]() { Churn(manager, 1337 + t); }));
+
+        for (auto& thread : threads)
+            thread.join();
+
+        auto duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        float opsNum = (float)threadsNum * OPS_PER_THREAD * 2; // allocation and release
+
+        cout << setw(14) << name << setw(10) << threadsNum << setw(14) << fixed << setprecision(1) << duration * 0.001f
+             << setw(14) << setprecision(2) << opsNum / duration << setw(14) << manager.AllocatedPeakSize() / (1024.f * 1024.f)
+             << setw(14) << manager.ReservedSize() / (1024.f * 1024.f) << endl;
+
+        manager.ReleaseAll();
+    }
+
+    void Churn(HostMemoryManager& manager, unsigned int seed)
+    {
+        mt19937 rng(seed);
+        uniform_real_distribution<float> dist(0.f, 1.f);
+
+        auto nextSize = [&]()
+        {
+            float r = dist(rng);
+            if (r < 0.6f)
+                return (size_t)(64 + dist(rng) * 4 * 1024);
+            if (r < 0.95f)
+                return (size_t)(4 * 1024 + dist(rng) * 60 * 1024);
+            return (size_t)(64 * 1024 + dist(rng) * 4 * 1024 * 1024);
+        };
+
+        vector<void*> blocks(LIVE_BLOCKS, nullptr);
+        for (auto& block : blocks)
+            manager.Allocate(&block, nextSize());
+
+        for (uint32_t i = 0; i < OPS_PER_THREAD; ++i)
+        {
+            auto& block = blocks[rng() % LIVE_BLOCKS];
+            manager.Free(block);
+            manager.Allocate(&block, nextSize());
+        }
+
+        for (auto block : blocks)
+            manager.Free(block);
+    }
+
+    const uint32_t OPS_PER_THREAD = 200000;
+    const uint32_t LIVE_BLOCKS = 256;
+};
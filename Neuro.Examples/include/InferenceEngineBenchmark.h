@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Neuro.h"
+
+using namespace std;
+using namespace Neuro;
+
+// Load generator for inference engine. Clients send single sample requests in a closed loop (next request is sent as soon as
+// response to the previous one arrives), latency of every request is measured from submission to response. Baseline calls
+// ModelBase::Predict per request serialized by a lock, which is how RPC layer without batching serves the model.
+class InferenceEngineBenchmark
+{
+public:
+    void Run()
+    {
+        Tensor::SetDefaultOpMode(CPU_MT);
+        GlobalRngSeed(1337);
+
+        auto model = Sequential("inference_benchmark");
+        model.AddLayer(new Dense(INPUT_SIZE, 512, new ReLU()));
+        model.AddLayer(new Dense(512, new ReLU()));
+        model.AddLayer(new Dense(10, new Softmax()));
+
+        cout << "Example: " << model.Name() << endl;
+        cout << model.Summary();
+
+        for (uint32_t i = 0; i < SAMPLES_NUM; ++i)
+            m_Samples.push_back(Uniform::Random(-1, 1, Shape(INPUT_SIZE)));
+
+        cout << "Clients: " << CLIENTS_NUM << ", requests per client: " << REQUESTS_PER_CLIENT << endl;
+        cout << setw(10) << "max batch" << setw(14) << "deadline[us]" << setw(12) << "avg batch" << setw(12) << "p50[us]" << setw(12) << "p99[us]" << setw(14) << "req/s" << endl;
+
+        {
+            mutex predictMtx;
+            auto result = GenerateLoad([&](const Tensor& sample)
+            {
+                unique_lock<mutex> predictLocker(predictMtx);
+                model.Predict(sample);
+            });
+            Report("-", "-", 1.f, result);
+        }
+
+        for (uint32_t maxBatchSize : { 1, 4, 16, 64 })
+        {
+            for (int64_t maxLatencyUs : { 0, 200, 1000, 5000 })
+            {
+                InferenceEngine engine(&model, maxBatchSize, maxLatencyUs);
+                auto result = GenerateLoad([&](const Tensor& sample) { engine.Predict({ &sample }); });
+                Report(to_string(maxBatchSize), to_string(maxLatencyUs), engine.Stats().AverageBatchSize(), result);
+            }
+        }
+
+        cin.get();
+    }
+
+private:
+    struct LoadResult
+    {
+        vector<int64_t> latencies; // microseconds, sorted
+        int64_t duration; // microseconds
+    };
+
+    template<typename F>
+    LoadResult GenerateLoad(F request)
+    {
+        vector<vector<int64_t>> clientLatencies(CLIENTS_NUM);
+        vector<thread> clients;
+
+        auto start = chrono::steady_clock::now();
+
+        for (uint32_t c = 0; c < CLIENTS_NUM; ++c)
+        {
+            clients.push_back(thread([&, c]()
+            {
+                for (uint32_t r = 0; r < REQUESTS_PER_CLIENT; ++r)
+                {
+                    auto submitTime = chrono::steady_clock::now();
+                    request(m_Samples[(c * REQUESTS_PER_CLIENT + r) % m_Samples.size()]);
+                    clientLatencies[c].push_back(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - submitTime).count());
+                }
+            }));
+        }
+
+        for (auto& client : clients)
+            client.join();
+
+        LoadResult result;
+        result.duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        for (auto& latencies : clientLatencies)
+            result.latencies.insert(result.latencies.end(), latencies.begin(), latencies.end());
+        sort(result.latencies.begin(), result.latencies.end());
+        return result;
+    }
+
+    static int64_t Percentile(const vector<int64_t>& sorted, float p)
+    {
+        return sorted[min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+    }
+
+    static void Report(const string& maxBatchSize, const string& maxLatency, float avgBatchSize, const LoadResult& result)
+    {
+        float throughput = result.latencies.size() / (result.duration * 0.000001f);
+        cout << setw(10) << maxBatchSize << setw(14) << maxLatency << setw(12) << fixed << setprecision(2) << avgBatchSize << setw(12) << Percentile(result.latencies, 0.5f) << setw(12) << Percentile(result.latencies, 0.99f) << setw(14) << setprecision(0) << throughput << endl;
+    }
+
+    const uint32_t INPUT_SIZE = 256;
+    const uint32_t SAMPLES_NUM = 1024;
+    const uint32_t CLIENTS_NUM = 32;
+    const uint32_t REQUESTS_PER_CLIENT = 200;
+
+    vector<Tensor> m_Samples;
+};
\ No newline at end of file
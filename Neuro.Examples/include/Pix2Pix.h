@@ -42,6 +42,8 @@ public:
             return 2;
         }
 
+        virtual bool Reentrant() const override { return false; }
+
     private:
         Random m_Rng;
     };
@@ -83,6 +85,8 @@ public:
             return 2;
         }
 
+        virtual bool Reentrant() const override { return false; }
+
     private:
         Random m_Rng;
     };
@@ -14,6 +14,8 @@
 #include "AdaptiveStyleTransfer.h"
 #include "Pix2Pix.h"
 #include "NeuralStyleTransferHD2.h"
+#include "InferenceEngineBenchmark.h"
+#include "AllocatorBenchmark.h"
 
 int main(int argc, char *argv[])
 {
@@ -39,6 +41,8 @@ int main(int argc, char *argv[])
     //AdaptiveStyleTransfer().Test();
     //Pix2Pix().Run();
     //Pix2Pix().RunDiscriminatorTrainTest();
+    //InferenceEngineBenchmark().Run();
+    //AllocatorBenchmark().Run();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include <numeric>
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(BatchGathererTests)
+    {
+        TEST_METHOD(Gather_ShuffledIndices)
+        {
+            TestGatherer(true, false);
+        }
+
+        TEST_METHOD(Gather_ConsecutiveIndices)
+        {
+            TestGatherer(false, false);
+        }
+
+        TEST_METHOD(Gather_Prefetched)
+        {
+            TestGatherer(true, true);
+        }
+
+        void TestGatherer(bool shuffle, bool prefetch)
+        {
+            const uint32_t SAMPLES = 103, BATCH_SIZE = 16;
+            Tensor input(Shape(5, 2, 1, SAMPLES)), output(Shape(3, 1, 1, SAMPLES));
+            input.FillWithRand();
+            output.FillWithRand();
+
+            vector<uint32_t> indices(SAMPLES);
+            iota(indices.begin(), indices.end(), 0);
+            if (shuffle)
+                random_shuffle(indices.begin(), indices.end(), [&](size_t max) { return GlobalRng().Next((int)max); });
+
+            vector<vector<uint32_t>> batchesIndices;
+            for (uint32_t i = 0; i < SAMPLES; i += BATCH_SIZE)
+                batchesIndices.push_back(vector<uint32_t>(indices.begin() + i, indices.begin() + min(SAMPLES, i + BATCH_SIZE)));
+
+            BatchGatherer gatherer({ &input, &output }, BATCH_SIZE);
+            for (size_t b = 0; b < batchesIndices.size(); ++b)
+            {
+                auto batch = gatherer.Gather(batchesIndices[b]);
+                if (prefetch && b + 1 < batchesIndices.size())
+                    gatherer.Prefetch(batchesIndices[b + 1]);
+
+                Assert::AreEqual((size_t)2, batch.size());
+                Assert::AreEqual((uint32_t)batchesIndices[b].size(), batch[0]->Batch());
+
+                for (uint32_t n = 0; n < batch[0]->Batch(); ++n)
+                {
+                    Assert::IsTrue(input.GetBatch(batchesIndices[b][n]).Equals(batch[0]->GetBatch(n)));
+                    Assert::IsTrue(output.GetBatch(batchesIndices[b][n]).Equals(batch[1]->GetBatch(n)));
+                }
+            }
+        }
+    };
+}
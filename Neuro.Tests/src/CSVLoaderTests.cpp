@@ -0,0 +1,134 @@
+#include <fstream>
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(CSVLoaderTests)
+    {
+        TEST_METHOD(ParseFloat)
+        {
+            const char* values[] = { "1", "-2.5", "+3.25e2", "0.000123", "1e-40", "3.4e38", ".5", "5.", " 7.5 ", "1E+5", "-0.1234567890123456789" };
+            for (auto value : values)
+                Assert::AreEqual((float)atof(value), CSVFile::ParseFloat(value, value + strlen(value)));
+        }
+
+        TEST_METHOD(Load_OneHotEncoded)
+        {
+            WriteTestFile("csv_test.csv", 1000);
+
+            CSVOptions options;
+            options.header = true;
+            options.outputsOneHotEncoded = true;
+            CSVFile file("csv_test.csv", 3, options);
+            Assert::IsTrue(file.IsValid());
+            Assert::AreEqual((size_t)4, file.ColumnNames().size());
+            Assert::IsTrue(file.ColumnNames()[1] == "b");
+
+            Tensor inputs, outputs;
+            file.Load(inputs, outputs);
+            Assert::IsTrue(inputs.GetShape() == Shape(3, 1, 1, 1000));
+            Assert::IsTrue(outputs.GetShape() == Shape(3, 1, 1, 1000));
+
+            for (uint32_t r = 0; r < 1000; ++r)
+            {
+                Assert::AreEqual((float)r, inputs(0, 0, 0, r));
+                Assert::AreEqual(r * 0.5f, inputs(1, 0, 0, r));
+                Assert::AreEqual(-(float)r, inputs(2, 0, 0, r));
+                for (uint32_t k = 0; k < 3; ++k)
+                    Assert::AreEqual(k == r % 3 ? 1.f : 0.f, outputs(k, 0, 0, r));
+            }
+        }
+
+        TEST_METHOD(Load_MultipleChunks)
+        {
+            // over 8MB, so file is split into a few chunks parsed in parallel
+            const uint32_t ROWS_NUM = 300000;
+            WriteTestFile("csv_test_chunks.csv", ROWS_NUM);
+
+            CSVOptions options;
+            options.header = true;
+            Tensor inputs, outputs;
+            CSVFile("csv_test_chunks.csv", 1, options).Load(inputs, outputs);
+            Assert::IsTrue(inputs.GetShape() == Shape(3, 1, 1, ROWS_NUM));
+
+            // rows at chunk boundaries are neither lost nor duplicated
+            for (uint32_t r = 0; r < ROWS_NUM; ++r)
+            {
+                Assert::AreEqual((float)r, inputs(0, 0, 0, r));
+                Assert::AreEqual(-(float)r, inputs(2, 0, 0, r));
+                Assert::AreEqual((float)(r % 3), outputs(0, 0, 0, r));
+            }
+        }
+
+        TEST_METHOD(Load_SelectedColumns)
+        {
+            WriteTestFile("csv_test_columns.csv", 100);
+
+            CSVOptions options;
+            options.header = true;
+            options.columnNames = { "c", "a" };
+
+            Tensor inputs, outputs;
+            CSVFile("csv_test_columns.csv", 1, options).Load(inputs, outputs, 50);
+            Assert::IsTrue(inputs.GetShape() == Shape(1, 1, 1, 50));
+
+            for (uint32_t r = 0; r < 50; ++r)
+            {
+                Assert::AreEqual(-(float)r, inputs(0, 0, 0, r));
+                Assert::AreEqual((float)r, outputs(0, 0, 0, r));
+            }
+        }
+
+        TEST_METHOD(CSVLoader_WrapsAround)
+        {
+            WriteTestFile("csv_test_loader.csv", 100);
+
+            CSVOptions options;
+            options.header = true;
+            CSVLoader loader("csv_test_loader.csv", 1, 30, options);
+
+            vector<Tensor> dest = { Tensor(Shape(3)), Tensor(Shape(1)) };
+            for (uint32_t b = 0; b < 5; ++b)
+            {
+                Assert::AreEqual((size_t)2, loader(dest, 0));
+                Assert::AreEqual((uint32_t)30, dest[0].Batch());
+
+                for (uint32_t n = 0; n < 30; ++n)
+                {
+                    uint32_t r = (b * 30 + n) % 100;
+                    Assert::AreEqual((float)r, dest[0](0, 0, 0, n));
+                    Assert::AreEqual((float)(r % 3), dest[1](0, 0, 0, n));
+                }
+            }
+        }
+
+        TEST_METHOD(CSVLoader_NoRows)
+        {
+            WriteTestFile("csv_test_empty.csv", 0);
+
+            CSVOptions options;
+            options.header = true;
+            CSVLoader loader("csv_test_empty.csv", 1, 30, options);
+
+            vector<Tensor> dest = { Tensor(Shape(3)), Tensor(Shape(1)) };
+            Assert::AreEqual((size_t)0, loader(dest, 0));
+        }
+
+        // Rows contain index, half of index, negated index and class, with empty lines and Windows line breaks in between
+        void WriteTestFile(const string& filename, uint32_t rowsNum)
+        {
+            ofstream stream(filename, ios::out | ios::binary);
+            stream << "a, b ,\"c\",label\r\n";
+            for (uint32_t r = 0; r < rowsNum; ++r)
+            {
+                if (r % 7 == 0)
+                    stream << "\r\n";
+                stream << r << "," << r * 0.5f << "," << -(int)r << "," << r % 3 << "\r\n";
+            }
+        }
+    };
+}
@@ -0,0 +1,210 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include "CppUnitTest.h"
+#include "Neuro.h"
+#include "Tensors/Cpu/CpuKernels.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(CompactTensorTests)
+    {
+        TEST_METHOD(Uint8_Expand)
+        {
+            // odd sample length so both vectorized and remaining values are expanded
+            Tensor t(Shape(7, 5, 3, 40));
+            for (uint32_t i = 0; i < t.Length(); ++i)
+                t.Values()[i] = (float)GlobalRng().Next(256) / 255.f;
+
+            CompactTensor compact(t, COMPACT_UINT8, 1 / 255.f);
+            Assert::AreEqual((size_t)t.Length(), compact.SizeInBytes());
+
+            Tensor batch(Shape(7, 5, 3));
+            compact.Expand({ 3, 0, 39 }, batch);
+            Assert::AreEqual(3u, batch.Batch());
+            Assert::IsTrue(batch.Equals(t.GetBatches({ 3, 0, 39 }), 0.0001f));
+            Assert::IsTrue(compact.ToTensor().Equals(t, 0.0001f));
+        }
+
+        TEST_METHOD(Float16_Expand)
+        {
+            Tensor t(Shape(7, 5, 3, 40));
+            t.FillWithRand(10, -100, 100);
+
+            CompactTensor compact(t, COMPACT_FLOAT16);
+            Assert::AreEqual((size_t)t.Length() * 2, compact.SizeInBytes());
+
+            Tensor batch(Shape(7, 5, 3));
+            compact.Expand(10, 20, batch);
+            Assert::AreEqual(20u, batch.Batch());
+            // half precision keeps 11 significant bits
+            for (uint32_t i = 0; i < batch.Length(); ++i)
+                Assert::AreEqual((double)t.Values()[10 * t.BatchLength() + i], (double)batch.Values()[i], 0.05);
+        }
+
+        TEST_METHOD(FloatToHalf_SpecialValues)
+        {
+            const float inf = numeric_limits<float>::infinity();
+            // smallest subnormal, halfway below it (ties to even zero) and above it, largest subnormal and smallest normal
+            const float values[] = { 0.f, -0.f, ldexp(1.f, -24), ldexp(1.f, -25), ldexp(1.5f, -25), ldexp(1023.f, -24), ldexp(1.f, -14),
+                // ties: 2049 is halfway between 2048 and 2050, 2051 between 2050 and 2052
+                2049.f, 2051.f, -2049.f,
+                // largest half, value rounding up to infinity and one rounding down to the largest half
+                65504.f, 65520.f, 65519.f, 1e10f, -inf, inf };
+            const uint16_t expected[] = { 0x0000, 0x8000, 0x0001, 0x0000, 0x0001, 0x03FF, 0x0400,
+                0x6800, 0x6802, 0xE800,
+                0x7BFF, 0x7C00, 0x7BFF, 0x7C00, 0xFC00, 0x7C00 };
+
+            const int len = (int)(sizeof(values) / sizeof(values[0]));
+            uint16_t halves[len];
+            CpuKernels::FloatToHalf(values, len, halves);
+            for (int i = 0; i < len; ++i)
+                Assert::AreEqual((int)expected[i], (int)halves[i]);
+
+            float nan = numeric_limits<float>::quiet_NaN();
+            uint16_t nanHalf;
+            CpuKernels::FloatToHalf(&nan, 1, &nanHalf);
+            Assert::AreEqual(0x7C00, nanHalf & 0x7C00);
+            Assert::IsTrue((nanHalf & 0x3FF) != 0);
+
+            float restored[len];
+            CpuKernels::HalfToFloat(expected, len, restored);
+            Assert::AreEqual(ldexp(1.f, -24), restored[2]);
+            Assert::AreEqual(ldexp(1023.f, -24), restored[5]);
+            Assert::AreEqual(65504.f, restored[10]);
+            Assert::AreEqual(inf, restored[11]);
+            Assert::AreEqual(-inf, restored[14]);
+
+            float nanRestored;
+            CpuKernels::HalfToFloat(&nanHalf, 1, &nanRestored);
+            Assert::IsTrue(isnan(nanRestored));
+        }
+
+        TEST_METHOD(HalfConversion_ScalarMatchesF16C)
+        {
+            if (!CpuKernels::SupportsF16C())
+                return;
+
+            // every half value and float bit patterns around each of them, including NaNs with various payloads
+            vector<uint16_t> halves(1 << 16);
+            vector<float> floats;
+            for (uint32_t h = 0; h < (1 << 16); ++h)
+            {
+                halves[h] = (uint16_t)h;
+                for (uint32_t bits : { h << 16, (h << 16) | 0x1000, (h << 16) | 0x1001, (h << 16) | 0x2000, (h << 16) | 0xFFFF })
+                {
+                    float f;
+                    memcpy(&f, &bits, sizeof(f));
+                    floats.push_back(f);
+                }
+            }
+
+            // conversion of whole buffer goes through F16C, single value is always converted by scalar code
+            vector<uint16_t> halvesF16C(floats.size());
+            CpuKernels::FloatToHalf(floats.data(), (int)floats.size(), halvesF16C.data());
+            for (size_t i = 0; i < floats.size(); ++i)
+            {
+                uint16_t half;
+                CpuKernels::FloatToHalf(&floats[i], 1, &half);
+                Assert::AreEqual((int)halvesF16C[i], (int)half);
+            }
+
+            vector<float> floatsF16C(halves.size());
+            CpuKernels::HalfToFloat(halves.data(), (int)halves.size(), floatsF16C.data());
+            for (size_t i = 0; i < halves.size(); ++i)
+            {
+                float f;
+                CpuKernels::HalfToFloat(&halves[i], 1, &f);
+                Assert::AreEqual(0, memcmp(&f, &floatsF16C[i], sizeof(f)));
+            }
+        }
+
+        TEST_METHOD(LoadMnistData_MatchesFloatTensors)
+        {
+            const uint32_t IMAGES_NUM = 12, SIZE = 6;
+            {
+                ofstream images("compact_mnist_images.bin", ios::binary);
+                ofstream labels("compact_mnist_labels.bin", ios::binary);
+                WriteBigInt32(images, { 2051, IMAGES_NUM, SIZE, SIZE });
+                WriteBigInt32(labels, { 2049, IMAGES_NUM });
+                for (uint32_t i = 0; i < IMAGES_NUM * SIZE * SIZE; ++i)
+                    images.put((char)GlobalRng().Next(256));
+                for (uint32_t i = 0; i < IMAGES_NUM; ++i)
+                    labels.put((char)(i % 10));
+            }
+
+            Tensor input, output;
+            LoadMnistData("compact_mnist_images.bin", "compact_mnist_labels.bin", input, output, true, false, 10);
+            CompactTensor compactInput, compactOutput;
+            LoadMnistData("compact_mnist_images.bin", "compact_mnist_labels.bin", compactInput, compactOutput, true, 10);
+
+            Assert::IsTrue(compactInput.GetShape() == Shape(SIZE, SIZE, 1, 10));
+            Assert::IsTrue(compactInput.ToTensor().Equals(input, 0.0001f));
+            Assert::IsTrue(compactOutput.ToTensor().Equals(output));
+        }
+
+        TEST_METHOD(LoadCifar10Data_MatchesFloatTensors)
+        {
+            const uint32_t IMAGES_NUM = 5;
+            {
+                ofstream images("compact_cifar.bin", ios::binary);
+                for (uint32_t i = 0; i < IMAGES_NUM; ++i)
+                {
+                    images.put((char)(i * 3 % 10));
+                    for (uint32_t p = 0; p < 3072; ++p)
+                        images.put((char)GlobalRng().Next(256));
+                }
+            }
+
+            Tensor input, output;
+            LoadCifar10Data("compact_cifar.bin", input, output, false);
+            CompactTensor compactInput, compactOutput;
+            LoadCifar10Data("compact_cifar.bin", compactInput, compactOutput, false);
+
+            Assert::IsTrue(compactInput.GetShape() == Shape(32, 32, 3, IMAGES_NUM));
+            Assert::IsTrue(compactInput.ToTensor().Equals(input));
+            Assert::IsTrue(compactOutput.ToTensor().Equals(output));
+        }
+
+        void WriteBigInt32(ostream& stream, const vector<uint32_t>& values)
+        {
+            for (auto value : values)
+            {
+                for (int shift = 24; shift >= 0; shift -= 8)
+                    stream.put((char)((value >> shift) & 0xFF));
+            }
+        }
+
+        TEST_METHOD(Loader_ConsecutiveBatches)
+        {
+            Tensor inputs(Shape(3, 2, 1, 20));
+            Tensor outputs(Shape(2, 1, 1, 20));
+            outputs.Zero();
+            for (uint32_t n = 0; n < inputs.Batch(); ++n)
+            {
+                inputs.FillWithValue((float)n, n * inputs.BatchLength());
+                outputs(n % 2, 0, 0, n) = 1;
+            }
+
+            CompactTensor compactInputs(inputs, COMPACT_UINT8);
+            CompactTensor compactOutputs(outputs, COMPACT_UINT8);
+            CompactTensorLoader loader({ &compactInputs, &compactOutputs }, 8, false);
+
+            vector<Tensor> dest = { Tensor(Shape(3, 2, 1)), Tensor(Shape(2, 1, 1)) };
+            for (uint32_t b = 0; b < 5; ++b)
+            {
+                Assert::AreEqual((size_t)2, loader(dest, 0));
+                for (uint32_t n = 0; n < 8; ++n)
+                {
+                    uint32_t sample = (b * 8 + n) % 20;
+                    Assert::AreEqual((float)sample, dest[0](0, 0, 0, n));
+                    Assert::AreEqual(1.f, dest[1](sample % 2, 0, 0, n));
+                }
+            }
+        }
+    };
+}
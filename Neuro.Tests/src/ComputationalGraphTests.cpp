@@ -99,6 +99,320 @@ namespace NeuroTests
             //Assert::AreEqual(5.0, (double)(*result[0])(0));
         }
 
+        TEST_METHOD(ParallelExecution_CompareWithSequential)
+        {
+            auto x = new Placeholder(Shape(8, 16));
+            auto w = new Variable(Tensor(Shape(4, 8)).FillWithRand());
+
+            // several independent branches sharing the same input
+            vector<TensorLike*> branches;
+            for (int i = 0; i < 6; ++i)
+                branches.push_back(square(add(matmul(x, w), new Constant((float)i))));
+
+            auto y = merge_sum(branches);
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+
+            auto result = Session::Default()->Run({ y }, { {x, &input} });
+            Tensor sequential = *result[0];
+
+            Session::Default()->SetParallelExecution(true);
+            result = Session::Default()->Run({ y }, { {x, &input} });
+            Session::Default()->SetParallelExecution(false);
+
+            Assert::IsTrue(result[0]->Equals(sequential));
+        }
+
+        TEST_METHOD(ParallelExecution_RandomOpsInOrder)
+        {
+            auto x = new Placeholder(Shape(8, 8));
+
+            // random rolls draw from global generator so they have to be computed in the same order as in sequential run
+            vector<TensorLike*> branches;
+            for (int i = 0; i < 6; ++i)
+                branches.push_back(multiply(random_roll(x), (float)(i + 1)));
+
+            auto y = merge_sum(branches);
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+
+            GlobalRngSeed(101);
+            auto result = Session::Default()->Run({ y }, { {x, &input} });
+            Tensor sequential = *result[0];
+
+            GlobalRngSeed(101);
+            Session::Default()->SetParallelExecution(true);
+            result = Session::Default()->Run({ y }, { {x, &input} });
+            Session::Default()->SetParallelExecution(false);
+
+            Assert::IsTrue(result[0]->Equals(sequential));
+        }
+
+        TEST_METHOD(ParallelGradients_CompareWithSequential)
+        {
+            auto x = new Placeholder(Shape(8, 16));
+            auto w = new Variable(Tensor(Shape(4, 8)).FillWithRand());
+
+            vector<TensorLike*> branches;
+            for (int i = 0; i < 6; ++i)
+                branches.push_back(square(add(matmul(x, w), new Constant((float)i))));
+
+            auto grads = gradients(merge_sum(branches), w);
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+
+            auto result = Session::Default()->Run(grads, { {x, &input} });
+            Tensor sequential = *result[0];
+
+            Graph::Default()->ParallelGradients(true);
+            result = Session::Default()->Run(grads, { {x, &input} });
+            Graph::Default()->ParallelGradients(false);
+
+            Assert::IsTrue(result[0]->Equals(sequential));
+        }
+
+        TEST_METHOD(SubtractSelf_ZeroGradient)
+        {
+            auto x = new Variable(2);
+            auto y = sub(x, x);
+
+            auto grads = gradients(y, x);
+
+            auto result = Session::Default()->Run(grads);
+
+            Assert::AreEqual(0.0, (double)(*result[0])(0));
+        }
+
+        TEST_METHOD(MemoryPlanning_Inference_CompareWithDynamic)
+        {
+            auto x = new Placeholder(Shape(8, 16));
+            auto w = new Variable(Tensor(Shape(4, 8)).FillWithRand());
+
+            auto h = negative(relu(add(matmul(x, w), new Constant(0.5f))));
+            auto y = add(h, relu(h));
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+
+            auto result = Session::Default()->Run({ y }, { {x, &input} });
+            Tensor dynamicY = *result[0];
+
+            Session::Default()->SetMemoryPlanning(true);
+            // first run is used to build the plan
+            Session::Default()->Run({ y }, { {x, &input} });
+            result = Session::Default()->Run({ y }, { {x, &input} });
+
+            auto plan = Session::Default()->ActiveMemoryPlan();
+            Assert::IsNotNull(plan);
+            Logger::WriteMessage(plan->ToString().c_str());
+            Assert::IsTrue(plan->InPlaceNum() > 0);
+            Assert::IsTrue(plan->ArenaSize() < plan->TensorsSize());
+            Assert::IsTrue(result[0]->Equals(dynamicY));
+
+            Session::Default()->SetMemoryPlanning(false);
+        }
+
+        TEST_METHOD(MemoryPlanning_Gradients_CompareWithDynamic)
+        {
+            auto x = new Placeholder(Shape(8, 16));
+            auto w = new Variable(Tensor(Shape(4, 8)).FillWithRand());
+
+            auto h = negative(relu(add(matmul(x, w), new Constant(0.5f))));
+            auto y = sum(square(add(h, relu(h))));
+            auto grads = gradients(y, w);
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+
+            auto result = Session::Default()->Run(grads, { {x, &input} });
+            Tensor dynamicGrad = *result[0];
+
+            Session::Default()->SetMemoryPlanning(true);
+            Session::Default()->Run(grads, { {x, &input} });
+            result = Session::Default()->Run(grads, { {x, &input} });
+
+            auto plan = Session::Default()->ActiveMemoryPlan();
+            Assert::IsNotNull(plan);
+            Logger::WriteMessage(plan->ToString().c_str());
+            Assert::IsTrue(plan->ArenaSize() <= plan->TensorsSize());
+            Assert::IsTrue(result[0]->Equals(dynamicGrad));
+
+            Session::Default()->SetMemoryPlanning(false);
+        }
+
+        TEST_METHOD(MemoryPlanning_PeakHostAllocation_LowerThanDynamic)
+        {
+            auto x = new Placeholder(Shape(64, 256));
+            auto w = new Variable(Tensor(Shape(64, 64)).FillWithRand());
+
+            // chain of elementwise operations can be computed in place
+            TensorLike* h = matmul(x, w);
+            for (int i = 0; i < 8; ++i)
+                h = relu(add(h, new Constant(0.1f * i)));
+            auto y = negative(h);
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+            auto& manager = HostMemoryManager::Default();
+
+            Session::Default()->SetMemoryPlanning(true);
+            // first run is used to build the plan
+            Session::Default()->Run({ y }, { {x, &input} });
+            Session::Default()->Run({ y }, { {x, &input} });
+
+            // releasing the plan leaves planned tensors without memory, so both measured runs start from the same state
+            Session::Default()->ActivateMemoryPlan(nullptr);
+            size_t allocatedSize = manager.AllocatedSize();
+            manager.ResetAllocatedPeakSize();
+            auto result = Session::Default()->Run({ y }, { {x, &input} });
+            size_t plannedPeak = manager.AllocatedPeakSize() - allocatedSize;
+            Tensor plannedY = *result[0];
+
+            Session::Default()->SetMemoryPlanning(false);
+            allocatedSize = manager.AllocatedSize();
+            manager.ResetAllocatedPeakSize();
+            result = Session::Default()->Run({ y }, { {x, &input} });
+            size_t dynamicPeak = manager.AllocatedPeakSize() - allocatedSize;
+
+            Logger::WriteMessage(("Peak host allocation planned: " + to_string(plannedPeak) + " dynamic: " + to_string(dynamicPeak)).c_str());
+            Assert::IsTrue(plannedPeak < dynamicPeak);
+            Assert::IsTrue(result[0]->Equals(plannedY));
+        }
+
+        TEST_METHOD(GraphOptimization_BinaryCrossEntropy_CompareWithUnoptimized)
+        {
+            auto target = new Placeholder(Shape(10, 1, 1, 32));
+            auto output = new Placeholder(Shape(10, 1, 1, 32));
+            // constant subgraph is folded
+            auto loss = multiply(BinaryCrossEntropy().Build(target, output), add(new Constant(2.f), new Constant(1.f)));
+
+            auto targetValue = Uniform::Random(0, 1, target->GetShape());
+            auto outputValue = Uniform::Random(0, 1, output->GetShape());
+
+            auto result = Session::Default()->Run({ loss }, { {target, &targetValue}, {output, &outputValue} });
+            Tensor unoptimized = *result[0];
+
+            Session session;
+            session.SetGraphOptimization(true);
+            result = session.Run({ loss }, { {target, &targetValue}, {output, &outputValue} });
+
+            auto stats = session.OptimizationStats({ loss });
+            Logger::WriteMessage(stats.ToString().c_str());
+            Assert::AreEqual(1u, stats.folded);
+            Assert::AreEqual(1u, stats.kernels);
+            Assert::IsTrue(stats.merged > 0);
+            Assert::IsTrue(stats.Eliminated() >= 10);
+            Assert::IsTrue(result[0]->Equals(unoptimized));
+        }
+
+        TEST_METHOD(GraphOptimization_Gradients_CompareWithUnoptimized)
+        {
+            auto x = new Placeholder(Shape(8, 16));
+            auto w = new Variable(Tensor(Shape(4, 8)).FillWithRand());
+
+            // elementwise chain on input doesn't care about gradient so it can be fused even in training order
+            auto xScaled = sigmoid(add(multiply(x, 2.f), new Constant(0.5f)));
+            auto y = sum(square(negative(relu(matmul(xScaled, w)))));
+            auto grads = gradients(y, w);
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+
+            auto result = Session::Default()->Run(grads, { {x, &input} });
+            Tensor unoptimizedGrad = *result[0];
+
+            Session session;
+            session.SetGraphOptimization(true);
+            result = session.Run(grads, { {x, &input} });
+
+            auto stats = session.OptimizationStats(grads);
+            Logger::WriteMessage(stats.ToString().c_str());
+            Assert::AreEqual(1u, stats.kernels);
+            Assert::IsTrue(result[0]->Equals(unoptimizedGrad));
+        }
+
+        TEST_METHOD(BatchNormFolding_Dense_CompareWithUnfolded)
+        {
+            auto x = new Placeholder(Shape(8));
+            auto w = new Variable(Uniform::Random(-1, 1, Shape(4, 8)));
+            auto b = new Variable(Uniform::Random(-1, 1, Shape(4)));
+            auto y = BatchNormalize(add(matmul(x, w), b), Shape(4));
+
+            Predicter predicter({ x }, { y });
+            Assert::AreEqual(1u, predicter.OptimizationStats().batchNorms);
+            TestBatchNormFolding(predicter, x, y, 3);
+
+            // folded parameters have to follow changes of variables
+            w->Output().Mul(2.f, w->Output());
+            Graph::Default()->ParametersChanged();
+            TestBatchNormFolding(predicter, x, y, 3);
+        }
+
+        TEST_METHOD(BatchNormFolding_Conv2D_CompareWithUnfolded)
+        {
+            auto x = new Placeholder(Shape(9, 9, 3));
+            auto kernels = new Variable(Uniform::Random(-1, 1, Shape(3, 3, 3, 5)));
+            auto y = BatchNormalize(conv2d(x, kernels, 2, 1, NCHW), Shape(1, 1, 5));
+
+            Predicter predicter({ x }, { y });
+            Assert::AreEqual(1u, predicter.OptimizationStats().batchNorms);
+            TestBatchNormFolding(predicter, x, y, 2);
+        }
+
+        TEST_METHOD(CompiledPredicter_CompareWithSession)
+        {
+            auto x = new Placeholder(Shape(8));
+            auto w = new Variable(Uniform::Random(-1, 1, Shape(8, 4)));
+            auto b = new Variable(Uniform::Random(-1, 1, Shape(4)));
+            auto w2 = new Variable(Uniform::Random(-1, 1, Shape(3, 4)));
+            auto h = dropout(sigmoid(add(matmul(x, transpose(w)), b)), 0.5f);
+            auto y = matmul(identity(h), w2);
+
+            Predicter predicter({ x }, { y });
+            Assert::IsTrue(predicter.Compile());
+            Assert::AreEqual((size_t)1, predicter.FrozenNum()); // transpose
+            Assert::AreEqual((size_t)2, predicter.StrippedNum()); // dropout and identity
+            Assert::AreEqual((size_t)4, predicter.InstructionsNum());
+
+            // growing batch triggers new memory plan, smaller batches reuse it
+            for (uint32_t batch : { 3u, 5u, 2u, 5u })
+                TestCompiledPredicter(predicter, x, y, batch);
+
+            // session's own memory plan for the same order has to leave frozen outputs alone
+            Session::Default()->SetMemoryPlanning(true);
+            for (int i = 0; i < 3; ++i)
+                TestCompiledPredicter(predicter, x, y, 5);
+            Session::Default()->SetMemoryPlanning(false);
+
+            // frozen operations have to follow changes of variables
+            w->Output().Mul(2.f, w->Output());
+            Graph::Default()->ParametersChanged();
+            TestCompiledPredicter(predicter, x, y, 4);
+        }
+
+        void TestCompiledPredicter(Predicter& predicter, Placeholder* x, TensorLike* y, uint32_t batch)
+        {
+            auto input = Uniform::Random(-1, 1, Shape::From(x->GetShape(), batch));
+
+            Tensor expected = *Session::Default()->Run({ y }, { {x, &input} })[0];
+            auto result = predicter.Predict({ &input });
+            Assert::IsTrue(result[0]->Equals(expected, 0.0001f));
+        }
+
+        TensorLike* BatchNormalize(TensorLike* x, const Shape& paramsShape)
+        {
+            auto gamma = new Variable(Uniform::Random(0.5f, 1.5f, paramsShape));
+            auto beta = new Variable(Uniform::Random(-1, 1, paramsShape));
+            auto runningMean = new Variable(Uniform::Random(-1, 1, paramsShape));
+            auto runningVar = new Variable(Uniform::Random(0.5f, 2, paramsShape));
+            return batch_norm(x, gamma, beta, runningMean, runningVar, 0.9f, 0.001f);
+        }
+
+        void TestBatchNormFolding(Predicter& predicter, Placeholder* x, TensorLike* y, uint32_t batch)
+        {
+            auto input = Uniform::Random(-1, 1, Shape::From(x->GetShape(), batch));
+
+            Tensor unfolded = *Session::Default()->Run({ y }, { {x, &input} })[0];
+            auto result = predicter.Predict({ &input });
+            Assert::IsTrue(result[0]->Equals(unfolded, 0.0001f));
+        }
+
         TEST_CLASS_CLEANUP(OpenMPCrashWorkaround)
         {
             Sleep(100); // this sleep is needed to workaround crash in OpenMP on unloading unit test dll
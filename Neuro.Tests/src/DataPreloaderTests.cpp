@@ -0,0 +1,78 @@
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(DataPreloaderTests)
+    {
+        // Fills destination with number of calls made so far, loading times vary so workers finish out of order
+        struct CountingLoader : public ILoader
+        {
+            CountingLoader(bool reentrant) : m_Reentrant(reentrant) {}
+
+            virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override
+            {
+                int count = m_Count++;
+                this_thread::sleep_for(chrono::milliseconds((count * 7) % 5));
+                dest[loadIdx].OverrideHost();
+                dest[loadIdx].FillWithValue((float)count);
+                return 1;
+            }
+
+            virtual bool Reentrant() const override { return m_Reentrant; }
+
+            atomic<int> m_Count{ 0 };
+            bool m_Reentrant;
+        };
+
+        TEST_METHOD(MultipleWorkers_OrderedDelivery)
+        {
+            Tensor destination(Shape(4));
+            CountingLoader loader(false);
+            DataPreloader preloader({ &destination }, { &loader }, 6, true, 4, true);
+
+            // non-reentrant loader is called in the same order data is delivered
+            for (int i = 0; i < 50; ++i)
+            {
+                preloader.Load();
+                Assert::AreEqual((float)i, destination.Get(0));
+            }
+        }
+
+        TEST_METHOD(MultipleWorkers_UnorderedDelivery)
+        {
+            Tensor destination(Shape(4));
+            CountingLoader loader(true);
+            DataPreloader preloader({ &destination }, { &loader }, 6, true, 4, false);
+
+            set<float> delivered;
+            for (int i = 0; i < 50; ++i)
+            {
+                preloader.Load();
+                delivered.insert(destination.Get(0));
+            }
+            Assert::AreEqual((size_t)50, delivered.size());
+        }
+
+        TEST_METHOD(NonThreaded_Load)
+        {
+            Tensor destination(Shape(4));
+            CountingLoader loader(false);
+            DataPreloader preloader({ &destination }, { &loader }, 2, false);
+
+            for (int i = 0; i < 5; ++i)
+            {
+                preloader.Load();
+                Assert::AreEqual((float)i, destination.Get(0));
+            }
+        }
+    };
+}
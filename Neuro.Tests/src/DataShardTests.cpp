@@ -0,0 +1,108 @@
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(DataShardTests)
+    {
+        TEST_METHOD(SaveShard_Load_ContiguousBatches)
+        {
+            TestLoader(true);
+        }
+
+        TEST_METHOD(SaveShard_Load_RandomSamples)
+        {
+            TestLoader(false);
+        }
+
+        TEST_METHOD(DataShard_Header)
+        {
+            Tensor input(Shape(4, 3, 2, 10)), output(Shape(1, 1, 1, 10));
+            Assert::IsTrue(SaveShard("data_shard_header.shard", { &input, &output }, { SHARD_UINT8, SHARD_FLOAT32 }, NHWC));
+
+            DataShard shard("data_shard_header.shard");
+            Assert::AreEqual((size_t)10, shard.SamplesNum());
+            Assert::IsTrue(shard.DataFormat() == NHWC);
+            Assert::AreEqual((size_t)2, shard.Fields().size());
+            Assert::IsTrue(shard.Fields()[0].shape == Shape(4, 3, 2));
+            Assert::IsTrue(shard.Fields()[0].type == SHARD_UINT8);
+            Assert::AreEqual((size_t)4 * 3 * 2, shard.FieldSampleSizeInBytes(0));
+            Assert::AreEqual((size_t)sizeof(float), shard.FieldSampleSizeInBytes(1));
+        }
+
+        TEST_METHOD(ShardLoader_ContiguousBatches_UniformStarts)
+        {
+            const uint32_t BATCH_SIZE = 32;
+            // shards have 9 and 33 possible batch starts, samples of the second one are numbered from 1000
+            const vector<uint32_t> SHARD_SAMPLES = { 40, 64 };
+            vector<string> files;
+            for (size_t s = 0; s < SHARD_SAMPLES.size(); ++s)
+            {
+                Tensor ids(Shape(1, 1, 1, SHARD_SAMPLES[s]));
+                for (uint32_t n = 0; n < SHARD_SAMPLES[s]; ++n)
+                    ids.Values()[n] = (float)(s * 1000 + n);
+
+                files.push_back("data_shard_starts" + to_string(s) + ".shard");
+                Assert::IsTrue(SaveShard(files.back(), { &ids }, { SHARD_FLOAT32 }));
+            }
+
+            ShardLoader loader(files, BATCH_SIZE, true, 1.f, 11);
+
+            const int DRAWS_PER_START = 1000;
+            map<uint32_t, int> startCounts;
+            vector<Tensor> dest = { Tensor(Shape(1)) };
+            for (int i = 0; i < 42 * DRAWS_PER_START; ++i)
+            {
+                loader(dest, 0);
+                ++startCounts[(uint32_t)dest[0].Values()[0]];
+            }
+
+            // every window is equally likely, including the last one in each shard
+            Assert::AreEqual((size_t)42, startCounts.size());
+            for (auto& count : startCounts)
+            {
+                Assert::IsTrue(count.first % 1000 <= SHARD_SAMPLES[count.first / 1000] - BATCH_SIZE);
+                Assert::IsTrue(abs(count.second - DRAWS_PER_START) < DRAWS_PER_START / 5);
+            }
+        }
+
+        // Every sample of the first field starts with its original index, so it can be verified that fields of the same sample stay together
+        void TestLoader(bool contiguousBatches)
+        {
+            const uint32_t SAMPLES = 1000, BATCH_SIZE = 32;
+            Tensor input(Shape(5, 2, 1, SAMPLES)), output(Shape(3, 1, 1, SAMPLES));
+            for (uint32_t n = 0; n < SAMPLES; ++n)
+            {
+                for (uint32_t i = 0; i < input.BatchLength(); ++i)
+                    input.Values()[n * input.BatchLength() + i] = n + i * 0.25f;
+                for (uint32_t i = 0; i < output.BatchLength(); ++i)
+                    output.Values()[n * output.BatchLength() + i] = (float)((n + i) % 256);
+            }
+
+            Assert::IsTrue(SaveShard("data_shard_test.shard", { &input, &output }, { SHARD_FLOAT32, SHARD_UINT8 }));
+
+            ShardLoader loader({ "data_shard_test.shard" }, BATCH_SIZE, contiguousBatches, 1.f, 7);
+            Assert::AreEqual((size_t)SAMPLES, loader.SamplesNum());
+
+            vector<Tensor> dest = { Tensor(Shape(5, 2)), Tensor(Shape(3)) };
+            for (int i = 0; i < 20; ++i)
+            {
+                Assert::AreEqual((size_t)2, loader(dest, 0));
+                Assert::AreEqual(BATCH_SIZE, dest[0].Batch());
+                Assert::AreEqual(BATCH_SIZE, dest[1].Batch());
+
+                for (uint32_t n = 0; n < BATCH_SIZE; ++n)
+                {
+                    uint32_t id = (uint32_t)dest[0].Get(0, 0, 0, n);
+                    for (uint32_t j = 0; j < dest[0].BatchLength(); ++j)
+                        Assert::AreEqual(id + j * 0.25f, dest[0].Values()[n * dest[0].BatchLength() + j]);
+                    for (uint32_t j = 0; j < dest[1].BatchLength(); ++j)
+                        Assert::AreEqual((float)((id + j) % 256), dest[1].Values()[n * dest[1].BatchLength() + j]);
+                }
+            }
+        }
+    };
+}
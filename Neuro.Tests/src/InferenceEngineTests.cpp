@@ -0,0 +1,51 @@
+#include <future>
+
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(InferenceEngineTests)
+    {
+        TEST_METHOD(CoalescedRequests_CompareWithSession)
+        {
+            auto x = new Placeholder(Shape(6));
+            auto w = new Variable(Uniform::Random(-1, 1, Shape(4, 6)));
+            auto y = sigmoid(matmul(x, w));
+
+            const uint32_t REQUESTS = 20;
+            vector<Tensor> inputs, expected;
+            for (uint32_t i = 0; i < REQUESTS; ++i)
+            {
+                inputs.push_back(Uniform::Random(-1, 1, Shape(6)));
+                expected.push_back(*Session::Default()->Run({ y }, { {x, &inputs.back()} })[0]);
+            }
+
+            InferenceEngineStats stats;
+            {
+                // deadline is long enough for all requests to be queued before it passes
+                InferenceEngine engine({ x }, { y }, 8, 100000);
+
+                vector<future<vector<Tensor>>> results;
+                for (uint32_t i = 0; i < REQUESTS; ++i)
+                    results.push_back(engine.Submit({ &inputs[i] }));
+
+                for (uint32_t i = 0; i < REQUESTS; ++i)
+                {
+                    auto result = results[i].get();
+                    Assert::AreEqual((size_t)1, result.size());
+                    Assert::IsTrue(result[0].Equals(expected[i], 0.0001f));
+                }
+
+                stats = engine.Stats();
+            }
+
+            Assert::AreEqual((uint64_t)REQUESTS, stats.requests);
+            Assert::AreEqual((uint64_t)3, stats.batches);
+            Assert::AreEqual((uint64_t)2, stats.fullBatches);
+        }
+    };
+}
@@ -0,0 +1,248 @@
+#include <future>
+#include <thread>
+#include <unordered_set>
+
+#include "CppUnitTest.h"
+#include "Neuro.h"
+#include "Memory/MemoryTrace.h"
+#include "Memory/SizeClassAllocator.h"
+#include "Windows.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(MemoryManagerTests)
+    {
+        TEST_METHOD(SizeClasses_ClassIndex)
+        {
+            const size_t GRANULARITY = 256;
+            uint32_t prevClassIdx = 0;
+            for (size_t size = 1; size < 1024 * 1024 * 1024; size = size * 3 / 2 + 1)
+            {
+                size_t classSize;
+                uint32_t classIdx = SizeClassAllocator::ClassIndex(size, GRANULARITY, classSize);
+                Assert::IsTrue(classIdx < SizeClassAllocator::CLASSES_NUM);
+                Assert::IsTrue(classIdx >= prevClassIdx);
+                Assert::IsTrue(classSize >= size);
+                Assert::AreEqual((size_t)0, classSize % GRANULARITY);
+                // rounding to size class wastes at most quarter of the block
+                Assert::IsTrue(classSize - size <= max(GRANULARITY, classSize / 4));
+                prevClassIdx = classIdx;
+            }
+        }
+
+        TEST_METHOD(SizeClasses_AllocateFree)
+        {
+            HostMemoryManager manager;
+            manager.SetAllocator(MEM_ALLOCATOR_SIZE_CLASSES);
+            Assert::IsTrue(manager.Allocator() == MEM_ALLOCATOR_SIZE_CLASSES);
+
+            vector<size_t> sizes = { 1, 100, 256, 257, 5000, 70000, 1000000, 50000000 };
+            vector<void*> ptrs;
+            unordered_set<void*> uniquePtrs;
+
+            for (auto size : sizes)
+            {
+                void* ptr = nullptr;
+                Assert::IsTrue(manager.Allocate(&ptr, size) == MEM_STATUS_SUCCESS);
+                Assert::IsNotNull(ptr);
+                memset(ptr, 0xAB, size);
+                ptrs.push_back(ptr);
+                uniquePtrs.insert(ptr);
+            }
+            Assert::AreEqual(sizes.size(), uniquePtrs.size());
+
+            for (auto ptr : ptrs)
+                Assert::IsTrue(manager.Free(ptr) == MEM_STATUS_SUCCESS);
+
+            // released block is reused by next allocation from the same size class
+            void* ptr = nullptr;
+            manager.Allocate(&ptr, 5000);
+            Assert::IsTrue(ptr == ptrs[4]);
+            manager.ScheduleFree(ptr);
+            // scheduled deallocations are processed on next allocation
+            void* otherPtr = nullptr;
+            manager.Allocate(&otherPtr, 4900);
+            Assert::IsTrue(otherPtr == ptr);
+            manager.Free(otherPtr);
+
+            manager.ReleaseAll();
+            manager.SetAllocator(MEM_ALLOCATOR_BEST_FIT);
+        }
+
+        TEST_METHOD(SizeClasses_DirectAllocation)
+        {
+            HostMemoryManager manager;
+            manager.SetAllocator(MEM_ALLOCATOR_SIZE_CLASSES);
+
+            // find the smallest size not fitting in any size class
+            size_t size = 1024 * 1024, classSize;
+            while (SizeClassAllocator::ClassIndex(size, 256, classSize) < SizeClassAllocator::CLASSES_NUM)
+                size = classSize + 1;
+
+            void* ptr = nullptr;
+            Assert::IsTrue(manager.Allocate(&ptr, size) == MEM_STATUS_SUCCESS);
+            Assert::IsNotNull(ptr);
+            Assert::IsTrue(manager.ReservedSize() >= size);
+
+            // block is returned to the system right away and not once again on release
+            Assert::IsTrue(manager.Free(ptr) == MEM_STATUS_SUCCESS);
+            Assert::AreEqual((size_t)0, manager.ReservedSize());
+            manager.ReleaseAll();
+            Assert::AreEqual((size_t)0, manager.ReservedSize());
+            manager.SetAllocator(MEM_ALLOCATOR_BEST_FIT);
+        }
+
+        TEST_METHOD(SizeClasses_ReleaseAllDropsOtherThreadsCaches)
+        {
+            HostMemoryManager manager;
+            manager.SetAllocator(MEM_ALLOCATOR_SIZE_CLASSES);
+
+            promise<void> cached, released;
+            size_t reservedAfterRelease = 0;
+
+            thread worker([&]()
+            {
+                // freed block stays in worker's cache
+                void* ptr = nullptr;
+                manager.Allocate(&ptr, 1000);
+                manager.Free(ptr);
+                cached.set_value();
+
+                released.get_future().wait();
+                // cached block was returned to the system, so new memory has to be reserved
+                manager.Allocate(&ptr, 1000);
+                reservedAfterRelease = manager.ReservedSize();
+                memset(ptr, 0xAB, 1000);
+                manager.Free(ptr);
+            });
+
+            cached.get_future().wait();
+            manager.ReleaseAll();
+            Assert::AreEqual((size_t)0, manager.ReservedSize());
+            released.set_value();
+            worker.join();
+
+            Assert::IsTrue(reservedAfterRelease > 0);
+            manager.ReleaseAll();
+        }
+
+        TEST_METHOD(ReplayTrainingStepTrace_CompareAllocators)
+        {
+            Tensor::SetForcedOpMode(CPU);
+            GlobalRngSeed(100);
+
+            auto x = new Placeholder(Shape(64, 32), "x");
+            auto y = new Placeholder(Shape(10, 32), "y");
+
+            auto w1 = new Variable(Tensor(Shape(128, 64)).FillWithRand(), "w1");
+            auto b1 = new Variable(Tensor(Shape(128)).FillWithRand(), "b1");
+            auto w2 = new Variable(Tensor(Shape(10, 128)).FillWithRand(), "w2");
+
+            auto h = relu(add(matmul(x, w1), b1));
+            auto loss = mean(square(subtract(matmul(h, w2), y)));
+            auto minimizeOp = Adam(0.01f).Minimize({ loss });
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+            auto output = Uniform::Random(-1, 1, y->GetShape());
+
+            // first step allocates optimizer state, trace is captured from the next one
+            Session::Default()->Run({ loss, minimizeOp }, { {x, &input}, {y, &output} });
+
+            MemoryTrace trace;
+            HostMemoryManager::Default().SetTrace(&trace);
+            Session::Default()->Run({ loss, minimizeOp }, { {x, &input}, {y, &output} });
+            HostMemoryManager::Default().SetTrace(nullptr);
+
+            Assert::IsTrue(trace.EventsNum() > 0);
+
+            const int REPEATS = 200;
+            MemTraceReplayStats bestFitStats = ReplayTrace(trace, MEM_ALLOCATOR_BEST_FIT, REPEATS);
+            MemTraceReplayStats sizeClassesStats = ReplayTrace(trace, MEM_ALLOCATOR_SIZE_CLASSES, REPEATS);
+
+            Logger::WriteMessage(("Best fit: " + bestFitStats.ToString()).c_str());
+            Logger::WriteMessage(("Size classes: " + sizeClassesStats.ToString()).c_str());
+            Assert::AreEqual(bestFitStats.eventsNum, sizeClassesStats.eventsNum);
+        }
+
+        TEST_METHOD(Trace_SaveLoadExport)
+        {
+            Tensor::SetForcedOpMode(CPU);
+
+            auto x = new Placeholder(Shape(16, 8), "x");
+            auto y = relu(negative(x, "neg"), "relu");
+
+            auto input = Uniform::Random(-1, 1, x->GetShape());
+
+            MemoryTrace trace;
+            HostMemoryManager::Default().SetTrace(&trace);
+            Session::Default()->Run({ y }, { {x, &input} });
+            HostMemoryManager::Default().SetTrace(nullptr);
+
+            auto events = trace.Events();
+            Assert::IsFalse(events.empty());
+
+            // allocations made while computing operation are tagged with its name
+            bool opNameFound = false;
+            for (auto& e : events)
+                opNameFound |= e.alloc && trace.Name(e.opNameId) == "relu";
+            Assert::IsTrue(opNameFound);
+
+            Assert::IsTrue(trace.Save("memory_trace.txt"));
+            Assert::IsTrue(trace.ExportChromeTrace("memory_trace.json"));
+
+            MemoryTrace loadedTrace;
+            Assert::IsTrue(loadedTrace.Load("memory_trace.txt"));
+            auto loadedEvents = loadedTrace.Events();
+            Assert::AreEqual(events.size(), loadedEvents.size());
+            for (size_t i = 0; i < events.size(); ++i)
+            {
+                Assert::IsTrue(events[i].ptr == loadedEvents[i].ptr);
+                Assert::AreEqual(events[i].size, loadedEvents[i].size);
+                Assert::AreEqual(events[i].alloc, loadedEvents[i].alloc);
+                Assert::IsTrue(trace.Name(events[i].annotationId) == loadedTrace.Name(loadedEvents[i].annotationId));
+            }
+        }
+
+        TEST_METHOD(Trace_RingBuffer)
+        {
+            MemoryTrace trace(3);
+            for (size_t i = 1; i <= 5; ++i)
+                trace.Record((void*)i, i, true, "");
+
+            // only the most recent events are kept
+            auto events = trace.Events();
+            Assert::AreEqual((size_t)3, events.size());
+            Assert::AreEqual((size_t)3, events[0].size);
+            Assert::AreEqual((size_t)5, events[2].size);
+
+            // names referred only by dropped events are dropped as well
+            for (size_t i = 0; i < 1000; ++i)
+            {
+                string opName = "op" + to_string(i % 7);
+                MemoryTrace::OpScope opScope(opName);
+                trace.Record((void*)i, i, true, "block" + to_string(i));
+            }
+            Assert::IsTrue(trace.NamesNum() <= 4 * 3 + 1);
+            events = trace.Events();
+            Assert::AreEqual(string("block999"), trace.Name(events[2].annotationId));
+            Assert::AreEqual(string("op5"), trace.Name(events[2].opNameId));
+        }
+
+        MemTraceReplayStats ReplayTrace(const MemoryTrace& trace, EMemAllocator allocator, int repeats)
+        {
+            HostMemoryManager manager;
+            manager.SetAllocator(allocator);
+            auto stats = trace.Replay(manager, repeats);
+            manager.ReleaseAll();
+            return stats;
+        }
+
+        TEST_CLASS_CLEANUP(OpenMPCrashWorkaround)
+        {
+            Sleep(100); // this sleep is needed to workaround crash in OpenMP on unloading unit test dll
+        };
+    };
+}
@@ -23,6 +23,70 @@ namespace NeuroTests
             TestDenseNetwork(2, 50, -1, 200);
         }
 
+        TEST_METHOD(SaveWeights_LoadWeights_Native)
+        {
+            auto model = new Sequential("save_test", 7);
+            model->AddLayer(new Dense(2, 5));
+            model->AddLayer(new Dense(3));
+            model->Optimize(new SGD(0.02f), new MeanSquareError());
+
+            Tensor inputs(Shape(2, 1, 1, 10));
+            inputs.FillWithRand(10, -2, 2);
+            Tensor outputs = *model->Predict(inputs)[0];
+            model->SaveWeights("model_tmp.bin");
+
+            auto model2 = new Sequential("load_test", 8);
+            model2->AddLayer(new Dense(2, 5));
+            model2->AddLayer(new Dense(3));
+            model2->Optimize(new SGD(0.02f), new MeanSquareError());
+            model2->LoadWeights("model_tmp.bin");
+
+            Assert::IsTrue(outputs.Equals(*model2->Predict(inputs)[0]));
+        }
+
+        // Provides consecutive batches of samples (inputs followed by outputs), wrapping around at the end
+        struct BatchLoader : public ILoader
+        {
+            BatchLoader(const Tensor& inputs, const Tensor& outputs, uint32_t batchSize) : m_Inputs(inputs), m_Outputs(outputs), m_BatchSize(batchSize) {}
+
+            virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override
+            {
+                vector<uint32_t> batchIds(m_BatchSize);
+                for (auto& id : batchIds)
+                    id = m_NextSample++ % m_Inputs.Batch();
+
+                dest[loadIdx].ResizeBatch(m_BatchSize);
+                dest[loadIdx + 1].ResizeBatch(m_BatchSize);
+                m_Inputs.GetBatches(batchIds, dest[loadIdx]);
+                m_Outputs.GetBatches(batchIds, dest[loadIdx + 1]);
+                return 2;
+            }
+
+            const Tensor& m_Inputs;
+            const Tensor& m_Outputs;
+            uint32_t m_BatchSize;
+            uint32_t m_NextSample = 0;
+        };
+
+        TEST_METHOD(Dense_Network_Fit_Async)
+        {
+            auto model = new Sequential("async_dense_test", 7);
+            model->AddLayer(new Dense(2, 5));
+            model->AddLayer(new Dense(4));
+            model->AddLayer(new Dense(2));
+
+            Tensor inputs(Shape::From(model->Layer(0)->InputShapesAt(-1)[0], 50));
+            inputs.FillWithRand(10, -2, 2);
+            Tensor outputs = inputs.Mul(1.7f);
+
+            model->Optimize(new SGD(0.02f), new MeanSquareError(), {}, Nothing);
+            BatchLoader loader(inputs, outputs, 10);
+            model->Fit({ &loader }, 5, 150, 0, 4, 2);
+
+            Assert::IsTrue(outputs.Equals(*model->Predict(inputs)[0], 0.02f));
+            Assert::AreEqual(750u, model->LastTrainingTimings().steps);
+        }
+
         ModelBase* CreateFitTestNet()
         {
             auto model = new Sequential("fit_test", 7);
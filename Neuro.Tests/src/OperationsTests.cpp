@@ -329,6 +329,57 @@ namespace NeuroTests
             auto x = Variable(Shape(2, 3, 4, 2));
             Assert::IsTrue(ValidateOperation(unique_ptr<Operation>(new ReshapeOp(&x, Shape(2,4,3,2))).get()));
         }
+
+        TEST_METHOD(SoftmaxCrossEntropy)
+        {
+            auto target = Variable(Shape(5, 1, 1, 3));
+            auto logits = Variable(Shape(5, 1, 1, 3));
+            Assert::IsTrue(ValidateOperation(unique_ptr<Operation>(new SoftmaxCrossEntropyOp(&target, &logits)).get()));
+        }
+
+        TEST_METHOD(SoftmaxCrossEntropy_CompareWithSoftmax)
+        {
+            Tensor logits = Uniform::Random(-5, 5, Shape(10, 1, 1, 3));
+            Tensor target(Shape(10, 1, 1, 3));
+            target.Zero();
+            for (uint32_t n = 0; n < target.Batch(); ++n)
+                target(n * 3, 0, 0, n) = 1;
+
+            Tensor probabilities(logits.GetShape()), loss(Shape(1, 1, 1, 3));
+            logits.SoftmaxCrossEntropy(target, probabilities, loss);
+
+            Tensor softmax(logits.GetShape());
+            logits.Softmax(softmax);
+            Assert::IsTrue(probabilities.Equals(softmax));
+            for (uint32_t n = 0; n < target.Batch(); ++n)
+                Assert::AreEqual(-log(softmax(n * 3, 0, 0, n)), loss(0, 0, 0, n), 1e-4f);
+        }
+
+        TEST_METHOD(SigmoidCrossEntropy)
+        {
+            auto target = Variable(Shape(2, 3, 4, 2));
+            auto logits = Variable(Shape(2, 3, 4, 2));
+            Assert::IsTrue(ValidateOperation(unique_ptr<Operation>(new SigmoidCrossEntropyOp(&target, &logits)).get()));
+        }
+
+        TEST_METHOD(SigmoidCrossEntropy_CompareWithBinaryCrossEntropy)
+        {
+            auto target = new Placeholder(Shape(6, 1, 1, 4));
+            auto logits = new Placeholder(Shape(6, 1, 1, 4));
+            auto output = sigmoid(logits);
+
+            auto fusedLoss = Neuro::SigmoidCrossEntropy().Build(target, output);
+            auto loss = BinaryCrossEntropy().Build(target, output);
+            // when output is not produced by sigmoid loss is computed from probabilities
+            auto fallbackLoss = Neuro::SigmoidCrossEntropy().Build(target, multiply(output, new Constant(1.f)));
+
+            auto targetValue = Uniform::Random(0, 1, target->GetShape());
+            auto logitsValue = Uniform::Random(-4, 4, logits->GetShape());
+            auto result = Session::Default()->Run({ fusedLoss, loss, fallbackLoss }, { {target, &targetValue}, {logits, &logitsValue} });
+
+            Assert::IsTrue(result[0]->Equals(*result[1], 1e-4f));
+            Assert::IsTrue(result[2]->Equals(*result[1], 1e-4f));
+        }
         
         //////////////////////////////////////////////////////////////////////////
         static bool ValidateOperation(Operation* op, bool onlyPositiveInputs = false, const vector<bool>& ignoreInput = {})
@@ -0,0 +1,217 @@
+﻿#include "CppUnitTest.h"
+#include "Neuro.h"
+#include "Windows.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(TensorOpCpuIm2ColTests)
+    {
+        TEST_METHOD(Conv2D_Valid_CompareWithCpuResult)
+        {
+            Tensor t(Shape(26, 26, 3, 3)); t.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 2)); kernels.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t.Conv2D(kernels, 1, 0, NCHW);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            NEURO_PROFILE("CPU_IM2COL", Tensor r2 = t.Conv2D(kernels, 1, 0, NCHW);)
+
+            Assert::IsTrue(r.Equals(r2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2D_Same_CompareWithCpuResult)
+        {
+            Tensor t(Shape(26, 26, 3, 3)); t.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 4)); kernels.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t.Conv2D(kernels, 1, 1, NCHW);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            NEURO_PROFILE("CPU_IM2COL", Tensor r2 = t.Conv2D(kernels, 1, 1, NCHW);)
+
+            Assert::IsTrue(r.Equals(r2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2D_Stride2_Padding2_CompareWithCpuResult)
+        {
+            Tensor t(Shape(27, 27, 3, 3)); t.FillWithRand();
+            Tensor kernels(Shape(5, 5, 3, 4)); kernels.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t.Conv2D(kernels, 2, 2, NCHW);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            NEURO_PROFILE("CPU_IM2COL", Tensor r2 = t.Conv2D(kernels, 2, 2, NCHW);)
+
+            Assert::IsTrue(r.Equals(r2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2D_Valid_NHWC_CompareWithCpuResult)
+        {
+            Tensor t(Shape(3, 26, 26, 3)); t.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 2)); kernels.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t.Conv2D(kernels, 1, 0, NHWC);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            NEURO_PROFILE("CPU_IM2COL", Tensor r2 = t.Conv2D(kernels, 1, 0, NHWC);)
+
+            Assert::IsTrue(r.Equals(r2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2D_Stride2_Padding2_NHWC_CompareWithCpuResult)
+        {
+            Tensor t(Shape(3, 27, 27, 3)); t.FillWithRand();
+            Tensor kernels(Shape(5, 5, 3, 4)); kernels.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t.Conv2D(kernels, 2, 2, NHWC);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            NEURO_PROFILE("CPU_IM2COL", Tensor r2 = t.Conv2D(kernels, 2, 2, NHWC);)
+
+            Assert::IsTrue(r.Equals(r2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2DBiasActivation_CompareWithCpuResult)
+        {
+            Tensor t(Shape(26, 26, 3, 3)); t.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 4)); kernels.FillWithRand();
+            Tensor bias(Shape(1, 1, 4)); bias.FillWithRand();
+
+            for (auto activation : { _Identity, _Sigmoid, _ReLU, _TanH, _ELU, _LeakyReLU })
+            {
+                Tensor::SetForcedOpMode(CPU);
+                Tensor r = t.Conv2D(kernels, 1, 1, NCHW).Add(bias);
+                r.Activation(activation, 0.2f, r);
+
+                Tensor::SetForcedOpMode(CPU_IM2COL);
+                NEURO_PROFILE("CPU_IM2COL", Tensor r2 = t.Conv2DBiasActivation(kernels, 1, 1, bias, activation, 0.2f);)
+
+                Assert::IsTrue(r.Equals(r2, 0.0001f));
+            }
+        }
+
+        TEST_METHOD(Conv2DInputGradient_CompareWithCpuResult)
+        {
+            Tensor output(Shape(24, 24, 2, 3)); output.FillWithRand();
+            Tensor input(Shape(26, 26, 3, 3)); input.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 2)); kernels.FillWithRand();
+            Tensor gradient(output); gradient.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            Tensor inputGradient(input);
+            NEURO_PROFILE("CPU", gradient.Conv2DInputsGradient(gradient, kernels, 1, 0, NCHW, inputGradient);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            Tensor inputGradient2(input);
+            NEURO_PROFILE("CPU_IM2COL", gradient.Conv2DInputsGradient(gradient, kernels, 1, 0, NCHW, inputGradient2);)
+
+            Assert::IsTrue(inputGradient.Equals(inputGradient2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2DInputGradient_Stride2_Padding1_CompareWithCpuResult)
+        {
+            Tensor output(Shape(13, 13, 4, 3)); output.FillWithRand();
+            Tensor input(Shape(26, 26, 3, 3)); input.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 4)); kernels.FillWithRand();
+            Tensor gradient(output); gradient.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            Tensor inputGradient(input);
+            NEURO_PROFILE("CPU", gradient.Conv2DInputsGradient(gradient, kernels, 2, 1, NCHW, inputGradient);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            Tensor inputGradient2(input);
+            NEURO_PROFILE("CPU_IM2COL", gradient.Conv2DInputsGradient(gradient, kernels, 2, 1, NCHW, inputGradient2);)
+
+            Assert::IsTrue(inputGradient.Equals(inputGradient2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2DInputGradient_NHWC_CompareWithCpuResult)
+        {
+            Tensor output(Shape(2, 24, 24, 3)); output.FillWithRand();
+            Tensor input(Shape(3, 26, 26, 3)); input.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 2)); kernels.FillWithRand();
+            Tensor gradient(output); gradient.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            Tensor inputGradient(input);
+            NEURO_PROFILE("CPU", gradient.Conv2DInputsGradient(gradient, kernels, 1, 0, NHWC, inputGradient);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            Tensor inputGradient2(input);
+            NEURO_PROFILE("CPU_IM2COL", gradient.Conv2DInputsGradient(gradient, kernels, 1, 0, NHWC, inputGradient2);)
+
+            Assert::IsTrue(inputGradient.Equals(inputGradient2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2DKernelsGradient_CompareWithCpuResult)
+        {
+            Tensor output(Shape(24, 24, 2, 3)); output.FillWithRand();
+            Tensor input(Shape(26, 26, 3, 3)); input.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 2)); kernels.FillWithRand();
+            Tensor gradient(output); gradient.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            Tensor kernelsGradient(kernels);
+            NEURO_PROFILE("CPU", input.Conv2DKernelsGradient(input, gradient, 1, 0, NCHW, kernelsGradient);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            Tensor kernelsGradient2(kernels);
+            NEURO_PROFILE("CPU_IM2COL", input.Conv2DKernelsGradient(input, gradient, 1, 0, NCHW, kernelsGradient2);)
+
+            // accumulation order differs from reference implementation
+            Assert::IsTrue(kernelsGradient.Equals(kernelsGradient2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2DKernelsGradient_Stride2_Padding1_CompareWithCpuResult)
+        {
+            Tensor output(Shape(13, 13, 4, 3)); output.FillWithRand();
+            Tensor input(Shape(26, 26, 3, 3)); input.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 4)); kernels.FillWithRand();
+            Tensor gradient(output); gradient.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            Tensor kernelsGradient(kernels);
+            NEURO_PROFILE("CPU", input.Conv2DKernelsGradient(input, gradient, 2, 1, NCHW, kernelsGradient);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            Tensor kernelsGradient2(kernels);
+            NEURO_PROFILE("CPU_IM2COL", input.Conv2DKernelsGradient(input, gradient, 2, 1, NCHW, kernelsGradient2);)
+
+            // accumulation order differs from reference implementation
+            Assert::IsTrue(kernelsGradient.Equals(kernelsGradient2, 0.0001f));
+        }
+
+        TEST_METHOD(Conv2DKernelsGradient_NHWC_CompareWithCpuResult)
+        {
+            Tensor output(Shape(2, 24, 24, 3)); output.FillWithRand();
+            Tensor input(Shape(3, 26, 26, 3)); input.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 2)); kernels.FillWithRand();
+            Tensor gradient(output); gradient.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            Tensor kernelsGradient(kernels);
+            NEURO_PROFILE("CPU", input.Conv2DKernelsGradient(input, gradient, 1, 0, NHWC, kernelsGradient);)
+
+            Tensor::SetForcedOpMode(CPU_IM2COL);
+            Tensor kernelsGradient2(kernels);
+            NEURO_PROFILE("CPU_IM2COL", input.Conv2DKernelsGradient(input, gradient, 1, 0, NHWC, kernelsGradient2);)
+
+            // accumulation order differs from reference implementation
+            Assert::IsTrue(kernelsGradient.Equals(kernelsGradient2, 0.0001f));
+        }
+
+        TEST_CLASS_CLEANUP(OpenMPCrashWorkaround)
+        {
+            Sleep(100);
+        };
+    };
+}
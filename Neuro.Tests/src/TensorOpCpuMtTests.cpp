@@ -23,6 +23,33 @@ namespace NeuroTests
             Assert::IsTrue(r.Equals(r2));
         }
 
+        TEST_METHOD(MatMul_Transposed_CompareWithCpuResult)
+        {
+            Tensor t1(Shape(40, 82, 3, 5)); t1.FillWithRand();
+            Tensor t2(Shape(82, 40, 3)); t2.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t1.MatMul(true, t2, true);)
+
+            Tensor::SetForcedOpMode(CPU_MT);
+            NEURO_PROFILE("CPU_MT", Tensor r2 = t1.MatMul(true, t2, true);)
+
+            Assert::IsTrue(r.Equals(r2));
+        }
+
+        TEST_METHOD(Transpose_CompareWithCpuResult)
+        {
+            Tensor t(Shape(70, 45, 3, 5)); t.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t.Transpose();)
+
+            Tensor::SetForcedOpMode(CPU_MT);
+            NEURO_PROFILE("CPU_MT", Tensor r2 = t.Transpose();)
+
+            Assert::IsTrue(r.Equals(r2));
+        }
+
         TEST_METHOD(Add_SameDims_CompareWithCpuResult)
         {
             Tensor t1(Shape(20, 30, 40, 50)); t1.FillWithRand();
@@ -146,6 +173,19 @@ namespace NeuroTests
             Assert::IsTrue(r.Equals(r2));
         }
 
+        TEST_METHOD(Sum_WidthAxis_CompareWithCpuResult)
+        {
+            Tensor t(Shape(20, 30, 40, 50)); t.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t.Sum(WidthAxis);)
+
+            Tensor::SetForcedOpMode(CPU_MT);
+            NEURO_PROFILE("CPU_MT", Tensor r2 = t.Sum(WidthAxis);)
+
+            Assert::IsTrue(r.Equals(r2));
+        }
+
         TEST_METHOD(Sum_GlobalAxis_CompareWithCpuResult)
         {
             Tensor t(Shape(20, 30, 40, 50)); t.FillWithRand();
@@ -156,7 +196,8 @@ namespace NeuroTests
             Tensor::SetForcedOpMode(CPU_MT);
             NEURO_PROFILE("CPU_MT", Tensor r2 = t.Sum(GlobalAxis);)
 
-            Assert::IsTrue(r.Equals(r2));
+            // partial sums are accumulated in different order than in sequential implementation
+            Assert::IsTrue(r.Equals(r2, 0.01f));
         }
 
         TEST_METHOD(Div_CompareWithCpuResult)
@@ -187,6 +228,19 @@ namespace NeuroTests
             Assert::IsTrue(r.Equals(r2));
         }
 
+        TEST_METHOD(UpSample2D_CompareWithCpuResult)
+        {
+            Tensor t(Shape(20, 30, 4, 5)); t.FillWithRand();
+
+            Tensor::SetForcedOpMode(CPU);
+            NEURO_PROFILE("CPU", Tensor r = t.UpSample2D(2);)
+
+            Tensor::SetForcedOpMode(CPU_MT);
+            NEURO_PROFILE("CPU_MT", Tensor r2 = t.UpSample2D(2);)
+
+            Assert::IsTrue(r.Equals(r2));
+        }
+
         TEST_METHOD(Softmax_CompareWithCpuResult)
         {
             Tensor t(Shape(20, 30, 1, 10)); t.FillWithRand(-1, -10, 10);
@@ -243,6 +297,27 @@ namespace NeuroTests
             Assert::IsTrue(r.Equals(r2));
         }*/
 
+        TEST_METHOD(Conv2DBiasActivation_CompareWithCpuResult)
+        {
+            Tensor t(Shape(26, 26, 3, 3)); t.FillWithRand();
+            Tensor kernels(Shape(3, 3, 3, 4)); kernels.FillWithRand();
+            Tensor bias(Shape(1, 1, 4)); bias.FillWithRand();
+
+            for (auto activation : { _Identity, _Sigmoid, _ReLU, _TanH, _ELU, _LeakyReLU })
+            {
+                Tensor::SetForcedOpMode(CPU);
+                Tensor r = t.Conv2D(kernels, 1, 1, NCHW).Add(bias);
+                r.Activation(activation, 0.2f, r);
+                Tensor r1 = t.Conv2DBiasActivation(kernels, 1, 1, bias, activation, 0.2f);
+
+                Tensor::SetForcedOpMode(CPU_MT);
+                NEURO_PROFILE("CPU_MT", Tensor r2 = t.Conv2DBiasActivation(kernels, 1, 1, bias, activation, 0.2f);)
+
+                Assert::IsTrue(r.Equals(r1));
+                Assert::IsTrue(r.Equals(r2));
+            }
+        }
+
         TEST_METHOD(Conv2DInputGradient_CompareWithCpuResult)
         {
             Tensor output(Shape(24, 24, 2, 3)); output.FillWithRand();
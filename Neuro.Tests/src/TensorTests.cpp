@@ -237,6 +237,30 @@ namespace NeuroTests
                 Assert::AreEqual((double)result.GetFlat(i), (double)t1.GetFlat(i) * t2.GetFlat(i), 1e-5);
         }
 
+        TEST_METHOD(MulElem_BroadcastDepth_LeftOperand)
+        {
+            auto t1 = Tensor(Shape(1, 1, 4, 1)); t1.FillWithRand();
+            auto t2 = Tensor(Shape(20, 30, 4, 5)); t2.FillWithRand();
+
+            auto result = t1.MulElem(t2);
+            for (uint32_t n = 0; n < t2.Batch(); ++n)
+            for (uint32_t d = 0; d < t2.Depth(); ++d)
+            for (uint32_t h = 0; h < t2.Height(); ++h)
+            for (uint32_t w = 0; w < t2.Width(); ++w)
+                Assert::AreEqual((double)result.Get(w, h, d, n), (double)t1.Get(0, 0, d, 0) * t2.Get(w, h, d, n), 1e-5);
+        }
+
+        TEST_METHOD(Div_BroadcastBatch)
+        {
+            auto t1 = Tensor(Shape(20, 30, 4, 5)); t1.FillWithRange(1);
+            auto t2 = Tensor(Shape(20, 30, 4, 1)); t2.FillWithRange(1);
+            auto result = Tensor(t1.GetShape());
+
+            t1.Div(t2, result);
+            for (uint32_t i = 0; i < t1.GetShape().Length; ++i)
+                Assert::AreEqual((double)result.GetFlat(i), (double)t1.GetFlat(i) / t2.GetFlat(i % t2.GetShape().Length), 1e-4);
+        }
+
         TEST_METHOD(MatMul_TT)
         {
             Tensor::SetDefaultOpMode(EOpMode::CPU);
@@ -349,6 +373,22 @@ namespace NeuroTests
             Assert::IsTrue(r.Equals(correct));
         }
 
+        TEST_METHOD(MatMul_Transposed_OddSizes_CompareWithExplicitTranspose)
+        {
+            Tensor::SetDefaultOpMode(EOpMode::CPU);
+
+            // sizes are chosen so that none of them is a multiple of GEMM blocking/tile sizes
+            Tensor a = Tensor(Shape(301, 133, 2, 3)); a.FillWithRand();
+            Tensor b = Tensor(Shape(301, 1037, 2)); b.FillWithRand();
+
+            Tensor r = a.MatMul(false, b, true);
+            Tensor correct = a.MatMul(b.Transpose());
+            Assert::IsTrue(r.Equals(correct, 0.0001f));
+
+            Tensor r2 = a.Transpose().MatMul(true, b, true);
+            Assert::IsTrue(r2.Equals(correct, 0.0001f));
+        }
+
         TEST_METHOD(Conv2D_Valid_1Kernel_1Batch)
         {
             Tensor::SetDefaultOpMode(EOpMode::CPU);
@@ -1341,7 +1381,59 @@ namespace NeuroTests
             Assert::IsTrue(t.Equals(t2, 0.01f));
         }*/
 
-        /*TEST_METHOD(Save_Load)
+        TEST_METHOD(Image_LoadWithPreprocessing)
+        {
+            // odd width so both vectorized and remaining pixels are converted
+            Tensor t(Shape(37, 5, 3));
+            for (uint32_t i = 0; i < t.Length(); ++i)
+                t.Values()[i] = (float)GlobalRng().Next(256);
+            SaveImage(t, "test_pixels.png", false);
+
+            Tensor loaded = LoadImage("test_pixels.png");
+            Assert::IsTrue(t.Equals(loaded));
+
+            Tensor preprocessed = LoadImage("test_pixels.png", 0, 0, 0, 0, NCHW, VGG16::CHANNEL_MEANS, true);
+            Assert::IsTrue(VGG16::PreprocessImageCopy(t, NCHW).Equals(preprocessed, 0.0001f));
+
+            Tensor nhwc = LoadImage("test_pixels.png", 0, 0, 0, 0, NHWC);
+            Assert::IsTrue(t.ToNHWC().Equals(nhwc));
+        }
+
+        TEST_METHOD(Image_Augmentation)
+        {
+            // odd width so both vectorized and remaining pixels are flipped
+            Tensor t(Shape(37, 5, 3));
+            for (uint32_t i = 0; i < t.Length(); ++i)
+                t.Values()[i] = (float)GlobalRng().Next(256);
+            SaveImage(t, "test_augmentation.png", false);
+
+            Random rng(13);
+            Tensor flipped(t.GetShape());
+            ImageAugmentation().HorizontalFlip(1.f).Normalize(VGG16::CHANNEL_MEANS, true).Apply("test_augmentation.png", t.Width(), t.Height(), rng, flipped.Values());
+
+            Tensor expected = VGG16::PreprocessImageCopy(t, NCHW);
+            for (uint32_t c = 0; c < 3; ++c)
+            for (uint32_t h = 0; h < t.Height(); ++h)
+            for (uint32_t w = 0; w < t.Width(); ++w)
+                Assert::AreEqual((double)expected.Get(t.Width() - w - 1, h, c), (double)flipped.Get(w, h, c), 0.0001);
+
+            // without jitter color transformation is identity, crop of the same size is the whole image
+            Tensor cropped(t.GetShape());
+            ImageAugmentation().RandomCrop().ColorJitter(0, 0.f, 0.f).Apply("test_augmentation.png", t.Width(), t.Height(), rng, cropped.Values());
+            Assert::IsTrue(t.Equals(cropped));
+
+            Tensor brighter(t.GetShape());
+            ImageAugmentation().ColorJitter(50.f, 0.f).Apply("test_augmentation.png", t.Width(), t.Height(), rng, brighter.Values());
+            // offset can be read only from value which wasn't saturated
+            uint32_t ref = 0;
+            while (t.Values()[ref] < 50 || t.Values()[ref] > 205)
+                ++ref;
+            float offset = brighter.Values()[ref] - t.Values()[ref];
+            for (uint32_t i = 0; i < t.Length(); ++i)
+                Assert::AreEqual((double)min(max(t.Values()[i] + offset, 0.f), 255.f), (double)brighter.Values()[i], 1.0);
+        }
+
+        TEST_METHOD(Save_Load)
         {
             auto t = Tensor(Shape(5, 4, 3, 2), "1337");
             t.FillWithRand();
@@ -1352,9 +1444,61 @@ namespace NeuroTests
             ostream.close();
 
             ifstream istream(filename, ios::in | ios::binary);
-            Assert::IsTrue(t.Equals(Tensor(istream)));
+            Tensor loaded(istream);
+            Assert::IsTrue(t.Equals(loaded));
+            Assert::IsTrue(t.Name() == loaded.Name());
             istream.close();
-        }*/
+        }
+
+        TEST_METHOD(TensorFile_MappedLoad)
+        {
+            auto t1 = Tensor(Shape(5, 4, 3, 2), "t1");
+            t1.FillWithRand();
+            auto t2 = Tensor(Shape(7), "t2");
+            t2.FillWithRand();
+
+            string filename = "tensors_tmp.bin";
+            Assert::IsTrue(TensorFile::Save(filename, { &t1, &t2 }));
+
+            TensorFile file(filename);
+            Assert::IsTrue(file.IsValid());
+            Assert::AreEqual((size_t)2, file.TensorsNum());
+            Assert::AreEqual(1, file.Find("t2"));
+
+            Tensor mapped;
+            file.Load(0, mapped);
+            Assert::IsTrue(mapped.GetShape() == t1.GetShape());
+            Assert::IsTrue(t1.Equals(mapped));
+            Assert::IsTrue(mapped.Values() == file.Data(0));
+
+            Tensor copied;
+            file.Load(1, copied, false);
+            Assert::IsTrue(t2.Equals(copied));
+            Assert::IsTrue(copied.Values() != file.Data(1));
+        }
+
+        TEST_METHOD(TensorFile_VerifyChecksum)
+        {
+            auto t = Tensor(Shape(16), "t");
+            t.FillWithRand();
+
+            string filename = "tensors_checksum_tmp.bin";
+            Assert::IsTrue(TensorFile::Save(filename, { &t }));
+            Assert::IsTrue(TensorFile(filename, true).IsValid());
+
+            // flip bits of the last data byte
+            {
+                fstream stream(filename, ios::in | ios::out | ios::binary);
+                stream.seekg(-1, ios::end);
+                char last = (char)stream.get();
+                stream.seekp(-1, ios::end);
+                stream.put(~last);
+            }
+
+            // checksum is verified only on request
+            Assert::IsTrue(TensorFile(filename).IsValid());
+            Assert::IsFalse(TensorFile(filename, true).IsValid());
+        }
 
         TEST_CLASS_CLEANUP(OpenMPCrashWorkaround)
         {
@@ -0,0 +1,54 @@
+#include <atomic>
+#include <stdexcept>
+
+#include "CppUnitTest.h"
+#include "Neuro.h"
+#include "ThreadPool.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+
+namespace NeuroTests
+{
+    TEST_CLASS(ThreadPoolTests)
+    {
+        TEST_METHOD(ParallelFor_CoversWholeRange)
+        {
+            ThreadPool pool(4);
+            atomic<uint64_t> sum(0);
+
+            for (int r = 0; r < 50; ++r)
+                pool.ParallelFor(0, 1000, 10, [&](uint32_t begin, uint32_t end) { for (uint32_t i = begin; i < end; ++i) sum += i; });
+
+            Assert::AreEqual((uint64_t)50 * 499500, sum.load());
+        }
+
+        TEST_METHOD(ParallelFor_ExceptionRethrownAfterAllChunks)
+        {
+            ThreadPool pool(4);
+
+            for (int r = 0; r < 20; ++r)
+            {
+                atomic<uint32_t> processed(0);
+                bool caught = false;
+                try
+                {
+                    pool.ParallelFor(0, 64, 1, [&](uint32_t begin, uint32_t end)
+                    {
+                        if (begin <= 13 && 13 < end)
+                            throw runtime_error("chunk failed");
+                        processed += end - begin;
+                    });
+                }
+                catch (const runtime_error&)
+                {
+                    caught = true;
+                }
+
+                Assert::IsTrue(caught);
+                // remaining chunks were processed before exception left ParallelFor
+                Assert::IsTrue(processed.load() >= 60u && processed.load() < 64u);
+            }
+        }
+    };
+}
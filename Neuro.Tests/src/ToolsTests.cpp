@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <experimental/filesystem>
+#include <fstream>
+#include <sstream>
+#include "CppUnitTest.h"
+#include "Neuro.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Neuro;
+namespace fs = std::experimental::filesystem;
+
+namespace NeuroTests
+{
+    TEST_CLASS(ToolsTests)
+    {
+        TEST_METHOD(LoadFilesList_CacheRoundTrip)
+        {
+            const string dir = PrepareImagesDir("files_list_round_trip", 3);
+
+            auto files = LoadFilesList(dir, false, false, true);
+            Assert::AreEqual((size_t)3, files.size());
+            auto cacheLines = ReadLines(dir + "_cache");
+            Assert::AreEqual((size_t)4, cacheLines.size());
+
+            // corrupted file keeping its modification time is still valid according to cache
+            CorruptFile(files[0], false);
+
+            auto cachedFiles = LoadFilesList(dir, false, true, true);
+            sort(files.begin(), files.end());
+            sort(cachedFiles.begin(), cachedFiles.end());
+            Assert::IsTrue(files == cachedFiles);
+            Assert::IsTrue(cacheLines == ReadLines(dir + "_cache"));
+        }
+
+        TEST_METHOD(LoadFilesList_ModifiedFileIsValidatedAgain)
+        {
+            const string dir = PrepareImagesDir("files_list_modified", 3);
+
+            auto files = LoadFilesList(dir, false, false, true);
+            Assert::AreEqual((size_t)3, files.size());
+
+            CorruptFile(files[1], true);
+
+            auto validFiles = LoadFilesList(dir, false, true, true);
+            Assert::AreEqual((size_t)2, validFiles.size());
+            Assert::IsTrue(find(validFiles.begin(), validFiles.end(), files[1]) == validFiles.end());
+        }
+
+        TEST_METHOD(LoadFilesList_CachedInvalidFileIsSkippedWithoutValidation)
+        {
+            const string dir = PrepareImagesDir("files_list_cached_invalid", 3);
+
+            auto files = LoadFilesList(dir, false, false, false);
+            Assert::AreEqual((size_t)3, files.size());
+
+            CorruptFile(files[2], true);
+            Assert::AreEqual((size_t)2, LoadFilesList(dir, false, true, true).size());
+
+            auto listedFiles = LoadFilesList(dir, false, true, false);
+            Assert::AreEqual((size_t)2, listedFiles.size());
+            Assert::IsTrue(find(listedFiles.begin(), listedFiles.end(), files[2]) == listedFiles.end());
+        }
+
+        TEST_METHOD(LoadFilesList_LegacyCacheIsRebuilt)
+        {
+            const string dir = PrepareImagesDir("files_list_legacy", 2);
+            {
+                // older versions stored plain list of files
+                ofstream cache(dir + "_cache");
+                cache << dir << "/img0.png\n" << dir << "/removed.png\n";
+            }
+
+            auto files = LoadFilesList(dir, false, true, false);
+            Assert::AreEqual((size_t)2, files.size());
+            Assert::IsTrue(find(files.begin(), files.end(), dir + "/removed.png") == files.end());
+
+            auto cacheLines = ReadLines(dir + "_cache");
+            Assert::AreEqual((size_t)3, cacheLines.size());
+            Assert::AreEqual('#', cacheLines[0][0]);
+        }
+
+        TEST_METHOD(GetImageDims_ServedFromCache)
+        {
+            const string dir = PrepareImagesDir("files_list_dims", 2);
+            LoadFilesList(dir, false, false, true);
+
+            // replace dimensions in cache so it is clear where they come from
+            auto cacheLines = ReadLines(dir + "_cache");
+            {
+                ofstream cache(dir + "_cache");
+                cache << cacheLines[0] << "\n";
+                for (size_t i = 1; i < cacheLines.size(); ++i)
+                {
+                    int64_t mtime;
+                    int state, width, height;
+                    string path;
+                    stringstream ss(cacheLines[i]);
+                    ss >> mtime >> state >> width >> height;
+                    ss.get();
+                    getline(ss, path);
+                    cache << mtime << ' ' << state << " 7 5 " << path << "\n";
+                }
+            }
+
+            auto files = LoadFilesList(dir, false, true, true);
+            Assert::IsTrue(GetImageDims(files[0]) == Shape(7, 5, 3));
+
+            // modified file is read again
+            fs::last_write_time(files[0], fs::last_write_time(files[0]) + chrono::seconds(10));
+            Assert::IsTrue(GetImageDims(files[0]) == Shape(8, 6, 3));
+        }
+
+        string PrepareImagesDir(const string& dir, uint32_t imagesNum)
+        {
+            fs::remove_all(dir);
+            fs::remove(dir + "_cache");
+            fs::create_directory(dir);
+
+            Tensor image(Shape(8, 6, 3));
+            for (uint32_t i = 0; i < imagesNum; ++i)
+            {
+                image.FillWithRand(-1, 0, 255);
+                SaveImage(image, dir + "/img" + to_string(i) + ".png", false);
+            }
+            return dir;
+        }
+
+        void CorruptFile(const string& filename, bool updateModificationTime)
+        {
+            auto mtime = fs::last_write_time(filename);
+            {
+                ofstream stream(filename, ios::out | ios::binary | ios::trunc);
+                stream << "not an image";
+            }
+            fs::last_write_time(filename, updateModificationTime ? mtime + chrono::seconds(10) : mtime);
+        }
+
+        vector<string> ReadLines(const string& filename)
+        {
+            vector<string> lines;
+            ifstream stream(filename);
+            string line;
+            while (getline(stream, line))
+                lines.push_back(line);
+            return lines;
+        }
+    };
+}
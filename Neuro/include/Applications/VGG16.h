@@ -24,5 +24,8 @@ namespace Neuro
         static Tensor DeprocessImageCopy(const Tensor& image, EDataFormat dataFormat, bool swapChannels = true, bool clipValues = true);
 
         static void SwapChannels(Tensor& image);
+
+        // Mean of ImageNet images in RGB order, can be passed to LoadImage to preprocess images while loading
+        static const float CHANNEL_MEANS[3];
     };
 }
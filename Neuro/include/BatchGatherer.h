@@ -0,0 +1,45 @@
+#pragma once
+
+#include <future>
+#include <vector>
+
+#include "Types.h"
+#include "Tensors/Tensor.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    // Assembles batches of samples picked from source tensors (all with the same number of samples) into persistent buffers, so no
+    // tensors are allocated per batch. Samples are copied in parallel, a range of consecutive samples is not copied at all as buffers
+    // are then pointed directly at source memory. Next batch can be gathered in the background into the second set of buffers while
+    // the current one is in use.
+    class NEURO_DLL_EXPORT BatchGatherer
+    {
+    public:
+        BatchGatherer(const const_tensor_ptr_vec_t& sources, uint32_t maxBatchSize);
+        ~BatchGatherer();
+
+        // Returns batch tensors (one per source), they remain valid until the next call. When the same indices were prefetched
+        // it only waits for background gathering to finish.
+        const_tensor_ptr_vec_t Gather(const vector<uint32_t>& indices);
+        // Starts gathering given samples in the background, batch is delivered by the following Gather call
+        void Prefetch(const vector<uint32_t>& indices);
+
+    private:
+        void GatherInto(vector<Tensor>& buffers, const vector<uint32_t>& indices) const;
+
+        const_tensor_ptr_vec_t m_Sources;
+        uint32_t m_MaxBatchSize;
+        // buffers returned by the last Gather call and the ones used for prefetching
+        vector<Tensor> m_Buffers[2];
+        int m_CurrentBuffers = 0;
+        vector<uint32_t> m_PrefetchedIndices;
+        future<void> m_Prefetch;
+    };
+}
+
+#pragma warning(pop)
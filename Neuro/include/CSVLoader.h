@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Types.h"
+#include "DataPreloader.h"
+#include "Memory/MappedFile.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Tensor;
+
+    struct NEURO_DLL_EXPORT CSVOptions
+    {
+        char delimiter = ',';
+        // First line contains column names and is skipped
+        bool header = false;
+        // Columns used (in given order), by default all columns are used. Names can be used only when file has a header.
+        vector<uint32_t> columns;
+        vector<string> columnNames;
+        // Last selected column contains class index which is one-hot encoded, otherwise the last outputsNum selected columns are outputs
+        bool outputsOneHotEncoded = false;
+    };
+
+    // Memory mapped CSV file. Rows are parsed in parallel directly into destination tensors, there are no intermediate strings.
+    // Empty lines are skipped, missing values are zeros.
+    class NEURO_DLL_EXPORT CSVFile
+    {
+    public:
+        CSVFile(const string& filename, int outputsNum, const CSVOptions& options = CSVOptions());
+        CSVFile(const CSVFile&) = delete;
+        CSVFile& operator=(const CSVFile&) = delete;
+
+        bool IsValid() const { return m_File->Data() != nullptr; }
+        const vector<string>& ColumnNames() const { return m_ColumnNames; }
+        uint32_t InputsNum() const { return m_InputsNum; }
+        uint32_t OutputsNum() const { return m_OutputsNum; }
+
+        // Loads all rows (or at most maxRows). File is split into chunks which are counted and then parsed in parallel.
+        void Load(Tensor& inputs, Tensor& outputs, int maxRows = -1) const;
+        // Parses up to rowsNum consecutive rows starting at given byte offset into destination buffers, returns offset of the next
+        // row and number of parsed rows
+        size_t Load(size_t offset, uint32_t rowsNum, float* inputs, float* outputs, uint32_t& parsedRowsNum) const;
+
+        // Offsets of the first data row and the end of data
+        size_t DataBegin() const { return m_DataBegin; }
+        size_t DataEnd() const { return m_File->Size(); }
+
+        static float ParseFloat(const char* begin, const char* end);
+
+    private:
+        // Returns end of the line starting at given pointer (excluding line break)
+        const char* LineEnd(const char* line) const;
+        void ParseRow(const char* row, const char* rowEnd, float* inputs, float* outputs) const;
+
+        unique_ptr<MappedFile> m_File;
+        const char* m_Data = nullptr;
+        size_t m_DataBegin = 0;
+        char m_Delimiter;
+        bool m_OutputsOneHotEncoded;
+        vector<string> m_ColumnNames;
+        // Position of every column among selected columns, -1 for skipped ones. Columns past the last selected one are not parsed at all.
+        vector<int> m_ColumnTargets;
+        uint32_t m_InputsNum = 0;
+        uint32_t m_OutputsNum = 0;
+    };
+
+    // Streams consecutive batches of rows from CSV file (wrapping around at the end) without loading the whole file. First destination
+    // tensor receives inputs and second one outputs. Nothing is loaded (and 0 is returned) when file has no data rows.
+    class NEURO_DLL_EXPORT CSVLoader : public ILoader
+    {
+    public:
+        CSVLoader(const string& filename, int outputsNum, uint32_t batchSize, const CSVOptions& options = CSVOptions());
+
+        virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
+
+        const CSVFile& File() const { return m_File; }
+
+    private:
+        CSVFile m_File;
+        uint32_t m_BatchSize;
+        size_t m_Offset;
+    };
+}
+
+#pragma warning(pop)
@@ -4,6 +4,7 @@
 #include <unordered_set>
 
 #include "Types.h"
+#include "ComputationalGraph/MemoryPlan.h"
 
 #pragma warning(push)
 #pragma warning(disable:4251)
@@ -17,6 +18,7 @@ namespace Neuro
     class Operation;
     class Variable;
     class Constant;
+    class Tensor;
 
     class NEURO_DLL_EXPORT Graph
     {
@@ -42,9 +44,24 @@ namespace Neuro
         void IncrementStep();
         uint32_t CurrentStep() const { return m_CurrentStep; }
 
+        // Version is bumped whenever variables' values may have changed (initialization, loading, copying and training runs).
+        // Tensors derived from variables (ie. folded batch normalization parameters) are recomputed when version changes. Code
+        // writing variables' values directly should call ParametersChanged.
+        void ParametersChanged() { ++m_ParametersVersion; }
+        uint32_t ParametersVersion() const { return m_ParametersVersion; }
+
         size_t PreloadSteps() const { return m_PreloadSteps; }
         void PreloadSteps(size_t steps) { m_PreloadSteps = steps; }
 
+        // When enabled gradients of independent branches will be computed concurrently on CPU threads. Node's gradient is computed
+        // as soon as all its consumers computed their input gradients. Graphs containing GPU operations are always processed sequentially.
+        bool ParallelGradients() const { return m_ParallelGradients; }
+        void ParallelGradients(bool enabled) { m_ParallelGradients = enabled; }
+
+        // When set, every computed gradient will be recorded in the trace (used for building memory plans)
+        vector<ExecutionStep>* ExecutionTrace() const { return m_ExecutionTrace; }
+        void SetExecutionTrace(vector<ExecutionStep>* trace) { m_ExecutionTrace = trace; }
+
         // Builds nodes visitation order for forward pass, returns true when order contains training operation
         bool BuildForwardOrder(const vector<TensorLike*>& endNodes, vector<TensorLike*>& order);
         // Builds nodes visitation order for backward/gradients computation pass
@@ -57,6 +74,21 @@ namespace Neuro
         void DebugLog();
 
     private:
+        struct BackwardNode
+        {
+            TensorLike* node;
+            bool isLoss;
+            // consumers' input gradients w.r.t. this node, summed up to get node's output gradient
+            vector<const Tensor*> gradSources;
+            // indices (in backward order) of input nodes waiting for this node's gradient
+            vector<size_t> inputs;
+            uint32_t consumersNum;
+        };
+
+        void BuildBackwardNodes(const vector<TensorLike*>& order, const vector<TensorLike*>& losses, const unordered_set<TensorLike*>& nodesAffectingLosses, vector<BackwardNode>& nodes) const;
+        void ComputeNodeGradient(const BackwardNode& bwNode);
+        void ComputeGradientsInParallel(const vector<BackwardNode>& nodes);
+
         void ProcessForwardNode(TensorLike* node, vector<TensorLike*>& nodes, unordered_set<TensorLike*>& visited, bool& is_training);
         void ProcessBackwardNode(TensorLike* node, vector<TensorLike*>& nodes, const vector<Variable*>& params, bool ignoreConsumersCheck, unordered_set<TensorLike*>& visited, unordered_set<TensorLike*>& visitedParams, const unordered_set<TensorLike*>& required);
 
@@ -66,7 +98,10 @@ namespace Neuro
         vector<Constant*> m_Constants;
         vector<TensorLike*> m_Nodes;
         uint32_t m_CurrentStep = 0;
+        uint32_t m_ParametersVersion = 0;
         size_t m_PreloadSteps = 8;
+        bool m_ParallelGradients = false;
+        vector<ExecutionStep>* m_ExecutionTrace = nullptr;
 
         static Graph* s_Default;
     };
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Types.h"
+#include "ComputationalGraph/Operation.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    class TensorLike;
+    class Constant;
+    class Conv2dOp;
+    class BatchNormalizeOp;
+
+    // Computes operation's output in place of the operation itself (and operations it was fused with), reading only its input nodes
+    class NEURO_DLL_EXPORT FusedKernel
+    {
+    public:
+        virtual ~FusedKernel() {}
+
+        // Nodes outside of fused operations read by the kernel
+        const vector<TensorLike*>& InputNodes() const { return m_InputNodes; }
+
+        // Returns false when current inputs can't be handled, in that case all but the last fused operation are computed regularly
+        // so the last one can compute its output on its own.
+        virtual bool Compute(Tensor& output, bool training) = 0;
+
+    protected:
+        vector<TensorLike*> m_InputNodes;
+    };
+
+    // Single kernel computing connected elementwise operations. Every operation is a step of a small program evaluated over blocks
+    // of elements, values produced by intermediate steps never leave those blocks so no intermediate tensors are written. Only the
+    // last operation's output is computed, remaining operations are not executed at all.
+    class NEURO_DLL_EXPORT FusedElementwise : public FusedKernel
+    {
+    public:
+        // Operations have to be topologically sorted, the last one is the one which output is computed by the kernel
+        FusedElementwise(const vector<Operation*>& ops);
+
+        const vector<Operation*>& Ops() const { return m_Ops; }
+        size_t StepsNum() const { return m_Steps.size(); }
+        // Number of operations identical to one of the preceding ones, their steps are evaluated only once
+        size_t MergedNum() const { return m_Ops.size() - m_Steps.size(); }
+
+        // Only scalar broadcasting is supported
+        virtual bool Compute(Tensor& output, bool training) override;
+
+    private:
+        struct Step
+        {
+            ElementwiseStep func;
+            uint32_t src[2];
+        };
+
+        vector<Operation*> m_Ops;
+        vector<Step> m_Steps;
+    };
+
+    // Inference batch normalization is an affine transformation, so it can be folded into weights and bias of preceding matrix
+    // multiplication or NCHW convolution (optionally followed by bias addition). Output is computed by a single matmul followed by
+    // bias addition or a single convolution with bias, normalization pass and its temporaries are gone. Folded parameters are
+    // recomputed whenever graph's parameters version changed since they were computed. Applies to CPU operations only.
+    class NEURO_DLL_EXPORT FoldedBatchNorm : public FusedKernel
+    {
+    public:
+        // Operations are matmul or conv2d, optional bias addition and batch normalization
+        FoldedBatchNorm(const vector<Operation*>& ops);
+
+        // Folded parameters are valid only for inference
+        virtual bool Compute(Tensor& output, bool training) override;
+
+        const Tensor& Weights() const { return m_Weights; }
+        const Tensor& Bias() const { return m_Bias; }
+
+    private:
+        void FoldParameters();
+
+        vector<Operation*> m_Ops;
+        Conv2dOp* m_Conv = nullptr;
+        TensorLike* m_WeightsNode = nullptr;
+        TensorLike* m_BiasNode = nullptr;
+        BatchNormalizeOp* m_BatchNorm = nullptr;
+        Tensor m_Weights;
+        Tensor m_Bias;
+        uint32_t m_ParametersVersion = 0;
+        bool m_Folded = false;
+    };
+
+    enum EGraphOptimizationPass
+    {
+        ConstantFoldingPass = 1 << 0,
+        ConstantMergingPass = 1 << 1,
+        BatchNormFoldingPass = 1 << 2,
+        ElementwiseFusionPass = 1 << 3,
+        DeadNodesPruningPass = 1 << 4,
+        AllPasses = ConstantFoldingPass | ConstantMergingPass | BatchNormFoldingPass | ElementwiseFusionPass | DeadNodesPruningPass
+    };
+
+    struct NEURO_DLL_EXPORT GraphOptimizationStats
+    {
+        uint32_t nodesBefore = 0;
+        uint32_t nodesAfter = 0;
+        uint32_t folded = 0; // operations replaced by constants
+        uint32_t merged = 0; // nodes replaced by identical node (including identical steps of fused kernels)
+        uint32_t fused = 0; // operations computed by fused kernels without being executed
+        uint32_t pruned = 0; // nodes not contributing to fetches anymore
+        uint32_t kernels = 0; // fused kernels created
+        uint32_t batchNorms = 0; // batch normalizations folded into preceding operations
+
+        uint32_t Eliminated() const { return nodesBefore - nodesAfter; }
+        string ToString() const;
+    };
+
+    // Pass manager rewriting forward order before its first run. Passes are executed in the following sequence:
+    // - constant folding: operations depending only on constants are computed once and replaced with constants holding their outputs,
+    // - common subexpression elimination: constants with identical values are merged, identical steps of fused kernels are evaluated once,
+    // - batch normalization folding: inference batch normalizations are computed together with preceding matmul/convolution,
+    // - elementwise fusion: connected elementwise CPU operations are computed by a single kernel producing only the last one's output,
+    // - dead nodes pruning: nodes no longer contributing to fetches are removed.
+    // Graph itself is modified only where it's valid for all orders (consumers of folded and merged constants are pointed at the
+    // remaining constant), fusion applies to optimized order only. Operations which gradients may be required by training operations
+    // present in the order are never fused.
+    class NEURO_DLL_EXPORT GraphOptimizer
+    {
+    public:
+        typedef unordered_map<TensorLike*, shared_ptr<FusedKernel>> fused_kernels_t;
+
+        // Passes is a combination of EGraphOptimizationPass flags
+        GraphOptimizer(const vector<TensorLike*>& fetches, bool training, int passes = AllPasses);
+
+        // Fused kernels are keyed by the operation which output they compute
+        GraphOptimizationStats Optimize(vector<TensorLike*>& order, fused_kernels_t& fusedKernels);
+
+    private:
+        uint32_t FoldConstants(vector<TensorLike*>& order);
+        uint32_t MergeConstants(vector<TensorLike*>& order);
+        uint32_t FoldBatchNormalization(vector<TensorLike*>& order, fused_kernels_t& fusedKernels);
+        uint32_t FuseElementwise(vector<TensorLike*>& order, fused_kernels_t& fusedKernels, GraphOptimizationStats& stats);
+        uint32_t PruneDeadNodes(vector<TensorLike*>& order, const fused_kernels_t& fusedKernels);
+
+        bool IsFusable(TensorLike* node) const;
+        bool IsFetched(TensorLike* node) const { return m_Fetches.find(node) != m_Fetches.end(); }
+        // Points all consumers of node at replacement, node is left without consumers
+        static void Replace(TensorLike* node, TensorLike* replacement);
+
+        unordered_set<TensorLike*> m_Fetches;
+        vector<Constant*> m_FoldedConstants;
+        bool m_Training;
+        int m_Passes;
+    };
+}
+
+#pragma warning(pop)
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Types.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    class TensorLike;
+    class Tensor;
+
+    // Single node computation (forward or gradient) observed during session run
+    struct ExecutionStep
+    {
+        TensorLike* node;
+        bool backward;
+        // nodes read by forward computation when they differ from node's inputs (ie. when computed by fused kernel)
+        const vector<TensorLike*>* inputs = nullptr;
+    };
+
+    // Static memory plan for host tensors of CPU operations. Lifetimes of outputs, output gradients and input gradients are derived
+    // from the sequence of steps of a single session run (including backward pass computed by training operations). Tensors which
+    // lifetimes don't overlap share memory in one preallocated arena. Elementwise operations supporting in-place computation reuse
+    // memory of their input when it's not used afterwards. Tensors which lifetime cannot be determined (ie. fetched outputs, variables,
+    // GPU operations) are left to dynamic allocation.
+    class NEURO_DLL_EXPORT MemoryPlan
+    {
+    public:
+        MemoryPlan(const vector<ExecutionStep>& steps, const vector<TensorLike*>& fetches);
+        ~MemoryPlan();
+
+        // Allocates arena and binds all planned tensors to their memory regions
+        void Apply();
+        // Unbinds all planned tensors and releases arena, from now on tensors will be allocated dynamically
+        void Release();
+
+        // Arena size required by the plan
+        size_t ArenaSize() const { return m_ArenaLen * sizeof(float); }
+        // Total size of all planned tensors, that much memory would be used when each tensor had its own allocation
+        size_t TensorsSize() const;
+        // Largest total size of tensors alive at the same time, it's the lower bound for arena size
+        size_t PeakLiveSize() const;
+        size_t TensorsNum() const { return m_Tensors.size(); }
+        size_t InPlaceNum() const { return m_InPlaceNum; }
+
+        string ToString() const;
+
+    private:
+        struct PlannedTensor
+        {
+            Tensor* tensor;
+            size_t len;
+            uint32_t first;
+            uint32_t last;
+            size_t buffer;
+        };
+
+        struct Buffer
+        {
+            size_t len;
+            uint32_t first;
+            uint32_t last;
+            size_t offset;
+        };
+
+        void Define(Tensor& tensor, uint32_t step);
+        void Use(const Tensor& tensor, uint32_t step);
+        bool IsPlanned(const Tensor& tensor) const { return m_TensorIndex.find(&tensor) != m_TensorIndex.end(); }
+        void AssignBuffers(const vector<ExecutionStep>& steps);
+        void AssignOffsets();
+
+        vector<PlannedTensor> m_Tensors;
+        unordered_map<const Tensor*, size_t> m_TensorIndex;
+        vector<Buffer> m_Buffers;
+        size_t m_InPlaceNum = 0;
+        size_t m_ArenaLen = 0;
+        float* m_Arena = nullptr;
+    };
+}
+
+#pragma warning(pop)
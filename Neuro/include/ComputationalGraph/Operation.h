@@ -8,6 +8,40 @@
 namespace Neuro
 {
     class Tensor;
+    class FusedKernel;
+
+    enum EElementwiseFunc
+    {
+        EW_Add,
+        EW_Sub,
+        EW_Mul,
+        EW_Div,
+        EW_AddScalar,
+        EW_MulScalar,
+        EW_DivScalar,
+        EW_Negate,
+        EW_Log,
+        EW_Exp,
+        EW_Sqrt,
+        EW_Abs,
+        EW_Pow,
+        EW_Clip,
+        EW_Sigmoid,
+        EW_Tanh,
+        EW_ReLU,
+        EW_LeakyReLU,
+        EW_Elu
+    };
+
+    // Single elementwise function with its scalar parameters, binary functions take two input nodes with matching lengths
+    struct ElementwiseStep
+    {
+        EElementwiseFunc func;
+        float a;
+        float b;
+
+        bool operator==(const ElementwiseStep& other) const { return func == other.func && a == other.a && b == other.b; }
+    };
 
     class NEURO_DLL_EXPORT Operation : public TensorLike
     {
@@ -17,7 +51,11 @@ namespace Neuro
         uint32_t LastComputeStep() const { return m_LastComputeStep; }
         vector<const Tensor*> GatherInputs() const;
 
-        const Tensor& Compute(bool training);
+        // Fused kernel (when given) computes output directly from inputs of the whole chain of elementwise operations ending at this one
+        const Tensor& Compute(bool training, FusedKernel* fused = nullptr);
+        // Inference computation used by compiled programs, op mode switching, device memory management, reference counting and
+        // offloading are skipped. Applies to CPU operations only.
+        void ComputeInference(FusedKernel* fused = nullptr);
         const vector<Tensor*>& ComputeGradient(const Tensor& grad);
 
         const vector<Tensor>& InputsGrads() const { return m_InputsGrads; }
@@ -29,9 +67,17 @@ namespace Neuro
         virtual void InputGradConsumed(TensorLike* inputNode) override;
         
         virtual bool ForceAllocInputGradNode(size_t index) const { return false; }
+        // Elementwise operations can write output over given input's memory when no one else is going to use that input
+        virtual bool SupportsInPlace(size_t inputIndex) const { return false; }
 
         // Existence of training operations in fetched list will cause network to automatically run in training mode
         virtual bool IsTrainingOp() const { return false; }
+        // Operations with side effects or non-deterministic output can't be evaluated ahead of time nor merged
+        virtual bool HasSideEffects() const { return IsTrainingOp(); }
+        // Elementwise operations expressible as a single step can be fused with their neighbours into one kernel
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const { return false; }
+        // Operations copying their only input to output unchanged (in given mode) can be stripped from compiled inference programs
+        virtual bool PassesInputThrough(bool training) const { return false; }
 
         virtual bool ShouldPreload() const override { return m_OpMode == GPU; }
         EOpMode OpMode() const { return m_OpMode; }
@@ -55,6 +101,9 @@ namespace Neuro
         bool m_InputsManuallyConsumed = false;
         bool m_CareAboutGradient = false;
         bool m_Training = false;
+
+        friend class MemoryPlan;
+        friend class GraphOptimizer;
     };
 }
 
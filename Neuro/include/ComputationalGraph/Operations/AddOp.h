@@ -10,6 +10,9 @@ namespace Neuro
         AddOp(TensorLike* a, TensorLike* b, const string& name = "");
         AddOp(TensorLike* x, float val, const string& name = "");
 
+        virtual bool SupportsInPlace(size_t inputIndex) const override { return true; }
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { m_InputNodes.size() == 1 ? EW_AddScalar : EW_Add, m_Val }; return true; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
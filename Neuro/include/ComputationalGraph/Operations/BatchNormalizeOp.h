@@ -9,6 +9,8 @@ namespace Neuro
     public:
         BatchNormalizeOp(TensorLike* x, TensorLike* gamma, TensorLike* beta, TensorLike* runningMean, TensorLike* runningVar, float momentum, float epsilon, const string& name = "");
 
+        float Epsilon() const { return m_Epsilon; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
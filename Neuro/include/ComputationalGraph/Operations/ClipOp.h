@@ -9,6 +9,8 @@ namespace Neuro
     public:
         ClipOp(TensorLike* x, float min, float max, const string& name = "");
 
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { EW_Clip, m_Min, m_Max }; return true; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -9,6 +9,10 @@ namespace Neuro
     public:
         Conv2dOp(TensorLike* x, TensorLike* kernels, uint32_t stride, uint32_t padding, EDataFormat dataFormat = NCHW, const string& name = "");
 
+        uint32_t Stride() const { return m_Stride; }
+        uint32_t Padding() const { return m_Padding; }
+        EDataFormat DataFormat() const { return m_DataFormat; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
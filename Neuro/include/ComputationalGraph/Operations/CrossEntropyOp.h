@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ComputationalGraph/Operation.h"
+
+namespace Neuro
+{
+    // Softmax followed by categorical cross entropy, loss is computed per batch. Gradient w.r.t. logits is softmax(logits) - target,
+    // so softmax jacobian is never needed.
+    class NEURO_DLL_EXPORT SoftmaxCrossEntropyOp : public Operation
+    {
+    public:
+        SoftmaxCrossEntropyOp(TensorLike* target, TensorLike* logits, const string& name = "");
+
+    protected:
+        virtual void UpdateOutputShape() override;
+        virtual void ComputeInternal() override;
+        virtual void ComputeGradientInternal(const Tensor& grad) override;
+
+    private:
+        // Used as cache between forward and backward steps
+        Tensor m_Probabilities;
+    };
+
+    // Sigmoid followed by binary cross entropy, loss is computed elementwise. Gradient w.r.t. logits is sigmoid(logits) - target.
+    class NEURO_DLL_EXPORT SigmoidCrossEntropyOp : public Operation
+    {
+    public:
+        SigmoidCrossEntropyOp(TensorLike* target, TensorLike* logits, const string& name = "");
+
+    protected:
+        virtual void UpdateOutputShape() override;
+        virtual void ComputeInternal() override;
+        virtual void ComputeGradientInternal(const Tensor& grad) override;
+    };
+
+    static Operation* softmax_cross_entropy(TensorLike* target, TensorLike* logits, const string& name = "")
+    {
+        return new SoftmaxCrossEntropyOp(target, logits, name);
+    }
+
+    static Operation* sigmoid_cross_entropy(TensorLike* target, TensorLike* logits, const string& name = "")
+    {
+        return new SigmoidCrossEntropyOp(target, logits, name);
+    }
+}
@@ -10,6 +10,8 @@ namespace Neuro
         DivideOp(TensorLike* a, TensorLike* b, const string& name = "");
         DivideOp(TensorLike* x, float val, const string& name = "");
 
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { m_InputNodes.size() == 1 ? EW_DivScalar : EW_Div, m_Val }; return true; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -9,6 +9,9 @@ namespace Neuro
     public:
         DropoutOp(TensorLike* x, float prob, const string& name = "");
 
+        virtual bool HasSideEffects() const override { return true; }
+        virtual bool PassesInputThrough(bool training) const override { return !training; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
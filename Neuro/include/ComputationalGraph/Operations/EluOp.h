@@ -9,6 +9,8 @@ namespace Neuro
     public:
         EluOp(TensorLike* x, float alpha, const string& name = "");
 
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { EW_Elu, m_Alpha }; return true; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -9,6 +9,8 @@ namespace Neuro
     public:
         IdentityOp(TensorLike* x, const string& name = "");
 
+        virtual bool PassesInputThrough(bool training) const override { return true; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
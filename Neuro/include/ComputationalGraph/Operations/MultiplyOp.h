@@ -10,6 +10,8 @@ namespace Neuro
         MultiplyOp(TensorLike* a, TensorLike* b, const string& name = "");
         MultiplyOp(TensorLike* x, float val, const string& name = "");
 
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { m_InputNodes.size() == 1 ? EW_MulScalar : EW_Mul, m_Val }; return true; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
@@ -9,6 +9,9 @@ namespace Neuro
     public:
         NegativeOp(TensorLike* x, const string& name = "");
 
+        virtual bool SupportsInPlace(size_t inputIndex) const override { return true; }
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { EW_Negate }; return true; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
@@ -11,6 +11,8 @@ namespace Neuro
         PowOp(TensorLike* x, TensorLike* p, const string& name = "");
         PowOp(TensorLike* x, float p, const string& name = "");
 
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { EW_Pow, m_Power }; return m_InputNodes.size() == 1; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
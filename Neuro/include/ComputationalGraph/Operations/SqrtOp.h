@@ -9,6 +9,8 @@ namespace Neuro
     public:
         SqrtOp(TensorLike* x, const string& name = "");
 
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { EW_Sqrt }; return true; }
+
     protected:
         virtual void ComputeInternal() override;
         virtual void ComputeGradientInternal(const Tensor& grad) override;
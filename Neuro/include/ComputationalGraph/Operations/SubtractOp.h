@@ -9,6 +9,8 @@ namespace Neuro
     public:
         SubtractOp(TensorLike* a, TensorLike* b, const string& name = "");
 
+        virtual bool GetElementwiseStep(ElementwiseStep& step) const override { step = { EW_Sub }; return true; }
+
     protected:
         virtual void UpdateOutputShape() override;
         virtual void ComputeInternal() override;
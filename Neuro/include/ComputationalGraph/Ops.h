@@ -12,6 +12,7 @@
 #include "ComputationalGraph/Operations/Conv2dOp.h"
 #include "ComputationalGraph/Operations/Conv2dBiasActivationOp.h"
 #include "ComputationalGraph/Operations/Conv2dTransposeOp.h"
+#include "ComputationalGraph/Operations/CrossEntropyOp.h"
 #include "ComputationalGraph/Operations/DivideOp.h"
 #include "ComputationalGraph/Operations/DropoutOp.h"
 #include "ComputationalGraph/Operations/DumpOp.h"
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <map>
+#include <memory>
 #include <vector>
 #include "Types.h"
+#include "ComputationalGraph/GraphOptimizer.h"
 
 #pragma warning(push)
 #pragma warning(disable:4251)
@@ -10,23 +13,72 @@ namespace Neuro
 {
     using namespace std;
 
+    class Graph;
     class TensorLike;
     class Placeholder;
+    class Operation;
+    class MemoryPlan;
 
+    // Runs inference order of given outputs. Batch normalizations are always folded into preceding dense/convolution operations,
+    // remaining graph optimizations are applied when they are enabled in default session.
     class NEURO_DLL_EXPORT Predicter
     {
     public:
         Predicter(const vector<Placeholder*>& inputPlaceholders, const vector<TensorLike*>& outputOps);
+        ~Predicter();
+
+        // Compiles inference order into a flat program executed directly by Predict/Eval instead of going through session:
+        // - variables are frozen, they are initialized once and operations depending only on parameters are computed ahead of time
+        //   (they are recomputed only when graph's parameters version changes),
+        // - operations passing their input through in inference (ie. dropout, identity) are stripped, their outputs share input's memory,
+        // - remaining operations are computed one after another with their output buffers preassigned by static memory plan built from
+        //   the first run (plan is rebuilt when batch size grows beyond the planned one).
+        // Per-node session bookkeeping (variables initialization, step counting, fetches lookups, reference counting, op mode switching,
+        // debug logging) is gone. Orders containing GPU operations can't be compiled, in that case false is returned.
+        bool Compile();
+        bool IsCompiled() const { return m_Compiled; }
 
         tensor_ptr_vec_t Predict(const const_tensor_ptr_vec_t& inputs);
         tensor_ptr_vec_t Eval(const map<Placeholder*, const Tensor*>& feeds);
 
+        const GraphOptimizationStats& OptimizationStats() const { return m_OptimizationStats; }
+        // Number of operations executed per compiled run
+        size_t InstructionsNum() const { return m_Program.size() - m_StrippedNum; }
+        size_t FrozenNum() const { return m_FrozenOps.size(); }
+        size_t StrippedNum() const { return m_StrippedNum; }
+
     private:
+        struct Instruction
+        {
+            Operation* op;
+            FusedKernel* fused;
+            // source of stripped operation's output, null for computed operations
+            const Tensor* alias;
+            EOpMode mode;
+            // nodes actually read by this instruction, stripped operations are replaced with their sources
+            vector<TensorLike*> inputs;
+        };
+
+        tensor_ptr_vec_t RunCompiled(const map<Placeholder*, const Tensor*>& feeds);
+        void Freeze();
+        FusedKernel* FindFusedKernel(TensorLike* node) const;
+
+        Graph* m_Graph;
         vector<Placeholder*> m_InputPlaceholders;
         vector<TensorLike*> m_OutputOps;
         map<Placeholder*, const Tensor*> m_Feeds;
 
         vector<TensorLike*> m_Order;
+        GraphOptimizer::fused_kernels_t m_FusedKernels;
+        GraphOptimizationStats m_OptimizationStats;
+
+        vector<Instruction> m_Program;
+        vector<Operation*> m_FrozenOps;
+        size_t m_StrippedNum = 0;
+        uint32_t m_FrozenParametersVersion = 0;
+        unique_ptr<MemoryPlan> m_MemoryPlan;
+        uint32_t m_PlannedBatch = 0;
+        bool m_Compiled = false;
     };
 }
 
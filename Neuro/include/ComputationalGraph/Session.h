@@ -1,9 +1,13 @@
 ﻿#pragma once
 
+#include <atomic>
 #include <vector>
 #include <map>
+#include <memory>
 
 #include "Types.h"
+#include "ComputationalGraph/MemoryPlan.h"
+#include "ComputationalGraph/GraphOptimizer.h"
 
 #pragma warning(push)
 #pragma warning(disable:4251)
@@ -29,19 +33,65 @@ namespace Neuro
 
         vector<Tensor*> Run(const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds = {});
         vector<Tensor*> RunInOrder(const vector<TensorLike*>& order, const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds, bool training);
+        // Order has to be optimized by graph optimizer which produced fused kernels
+        vector<Tensor*> RunInOrder(const vector<TensorLike*>& order, const GraphOptimizer::fused_kernels_t* fusedKernels, const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds, bool training);
 
         void Clear();
 
+        // When enabled independent operations will be computed concurrently on CPU threads. Nodes are scheduled as soon as all
+        // their inputs are computed. Training operations act as barriers, operations with side effects (ie. dropout drawing from
+        // global random generator) are computed one after another in order. Graphs containing GPU operations always run sequentially.
+        void SetParallelExecution(bool enabled) { m_ParallelExecution = enabled; }
+
+        // When enabled host memory of CPU operations' tensors will be assigned according to static memory plan. Plan is built from
+        // the first run of given order and used by all subsequent runs. Doesn't apply to parallel execution.
+        void SetMemoryPlanning(bool enabled);
+        // Memory plan used by the most recent run, null when memory planning was not used
+        const MemoryPlan* ActiveMemoryPlan() const { return m_ActiveMemoryPlan; }
+        // Binds tensors to given plan releasing the currently active one, plan has to stay alive until it's deactivated
+        void ActivateMemoryPlan(MemoryPlan* plan);
+
+        // When enabled order built for new set of fetches is rewritten by graph optimizer (constant folding, merging constants,
+        // batch normalization folding, elementwise fusion and dead nodes pruning) before its first run. Orders already cached are not affected.
+        void SetGraphOptimization(bool enabled) { m_GraphOptimization = enabled; }
+        bool GraphOptimization() const { return m_GraphOptimization; }
+        // Summary of optimization of order cached for given fetches, empty when it was built with graph optimization disabled
+        GraphOptimizationStats OptimizationStats(const vector<TensorLike*>& fetches) const;
+
     private:
+        void ComputeNode(TensorLike* node, FusedKernel* fused, const vector<TensorLike*>& fetches, bool training);
+        bool CanRunInParallel(const vector<TensorLike*>& order) const;
+        void RunInParallel(const vector<TensorLike*>& order, const GraphOptimizer::fused_kernels_t* fusedKernels, const vector<TensorLike*>& fetches, bool training);
+
+        // Dependencies between nodes of an order used by parallel execution, they are built on first parallel run of given order
+        struct ParallelSchedule
+        {
+            vector<FusedKernel*> fused;
+            vector<vector<size_t>> consumers;
+            vector<uint32_t> dependenciesNum;
+            // reset to dependencies number at the beginning of every run
+            unique_ptr<atomic<uint32_t>[]> pendingInputs;
+        };
+
+        ParallelSchedule* GetParallelSchedule(const vector<TensorLike*>& order, const GraphOptimizer::fused_kernels_t* fusedKernels);
+
         Graph* m_Graph;
+        bool m_ParallelExecution = false;
+        bool m_MemoryPlanning = false;
+        bool m_GraphOptimization = false;
+        map<size_t, unique_ptr<MemoryPlan>> m_MemoryPlans;
+        MemoryPlan* m_ActiveMemoryPlan = nullptr;
 
         struct OrderCacheData
         {
             vector<TensorLike*> order;
             bool is_training;
+            GraphOptimizer::fused_kernels_t fused_kernels;
+            GraphOptimizationStats optimization_stats;
         };
 
         map<size_t, OrderCacheData> m_OrderCache;
+        map<size_t, unique_ptr<ParallelSchedule>> m_ParallelSchedules;
 
         static Session* s_Default;
     };
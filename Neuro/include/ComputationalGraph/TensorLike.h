@@ -62,6 +62,8 @@ namespace Neuro
         bool UndeterminedOutputShape() const { return m_UndeterminedOutputShape; }
         void SetAlwaysOffload(bool enabled) { m_AlwaysOffload = enabled; }
         void SetFetched(bool fetched) { m_Fetched = fetched; }
+        // Frozen output is computed ahead of time and reused by many runs, so it is never assigned memory by memory plans
+        void SetFrozen(bool frozen) { m_Frozen = frozen; }
 
         struct metadata
         {
@@ -89,11 +91,14 @@ namespace Neuro
         bool m_UndeterminedOutputShape : 1;
         bool m_AlwaysOffload : 1;
         bool m_Fetched : 1;
+        bool m_Frozen : 1;
 
         friend class Operation;
         friend class Session;
         friend class Graph;
         friend class OptimizerBase;
+        friend class MemoryPlan;
+        friend class GraphOptimizer;
     };
 }
 
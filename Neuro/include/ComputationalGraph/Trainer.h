@@ -19,6 +19,11 @@ namespace Neuro
         Trainer(const vector<Placeholder*>& inputPlaceholders, const vector<Placeholder*>& targetPlaceholders, const vector<TensorLike*>& fetchOps);
 
         tensor_ptr_vec_t Train(const const_tensor_ptr_vec_t& inputs, const const_tensor_ptr_vec_t& outputs);
+        // Trains on data already present in placeholders (ie. copied there by DataPreloader)
+        tensor_ptr_vec_t Train();
+
+        const vector<Placeholder*>& InputPlaceholders() const { return m_InputPlaceholders; }
+        const vector<Placeholder*>& TargetPlaceholders() const { return m_TargetPlaceholders; }
 
     private:
         vector<Placeholder*> m_InputPlaceholders;
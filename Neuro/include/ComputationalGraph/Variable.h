@@ -22,7 +22,7 @@ namespace Neuro
         bool Trainable() const { return m_Trainable; }
 
         void Initialize();
-        void ForceInitialized() { m_Initialized = true; }
+        void ForceInitialized();
 
         virtual bool CareAboutGradient() const override;
 
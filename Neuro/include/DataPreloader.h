@@ -1,10 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <vector>
 #include <list>
+#include <map>
 
 #include "Types.h"
 
@@ -22,34 +24,54 @@ namespace Neuro
         virtual ~ILoader() {}
         // Loads tensor(s) starting at loadIdx. Returns number of tensors loaded.
         virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) = 0;
+        // Whether loader can be called by multiple preloader workers at once, non-reentrant loaders are called one at a time
+        virtual bool Reentrant() const { return false; }
     };
 
+    // Loads data in background into a fixed number of buffers (capacity is the prefetch depth). With multiple workers several
+    // batches are loaded at once. In ordered mode batches are delivered in the order workers started loading them, otherwise
+    // whichever batch is ready first is delivered.
     class NEURO_DLL_EXPORT DataPreloader
     {
     public:
-        DataPreloader(const vector<Tensor*>& destination, const vector<ILoader*>& loaders, size_t capacity, bool threadedMode = true);
+        DataPreloader(const vector<Tensor*>& destination, const vector<ILoader*>& loaders, size_t capacity, bool threadedMode = true, uint32_t workersNum = 1, bool orderedDelivery = true);
         ~DataPreloader();
 
         // This function will copy first available tensors to the destination tensors
         void Load();
 
+        // Total time (in microseconds) Load spent waiting for data to be loaded and copying it to destination
+        int64_t WaitTime() const { return m_WaitTime; }
+        int64_t CopyTime() const { return m_CopyTime; }
+
     private:
         void Preload();
         void PreloadFunc();
 
         bool m_ThreadedMode = false;
-        bool m_Stop = false;
-        thread m_PreloaderThread;
+        bool m_OrderedDelivery = true;
+        atomic<bool> m_Stop;
+        vector<thread> m_Workers;
 
         condition_variable m_AvailableCond;
         mutex m_AvailableMtx;
-        list<vector<Tensor>*> m_Available;
+        // loaded data keyed by sequence number it was assigned when loading started
+        map<size_t, vector<Tensor>*> m_Available;
+        size_t m_NextDeliverySeq = 0;
         condition_variable m_PendingCond;
         mutex m_PendingMtx;
         list<vector<Tensor>*> m_Pending;
+        size_t m_NextLoadSeq = 0;
 
         vector<Tensor*> m_Destination;
         vector<ILoader*> m_Loaders;
+        condition_variable m_LoaderCond;
+        mutex m_LoaderMtx;
+        // sequence number of data to be loaded next by each loader
+        vector<size_t> m_LoaderNextSeq;
+
+        int64_t m_WaitTime = 0;
+        int64_t m_CopyTime = 0;
     };
 }
 
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Types.h"
+#include "Random.h"
+#include "DataPreloader.h"
+#include "Memory/MappedFile.h"
+#include "Tensors/Shape.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Tensor;
+
+    enum EShardElementType
+    {
+        SHARD_FLOAT32,
+        SHARD_UINT8,
+    };
+
+    // Single tensor stored for every sample of a shard (ie. image and its label are 2 fields)
+    struct NEURO_DLL_EXPORT ShardField
+    {
+        // Shape of single sample, batch dimension is ignored
+        Shape shape;
+        EShardElementType type = SHARD_FLOAT32;
+    };
+
+    // Shard is a binary file with pre-decoded samples. It starts with a header describing data format, number of samples and fields,
+    // followed by data of every field. Samples of each field are stored contiguously at page aligned offset, so any range of samples
+    // can be mapped directly into memory and used as a batch without copying.
+    class NEURO_DLL_EXPORT DataShardWriter
+    {
+    public:
+        DataShardWriter(const string& filename, const vector<ShardField>& fields, size_t samplesNum, EDataFormat dataFormat = NCHW);
+        ~DataShardWriter();
+
+        // Appends all samples from given tensors (one per field, all with the same batch size). Values are truncated to 0-255 range when
+        // stored as uint8.
+        void Append(const vector<const Tensor*>& fieldsData);
+        // Returns false when writing failed or not all declared samples were appended
+        bool Close();
+
+    private:
+        ofstream m_Stream;
+        vector<ShardField> m_Fields;
+        vector<size_t> m_DataOffsets;
+        size_t m_SamplesNum;
+        size_t m_WrittenSamplesNum = 0;
+    };
+
+    // Writes tensors (one per field) into a single shard, when shuffle is enabled samples are stored in random order
+    NEURO_DLL_EXPORT bool SaveShard(const string& filename, const vector<const Tensor*>& fieldsData, const vector<EShardElementType>& types, EDataFormat dataFormat = NCHW, bool shuffle = true);
+    // Converters from all supported dataset sources, images are stored as uint8 (not normalized) and all other values as float
+    NEURO_DLL_EXPORT bool ConvertImagesToShard(const string& dir, const string& filename, uint32_t width, uint32_t height, EDataFormat dataFormat = NCHW, bool shuffle = true);
+    NEURO_DLL_EXPORT bool ConvertMnistToShard(const string& imagesFile, const string& labelsFile, const string& filename, bool shuffle = true);
+    NEURO_DLL_EXPORT bool ConvertCifar10ToShard(const string& imagesFile, const string& filename, bool shuffle = true);
+    NEURO_DLL_EXPORT bool ConvertCSVToShard(const string& csvFile, int outputsNum, const string& filename, bool outputsOneHotEncoded = false, bool shuffle = true);
+
+    // Memory mapped shard file
+    class NEURO_DLL_EXPORT DataShard
+    {
+    public:
+        DataShard(const string& filename);
+        DataShard(const DataShard&) = delete;
+        DataShard& operator=(const DataShard&) = delete;
+
+        size_t SamplesNum() const { return m_SamplesNum; }
+        EDataFormat DataFormat() const { return m_DataFormat; }
+        const vector<ShardField>& Fields() const { return m_Fields; }
+        // Pointer to given field of the first sample, mapping is copy-on-write so writes never reach the file
+        uint8_t* FieldData(size_t fieldIdx) const { return m_Data + m_DataOffsets[fieldIdx]; }
+        size_t FieldSampleSizeInBytes(size_t fieldIdx) const;
+
+    private:
+        unique_ptr<MappedFile> m_File;
+        uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+        size_t m_SamplesNum = 0;
+        EDataFormat m_DataFormat = NCHW;
+        vector<ShardField> m_Fields;
+        vector<size_t> m_DataOffsets;
+    };
+
+    // Serves random batches from memory mapped shards, every field is loaded into consecutive destination tensor. In contiguous mode
+    // batch is a random range of consecutive samples (shards are expected to be shuffled when written), float fields are then not copied
+    // at all, destination tensors are pointed directly at mapped memory. Otherwise every sample is picked randomly and copied. Uint8
+    // fields are converted to float and multiplied by uint8Scale. Loader has to outlive preloader using it.
+    class NEURO_DLL_EXPORT ShardLoader : public ILoader
+    {
+    public:
+        ShardLoader(const vector<string>& shardFiles, uint32_t batchSize, bool contiguousBatches = true, float uint8Scale = 1.f, unsigned int seed = 0);
+        ~ShardLoader();
+
+        virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
+        virtual bool Reentrant() const override { return true; }
+
+        size_t SamplesNum() const { return m_SamplesNum; }
+
+    private:
+        // Number of positions first sample of a batch can be picked from
+        size_t StartsNum(const DataShard* shard) const;
+
+        vector<DataShard*> m_Shards;
+        size_t m_SamplesNum = 0;
+        size_t m_StartsNum = 0;
+        uint32_t m_BatchSize;
+        bool m_ContiguousBatches;
+        float m_Uint8Scale;
+        mutex m_RngLock;
+        Random m_Rng;
+    };
+}
+
+#pragma warning(pop)
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <vector>
+#include <deque>
+
+#include "Types.h"
+#include "Tensors/Tensor.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    class TensorLike;
+    class Placeholder;
+    class Predicter;
+    class ModelBase;
+
+    struct NEURO_DLL_EXPORT InferenceEngineStats
+    {
+        uint64_t requests = 0;
+        uint64_t batches = 0;
+        uint64_t fullBatches = 0; // batches dispatched because they reached max batch size, remaining ones were dispatched on deadline
+
+        float AverageBatchSize() const { return batches ? (float)requests / batches : 0.f; }
+    };
+
+    // Serves single sample inference requests submitted from any number of threads. Requests are queued and coalesced into a batch
+    // which is computed by a single predicter run on engine's worker thread. Batch is dispatched as soon as it reaches max batch size
+    // or when the oldest queued request has waited for max latency, outputs are then split back into per request results. Predicter
+    // is compiled for inference when possible (see Predicter::Compile). Graph is not thread-safe so nothing else should run it while
+    // engine is alive.
+    class NEURO_DLL_EXPORT InferenceEngine
+    {
+    public:
+        InferenceEngine(const vector<Placeholder*>& inputPlaceholders, const vector<TensorLike*>& outputOps, uint32_t maxBatchSize, int64_t maxLatencyUs);
+        InferenceEngine(ModelBase* model, uint32_t maxBatchSize, int64_t maxLatencyUs);
+        ~InferenceEngine();
+
+        // Inputs have to be single samples (batch of size 1), they are copied so they don't have to outlive the request.
+        // Future holds an exception when batch computation failed or when request was submitted while engine was being destroyed.
+        future<vector<Tensor>> Submit(const const_tensor_ptr_vec_t& inputs);
+        // Blocks until request is computed
+        vector<Tensor> Predict(const const_tensor_ptr_vec_t& inputs);
+
+        uint32_t MaxBatchSize() const { return m_MaxBatchSize; }
+        int64_t MaxLatency() const { return m_MaxLatency; }
+        InferenceEngineStats Stats() const;
+
+    private:
+        struct Request
+        {
+            vector<Tensor> inputs;
+            promise<vector<Tensor>> outputs;
+            chrono::steady_clock::time_point submitTime;
+        };
+
+        void WorkerFunc();
+        void RunBatch(vector<Request*>& batch);
+
+        vector<Placeholder*> m_InputPlaceholders;
+        // shapes of single sample inputs
+        vector<Shape> m_InputShapes;
+        Predicter* m_Predicter = nullptr;
+        uint32_t m_MaxBatchSize;
+        int64_t m_MaxLatency;
+
+        atomic<bool> m_Stop;
+        thread m_Worker;
+        condition_variable m_QueueCond;
+        mutable mutex m_QueueMtx;
+        deque<Request*> m_Queue;
+
+        // inputs of the whole batch fed to predicter
+        vector<Tensor> m_BatchInputs;
+        InferenceEngineStats m_Stats;
+    };
+}
+
+#pragma warning(pop)
\ No newline at end of file
@@ -33,6 +33,36 @@ namespace Neuro
         virtual TensorLike* Build(TensorLike* targetOutput, TensorLike* output) override;
 	};
 
+    // Softmax and categorical cross entropy computed by a single operation using log-sum-exp, gradient w.r.t. logits is simply
+    // softmax(logits) - target. Unless fromLogits is set, output should be produced by softmax and its input is used as logits
+    // (so model still outputs probabilities), otherwise loss falls back to cross entropy of probabilities. Used for multi-class classification
+    class NEURO_DLL_EXPORT SoftmaxCrossEntropy : public LossBase
+    {
+    public:
+        SoftmaxCrossEntropy(bool fromLogits = false);
+
+        virtual LossBase* Clone() const override { return new SoftmaxCrossEntropy(*this); }
+        virtual TensorLike* Build(TensorLike* targetOutput, TensorLike* output) override;
+
+    private:
+        bool m_FromLogits;
+    };
+
+    // Sigmoid and binary cross entropy computed by a single numerically stable operation, gradient w.r.t. logits is simply
+    // sigmoid(logits) - target. Unless fromLogits is set, output should be produced by sigmoid and its input is used as logits,
+    // otherwise it falls back to BinaryCrossEntropy.
+    class NEURO_DLL_EXPORT SigmoidCrossEntropy : public LossBase
+    {
+    public:
+        SigmoidCrossEntropy(bool fromLogits = false);
+
+        virtual LossBase* Clone() const override { return new SigmoidCrossEntropy(*this); }
+        virtual TensorLike* Build(TensorLike* targetOutput, TensorLike* output) override;
+
+    private:
+        bool m_FromLogits;
+    };
+
     class NEURO_DLL_EXPORT MeanSquareError : public LossBase
     {
 	public:
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+#include "Types.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    // Copy-on-write memory mapping of a whole file, mapped memory can be modified but changes never reach the file. When file
+    // cannot be opened or mapped Data() returns null.
+    class NEURO_DLL_EXPORT MappedFile
+    {
+    public:
+        explicit MappedFile(const string& filename);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        uint8_t* Data() const { return m_Data; }
+        size_t Size() const { return m_Size; }
+
+    private:
+        uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+        void* m_FileHandle = nullptr;
+        void* m_MappingHandle = nullptr;
+    };
+}
+
+#pragma warning(pop)
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <atomic>
 #include <cstdio>
 #include <list>
 #include <mutex>
+#include <vector>
 #include <driver_types.h>
 
 #include "Types.h"
@@ -30,6 +32,12 @@ namespace Neuro
         MEM_FLAGS_CANNOT_GROW = 1,   /// Prevent the manager from growing its memory consumption.
     };
 
+    enum EMemAllocator
+    {
+        MEM_ALLOCATOR_BEST_FIT = 0,  /// Best fit search in sorted list of free blocks, blocks are split and merged.
+        MEM_ALLOCATOR_SIZE_CLASSES,  /// Segregated size classes with per-thread caches (see SizeClassAllocator).
+    };
+
     #define KB_TO_B(x) (x * 1024)
     #define MB_TO_B(x) (x * 1024 * 1024)
 
@@ -73,10 +81,14 @@ namespace Neuro
         size_t size;
     };
 
+    class SizeClassAllocator;
+    class MemoryTrace;
+
     class NEURO_DLL_EXPORT MemoryManagerBase
     {
     public:
         MemoryManagerBase(size_t allocGranularity, size_t nativeAllocGranularity);
+        virtual ~MemoryManagerBase();
 
         EMemStatus Allocate(void** ptr, size_t size, const string& annotation = "");
         EMemStatus ScheduleFree(void* ptr);
@@ -91,6 +103,24 @@ namespace Neuro
 
         EMemStatus ReleaseAll();
 
+        // Allocator can only be changed when no memory is allocated. In size classes mode annotations are not tracked and
+        // MinSizeForDirectAllocation is ignored.
+        void SetAllocator(EMemAllocator allocator);
+        EMemAllocator Allocator() const { return m_SizeClassAllocator ? MEM_ALLOCATOR_SIZE_CLASSES : MEM_ALLOCATOR_BEST_FIT; }
+
+        // All subsequent allocations and releases will be recorded in given trace, pass null to stop recording. Trace can be
+        // shared by multiple memory managers.
+        void SetTrace(MemoryTrace* trace) { m_Trace = trace; }
+        MemoryTrace* Trace() const { return m_Trace; }
+
+        // Sizes don't include allocations passed directly to the system
+        size_t AllocatedSize() const;
+        size_t AllocatedPeakSize() const;
+        // Peak will be tracked from currently allocated size
+        void ResetAllocatedPeakSize();
+        // Size of memory obtained from the system
+        size_t ReservedSize() const;
+
     protected:
         virtual void InternalAllocate(void** ptr, size_t size, const string& annotation = "") = 0;
         virtual void InternalFree(void* ptr) = 0;
@@ -98,6 +128,9 @@ namespace Neuro
         virtual const char* InternalName() const = 0;
 
         EMemStatus AllocateBlock(Block*& curr, Block*& prev, size_t size);
+        // Returns all native memory to the system regardless of outstanding allocations. It has to be called by destructors of
+        // derived managers, native memory can't be released by base destructor as InternalFree is no longer available there.
+        void ReleaseNativeMemory();
 
     private:
         EMemStatus ReleaseBlock(Block* curr, Block* prev);
@@ -111,6 +144,7 @@ namespace Neuro
         inline EMemStatus GetUsedMemory(size_t& usedMemory) const;
         inline EMemStatus GetFreeMemory(size_t& freeMemory) const;
         EMemStatus GetMemory(size_t& size, const Block* head) const;        
+        void RecordAllocEvent(void* ptr, size_t size, bool alloc, const string& annotation = "");
 
         Block* m_UsedBlocks = nullptr;
         Block* m_FreeBlocks = nullptr;
@@ -124,8 +158,13 @@ namespace Neuro
         int m_MinSizeForDirectAllocation = -1;
         vector<void*> m_DirectAlocations;
 
-        mutex m_AllocFreeMtx;
+        SizeClassAllocator* m_SizeClassAllocator = nullptr;
+        atomic<MemoryTrace*> m_Trace{ nullptr };
+
+        mutable mutex m_AllocFreeMtx;
         mutex m_ScheduledFreeMtx;
+
+        friend class SizeClassAllocator;
     };
 
     // Memory manager for GPU memory
@@ -133,6 +172,7 @@ namespace Neuro
     {
     public:
         DeviceMemoryManager();
+        ~DeviceMemoryManager();
         static DeviceMemoryManager& Default();
 
         EMemStatus Reserve(size_t size);
@@ -160,6 +200,7 @@ namespace Neuro
     {
     public:
         HostMemoryManager();
+        ~HostMemoryManager();
         static HostMemoryManager& Default();
 
     protected:
@@ -174,6 +215,7 @@ namespace Neuro
     {
     public:
         HostPinnedMemoryManager();
+        ~HostPinnedMemoryManager();
         static HostPinnedMemoryManager& Default();
 
     protected:
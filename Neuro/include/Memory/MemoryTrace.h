@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Types.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    class MemoryManagerBase;
+
+    // Single allocation or release observed by memory manager
+    struct MemAllocEvent
+    {
+        // Microseconds since trace creation
+        __int64 timestamp;
+        void* ptr;
+        // Requested size, releases have size 0
+        size_t size;
+        uint32_t annotationId;
+        uint32_t opNameId;
+        uint32_t threadId;
+        bool alloc;
+    };
+
+    struct NEURO_DLL_EXPORT MemTraceReplayStats
+    {
+        size_t eventsNum = 0;
+        // Nanoseconds spent inside allocate/free calls
+        __int64 allocTime = 0;
+        __int64 freeTime = 0;
+        __int64 maxAllocLatency = 0;
+        __int64 maxFreeLatency = 0;
+        size_t peakAllocatedSize = 0;
+        size_t reservedSize = 0;
+
+        // Part of reserved memory which was never in use, even at the peak
+        float Fragmentation() const { return reservedSize ? 1.f - (float)peakAllocatedSize / reservedSize : 0.f; }
+        string ToString() const;
+    };
+
+    // Log of allocations and releases made through memory managers it is attached to (see MemoryManagerBase::SetTrace). Strings
+    // are interned, operation name is interned once per operation scope so recording an event is just a lock, annotation lookup
+    // and a push back. When events limit is set, trace works as a ring buffer keeping only the most recent events and names they
+    // refer to, so it can stay enabled in long running processes.
+    class NEURO_DLL_EXPORT MemoryTrace
+    {
+    public:
+        MemoryTrace(size_t maxEventsNum = 0);
+
+        void Record(void* ptr, size_t size, bool alloc, const string& annotation);
+        void Clear();
+
+        // Returns events in chronological order
+        vector<MemAllocEvent> Events() const;
+        size_t EventsNum() const;
+        string Name(uint32_t id) const;
+        size_t NamesNum() const;
+
+        bool Save(const string& filename) const;
+        bool Load(const string& filename);
+        // Exports timeline in Chrome trace event format (chrome://tracing, Perfetto), every block is an async slice spanning its
+        // lifetime and total traced allocated size is a counter
+        bool ExportChromeTrace(const string& filename) const;
+
+        // Performs all traced allocations and releases on given memory manager. Blocks released in the trace but allocated before
+        // it started are skipped, blocks still alive at the end of the trace are released after each repetition. Memory manager
+        // should be a fresh instance for peak and reserved sizes to be meaningful.
+        MemTraceReplayStats Replay(MemoryManagerBase& manager, int repeats = 1) const;
+
+        // Operation name attached to all events recorded by current thread while the scope is alive
+        class NEURO_DLL_EXPORT OpScope
+        {
+        public:
+            OpScope(const string& opName);
+            ~OpScope();
+
+        private:
+            const string& m_OpName;
+            OpScope* m_Prev;
+            // id of operation name valid for trace names generation it was interned in
+            uint64_t m_NamesGeneration = 0;
+            uint32_t m_OpNameId = 0;
+
+            friend class MemoryTrace;
+        };
+
+    private:
+        uint32_t Intern(const string& str);
+        void ResetNames(const vector<string>& names);
+        // Drops names no longer referenced by any event in ring buffer
+        void CompactNames();
+        vector<MemAllocEvent> EventsInternal() const;
+
+        mutable mutex m_Lock;
+        vector<MemAllocEvent> m_Events;
+        size_t m_MaxEventsNum;
+        // Position of the oldest event once ring buffer is full
+        size_t m_FirstEvent = 0;
+        vector<string> m_Names;
+        unordered_map<string, uint32_t> m_NameIds;
+        // changes whenever ids of already interned names become invalid, it's unique across all traces
+        uint64_t m_NamesGeneration;
+        chrono::steady_clock::time_point m_Start;
+    };
+}
+
+#pragma warning(pop)
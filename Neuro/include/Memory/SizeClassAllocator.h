@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Types.h"
+#include "Memory/MemoryManager.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    // Allocator with segregated size classes. Requested sizes are rounded up to one of the classes (4 classes per power of two) and
+    // each class keeps its own list of free blocks, so both allocation and release take constant time regardless of fragmentation.
+    // Small blocks are carved from larger native allocations and additionally cached per thread, so most allocations don't touch any
+    // shared lock. Blocks are never split nor merged, memory is returned to the system only by ReleaseAll. Native memory is obtained
+    // from owning memory manager, so the same allocator works for both host and device memory.
+    class NEURO_DLL_EXPORT SizeClassAllocator
+    {
+    public:
+        SizeClassAllocator(MemoryManagerBase& manager, size_t granularity);
+        // Returns all native memory through owning manager, so it has to be destroyed before derived manager is
+        ~SizeClassAllocator();
+
+        EMemStatus Allocate(void** ptr, size_t size);
+        EMemStatus Free(void* ptr);
+        EMemStatus ReleaseAll();
+
+        // Size of memory currently handed out (including rounding to size class)
+        size_t AllocatedSize() const { return m_AllocatedSize.load(); }
+        size_t AllocatedPeakSize() const { return m_AllocatedPeakSize.load(); }
+        void ResetAllocatedPeakSize() { m_AllocatedPeakSize = m_AllocatedSize.load(); }
+        // Size of memory obtained from the system
+        size_t ReservedSize() const { return m_ReservedSize.load(); }
+
+        void DumpState(FILE* file) const;
+
+        // Returns index of size class given size falls into, for sizes not fitting in any class returns CLASSES_NUM
+        static uint32_t ClassIndex(size_t size, size_t granularity, size_t& classSize);
+
+        static const uint32_t CLASSES_NUM = 96;
+
+    private:
+        struct SizeClass
+        {
+            mutex lock;
+            vector<void*> freeBlocks;
+            size_t size = 0;
+            size_t blocksNum = 0;
+        };
+
+        // Accessed only by its thread, blocks cached before the most recent ReleaseAll are dropped on the next access
+        struct ThreadCache
+        {
+            vector<void*> freeBlocks[CLASSES_NUM];
+            uint64_t generation = 0;
+        };
+
+        struct BlocksMapShard
+        {
+            mutex lock;
+            unordered_map<void*, uint32_t> blocks;
+        };
+
+        bool IsSmallClass(uint32_t classIdx) const { return m_Classes[classIdx].size <= SMALL_CLASS_MAX_SIZE; }
+        // Number of blocks moved at once between thread cache and size class
+        uint32_t TransferBatch(uint32_t classIdx) const;
+        ThreadCache& LocalCache();
+        BlocksMapShard& Shard(void* ptr) { return m_Shards[((size_t)ptr / m_Granularity) % SHARDS_NUM]; }
+        void* NativeAllocate(size_t size);
+        void RegisterBlock(void* ptr, uint32_t classIdx);
+        void AddAllocated(size_t size);
+        void RefillCache(uint32_t classIdx, vector<void*>& cacheBlocks);
+        void ReleaseNative();
+
+        static const size_t SMALL_CLASS_MAX_SIZE = 64 * 1024;
+        static const size_t SLAB_SIZE = 1024 * 1024;
+        static const uint32_t SHARDS_NUM = 16;
+        static const uint32_t DIRECT_CLASS = CLASSES_NUM;
+
+        MemoryManagerBase& m_Manager;
+        const size_t m_Granularity;
+        const uint64_t m_Id;
+        SizeClass m_Classes[CLASSES_NUM];
+        BlocksMapShard m_Shards[SHARDS_NUM];
+
+        mutex m_NativeLock;
+        vector<void*> m_NativeAllocations;
+        // allocations too big for any size class are passed directly to the system
+        unordered_map<void*, size_t> m_DirectAllocations;
+
+        mutex m_CachesLock;
+        vector<unique_ptr<ThreadCache>> m_Caches;
+        // incremented by ReleaseAll, invalidates all thread caches
+        atomic<uint64_t> m_Generation;
+
+        atomic<size_t> m_AllocatedSize;
+        atomic<size_t> m_AllocatedPeakSize;
+        atomic<size_t> m_ReservedSize;
+    };
+}
+
+#pragma warning(pop)
@@ -4,6 +4,7 @@
 #include <vector>
 #include <unordered_set>
 #include <fstream>
+#include <memory>
 
 #include "Layers/LayerBase.h"
 #include "ParameterAndGradient.h"
@@ -22,6 +23,26 @@ namespace Neuro
     class Trainer;
     class Predicter;
     class Placeholder;
+    class TensorFile;
+    struct ILoader;
+
+    // Time (in microseconds) spent in each stage of asynchronous training loop. When waiting for data takes longer than compute,
+    // training is input bound and more preloader workers should help.
+    struct NEURO_DLL_EXPORT TrainingTimings
+    {
+        // waiting for background workers to load a batch
+        int64_t dataWait = 0;
+        // copying loaded batch into placeholders (including host to device transfer)
+        int64_t transfer = 0;
+        // running training steps, on GPU it mostly covers dispatching work which is awaited when metrics are read
+        int64_t compute = 0;
+        // reading reduced metrics
+        int64_t metrics = 0;
+        uint32_t steps = 0;
+
+        bool InputBound() const { return dataWait + transfer > compute + metrics; }
+        string ToString() const;
+    };
 
     class NEURO_DLL_EXPORT ModelBase : public LayerBase
     {
@@ -36,11 +57,19 @@ namespace Neuro
         // Training method, when batch size is -1 the whole training set is used for single gradient descent step (in other words, batch size equals to training set size)
         void Fit(const const_tensor_ptr_vec_t& inputs, const const_tensor_ptr_vec_t& outputs, int batchSize = -1, uint32_t epochs = 1, const const_tensor_ptr_vec_t* validInputs = nullptr, const const_tensor_ptr_vec_t* validOutputs = nullptr, uint32_t verbose = 1, bool shuffle = true);
 
+        // Asynchronous training on batches provided by loaders (model inputs followed by targets). Next batches are loaded by workers
+        // in the background while the model trains on the current one; loss and accuracy are summed on the compute device and read only
+        // when reported instead of after every step.
+        void Fit(const vector<ILoader*>& loaders, uint32_t stepsPerEpoch, uint32_t epochs = 1, uint32_t verbose = 1, uint32_t prefetchDepth = 4, uint32_t workersNum = 1);
+
         tuple<float, float> TrainOnBatch(const Tensor& input, const Tensor& output);
         tuple<float, float> TrainOnBatch(const const_tensor_ptr_vec_t& inputs, const const_tensor_ptr_vec_t& outputs);
 
         tensor_ptr_vec_t Predict(const const_tensor_ptr_vec_t& inputs);
         tensor_ptr_vec_t Predict(const Tensor& input);
+        // Subsequent predictions will run compiled inference program with frozen parameters (see Predicter::Compile), returns false
+        // when model can't be compiled (ie. it runs on GPU)
+        bool CompileForInference();
 
         tensor_ptr_vec_t Eval(const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds);
 
@@ -63,6 +92,8 @@ namespace Neuro
         LayerBase* Layer(size_t idx) { return m_Layers[idx]; }
 
         float LastTrainError() const { return m_LastTrainError; }
+        // Timings of the last asynchronous Fit
+        const TrainingTimings& LastTrainingTimings() const { return m_TrainingTimings; }
 
     protected:
         ModelBase() {}
@@ -95,11 +126,13 @@ namespace Neuro
         void MapGraphNetwork(const vector<TensorLike*>& inputs, const vector<TensorLike*>& outputs);
         void ProcessLayer(LayerBase* layer, unordered_set<LayerBase*>& visited);
 
+        // Native tensor file format, weights are memory mapped and used without copying when possible
+        void SaveWeightsBin(const string& filename) const;
+        void LoadWeightsBin(const string& filename, bool byName);
+
         // This is vectorized gradient descent
         void TrainStep(const const_tensor_ptr_vec_t& inputs, const const_tensor_ptr_vec_t& outputs, float* trainError = nullptr, float* trainAcc = nullptr);
-
-        // Build a single tensor with multiple batches for each input
-        const_tensor_ptr_vec_t GenerateBatch(const const_tensor_ptr_vec_t& inputs, const vector<uint32_t>& batchIndices);
+        Predicter* GetPredicter();
 
         OptimizerBase* m_Optimizer = nullptr;
         vector<accuracy_func_t> m_AccuracyFuncs;
@@ -108,6 +141,8 @@ namespace Neuro
         Trainer* m_Trainer = nullptr;
         Predicter* m_Predicter = nullptr;
         map<size_t, Predicter*> m_EvalPredicters;
+        // Mapped weights files, parameters loaded from them refer directly to their memory
+        vector<shared_ptr<TensorFile>> m_WeightsFiles;
 
         map<EMetric, pair<TensorLike*, size_t>> m_Metrics;
         int m_TrackedMetrics;
@@ -119,6 +154,9 @@ namespace Neuro
         int m_ChartSaveInterval = 20;
         int m_Seed;
         float m_LastTrainError;
+        TrainingTimings m_TrainingTimings;
+
+        friend class InferenceEngine;
 	};
 }
 
@@ -46,12 +46,17 @@
 
 #include "Tensors/Shape.h"
 #include "Tensors/Tensor.h"
+#include "Tensors/TensorFile.h"
+#include "Tensors/CompactTensor.h"
 
 #include "ComputationalGraph/TensorLike.h"
 #include "ComputationalGraph/Operation.h"
 #include "ComputationalGraph/Graph.h"
+#include "ComputationalGraph/MemoryPlan.h"
+#include "ComputationalGraph/GraphOptimizer.h"
 #include "ComputationalGraph/Placeholder.h"
 #include "ComputationalGraph/Session.h"
+#include "ComputationalGraph/Predicter.h"
 #include "ComputationalGraph/Variable.h"
 #include "ComputationalGraph/Constant.h"
 #include "ComputationalGraph/NameScope.h"
@@ -62,6 +67,11 @@
 #include "Applications/VGG19.h"
 
 #include "Debug.h"
+#include "BatchGatherer.h"
 #include "DataPreloader.h"
+#include "InferenceEngine.h"
+#include "DataShard.h"
+#include "CSVLoader.h"
 
-#include "Memory/MemoryManager.h"
\ No newline at end of file
+#include "Memory/MemoryManager.h"
+#include "Memory/MemoryTrace.h"
\ No newline at end of file
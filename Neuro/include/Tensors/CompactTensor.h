@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+#include "Types.h"
+#include "Random.h"
+#include "DataPreloader.h"
+#include "Tensors/Shape.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Tensor;
+
+    enum ECompactElementType
+    {
+        COMPACT_UINT8,
+        COMPACT_FLOAT16,
+    };
+
+    // Host-only dataset storage using 1 (uint8) or 2 (half precision) bytes per value instead of 4, so whole datasets can stay
+    // resident in memory. Values are expanded to floats only when samples are copied into regular tensors (ie. when batch is
+    // assembled to be fed into placeholders). Stored uint8 value v represents v * scale + offset, scale and offset are ignored
+    // for half precision.
+    class NEURO_DLL_EXPORT CompactTensor
+    {
+    public:
+        CompactTensor() {}
+        CompactTensor(const Shape& shape, ECompactElementType type, float scale = 1.f, float offset = 0.f);
+        // Converts tensor's values, uint8 values are rounded and saturated
+        CompactTensor(const Tensor& t, ECompactElementType type, float scale = 1.f, float offset = 0.f);
+
+        const Shape& GetShape() const { return m_Shape; }
+        uint32_t Batch() const { return m_Shape.Batch(); }
+        uint32_t BatchLength() const { return m_Shape.Dim0Dim1Dim2; }
+        uint32_t Length() const { return m_Shape.Length; }
+        ECompactElementType Type() const { return m_Type; }
+        float Scale() const { return m_Scale; }
+        float Offset() const { return m_Offset; }
+
+        size_t ElementSize() const { return m_Type == COMPACT_UINT8 ? 1 : 2; }
+        size_t SizeInBytes() const { return m_Data.size(); }
+        uint8_t* Data() { return m_Data.data(); }
+        const uint8_t* Data() const { return m_Data.data(); }
+        uint8_t* SampleData(uint32_t n) { return m_Data.data() + (size_t)n * BatchLength() * ElementSize(); }
+        const uint8_t* SampleData(uint32_t n) const { return m_Data.data() + (size_t)n * BatchLength() * ElementSize(); }
+
+        // Expands given samples into target, its batch is resized to number of samples. Samples are expanded in parallel.
+        void Expand(const vector<uint32_t>& samples, Tensor& target) const;
+        void Expand(uint32_t firstSample, uint32_t samplesNum, Tensor& target) const;
+        Tensor ToTensor() const;
+
+    private:
+        void ExpandSample(uint32_t n, float* dst) const;
+
+        Shape m_Shape = Shape(0);
+        ECompactElementType m_Type = COMPACT_UINT8;
+        float m_Scale = 1.f;
+        float m_Offset = 0.f;
+        vector<uint8_t> m_Data;
+    };
+
+    // Loads batches of samples from compact tensors (one destination tensor per source), samples are expanded to floats by
+    // preloader worker. Batches consist of random samples or of consecutive ones (wrapping around at the end).
+    class NEURO_DLL_EXPORT CompactTensorLoader : public ILoader
+    {
+    public:
+        CompactTensorLoader(const vector<const CompactTensor*>& sources, uint32_t batchSize, bool shuffle = true, unsigned int seed = 0);
+
+        virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
+
+    private:
+        vector<const CompactTensor*> m_Sources;
+        uint32_t m_BatchSize;
+        bool m_Shuffle;
+        Random m_Rng;
+        uint32_t m_NextSample = 0;
+    };
+}
+
+#pragma warning(pop)
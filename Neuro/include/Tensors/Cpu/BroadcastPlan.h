@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+
+#include "Tensors/Shape.h"
+
+namespace Neuro
+{
+    using namespace std;
+
+    // Describes how two operands of elementwise binary operation map onto output. Leading dimensions in which both operands are
+    // either identical to output or entirely broadcasted are collapsed into a single contiguous block, so that the inner loop
+    // never has to deal with modulo indexing. This covers scalar, per-row (ie. bias in dense layer), per-channel (ie. batch
+    // normalization scale/shift) and batch-repeat operands. Remaining dimensions are iterated over block by block.
+    struct BroadcastPlan
+    {
+        BroadcastPlan(const Shape& t1Shape, const Shape& t2Shape, const Shape& outputShape)
+            : m_T1Shape(t1Shape), m_T2Shape(t2Shape), m_OutputShape(outputShape)
+        {
+            uint32_t axes = 4;
+            while (axes > 0 && (!CanCollapse(t1Shape, axes) || !CanCollapse(t2Shape, axes)))
+                --axes;
+
+            m_CollapsedAxes = axes;
+            BlockLen = 1;
+            for (uint32_t i = 0; i < axes; ++i)
+                BlockLen *= outputShape.Len(i);
+            BlocksNum = outputShape.Length / BlockLen;
+
+            // when a single value from given operand is used for the whole block
+            T1Repeat = BlockLen > 1 && IsRepeated(t1Shape, axes);
+            T2Repeat = BlockLen > 1 && IsRepeated(t2Shape, axes);
+
+            // large blocks are split into chunks, so there is enough work to distribute across threads even for few blocks
+            ChunkLen = min(BlockLen, (uint32_t)CHUNK_LEN);
+            ChunksPerBlock = (BlockLen + ChunkLen - 1) / ChunkLen;
+            TasksNum = BlocksNum * ChunksPerBlock;
+        }
+
+        // Computes offsets of the first elements used by given output block
+        void BlockOffsets(uint32_t block, uint32_t& t1Offset, uint32_t& t2Offset) const
+        {
+            t1Offset = t2Offset = 0;
+            for (uint32_t i = m_CollapsedAxes; i < 4; ++i)
+            {
+                uint32_t idx = block % m_OutputShape.Len(i);
+                block /= m_OutputShape.Len(i);
+                t1Offset += (idx % m_T1Shape.Len(i)) * m_T1Shape.Str(i);
+                t2Offset += (idx % m_T2Shape.Len(i)) * m_T2Shape.Str(i);
+            }
+        }
+
+        static const uint32_t CHUNK_LEN = 16384;
+
+        uint32_t BlockLen;
+        uint32_t BlocksNum;
+        bool T1Repeat;
+        bool T2Repeat;
+        // single task processes single chunk of a block
+        uint32_t ChunkLen;
+        uint32_t ChunksPerBlock;
+        uint32_t TasksNum;
+
+    private:
+        bool IsRepeated(const Shape& shape, uint32_t axes) const
+        {
+            for (uint32_t i = 0; i < axes; ++i)
+                if (shape.Len(i) != 1)
+                    return false;
+            return true;
+        }
+
+        bool IsFull(const Shape& shape, uint32_t axes) const
+        {
+            for (uint32_t i = 0; i < axes; ++i)
+                if (shape.Len(i) != m_OutputShape.Len(i))
+                    return false;
+            return true;
+        }
+
+        bool CanCollapse(const Shape& shape, uint32_t axes) const { return IsFull(shape, axes) || IsRepeated(shape, axes); }
+
+        const Shape& m_T1Shape;
+        const Shape& m_T2Shape;
+        const Shape& m_OutputShape;
+        uint32_t m_CollapsedAxes;
+    };
+
+    // Runs elementwise binary operation with broadcasting according to plan for tasks in [taskBegin, taskEnd). Op should be a lambda
+    // so that it can be inlined into contiguous inner loops which compiler is able to vectorize.
+    template <typename Op>
+    void BroadcastElementwise(const float* t1Values, const float* t2Values, float* outputValues, const BroadcastPlan& plan, uint32_t taskBegin, uint32_t taskEnd, Op op)
+    {
+        for (uint32_t task = taskBegin; task < taskEnd; ++task)
+        {
+            uint32_t block = task / plan.ChunksPerBlock;
+            uint32_t begin = (task % plan.ChunksPerBlock) * plan.ChunkLen;
+            uint32_t len = min(plan.ChunkLen, plan.BlockLen - begin);
+
+            uint32_t t1Offset, t2Offset;
+            plan.BlockOffsets(block, t1Offset, t2Offset);
+
+            const float* a = t1Values + t1Offset + (plan.T1Repeat ? 0 : begin);
+            const float* b = t2Values + t2Offset + (plan.T2Repeat ? 0 : begin);
+            float* out = outputValues + (size_t)block * plan.BlockLen + begin;
+
+            if (!plan.T1Repeat && !plan.T2Repeat)
+            {
+                for (uint32_t i = 0; i < len; ++i)
+                    out[i] = op(a[i], b[i]);
+            }
+            else if (!plan.T1Repeat)
+            {
+                const float bVal = *b;
+                for (uint32_t i = 0; i < len; ++i)
+                    out[i] = op(a[i], bVal);
+            }
+            else if (!plan.T2Repeat)
+            {
+                const float aVal = *a;
+                for (uint32_t i = 0; i < len; ++i)
+                    out[i] = op(aVal, b[i]);
+            }
+            else
+                fill(out, out + len, op(*a, *b));
+        }
+    }
+
+    // Runs all tasks of a plan using OpenMP
+    template <typename Op>
+    void BroadcastElementwise(const float* t1Values, const float* t2Values, float* outputValues, const BroadcastPlan& plan, Op op)
+    {
+        #pragma omp parallel for if ((size_t)plan.BlocksNum * plan.BlockLen > BroadcastPlan::CHUNK_LEN)
+        for (int task = 0; task < (int)plan.TasksNum; ++task)
+            BroadcastElementwise(t1Values, t2Values, outputValues, plan, (uint32_t)task, (uint32_t)task + 1, op);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Types.h"
+
+namespace Neuro
+{
+    struct NEURO_DLL_EXPORT CpuKernels
+    {
+        // Per-row bias followed by activation, applied to values as soon as they are final (Softmax is not supported)
+        struct Epilogue
+        {
+            const float* rowBias;
+            EActivation activation;
+            float activationAlpha;
+        };
+
+        // Row-major single precision matrix multiplication C = alpha * op(A) * op(B) + beta * C, where op(A) is MxK, op(B) is KxN and C is MxN.
+        // Uses AVX-512 or AVX2 micro kernel depending on what is supported by CPU it is running on, with scalar fallback.
+        // When allowThreads is false it runs entirely on calling thread (useful when caller already parallelizes over multiple matrices).
+        // Optional epilogue is applied to every tile of C right after its last K slice is accumulated, while the tile is still in cache.
+        static void Sgemm(bool transA, bool transB, int m, int n, int k, float alpha, const float* a, int lda, const float* b, int ldb, float beta, float* c, int ldc, bool allowThreads = true, const Epilogue* epilogue = nullptr);
+
+        // Adds bias to len contiguous values and applies activation in a single pass
+        static void BiasActivation(float* values, int len, float bias, EActivation activation, float activationAlpha);
+
+        // Converts row of 8-bit pixels (3 or 4 bytes per pixel) into floats, optionally subtracting per channel mean. channelOffsets selects
+        // byte of a pixel for each of 3 output channels, so channels can be reordered during conversion. For NCHW output channels are
+        // channelStride values apart, for NHWC they are interleaved and channelStride is ignored.
+        static void PixelRowToFloat(const uint8_t* src, int width, int bytesPerPixel, const int channelOffsets[3], const float* channelMeans, EDataFormat dataFormat, int channelStride, float* dst);
+        // Writes row of 8-bit pixels (3 or 4 bytes per pixel) in reverse order, src and dst cannot overlap
+        static void PixelRowFlip(const uint8_t* src, int width, int bytesPerPixel, uint8_t* dst);
+        // Computes dst = saturate(round(src * gain + offset)) for row of 8-bit pixels, gain and offset are picked per byte of a pixel.
+        // It can run in place.
+        static void PixelRowAffine(const uint8_t* src, int width, int bytesPerPixel, const float* gains, const float* offsets, uint8_t* dst);
+
+        // Expands 8-bit values to floats computing value * scale + offset
+        static void Uint8ToFloat(const uint8_t* src, int len, float scale, float offset, float* dst);
+        // Half precision (IEEE 754 binary16) conversions, values are rounded to nearest even
+        static void HalfToFloat(const uint16_t* src, int len, float* dst);
+        static void FloatToHalf(const float* src, int len, uint16_t* dst);
+
+        static bool SupportsAvx2();
+        static bool SupportsAvx512();
+        static bool SupportsF16C();
+
+        // Lowers single sample of convolution input into columns matrix. For NCHW columns matrix is (kernelLen x outputLen), for NHWC it is (outputLen x kernelLen),
+        // where kernelLen = channels * kernelHeight * kernelWidth and outputLen = outHeight * outWidth. Kernel elements are ordered the same way as in kernels tensor.
+        static void Im2Col(const float* input, int channels, int height, int width, int kernelHeight, int kernelWidth, int stride, int paddingX, int paddingY, int outHeight, int outWidth, EDataFormat dataFormat, float* col);
+        // Reverse of Im2Col, columns are accumulated into input (it has to be zeroed beforehand)
+        static void Col2Im(const float* col, int channels, int height, int width, int kernelHeight, int kernelWidth, int stride, int paddingX, int paddingY, int outHeight, int outWidth, EDataFormat dataFormat, float* input);
+    };
+}
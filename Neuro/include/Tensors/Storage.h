@@ -41,6 +41,12 @@ namespace Neuro
 
         void AllocateOnHost() const;
         void FreeOnHost();
+        /// Host data will be placed in externally owned memory (ie. memory planner arena) instead of being allocated by memory manager.
+        /// Binding is dropped automatically when storage grows beyond capacity.
+        void BindHostMemory(float* ptr, size_t capacity);
+        void UnbindHostMemory();
+        bool IsHostMemoryBound() const { return m_BoundDataPtr != nullptr; }
+        bool CanBindHostMemory() const { return !(m_Type & ST_Offloadable) && !m_DeviceDataPtr; }
 
         void AllocateOnDevice() const;
         void FreeOnDevice(bool force = false, bool forceWaitForOffload = false);
@@ -95,6 +101,8 @@ namespace Neuro
 
         float* m_DataPtr = nullptr;
         float* m_DeviceDataPtr = nullptr;
+        mutable float* m_BoundDataPtr = nullptr;
+        size_t m_BoundCapacity = 0;
         int m_Type = ST_Default;
         size_t m_AllocSize = 0;
         size_t m_Size = 0;
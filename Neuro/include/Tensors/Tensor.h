@@ -40,6 +40,8 @@ namespace Neuro
 		static void SetDefaultOpMode(EOpMode mode);
         static void SetForcedOpMode(EOpMode mode);
         static void ClearForcedOpMode();
+        // Whether op mode is forced on calling thread
+        static bool HasForcedOpMode();
 
         void SetOpMode(EOpMode mode);
 
@@ -310,6 +312,14 @@ namespace Neuro
         void LeakyReLUGradient(const Tensor& output, const Tensor& outputGradient, float alpha, Tensor& inputGradient) const;
         void Softmax(Tensor& result) const;
         void SoftmaxGradient(const Tensor& output, const Tensor& outputGradient, Tensor& inputGradient) const;
+        // Categorical cross entropy of softmax-ed logits (this) computed per batch using log-sum-exp, probabilities are saved for gradient
+        void SoftmaxCrossEntropy(const Tensor& target, Tensor& probabilities, Tensor& loss) const;
+        // Logits gradient is probabilities * sum(target) - target (scaled by loss gradient of given batch), either gradient can be null
+        void SoftmaxCrossEntropyGradient(const Tensor& probabilities, const Tensor& target, const Tensor& lossGradient, Tensor* logitsGradient, Tensor* targetGradient) const;
+        // Binary cross entropy of sigmoid-ed logits (this) computed elementwise as max(x, 0) - x * target + log(1 + exp(-|x|))
+        void SigmoidCrossEntropy(const Tensor& target, Tensor& loss) const;
+        // Logits gradient is sigmoid(logits) - target (scaled by loss gradient), either gradient can be null
+        void SigmoidCrossEntropyGradient(const Tensor& target, const Tensor& lossGradient, Tensor* logitsGradient, Tensor* targetGradient) const;
 
 		const Shape& GetShape() const { return m_Shape; }
 
@@ -325,6 +335,11 @@ namespace Neuro
         void IncRef(size_t n = 1);
         void DecRef(size_t n = 1);
         void ReleaseData();
+        /// Host data will be placed in externally owned memory (ie. memory planner arena) until unbound
+        void BindHostMemory(float* ptr, size_t capacity);
+        void UnbindHostMemory();
+        bool IsHostMemoryBound() const { return m_Storage.IsHostMemoryBound(); }
+        bool CanBindHostMemory() const { return m_Storage.CanBindHostMemory(); }
         void CopyToDevice() const;
         void CopyToHost(bool allowAlloc = false) const;
         /// Sync will copy data from device to host but it won't change location (useful for read-only operations performed on CPU)
@@ -360,10 +375,10 @@ namespace Neuro
 		static TensorOpCpu* GetOpFromMode(EOpMode mode);
 
 		static TensorOpCpu* g_DefaultOp;
-        static TensorOpCpu* g_ForcedOp;
 		static TensorOpCpu* g_OpCpu;
         static TensorOpCpu* g_OpCpuMt;
         static TensorOpCpu* g_OpCpuMkl;
+        static TensorOpCpu* g_OpCpuIm2Col;
         static TensorOpCpu* g_OpGpu;
 
         friend class TensorOpGpu;
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Types.h"
+#include "Tensors/Shape.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    class Tensor;
+    class MappedFile;
+
+    // Native binary format for tensors. File starts with a versioned header followed by a table of entries (name, shape and data
+    // offset) and data region. Data of every tensor is 64 bytes aligned and stored as raw floats, so memory mapped file can be used
+    // directly as tensors' host memory. Header contains a (non-cryptographic) checksum of the table and all tensors' data.
+    class NEURO_DLL_EXPORT TensorFile
+    {
+    public:
+        static const uint32_t VERSION = 1;
+        static const size_t DATA_ALIGNMENT = 64;
+
+        static void Write(ostream& stream, const vector<const Tensor*>& tensors, const vector<string>& names = {});
+        // When names are not provided tensors' names are used
+        static bool Save(const string& filename, const vector<const Tensor*>& tensors, const vector<string>& names = {});
+        // Reads and copies all tensors from stream, returns empty vector when stream doesn't contain valid tensor file
+        static vector<Tensor> Read(istream& stream, bool verifyChecksum = true);
+        static bool IsTensorFile(const string& filename);
+        static uint64_t HashBytes(const void* data, size_t size);
+
+        // Memory maps whole file, it has to outlive all tensors loaded without copying. Verifying checksum reads all the data
+        // up front, so it is opt-in to keep opening large files cheap.
+        explicit TensorFile(const string& filename, bool verifyChecksum = false);
+        ~TensorFile();
+        TensorFile(const TensorFile&) = delete;
+        TensorFile& operator=(const TensorFile&) = delete;
+
+        bool IsValid() const { return m_Error.empty(); }
+        const string& Error() const { return m_Error; }
+
+        size_t TensorsNum() const { return m_Entries.size(); }
+        const string& Name(size_t idx) const { return m_Entries[idx].name; }
+        const Shape& GetShape(size_t idx) const { return m_Entries[idx].shape; }
+        const float* Data(size_t idx) const;
+        // Returns -1 when there is no tensor with given name
+        int Find(const string& name) const;
+
+        // Resizes target and fills it with given tensor's data. When possible (target's storage allows binding external memory)
+        // target's host memory is bound directly to mapped file, otherwise data is copied. Mapping is copy-on-write so modifying
+        // bound tensor never changes the file.
+        void Load(size_t idx, Tensor& target, bool zeroCopy = true) const;
+
+    private:
+        struct Entry
+        {
+            string name;
+            Shape shape;
+            uint64_t offset;
+        };
+
+        // Returns error message or empty string when table is valid
+        static string ParseTable(const uint8_t* table, uint64_t tableSize, uint32_t tensorsNum, uint64_t dataSize, vector<Entry>& entries);
+
+        unique_ptr<MappedFile> m_File;
+        vector<Entry> m_Entries;
+        const uint8_t* m_Data = nullptr;
+        string m_Error;
+    };
+}
+
+#pragma warning(pop)
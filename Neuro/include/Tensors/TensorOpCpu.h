@@ -71,6 +71,10 @@ namespace Neuro
         virtual void LeakyReLUGradient(const Tensor& output, const Tensor& outputGradient, float alpha, Tensor& inputGradient) const;
         virtual void Softmax(const Tensor& input, Tensor& output) const;
         virtual void SoftmaxGradient(const Tensor& output, const Tensor& outputGradient, Tensor& inputGradient) const;
+        virtual void SoftmaxCrossEntropy(const Tensor& logits, const Tensor& target, Tensor& probabilities, Tensor& loss) const;
+        virtual void SoftmaxCrossEntropyGradient(const Tensor& logits, const Tensor& probabilities, const Tensor& target, const Tensor& lossGradient, Tensor* logitsGradient, Tensor* targetGradient) const;
+        virtual void SigmoidCrossEntropy(const Tensor& logits, const Tensor& target, Tensor& loss) const;
+        virtual void SigmoidCrossEntropyGradient(const Tensor& logits, const Tensor& target, const Tensor& lossGradient, Tensor* logitsGradient, Tensor* targetGradient) const;
         virtual void ExtractSubTensor2D(const Tensor& input, uint32_t widthOffset, uint32_t heightOffset, Tensor& output) const;
         virtual void FuseSubTensor2D(const Tensor& input, uint32_t widthOffset, uint32_t heightOffset, bool add, Tensor& output) const;
         virtual void AdamStep(Tensor& parameter, const Tensor& gradient, Tensor& mGrad, Tensor& vGrad, float lr, float beta1, float beta2, float epsilon) const;
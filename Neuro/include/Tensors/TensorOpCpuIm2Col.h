@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Tensors/TensorOpCpu.h"
+
+namespace Neuro
+{
+    // Lowers convolutions to matrix multiplications by unrolling input patches into columns (im2col)
+    class NEURO_DLL_EXPORT TensorOpCpuIm2Col : public TensorOpCpu
+    {
+    public:
+        virtual EOpMode OpMode() const { return CPU_IM2COL; }
+
+        virtual void Conv2D(const Tensor& input, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, EDataFormat dataFormat, Tensor& output) const override;
+        // Bias and activation are applied in GEMM epilogue
+        virtual void Conv2DBiasActivation(const Tensor& input, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, const Tensor& bias, EActivation activation, float activationAlpha, Tensor& output) override;
+        virtual void Conv2DInputGradient(const Tensor& gradient, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, EDataFormat dataFormat, Tensor& inputGradient) const override;
+        virtual void Conv2DKernelsGradient(const Tensor& input, const Tensor& gradient, uint32_t stride, uint32_t paddingX, uint32_t paddingY, EDataFormat dataFormat, Tensor& kernelsGradient) const override;
+    };
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Types.h"
+
+#pragma warning(push)
+#pragma warning(disable:4251)
+
+namespace Neuro
+{
+    using namespace std;
+
+    // Portable work-stealing thread pool. Every worker owns a queue of chunks, it processes it from the front and when it runs
+    // out of work it steals from the back of other workers' queues. Thread calling ParallelFor takes part in processing as well,
+    // so nested ParallelFor calls (ie. from inside of another ParallelFor body) cannot deadlock.
+    class NEURO_DLL_EXPORT ThreadPool
+    {
+    public:
+        // Passing 0 will create as many threads as there are hardware threads available (including calling thread)
+        explicit ThreadPool(uint32_t threadsNum = 0);
+        ~ThreadPool();
+
+        // Pool shared by all CPU tensor operations
+        static ThreadPool& Default();
+
+        // Splits [begin, end) into chunks of at least grainSize elements and runs body(chunkBegin, chunkEnd) for each of them.
+        // Returns once all chunks have been processed, first exception thrown by body is rethrown afterwards.
+        void ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const function<void(uint32_t, uint32_t)>& body);
+
+        // Schedules a single task to be run asynchronously by any of the threads. Task must not throw, exception escaping it would
+        // terminate the worker thread; tasks have to capture their errors and report them to whoever is waiting for them.
+        void Enqueue(const function<void()>& task);
+        // Runs one pending chunk or task on calling thread, returns false when there was nothing to run. Threads waiting for
+        // enqueued tasks to finish should call it instead of blocking.
+        bool RunPendingTask();
+
+        uint32_t ThreadsNum() const { return (uint32_t)m_Workers.size() + 1; }
+
+    private:
+        struct Job
+        {
+            const function<void(uint32_t, uint32_t)>* body;
+            atomic<uint32_t> pendingChunks;
+            // enqueued tasks are owned by the pool and deleted once processed
+            function<void(uint32_t, uint32_t)> ownedBody;
+            bool owned = false;
+            // first exception thrown by any of the chunks
+            exception_ptr error;
+            mutex errorLock;
+        };
+
+        struct Chunk
+        {
+            Job* job;
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        struct WorkQueue
+        {
+            mutex lock;
+            deque<Chunk> chunks;
+        };
+
+        void Push(uint32_t queueIdx, const Chunk& chunk);
+        uint32_t CurrentQueue() const;
+        void WorkerLoop(uint32_t queueIdx);
+        bool TryRunChunk(uint32_t queueIdx);
+        bool TryPop(uint32_t queueIdx, bool steal, Chunk& chunk);
+
+        vector<thread> m_Workers;
+        vector<unique_ptr<WorkQueue>> m_Queues;
+        atomic<uint32_t> m_QueuedChunks;
+        atomic<uint32_t> m_NextQueue;
+        mutex m_WakeLock;
+        condition_variable m_WakeCondition;
+        bool m_Stop = false;
+    };
+}
+
+#pragma warning(pop)
@@ -29,6 +29,7 @@ namespace Neuro
 
 	class Tensor;
     class Variable;
+    class CompactTensor;
 
     const float _EPSILON = 10e-7f;
     
@@ -61,19 +62,28 @@ namespace Neuro
     NEURO_DLL_EXPORT void LoadMnistData(const string& imagesFile, const string& labelsFile, Tensor& input, Tensor& output, bool normalize, bool generateImage = false, int maxImages = -1);
     //void SaveMnistData(const Tensor& input, const Tensor& output, const string& imagesFile, const string& labelsFile);
     NEURO_DLL_EXPORT void LoadCifar10Data(const string& imagesFile, Tensor& input, Tensor& output, bool normalize, bool generateImage = false, int maxImages = -1);
+    // Compact versions keep images as raw bytes (normalization is applied through scale when they are expanded) and labels as
+    // one-hot encoded bytes, so datasets take 4 times less memory
+    NEURO_DLL_EXPORT void LoadMnistData(const string& imagesFile, const string& labelsFile, CompactTensor& input, CompactTensor& output, bool normalize, int maxImages = -1);
+    NEURO_DLL_EXPORT void LoadCifar10Data(const string& imagesFile, CompactTensor& input, CompactTensor& output, bool normalize, int maxImages = -1);
     NEURO_DLL_EXPORT void SaveCifar10Data(const string& imagesFile, const Tensor& input, const Tensor& output);
     NEURO_DLL_EXPORT void LoadCSVData(const string& filename, int outputsNum, Tensor& inputs, Tensor& outputs, bool outputsOneHotEncoded = false, int maxLines = -1);
 
     // Loaded tensor is flat and internal data layout is NHWC, it should be transposed and normalized before use
-    NEURO_DLL_EXPORT void LoadImage(const string& filename, float* buffer, uint32_t targetSizeX = 0, uint32_t targetSizeY = 0, uint32_t cropSizeX = 0, uint32_t cropSizeY = 0, EDataFormat targetFormat = NCHW);
-    NEURO_DLL_EXPORT Tensor LoadImage(const string& filename, uint32_t targetSizeX = 0, uint32_t targetSizeY = 0, uint32_t cropSizeX = 0, uint32_t cropSizeY = 0, EDataFormat targetFormat = NCHW);
+    // Optional channel means (in RGB order) are subtracted and channels can be swapped to BGR while converting pixels (see VGG16::CHANNEL_MEANS)
+    NEURO_DLL_EXPORT void LoadImage(const string& filename, float* buffer, uint32_t targetSizeX = 0, uint32_t targetSizeY = 0, uint32_t cropSizeX = 0, uint32_t cropSizeY = 0, EDataFormat targetFormat = NCHW, const float* channelMeans = nullptr, bool swapChannels = false);
+    NEURO_DLL_EXPORT Tensor LoadImage(const string& filename, uint32_t targetSizeX = 0, uint32_t targetSizeY = 0, uint32_t cropSizeX = 0, uint32_t cropSizeY = 0, EDataFormat targetFormat = NCHW, const float* channelMeans = nullptr, bool swapChannels = false);
     NEURO_DLL_EXPORT Tensor LoadImage(uint8_t* imageBuffer, uint32_t width, uint32_t height, EPixelFormat format = RGB);
     NEURO_DLL_EXPORT void SaveImage(const Tensor& t, const string& imageFile, bool denormalize, uint32_t maxCols = 0);
     NEURO_DLL_EXPORT bool IsImageFileValid(const string& filename);
     NEURO_DLL_EXPORT Shape GetShapeForMinSize(const Shape& shape, uint32_t minSize);
     NEURO_DLL_EXPORT Shape GetShapeForMaxSize(const Shape& shape, uint32_t maxSize);
+    // Dimensions of unmodified images validated by LoadFilesList are known without reading the file, otherwise only image header is read
     NEURO_DLL_EXPORT Shape GetImageDims(const string& filename);
 
+    // Without validation directory is only listed, files which cache marks as invalid are still skipped. Validation decodes files in parallel, cache (stored next to the directory) keeps
+    // modification time, validation result and image dimensions of every file so only files changed since they were validated are
+    // decoded again. Cache is updated as validation progresses so interrupted scan can be resumed.
     NEURO_DLL_EXPORT vector<string> LoadFilesList(const string& dir, bool shuffle, bool useCache = true, bool validate = false);
 
     NEURO_DLL_EXPORT void SampleImagesBatch(const vector<string>& files, Tensor& output, bool shuffle = true);
@@ -107,11 +117,61 @@ namespace Neuro
     {
         ImageLoader(const vector<string>& files, uint32_t batchSize, uint32_t upScaleFactor = 1) : m_Files(files), m_BatchSize(batchSize), m_UpScaleFactor(upScaleFactor) {}
 
+        // Images of a batch are decoded in parallel
         virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
+        // Derived loaders keeping their own state (ie. random generator) have to override it back to false
+        virtual bool Reentrant() const override { return true; }
 
         vector<string> m_Files;
         uint32_t m_BatchSize;
         uint32_t m_UpScaleFactor;
+        // Preprocessing fused into pixel conversion, same as in LoadImage
+        vector<float> m_ChannelMeans;
+        bool m_SwapChannels = false;
+    };
+
+    // Random augmentation of images done while they are loaded. All steps work on 8-bit pixels (before conversion to floats) in
+    // loader's worker threads so their cost hides behind training. Steps are applied in fixed order: scale jitter, crop, flip,
+    // color jitter and conversion with mean subtraction.
+    struct NEURO_DLL_EXPORT ImageAugmentation
+    {
+        // Image is rescaled to cover output size multiplied by random factor from given range (1 means it fits exactly)
+        ImageAugmentation& ScaleJitter(float minScale, float maxScale) { m_MinScale = minScale; m_MaxScale = maxScale; return *this; }
+        // Output is cropped at random position instead of the center
+        ImageAugmentation& RandomCrop(bool enable = true) { m_RandomCrop = enable; return *this; }
+        ImageAugmentation& HorizontalFlip(float probability = 0.5f) { m_FlipProbability = probability; return *this; }
+        // Brightness is the largest offset added to pixel values, contrast and color are the largest relative changes of contrast
+        // and of every channel's intensity
+        ImageAugmentation& ColorJitter(float brightness, float contrast, float color = 0.f) { m_Brightness = brightness; m_Contrast = contrast; m_Color = color; return *this; }
+        // Subtracts channel means (in RGB order) and optionally swaps channels to BGR (see VGG16::CHANNEL_MEANS)
+        ImageAugmentation& Normalize(const float channelMeans[3], bool swapChannels = false) { m_ChannelMeans.assign(channelMeans, channelMeans + 3); m_SwapChannels = swapChannels; return *this; }
+
+        // Loads image and writes its augmented version of given size to output in NCHW format
+        void Apply(const string& filename, uint32_t width, uint32_t height, Random& rng, float* output) const;
+
+        float m_MinScale = 1.f;
+        float m_MaxScale = 1.f;
+        bool m_RandomCrop = false;
+        float m_FlipProbability = 0.f;
+        float m_Brightness = 0.f;
+        float m_Contrast = 0.f;
+        float m_Color = 0.f;
+        vector<float> m_ChannelMeans;
+        bool m_SwapChannels = false;
+    };
+
+    // Loads batches of random images augmented on the fly, output size is taken from destination tensor
+    struct NEURO_DLL_EXPORT AugmentedImageLoader : public ILoader
+    {
+        AugmentedImageLoader(const vector<string>& files, uint32_t batchSize, const ImageAugmentation& augmentation) : m_Files(files), m_BatchSize(batchSize), m_Augmentation(augmentation) {}
+
+        // Images of a batch are decoded and augmented in parallel
+        virtual size_t operator()(vector<Tensor>& dest, size_t loadIdx) override;
+        virtual bool Reentrant() const override { return true; }
+
+        vector<string> m_Files;
+        uint32_t m_BatchSize;
+        ImageAugmentation m_Augmentation;
     };
 
     class NEURO_DLL_EXPORT Tqdm
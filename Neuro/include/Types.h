@@ -36,6 +36,7 @@ namespace Neuro
         CPU,
         CPU_MKL,
         CPU_MT,
+        CPU_IM2COL,
         GPU
     };
 
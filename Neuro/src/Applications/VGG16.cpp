@@ -11,10 +11,12 @@
 
 namespace Neuro
 {
+    const float VGG16::CHANNEL_MEANS[3] = { 123.68f, 116.779f, 103.939f };
+
     //////////////////////////////////////////////////////////////////////////
     void VGG16::PreprocessImage(Tensor& image, EDataFormat dataFormat, bool swapChannels)
     {
-        image.Sub(Tensor({ 123.68f, 116.779f, 103.939f }, dataFormat == NHWC ? Shape(3) : Shape(1, 1, 3)), image);
+        image.Sub(Tensor({ CHANNEL_MEANS[0], CHANNEL_MEANS[1], CHANNEL_MEANS[2] }, dataFormat == NHWC ? Shape(3) : Shape(1, 1, 3)), image);
         //VGG networks were trained on BGR images so for RGB we have to swap channels
         if (swapChannels) // weights in first conv layer of VGG are expecting image in BGR format
             SwapChannels(image);
@@ -37,7 +39,7 @@ namespace Neuro
         if (swapChannels)
             SwapChannels(image);
 
-        image.Add(Tensor({ 123.68f, 116.779f, 103.939f }, dataFormat == NHWC ? Shape(3) : Shape(1, 1, 3)), image);
+        image.Add(Tensor({ CHANNEL_MEANS[0], CHANNEL_MEANS[1], CHANNEL_MEANS[2] }, dataFormat == NHWC ? Shape(3) : Shape(1, 1, 3)), image);
 
         if (clipValues)
             image.Clip(0, 255, image);
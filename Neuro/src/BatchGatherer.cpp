@@ -0,0 +1,108 @@
+#include <cstring>
+
+#include "BatchGatherer.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    // minimum number of values copied by a single thread
+    static const uint32_t GATHER_GRAIN_LENGTH = 16384;
+
+    //////////////////////////////////////////////////////////////////////////
+    BatchGatherer::BatchGatherer(const const_tensor_ptr_vec_t& sources, uint32_t maxBatchSize)
+        : m_Sources(sources), m_MaxBatchSize(maxBatchSize)
+    {
+        for (auto source : m_Sources)
+        {
+            NEURO_ASSERT(source->Batch() == m_Sources[0]->Batch(), "Number of samples across all sources must match.");
+            // sources are read from background thread so they have to be on host already
+            source->CopyToHost();
+
+            for (auto& buffers : m_Buffers)
+                buffers.push_back(Tensor(Shape::From(source->GetShape(), maxBatchSize)));
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    BatchGatherer::~BatchGatherer()
+    {
+        if (m_Prefetch.valid())
+            m_Prefetch.wait();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    const_tensor_ptr_vec_t BatchGatherer::Gather(const vector<uint32_t>& indices)
+    {
+        if (m_Prefetch.valid())
+        {
+            m_Prefetch.get();
+            if (m_PrefetchedIndices == indices)
+                m_CurrentBuffers = 1 - m_CurrentBuffers;
+            else
+                GatherInto(m_Buffers[m_CurrentBuffers], indices);
+        }
+        else
+            GatherInto(m_Buffers[m_CurrentBuffers], indices);
+
+        const_tensor_ptr_vec_t batch;
+        for (auto& buffer : m_Buffers[m_CurrentBuffers])
+            batch.push_back(&buffer);
+        return batch;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void BatchGatherer::Prefetch(const vector<uint32_t>& indices)
+    {
+        if (m_Prefetch.valid())
+            m_Prefetch.get();
+
+        m_PrefetchedIndices = indices;
+        vector<Tensor>* buffers = &m_Buffers[1 - m_CurrentBuffers];
+        m_Prefetch = async(launch::async, [this, buffers]() { GatherInto(*buffers, m_PrefetchedIndices); });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void BatchGatherer::GatherInto(vector<Tensor>& buffers, const vector<uint32_t>& indices) const
+    {
+        NEURO_ASSERT(indices.size() <= m_MaxBatchSize, "Batch of " << indices.size() << " samples exceeds maximum batch size " << m_MaxBatchSize << ".");
+        const uint32_t batchSize = (uint32_t)indices.size();
+
+        bool consecutive = batchSize > 0;
+        for (uint32_t n = 1; n < batchSize && consecutive; ++n)
+            consecutive = indices[n] == indices[0] + n;
+
+        for (size_t i = 0; i < m_Sources.size(); ++i)
+        {
+            auto& source = *m_Sources[i];
+            auto& buffer = buffers[i];
+            const uint32_t sampleLen = source.BatchLength();
+
+            // buffer may still be pointed at source memory since previous batch, its device copy (made when it was fed to the model)
+            // has to be released as well, otherwise it couldn't be allocated on host again
+            if (buffer.IsHostMemoryBound())
+            {
+                buffer.ReleaseData();
+                buffer.UnbindHostMemory();
+            }
+            buffer.ResizeBatch(batchSize);
+
+            if (consecutive && buffer.CanBindHostMemory())
+            {
+                buffer.BindHostMemory(const_cast<float*>(source.Values()) + (size_t)indices[0] * sampleLen, buffer.Length());
+                buffer.OverrideHost();
+                continue;
+            }
+
+            buffer.OverrideHost();
+            const float* sourceValues = source.Values();
+            float* bufferValues = buffer.Values();
+
+            ThreadPool::Default().ParallelFor(0, batchSize, max(1u, GATHER_GRAIN_LENGTH / sampleLen), [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t n = begin; n < end; ++n)
+                    memcpy(bufferValues + (size_t)n * sampleLen, sourceValues + (size_t)indices[n] * sampleLen, sampleLen * sizeof(float));
+            });
+        }
+    }
+}
@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include "CSVLoader.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+#include "Tensors/Tensor.h"
+
+namespace Neuro
+{
+    // file is split into chunks of at least this size when loading all rows
+    static const size_t CSV_CHUNK_SIZE = 4 << 20;
+    // minimum number of rows parsed by a single thread
+    static const uint32_t CSV_ROWS_GRAIN = 64;
+
+    static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    //////////////////////////////////////////////////////////////////////////
+    static bool IsTrimmed(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r' || c == '"';
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static bool IsEmptyLine(const char* line, const char* lineEnd)
+    {
+        return line == lineEnd || (lineEnd - line == 1 && *line == '\r');
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    float CSVFile::ParseFloat(const char* begin, const char* end)
+    {
+        while (begin < end && IsTrimmed(*begin))
+            ++begin;
+        while (end > begin && IsTrimmed(end[-1]))
+            --end;
+
+        const char* p = begin;
+        bool negative = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+'))
+            ++p;
+
+        // only first 19 significant digits fit into mantissa, remaining ones just scale it
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa > 0 ? 1 : 0;
+            }
+            else
+                ++exponent;
+        }
+
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p)
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    digits += mantissa > 0 ? 1 : 0;
+                    --exponent;
+                }
+            }
+        }
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            bool negativeExp = p < end && *p == '-';
+            if (p < end && (*p == '-' || *p == '+'))
+                ++p;
+            int exp = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; ++p)
+                exp = min(exp * 10 + (*p - '0'), 10000);
+            exponent += negativeExp ? -exp : exp;
+        }
+
+        // anything unusual (ie. nan, inf, hex) is left to standard library
+        if (p != end)
+            return (float)atof(string(begin, end).c_str());
+
+        double value = (double)mantissa;
+        for (; exponent > 22; exponent -= 22)
+            value *= POW10[22];
+        for (; exponent < -22; exponent += 22)
+            value /= POW10[22];
+        value = exponent >= 0 ? value * POW10[exponent] : value / POW10[-exponent];
+
+        return (float)(negative ? -value : value);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    CSVFile::CSVFile(const string& filename, int outputsNum, const CSVOptions& options)
+        : m_Delimiter(options.delimiter), m_OutputsOneHotEncoded(options.outputsOneHotEncoded)
+    {
+        m_File = make_unique<MappedFile>(filename);
+        if (!m_File->Data())
+            return;
+
+        m_Data = (const char*)m_File->Data();
+        const char* dataEnd = m_Data + DataEnd();
+
+        const char* line = m_Data;
+        if (DataEnd() >= 3 && memcmp(line, "\xEF\xBB\xBF", 3) == 0)
+            line += 3;
+
+        if (options.header)
+        {
+            const char* lineEnd = LineEnd(line);
+            for (const char* field = line; field <= lineEnd;)
+            {
+                const char* fieldEnd = find(field, lineEnd, m_Delimiter);
+                const char* nameBegin = field;
+                const char* nameEnd = fieldEnd;
+                while (nameBegin < nameEnd && IsTrimmed(*nameBegin))
+                    ++nameBegin;
+                while (nameEnd > nameBegin && IsTrimmed(nameEnd[-1]))
+                    --nameEnd;
+                m_ColumnNames.push_back(string(nameBegin, nameEnd));
+                field = fieldEnd + 1;
+            }
+            line = min(lineEnd + 1, dataEnd);
+        }
+
+        m_DataBegin = line - m_Data;
+
+        // number of columns is determined by header or the first non-empty row
+        uint32_t columnsNum = (uint32_t)m_ColumnNames.size();
+        for (; !columnsNum && line < dataEnd; line = LineEnd(line) + 1)
+        {
+            const char* lineEnd = LineEnd(line);
+            if (!IsEmptyLine(line, lineEnd))
+                columnsNum = (uint32_t)count(line, lineEnd, m_Delimiter) + 1;
+        }
+
+        vector<uint32_t> columns = options.columns;
+        for (auto& name : options.columnNames)
+        {
+            auto it = find(m_ColumnNames.begin(), m_ColumnNames.end(), name);
+            NEURO_ASSERT(it != m_ColumnNames.end(), "Column '" << name << "' not found in '" << filename << "'.");
+            columns.push_back((uint32_t)(it - m_ColumnNames.begin()));
+        }
+
+        if (columns.empty())
+        {
+            columns.resize(columnsNum);
+            for (uint32_t i = 0; i < columnsNum; ++i)
+                columns[i] = i;
+        }
+
+        for (uint32_t i = 0; i < (uint32_t)columns.size(); ++i)
+        {
+            if (columns[i] >= m_ColumnTargets.size())
+                m_ColumnTargets.resize(columns[i] + 1, -1);
+            NEURO_ASSERT(m_ColumnTargets[columns[i]] < 0, "Column " << columns[i] << " selected more than once.");
+            m_ColumnTargets[columns[i]] = (int)i;
+        }
+
+        uint32_t outputColumnsNum = m_OutputsOneHotEncoded ? 1 : (uint32_t)outputsNum;
+        NEURO_ASSERT(columns.size() >= outputColumnsNum, "Expected at least " << outputColumnsNum << " columns, found " << columns.size() << ".");
+        m_InputsNum = (uint32_t)columns.size() - outputColumnsNum;
+        m_OutputsNum = (uint32_t)outputsNum;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    const char* CSVFile::LineEnd(const char* line) const
+    {
+        const char* dataEnd = m_Data + DataEnd();
+        const char* lineEnd = (const char*)memchr(line, '\n', dataEnd - line);
+        return lineEnd ? lineEnd : dataEnd;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CSVFile::ParseRow(const char* row, const char* rowEnd, float* inputs, float* outputs) const
+    {
+        fill(inputs, inputs + m_InputsNum, 0.f);
+        fill(outputs, outputs + m_OutputsNum, 0.f);
+
+        const char* field = row;
+        for (size_t c = 0; c < m_ColumnTargets.size(); ++c)
+        {
+            const char* fieldEnd = (const char*)memchr(field, m_Delimiter, rowEnd - field);
+            if (!fieldEnd)
+                fieldEnd = rowEnd;
+
+            int target = m_ColumnTargets[c];
+            if (target >= 0)
+            {
+                float value = ParseFloat(field, fieldEnd);
+
+                if ((uint32_t)target < m_InputsNum)
+                    inputs[target] = value;
+                else if (!m_OutputsOneHotEncoded)
+                    outputs[target - m_InputsNum] = value;
+                else if (value >= 0 && (uint32_t)value < m_OutputsNum)
+                    outputs[(uint32_t)value] = 1.f;
+            }
+
+            if (fieldEnd == rowEnd)
+                break;
+            field = fieldEnd + 1;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CSVFile::Load(Tensor& inputs, Tensor& outputs, int maxRows) const
+    {
+        NEURO_ASSERT(IsValid(), "CSV file is not valid.");
+
+        const char* dataEnd = m_Data + DataEnd();
+
+        // chunks start at the beginning of a line
+        vector<const char*> chunks = { m_Data + m_DataBegin };
+        while (dataEnd - chunks.back() > (ptrdiff_t)CSV_CHUNK_SIZE)
+            chunks.push_back(min(LineEnd(chunks.back() + CSV_CHUNK_SIZE) + 1, dataEnd));
+        chunks.push_back(dataEnd);
+
+        const uint32_t chunksNum = (uint32_t)chunks.size() - 1;
+        vector<size_t> chunkRows(chunksNum + 1, 0);
+
+        ThreadPool::Default().ParallelFor(0, chunksNum, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t c = begin; c < end; ++c)
+            {
+                for (const char* line = chunks[c]; line < chunks[c + 1]; )
+                {
+                    const char* lineEnd = LineEnd(line);
+                    chunkRows[c + 1] += IsEmptyLine(line, lineEnd) ? 0 : 1;
+                    line = lineEnd + 1;
+                }
+            }
+        });
+
+        // turn counts into index of the first row of every chunk
+        for (uint32_t c = 0; c < chunksNum; ++c)
+            chunkRows[c + 1] += chunkRows[c];
+
+        uint32_t rowsNum = (uint32_t)chunkRows.back();
+        if (maxRows >= 0)
+            rowsNum = min(rowsNum, (uint32_t)maxRows);
+
+        inputs = Tensor(Shape(m_InputsNum, 1, 1, rowsNum));
+        outputs = Tensor(Shape(m_OutputsNum, 1, 1, rowsNum));
+        float* inputValues = inputs.Values();
+        float* outputValues = outputs.Values();
+
+        ThreadPool::Default().ParallelFor(0, chunksNum, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t c = begin; c < end; ++c)
+            {
+                size_t row = chunkRows[c];
+                for (const char* line = chunks[c]; line < chunks[c + 1] && row < rowsNum; )
+                {
+                    const char* lineEnd = LineEnd(line);
+                    if (!IsEmptyLine(line, lineEnd))
+                    {
+                        ParseRow(line, lineEnd, inputValues + row * m_InputsNum, outputValues + row * m_OutputsNum);
+                        ++row;
+                    }
+                    line = lineEnd + 1;
+                }
+            }
+        });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t CSVFile::Load(size_t offset, uint32_t rowsNum, float* inputs, float* outputs, uint32_t& parsedRowsNum) const
+    {
+        NEURO_ASSERT(IsValid(), "CSV file is not valid.");
+
+        const char* dataEnd = m_Data + DataEnd();
+
+        // finding rows is sequential, parsing them is not
+        vector<pair<const char*, const char*>> rows;
+        rows.reserve(rowsNum);
+        const char* line = m_Data + offset;
+        while (rows.size() < rowsNum && line < dataEnd)
+        {
+            const char* lineEnd = LineEnd(line);
+            if (!IsEmptyLine(line, lineEnd))
+                rows.push_back({ line, lineEnd });
+            line = lineEnd + 1;
+        }
+
+        ThreadPool::Default().ParallelFor(0, (uint32_t)rows.size(), CSV_ROWS_GRAIN, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t r = begin; r < end; ++r)
+                ParseRow(rows[r].first, rows[r].second, inputs + r * m_InputsNum, outputs + r * m_OutputsNum);
+        });
+
+        parsedRowsNum = (uint32_t)rows.size();
+        return min(line, dataEnd) - m_Data;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    CSVLoader::CSVLoader(const string& filename, int outputsNum, uint32_t batchSize, const CSVOptions& options)
+        : m_File(filename, outputsNum, options), m_BatchSize(batchSize)
+    {
+        NEURO_ASSERT(m_File.IsValid(), "Failed to open '" << filename << "'.");
+        m_Offset = m_File.DataBegin();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t CSVLoader::operator()(vector<Tensor>& dest, size_t loadIdx)
+    {
+        auto& inputs = dest[loadIdx];
+        auto& outputs = dest[loadIdx + 1];
+        NEURO_ASSERT(inputs.BatchLength() == m_File.InputsNum(), "Expected " << m_File.InputsNum() << " inputs, destination has " << inputs.BatchLength() << ".");
+        NEURO_ASSERT(outputs.BatchLength() == m_File.OutputsNum(), "Expected " << m_File.OutputsNum() << " outputs, destination has " << outputs.BatchLength() << ".");
+
+        inputs.ResizeBatch(m_BatchSize);
+        outputs.ResizeBatch(m_BatchSize);
+        inputs.OverrideHost();
+        outputs.OverrideHost();
+
+        // when end of file is reached batch is filled from the beginning
+        uint32_t loadedRowsNum = 0;
+        while (loadedRowsNum < m_BatchSize)
+        {
+            uint32_t parsedRowsNum = 0;
+            size_t offset = m_Offset;
+            m_Offset = m_File.Load(m_Offset, m_BatchSize - loadedRowsNum, inputs.Values() + loadedRowsNum * m_File.InputsNum(), outputs.Values() + loadedRowsNum * m_File.OutputsNum(), parsedRowsNum);
+            loadedRowsNum += parsedRowsNum;
+
+            // nothing was found even when starting from the first row
+            if (parsedRowsNum == 0 && offset == m_File.DataBegin())
+            {
+                cout << "CSV file has no rows.\n";
+                inputs.ResizeBatch(0);
+                outputs.ResizeBatch(0);
+                return 0;
+            }
+
+            if (m_Offset >= m_File.DataEnd())
+                m_Offset = m_File.DataBegin();
+        }
+
+        return 2;
+    }
+}
@@ -1,4 +1,5 @@
 ﻿#include <fstream>
+#include <unordered_map>
 
 #include "ComputationalGraph/Graph.h"
 #include "ComputationalGraph/TensorLike.h"
@@ -6,7 +7,10 @@
 #include "ComputationalGraph/Variable.h"
 #include "ComputationalGraph/Constant.h"
 #include "ComputationalGraph/Operation.h"
+#include "Tensors/Tensor.h"
+#include "Tensors/TensorOpCpu.h"
 #include "Debug.h"
+#include "ThreadPool.h"
 #include "Tools.h"
 #include "Memory/MemoryManager.h"
 
@@ -43,6 +47,7 @@ namespace Neuro
     {
         m_Variables.push_back(v);
         m_Nodes.push_back(v);
+        ParametersChanged();
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -216,6 +221,31 @@ namespace Neuro
         auto newOrder = order;
         newOrder.erase(remove_if(newOrder.begin(), newOrder.end(), [](const TensorLike* node) { return !node->CareAboutGradient(); }), newOrder.end());
 
+        vector<BackwardNode> nodes;
+        BuildBackwardNodes(newOrder, losses, nodesAffectingLosses, nodes);
+
+        unordered_set<TensorLike*> paramsSet(params.begin(), params.end());
+        for (auto node : newOrder)
+        {
+            if (node->IsVar())
+            {
+                Variable* var = static_cast<Variable*>(node);
+                if (var->Trainable() && (params.empty() || paramsSet.find(node) != paramsSet.end()))
+                    variables.push_back(var);
+            }
+        }
+
+        bool anyGpuOp = false;
+        for (auto node : newOrder)
+            anyGpuOp |= node->IsOp() && static_cast<Operation*>(node)->OpMode() == GPU;
+
+        // memory planning relies on sequential execution
+        if (m_ParallelGradients && !anyGpuOp && !m_ExecutionTrace)
+        {
+            ComputeGradientsInParallel(nodes);
+            return variables;
+        }
+
         size_t lastPrefetched = 0;
         
         for (size_t n = 0; n < newOrder.size(); ++n)
@@ -232,97 +262,215 @@ namespace Neuro
             }
             lastPrefetched = n + m_PreloadSteps;
 
-            auto node = newOrder[n];
-            GRAPH_DEBUG_INFO("##Graph: Computing gradient '%s'... (care about grad: %d)\n", node->Name().c_str(), node->CareAboutGradient() ? 1 : 0);
+            ComputeNodeGradient(nodes[n]);
+        }
+
+        return variables;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::BuildBackwardNodes(const vector<TensorLike*>& order, const vector<TensorLike*>& losses, const unordered_set<TensorLike*>& nodesAffectingLosses, vector<BackwardNode>& nodes) const
+    {
+        unordered_map<TensorLike*, size_t> nodeIndex;
+        for (size_t i = 0; i < order.size(); ++i)
+            nodeIndex[order[i]] = i;
 
-            if (node->CareAboutGradient())
+        unordered_set<TensorLike*> lossesSet(losses.begin(), losses.end());
+
+        nodes.resize(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            auto node = order[i];
+            auto& bwNode = nodes[i];
+            bwNode.node = node;
+            bwNode.isLoss = lossesSet.find(node) != lossesSet.end();
+            bwNode.consumersNum = 0;
+
+            unordered_set<TensorLike*> visitedConsumers;
+            for (auto consumer : node->m_Consumers)
             {
-                NVTXProfile nvtxProf((string("Output grad for ") + node->Name()).c_str(), 0xFF4242FF);
-                if (node->IsVar())
-                {
-                    Variable* var = static_cast<Variable*>(node);
-                    if (var->Trainable() && (params.empty() || find(params.begin(), params.end(), node) != params.end()))
-                        variables.push_back(var);
-                }
+                assert(consumer->IsOp());
+
+                // node used as multiple inputs of the same consumer appears multiple times in consumers list, all its inputs
+                // gradients are gathered at once
+                if (!visitedConsumers.insert(consumer).second)
+                    continue;
+
+                if (nodeIndex.find(consumer) != nodeIndex.end())
+                    ++bwNode.consumersNum;
 
-                auto& nodeOutputGrad = node->m_OutputGrad;
-                nodeOutputGrad.Resize(node->m_Output.GetShape());
-                if (nodeOutputGrad.TryDeviceAllocate())
-                    nodeOutputGrad.OverrideDevice();
-                nodeOutputGrad.Zero(); // reset gradient
+                // ignore consumer when it didn't affect loss. one example of such consumers might be accuracy operation
+                if (nodesAffectingLosses.find(consumer) == nodesAffectingLosses.end())
+                    continue;
 
-                if (find(losses.begin(), losses.end(), node) != losses.end())
+                auto& inputsGrad = static_cast<Operation*>(consumer)->InputsGrads();
+                for (size_t inputIdx = 0; inputIdx < consumer->m_InputNodes.size(); ++inputIdx)
                 {
-                    // gradient of loss w.r.t to loss is 1
-                    nodeOutputGrad.One();
+                    if (consumer->m_InputNodes[inputIdx] == node)
+                        bwNode.gradSources.push_back(&inputsGrad[inputIdx]);
                 }
-                else
-                {
-                    for (auto consumer : node->m_Consumers)
-                    {
-                        assert(consumer->IsOp());
-                        Operation* consumerOp = static_cast<Operation*>(consumer);
+            }
 
-                        // ignore consumer when it didn't affect loss. one example of such consumers might be accuracy operation
-                        if (nodesAffectingLosses.find(consumer) == nodesAffectingLosses.end())
-                            continue;
+            unordered_set<TensorLike*> visitedInputs;
+            for (auto inputNode : node->m_InputNodes)
+            {
+                auto inputIt = nodeIndex.find(inputNode);
+                if (inputIt != nodeIndex.end() && visitedInputs.insert(inputNode).second)
+                    bwNode.inputs.push_back(inputIt->second);
+            }
+        }
+    }
 
-                        auto& inputsGrad = consumerOp->InputsGrads();
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::ComputeNodeGradient(const BackwardNode& bwNode)
+    {
+        auto node = bwNode.node;
+        GRAPH_DEBUG_INFO("##Graph: Computing gradient '%s'... (care about grad: %d)\n", node->Name().c_str(), node->CareAboutGradient() ? 1 : 0);
 
-                        if (inputsGrad.size() == 1)
-                        {
-                            assert(inputsGrad[0].Length());
-                            nodeOutputGrad.Add(inputsGrad[0], nodeOutputGrad);
-                        }
-                        else
-                        {
-                            auto nodeIndexInConsumerInputs = distance(consumer->m_InputNodes.begin(), find(consumer->m_InputNodes.begin(), consumer->m_InputNodes.end(), node));
-                            auto& lossGradWrtNode = inputsGrad[nodeIndexInConsumerInputs];
-                            assert(lossGradWrtNode.Length());
-                            nodeOutputGrad.Add(lossGradWrtNode, nodeOutputGrad);
-                        }
-                    }
+        if (m_ExecutionTrace)
+            m_ExecutionTrace->push_back({ node, true });
+
+        if (node->CareAboutGradient())
+        {
+            NVTXProfile nvtxProf((string("Output grad for ") + node->Name()).c_str(), 0xFF4242FF);
+
+            auto& nodeOutputGrad = node->m_OutputGrad;
+            nodeOutputGrad.Resize(node->m_Output.GetShape());
+            if (nodeOutputGrad.TryDeviceAllocate())
+                nodeOutputGrad.OverrideDevice();
+            nodeOutputGrad.Zero(); // reset gradient
+
+            if (bwNode.isLoss)
+            {
+                // gradient of loss w.r.t to loss is 1
+                nodeOutputGrad.One();
+            }
+            else
+            {
+                for (auto lossGradWrtNode : bwNode.gradSources)
+                {
+                    assert(lossGradWrtNode->Length());
+                    nodeOutputGrad.Add(*lossGradWrtNode, nodeOutputGrad);
                 }
+            }
 
-                Operation* opNode = node->IsOp() ? static_cast<Operation*>(node) : nullptr;
+            Operation* opNode = node->IsOp() ? static_cast<Operation*>(node) : nullptr;
                 
-                if (opNode)
-                {
-                    NVTXProfile nvtxProf((string("Compute grad ") + node->Name()).c_str(), 0xFF4242FF);
-                    opNode->ComputeGradient(nodeOutputGrad);
+            if (opNode)
+            {
+                NVTXProfile nvtxProf((string("Compute grad ") + node->Name()).c_str(), 0xFF4242FF);
+                opNode->ComputeGradient(nodeOutputGrad);
 
-                    if (Debug::ShouldLogGrad(node->Name()))
+                if (Debug::ShouldLogGrad(node->Name()))
+                {
+                    nodeOutputGrad.DebugDumpValues(node->Name() + "_output0_grad_step" + to_string(Debug::GetStep()) + ".log");
+                    for (size_t i = 0; i < opNode->InputsGrads().size(); ++i)
                     {
-                        nodeOutputGrad.DebugDumpValues(node->Name() + "_output0_grad_step" + to_string(Debug::GetStep()) + ".log");
-                        for (size_t i = 0; i < opNode->InputsGrads().size(); ++i)
+                        if (opNode->InputNodes()[i]->CareAboutGradient())
+                            opNode->InputsGrads()[i].DebugDumpValues(node->Name() + "_input" + to_string(i) + "_grad_step" + to_string(Debug::GetStep()) + ".log");
+                        else
                         {
-                            if (opNode->InputNodes()[i]->CareAboutGradient())
-                                opNode->InputsGrads()[i].DebugDumpValues(node->Name() + "_input" + to_string(i) + "_grad_step" + to_string(Debug::GetStep()) + ".log");
-                            else
-                            {
-                                ofstream s(node->Name() + "_input" + to_string(i) + "_grad_step" + to_string(Debug::GetStep()) + ".log");
-                                s << "doesn't care about gradient";
-                                s.close();
-                            }
+                            ofstream s(node->Name() + "_input" + to_string(i) + "_grad_step" + to_string(Debug::GetStep()) + ".log");
+                            s << "doesn't care about gradient";
+                            s.close();
                         }
                     }
+                }
+
+                node->Output().DecRef(); // output is no longer needed, we've already used it to compute input gradients
+                node->OutputGrad().ReleaseData(); // output grad is no longer needed, we've already used it to compute input gradients
+            }
+            else
+            {
+                if (Debug::ShouldLogGrad(node->Name()))
+                    nodeOutputGrad.DebugDumpValues(node->Name() + "_grad_step" + to_string(Debug::GetStep()) + ".log");
+            }
+        }
+
+        // all consumers contributing to this node's output grad can be notified so they can release their corresponding input gradient
+        for (auto consumerNode : node->m_Consumers)
+            consumerNode->InputGradConsumed(node);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Graph::ComputeGradientsInParallel(const vector<BackwardNode>& nodes)
+    {
+        unique_ptr<atomic<uint32_t>[]> pendingConsumers(new atomic<uint32_t>[nodes.size()]);
+        for (size_t i = 0; i < nodes.size(); ++i)
+            pendingConsumers[i] = nodes[i].consumersNum;
+
+        auto& pool = ThreadPool::Default();
+        // nodes enqueued and not finished yet, consumer is counted before it is enqueued so it can only reach 0 once no task
+        // referring to this stack frame is left
+        atomic<size_t> pendingNodes(0);
+        // once any node fails its inputs are no longer enqueued so the calling thread can rethrow as soon as running ones finish
+        atomic<bool> failed(false);
+        exception_ptr error;
+        mutex errorLock;
+        // tasks can be picked up by worker threads, they have to use the same tensor op as calling thread
+        EOpMode opMode = Tensor::ActiveOp()->OpMode();
+
+        function<void(size_t)> computeNode = [&](size_t i)
+        {
+            if (!failed)
+            {
+                // pool threads outlive this call, their own forced mode has to be restored
+                bool wasForced = Tensor::HasForcedOpMode();
+                EOpMode oldMode = Tensor::ActiveOp()->OpMode();
+
+                Tensor::SetForcedOpMode(opMode);
 
-                    node->Output().DecRef(); // output is no longer needed, we've already used it to compute input gradients
-                    node->OutputGrad().ReleaseData(); // output grad is no longer needed, we've already used it to compute input gradients
+                try
+                {
+                    ComputeNodeGradient(nodes[i]);
                 }
+                catch (...)
+                {
+                    unique_lock<mutex> errorLocker(errorLock);
+                    if (!error)
+                        error = current_exception();
+                    failed = true;
+                }
+
+                if (wasForced)
+                    Tensor::SetForcedOpMode(oldMode);
                 else
+                    Tensor::ClearForcedOpMode();
+            }
+
+            if (!failed)
+            {
+                for (size_t input : nodes[i].inputs)
                 {
-                    if (Debug::ShouldLogGrad(node->Name()))
-                        nodeOutputGrad.DebugDumpValues(node->Name() + "_grad_step" + to_string(Debug::GetStep()) + ".log");
+                    if (--pendingConsumers[input] == 0)
+                    {
+                        ++pendingNodes;
+                        pool.Enqueue([&computeNode, input]() { computeNode(input); });
+                    }
                 }
             }
 
-            // all consumers contributing to this node's output grad can be notified so they can release their corresponding input gradient
-            for (auto consumerNode : node->m_Consumers)
-                consumerNode->InputGradConsumed(node);
+            --pendingNodes;
+        };
+
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (pendingConsumers[i] == 0)
+            {
+                ++pendingNodes;
+                pool.Enqueue([&computeNode, i]() { computeNode(i); });
+            }
         }
 
-        return variables;
+        // calling thread helps computing gradients until all nodes are done
+        while (pendingNodes.load() > 0)
+        {
+            if (!pool.RunPendingTask())
+                this_thread::yield();
+        }
+
+        if (error)
+            rethrow_exception(error);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,598 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+#include "ComputationalGraph/GraphOptimizer.h"
+#include "ComputationalGraph/Constant.h"
+#include "ComputationalGraph/Graph.h"
+#include "ComputationalGraph/Operation.h"
+#include "ComputationalGraph/Operations/AddOp.h"
+#include "ComputationalGraph/Operations/BatchNormalizeOp.h"
+#include "ComputationalGraph/Operations/Conv2DOp.h"
+#include "ComputationalGraph/Operations/MatMulOp.h"
+#include "Tensors/Tensor.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    // number of elements evaluated by every step before moving to the next one, intermediate values have to stay in L1 cache
+    static const uint32_t FUSED_BLOCK_LENGTH = 1024;
+    // minimum number of elements computed by a single thread
+    static const uint32_t FUSED_GRAIN_LENGTH = 16384;
+
+    //////////////////////////////////////////////////////////////////////////
+    static void EvaluateStep(const ElementwiseStep& step, const float* x, const float* y, float* out, uint32_t n)
+    {
+        const float a = step.a, b = step.b;
+
+        // formulas mirror the ones used by CPU tensor operations so fused results are consistent with regular ones
+        switch (step.func)
+        {
+        case EW_Add: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] + y[i]; break;
+        case EW_Sub: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] - y[i]; break;
+        case EW_Mul: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] * y[i]; break;
+        case EW_Div: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] / y[i]; break;
+        case EW_AddScalar: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] + a; break;
+        case EW_MulScalar: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] * a; break;
+        case EW_DivScalar: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] / a; break;
+        case EW_Negate: for (uint32_t i = 0; i < n; ++i) out[i] = -x[i]; break;
+        case EW_Log: for (uint32_t i = 0; i < n; ++i) out[i] = (float)::log(x[i]); break;
+        case EW_Exp: for (uint32_t i = 0; i < n; ++i) out[i] = (float)::exp(x[i]); break;
+        case EW_Sqrt: for (uint32_t i = 0; i < n; ++i) out[i] = (float)::sqrt(x[i]); break;
+        case EW_Abs: for (uint32_t i = 0; i < n; ++i) out[i] = (float)::fabs(x[i]); break;
+        case EW_Pow: for (uint32_t i = 0; i < n; ++i) out[i] = (float)::pow(x[i], a); break;
+        case EW_Clip: for (uint32_t i = 0; i < n; ++i) out[i] = Clip(x[i], a, b); break;
+        case EW_Sigmoid: for (uint32_t i = 0; i < n; ++i) out[i] = 1 / (1 + (float)::exp(-x[i])); break;
+        case EW_Tanh: for (uint32_t i = 0; i < n; ++i) out[i] = 2 / (1 + (float)::exp(-2 * x[i])) - 1; break;
+        case EW_ReLU: for (uint32_t i = 0; i < n; ++i) out[i] = max(0.f, x[i]); break;
+        case EW_LeakyReLU: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] >= 0 ? x[i] : (a * x[i]); break;
+        case EW_Elu: for (uint32_t i = 0; i < n; ++i) out[i] = x[i] >= 0 ? x[i] : a * ((float)::exp(x[i]) - 1); break;
+        default: NEURO_ASSERT(false, "Unsupported elementwise function " << step.func << ".");
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static bool IsBinary(EElementwiseFunc func)
+    {
+        return func == EW_Add || func == EW_Sub || func == EW_Mul || func == EW_Div;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    FusedElementwise::FusedElementwise(const vector<Operation*>& ops)
+        : m_Ops(ops)
+    {
+        NEURO_ASSERT(!m_Ops.empty(), "Nothing to fuse.");
+
+        unordered_map<TensorLike*, size_t> opIndex;
+        for (size_t i = 0; i < m_Ops.size(); ++i)
+            opIndex[m_Ops[i]] = i;
+
+        for (auto op : m_Ops)
+        {
+            for (auto inputNode : op->InputNodes())
+            {
+                if (opIndex.find(inputNode) == opIndex.end() && find(m_InputNodes.begin(), m_InputNodes.end(), inputNode) == m_InputNodes.end())
+                    m_InputNodes.push_back(inputNode);
+            }
+        }
+
+        // registers hold inputs followed by steps results
+        const uint32_t inputsNum = (uint32_t)m_InputNodes.size();
+        vector<uint32_t> opRegister(m_Ops.size());
+
+        for (size_t i = 0; i < m_Ops.size(); ++i)
+        {
+            auto op = m_Ops[i];
+            Step step;
+            bool isElementwise = op->GetElementwiseStep(step.func);
+            NEURO_ASSERT(isElementwise, "Operation '" << op->Name() << "' is not elementwise.");
+            NEURO_ASSERT(op->InputNodes().size() == (IsBinary(step.func.func) ? 2 : 1), "Mismatched number of inputs of operation '" << op->Name() << "'.");
+
+            for (size_t s = 0; s < 2; ++s)
+            {
+                auto inputNode = op->InputNodes()[min(s, op->InputNodes().size() - 1)];
+                auto opIt = opIndex.find(inputNode);
+                if (opIt != opIndex.end())
+                    step.src[s] = opRegister[opIt->second];
+                else
+                    step.src[s] = (uint32_t)(find(m_InputNodes.begin(), m_InputNodes.end(), inputNode) - m_InputNodes.begin());
+            }
+
+            // identical step was already evaluated, its result can be reused (last step has to write kernel's output)
+            uint32_t sameStep = (uint32_t)m_Steps.size();
+            if (i + 1 < m_Ops.size())
+            {
+                for (uint32_t j = 0; j < (uint32_t)m_Steps.size(); ++j)
+                {
+                    if (m_Steps[j].func == step.func && m_Steps[j].src[0] == step.src[0] && m_Steps[j].src[1] == step.src[1])
+                    {
+                        sameStep = j;
+                        break;
+                    }
+                }
+            }
+
+            if (sameStep == m_Steps.size())
+                m_Steps.push_back(step);
+
+            opRegister[i] = inputsNum + sameStep;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool FusedElementwise::Compute(Tensor& output, bool training)
+    {
+        uint32_t batch = 1;
+        for (auto inputNode : m_InputNodes)
+            batch = max(batch, inputNode->Output().Batch());
+        output.ResizeBatch(batch);
+
+        const uint32_t length = output.Length();
+        for (auto inputNode : m_InputNodes)
+        {
+            uint32_t inputLength = inputNode->Output().Length();
+            if (inputLength != length && inputLength != 1)
+            {
+                for (size_t i = 0; i + 1 < m_Ops.size(); ++i)
+                    m_Ops[i]->Compute(training);
+                return false;
+            }
+        }
+
+        const uint32_t inputsNum = (uint32_t)m_InputNodes.size();
+        const uint32_t stepsNum = (uint32_t)m_Steps.size();
+        vector<const float*> inputsValues(inputsNum);
+        for (uint32_t i = 0; i < inputsNum; ++i)
+        {
+            auto& input = m_InputNodes[i]->Output();
+            input.CopyToHost();
+            inputsValues[i] = input.Values();
+        }
+
+        output.OverrideHost();
+        float* outputValues = output.Values();
+
+        const uint32_t blocksNum = (length + FUSED_BLOCK_LENGTH - 1) / FUSED_BLOCK_LENGTH;
+
+        ThreadPool::Default().ParallelFor(0, blocksNum, max(1u, FUSED_GRAIN_LENGTH / FUSED_BLOCK_LENGTH), [&](uint32_t begin, uint32_t end)
+        {
+            vector<float> blocks((size_t)(inputsNum + stepsNum) * FUSED_BLOCK_LENGTH);
+            vector<const float*> registers(inputsNum + stepsNum);
+
+            // scalar inputs are broadcasted once into their blocks
+            for (uint32_t i = 0; i < inputsNum; ++i)
+            {
+                if (m_InputNodes[i]->Output().Length() == 1 && length != 1)
+                    fill_n(&blocks[(size_t)i * FUSED_BLOCK_LENGTH], FUSED_BLOCK_LENGTH, inputsValues[i][0]);
+            }
+
+            for (uint32_t block = begin; block < end; ++block)
+            {
+                const uint32_t offset = block * FUSED_BLOCK_LENGTH;
+                const uint32_t n = min(FUSED_BLOCK_LENGTH, length - offset);
+
+                for (uint32_t i = 0; i < inputsNum; ++i)
+                    registers[i] = (m_InputNodes[i]->Output().Length() == 1 && length != 1) ? &blocks[(size_t)i * FUSED_BLOCK_LENGTH] : inputsValues[i] + offset;
+
+                for (uint32_t s = 0; s < stepsNum; ++s)
+                {
+                    auto& step = m_Steps[s];
+                    float* stepOutput = (s + 1 == stepsNum) ? outputValues + offset : &blocks[(size_t)(inputsNum + s) * FUSED_BLOCK_LENGTH];
+                    EvaluateStep(step.func, registers[step.src[0]], registers[step.src[1]], stepOutput, n);
+                    registers[inputsNum + s] = stepOutput;
+                }
+            }
+        });
+
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    FoldedBatchNorm::FoldedBatchNorm(const vector<Operation*>& ops)
+        : m_Ops(ops)
+    {
+        NEURO_ASSERT(m_Ops.size() == 2 || m_Ops.size() == 3, "Unexpected number of operations to fold.");
+
+        m_Conv = dynamic_cast<Conv2dOp*>(m_Ops.front());
+        m_BatchNorm = dynamic_cast<BatchNormalizeOp*>(m_Ops.back());
+        NEURO_ASSERT(m_BatchNorm, "Operation '" << m_Ops.back()->Name() << "' is not batch normalization.");
+        NEURO_ASSERT(m_Conv || dynamic_cast<MatMulOp*>(m_Ops.front()), "Operation '" << m_Ops.front()->Name() << "' is neither convolution nor matmul.");
+
+        m_InputNodes.push_back(m_Ops.front()->InputNodes()[0]);
+        m_WeightsNode = m_Ops.front()->InputNodes()[1];
+        if (m_Ops.size() == 3)
+            m_BiasNode = m_Ops[1]->InputNodes()[1];
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool FoldedBatchNorm::Compute(Tensor& output, bool training)
+    {
+        // training normalization uses batch statistics
+        if (training)
+        {
+            for (size_t i = 0; i + 1 < m_Ops.size(); ++i)
+                m_Ops[i]->Compute(training);
+            return false;
+        }
+
+        if (!m_Folded || m_ParametersVersion != m_BatchNorm->GetGraph()->ParametersVersion())
+            FoldParameters();
+
+        auto& input = m_InputNodes[0]->Output();
+        output.ResizeBatch(input.Batch());
+
+        if (m_Conv)
+            input.Conv2DBiasActivation(m_Weights, m_Conv->Stride(), m_Conv->Padding(), m_Bias, _Identity, 0, output);
+        else
+        {
+            input.MatMul(m_Weights, output);
+            output.Add(m_Bias, output);
+        }
+
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void FoldedBatchNorm::FoldParameters()
+    {
+        auto& weights = m_WeightsNode->Output();
+        auto& gamma = m_BatchNorm->InputNodes()[1]->Output();
+        auto& beta = m_BatchNorm->InputNodes()[2]->Output();
+        auto& runningMean = m_BatchNorm->InputNodes()[3]->Output();
+        auto& runningVar = m_BatchNorm->InputNodes()[4]->Output();
+        const float epsilon = m_BatchNorm->Epsilon();
+
+        weights.CopyToHost();
+        gamma.CopyToHost();
+        beta.CopyToHost();
+        runningMean.CopyToHost();
+        runningVar.CopyToHost();
+
+        // convolution kernels are stacked along batch axis, matmul weights columns correspond to output units
+        const uint32_t channels = m_Conv ? weights.Batch() : weights.Width();
+        m_Weights.Resize(weights.GetShape());
+        m_Bias.Resize(m_Conv ? Shape(1, 1, channels) : Shape(channels));
+        m_Weights.OverrideHost();
+        m_Bias.OverrideHost();
+        copy(weights.Values(), weights.Values() + weights.Length(), m_Weights.Values());
+
+        if (m_BiasNode)
+            m_BiasNode->Output().CopyToHost();
+
+        float* weightsValues = m_Weights.Values();
+        float* biasValues = m_Bias.Values();
+        const uint32_t kernelLen = weights.BatchLength();
+
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            // same formula as in batch normalization: (x - mean) * (1 / sqrt(var + epsilon)) * gamma + beta
+            float scale = (1.f / (float)::sqrt(runningVar.Values()[c] + epsilon)) * gamma.Values()[c];
+            float bias = m_BiasNode ? m_BiasNode->Output().Values()[c] : 0.f;
+            biasValues[c] = (bias - runningMean.Values()[c]) * scale + beta.Values()[c];
+
+            if (m_Conv)
+            {
+                for (uint32_t i = 0; i < kernelLen; ++i)
+                    weightsValues[c * kernelLen + i] *= scale;
+            }
+            else
+            {
+                for (uint32_t row = 0; row < weights.Height(); ++row)
+                    weightsValues[row * channels + c] *= scale;
+            }
+        }
+
+        m_ParametersVersion = m_BatchNorm->GetGraph()->ParametersVersion();
+        m_Folded = true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string GraphOptimizationStats::ToString() const
+    {
+        stringstream ss;
+        ss << "Graph optimization: " << nodesBefore << " -> " << nodesAfter << " nodes (" << Eliminated() << " eliminated: " << folded << " folded, "
+           << merged << " merged, " << fused << " fused into " << kernels << " kernels, " << batchNorms << " batch normalizations folded, " << pruned << " pruned)";
+        return ss.str();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    GraphOptimizer::GraphOptimizer(const vector<TensorLike*>& fetches, bool training, int passes)
+        : m_Fetches(fetches.begin(), fetches.end()), m_Training(training), m_Passes(passes)
+    {
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    GraphOptimizationStats GraphOptimizer::Optimize(vector<TensorLike*>& order, fused_kernels_t& fusedKernels)
+    {
+        GraphOptimizationStats stats;
+        stats.nodesBefore = (uint32_t)order.size();
+
+        if (m_Passes & ConstantFoldingPass)
+            stats.folded = FoldConstants(order);
+        if (m_Passes & ConstantMergingPass)
+            stats.merged = MergeConstants(order);
+        if ((m_Passes & BatchNormFoldingPass) && !m_Training)
+            stats.batchNorms = FoldBatchNormalization(order, fusedKernels);
+        if (m_Passes & ElementwiseFusionPass)
+            stats.fused = FuseElementwise(order, fusedKernels, stats);
+        if (m_Passes & DeadNodesPruningPass)
+            stats.pruned = PruneDeadNodes(order, fusedKernels);
+
+        stats.nodesAfter = (uint32_t)order.size();
+        return stats;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t GraphOptimizer::FoldConstants(vector<TensorLike*>& order)
+    {
+        uint32_t foldedNum = 0;
+        vector<TensorLike*> newOrder;
+
+        for (auto node : order)
+        {
+            // operations without consumers (ie. already folded in another order) will be pruned anyway
+            bool canFold = node->IsOp() && !node->m_InputNodes.empty() && !node->m_Consumers.empty() && !IsFetched(node) && !node->UndeterminedOutputShape() &&
+                           !static_cast<Operation*>(node)->HasSideEffects();
+            // consumers were already pointed at folded inputs, order guarantees inputs are processed first
+            for (size_t i = 0; canFold && i < node->m_InputNodes.size(); ++i)
+                canFold = node->m_InputNodes[i]->IsConst();
+
+            if (!canFold)
+            {
+                newOrder.push_back(node);
+                continue;
+            }
+
+            auto op = static_cast<Operation*>(node);
+            op->Compute(false);
+            auto folded = new Constant(op->Output(), op->Name() + "/folded");
+            Replace(op, folded);
+            m_FoldedConstants.push_back(folded);
+            ++foldedNum;
+        }
+
+        order = newOrder;
+        return foldedNum;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t GraphOptimizer::MergeConstants(vector<TensorLike*>& order)
+    {
+        vector<Constant*> constants;
+        for (auto node : order)
+        {
+            if (node->IsConst())
+                constants.push_back(static_cast<Constant*>(node));
+        }
+        constants.insert(constants.end(), m_FoldedConstants.begin(), m_FoldedConstants.end());
+
+        // constants with the same length are candidates for merging, first occurrence is kept
+        map<uint32_t, vector<Constant*>> uniqueConstants;
+        unordered_set<TensorLike*> merged;
+
+        for (auto constant : constants)
+        {
+            auto& value = constant->Output();
+            value.CopyToHost();
+            auto& candidates = uniqueConstants[value.Length()];
+
+            Constant* same = nullptr;
+            for (auto candidate : candidates)
+            {
+                auto& candidateValue = candidate->Output();
+                if (candidateValue.GetShape() == value.GetShape() && equal(value.Values(), value.Values() + value.Length(), candidateValue.Values()))
+                {
+                    same = candidate;
+                    break;
+                }
+            }
+
+            if (!same || IsFetched(constant))
+            {
+                candidates.push_back(constant);
+                continue;
+            }
+
+            Replace(constant, same);
+            merged.insert(constant);
+        }
+
+        order.erase(remove_if(order.begin(), order.end(), [&](TensorLike* node) { return merged.find(node) != merged.end(); }), order.end());
+        return (uint32_t)merged.size();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t GraphOptimizer::FoldBatchNormalization(vector<TensorLike*>& order, fused_kernels_t& fusedKernels)
+    {
+        unordered_set<TensorLike*> orderNodes(order.begin(), order.end());
+        unordered_set<TensorLike*> folded;
+        uint32_t foldedNum = 0;
+
+        // folded operation has to be consumed only by the next one in chain, otherwise its output would still be needed
+        auto isFoldable = [&](TensorLike* node, TensorLike* consumer)
+        {
+            if (!node->IsOp() || IsFetched(node) || fusedKernels.find(node) != fusedKernels.end() || static_cast<Operation*>(node)->HasSideEffects())
+                return false;
+
+            for (auto nodeConsumer : node->m_Consumers)
+            {
+                if (nodeConsumer != consumer && orderNodes.find(nodeConsumer) != orderNodes.end())
+                    return false;
+            }
+            return true;
+        };
+        // parameters can't change during a run
+        auto isParameter = [](TensorLike* node) { return node->IsVar() || node->IsConst(); };
+
+        for (auto node : order)
+        {
+            auto batchNorm = dynamic_cast<BatchNormalizeOp*>(node);
+            if (!batchNorm || fusedKernels.find(node) != fusedKernels.end())
+                continue;
+
+            bool paramsFoldable = true;
+            for (size_t i = 1; i < batchNorm->m_InputNodes.size(); ++i)
+                paramsFoldable &= isParameter(batchNorm->m_InputNodes[i]);
+            if (!paramsFoldable)
+                continue;
+
+            vector<Operation*> ops = { batchNorm };
+            TensorLike* x = batchNorm->m_InputNodes[0];
+
+            if (dynamic_cast<AddOp*>(x) && isFoldable(x, batchNorm) && x->m_InputNodes.size() == 2 && isParameter(x->m_InputNodes[1]))
+            {
+                ops.insert(ops.begin(), static_cast<Operation*>(x));
+                x = x->m_InputNodes[0];
+            }
+
+            auto conv = dynamic_cast<Conv2dOp*>(x);
+            if ((!conv && !dynamic_cast<MatMulOp*>(x)) || !isFoldable(x, ops.front()) || !isParameter(x->m_InputNodes[1]))
+                continue;
+
+            // normalization parameters have to be per output channel (spatial for convolution, per unit for dense output)
+            const Shape& weightsShape = x->m_InputNodes[1]->GetShape();
+            const Shape& outputShape = x->GetShape();
+            const uint32_t channels = conv ? weightsShape.Batch() : weightsShape.Width();
+            bool channelsMatch = batchNorm->m_InputNodes[1]->GetShape().Length == channels;
+            if (conv)
+                channelsMatch &= conv->DataFormat() == NCHW;
+            else
+                channelsMatch &= outputShape.Height() == 1 && outputShape.Depth() == 1 && weightsShape.Depth() == 1 && weightsShape.Batch() == 1;
+            // bias has to be broadcasted per channel the same way
+            if (ops.size() == 2)
+                channelsMatch &= ops.front()->m_InputNodes[1]->GetShape() == (conv ? Shape(1, 1, channels) : Shape(channels));
+
+            // device references are released per actual input nodes, skipped operations would never release theirs
+            if (!channelsMatch || static_cast<Operation*>(x)->OpMode() == GPU || batchNorm->OpMode() == GPU)
+                continue;
+
+            ops.insert(ops.begin(), static_cast<Operation*>(x));
+            fusedKernels[batchNorm] = make_shared<FoldedBatchNorm>(ops);
+            for (size_t i = 0; i + 1 < ops.size(); ++i)
+                folded.insert(ops[i]);
+            ++foldedNum;
+        }
+
+        order.erase(remove_if(order.begin(), order.end(), [&](TensorLike* node) { return folded.find(node) != folded.end(); }), order.end());
+        return foldedNum;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t GraphOptimizer::FuseElementwise(vector<TensorLike*>& order, fused_kernels_t& fusedKernels, GraphOptimizationStats& stats)
+    {
+        unordered_map<TensorLike*, size_t> nodeIndex;
+        for (size_t i = 0; i < order.size(); ++i)
+            nodeIndex[order[i]] = i;
+
+        unordered_set<TensorLike*> fused;
+
+        // kernels are grown from their last operation towards inputs, operation can be absorbed only when all its consumers
+        // computed in this order are already part of the kernel (so its output is not needed outside)
+        for (size_t n = order.size(); n-- > 0;)
+        {
+            auto last = order[n];
+            if (fused.find(last) != fused.end() || fusedKernels.find(last) != fusedKernels.end() || !IsFusable(last))
+                continue;
+
+            unordered_set<TensorLike*> kernelOps = { last };
+            for (bool grown = true; grown;)
+            {
+                grown = false;
+                for (auto op : vector<TensorLike*>(kernelOps.begin(), kernelOps.end()))
+                {
+                    for (auto inputNode : op->m_InputNodes)
+                    {
+                        if (kernelOps.find(inputNode) != kernelOps.end() || fused.find(inputNode) != fused.end() || nodeIndex.find(inputNode) == nodeIndex.end() ||
+                            IsFetched(inputNode) || !IsFusable(inputNode))
+                            continue;
+
+                        bool onlyFusedConsumers = true;
+                        for (auto consumer : inputNode->m_Consumers)
+                            onlyFusedConsumers &= nodeIndex.find(consumer) == nodeIndex.end() || kernelOps.find(consumer) != kernelOps.end();
+
+                        if (onlyFusedConsumers)
+                        {
+                            kernelOps.insert(inputNode);
+                            grown = true;
+                        }
+                    }
+                }
+            }
+
+            if (kernelOps.size() < 2)
+                continue;
+
+            vector<Operation*> ops;
+            for (auto op : kernelOps)
+                ops.push_back(static_cast<Operation*>(op));
+            sort(ops.begin(), ops.end(), [&](Operation* a, Operation* b) { return nodeIndex[a] < nodeIndex[b]; });
+
+            auto kernel = make_shared<FusedElementwise>(ops);
+            fusedKernels[last] = kernel;
+            ++stats.kernels;
+            stats.merged += (uint32_t)kernel->MergedNum();
+
+            for (size_t i = 0; i + 1 < ops.size(); ++i)
+                fused.insert(ops[i]);
+        }
+
+        order.erase(remove_if(order.begin(), order.end(), [&](TensorLike* node) { return fused.find(node) != fused.end(); }), order.end());
+        return (uint32_t)fused.size();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t GraphOptimizer::PruneDeadNodes(vector<TensorLike*>& order, const fused_kernels_t& fusedKernels)
+    {
+        unordered_set<TensorLike*> live(m_Fetches.begin(), m_Fetches.end());
+
+        // order is topologically sorted so consumers are always visited before their inputs
+        for (size_t n = order.size(); n-- > 0;)
+        {
+            auto node = order[n];
+            if (live.find(node) == live.end())
+                continue;
+
+            auto kernelIt = fusedKernels.find(node);
+            auto& inputNodes = kernelIt != fusedKernels.end() ? kernelIt->second->InputNodes() : node->m_InputNodes;
+            live.insert(inputNodes.begin(), inputNodes.end());
+        }
+
+        size_t oldSize = order.size();
+        order.erase(remove_if(order.begin(), order.end(), [&](TensorLike* node) { return live.find(node) == live.end(); }), order.end());
+        return (uint32_t)(oldSize - order.size());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool GraphOptimizer::IsFusable(TensorLike* node) const
+    {
+        if (!node->IsOp() || node->UndeterminedOutputShape())
+            return false;
+
+        auto op = static_cast<Operation*>(node);
+        ElementwiseStep step;
+        // skipped operations' outputs would be missing when computing gradients
+        return op->OpMode() != GPU && !op->HasSideEffects() && (!m_Training || !op->CareAboutGradient()) && op->GetElementwiseStep(step);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void GraphOptimizer::Replace(TensorLike* node, TensorLike* replacement)
+    {
+        for (auto consumer : node->m_Consumers)
+        {
+            auto consumerOp = static_cast<Operation*>(consumer);
+            for (size_t i = 0; i < consumerOp->m_InputNodes.size(); ++i)
+            {
+                if (consumerOp->m_InputNodes[i] != node)
+                    continue;
+
+                consumerOp->m_InputNodes[i] = replacement;
+                consumerOp->m_Inputs[i] = replacement->OutputPtr();
+                replacement->m_Consumers.push_back(consumer);
+            }
+        }
+
+        node->m_Consumers.clear();
+    }
+}
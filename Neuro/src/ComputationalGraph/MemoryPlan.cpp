@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+
+#include "ComputationalGraph/MemoryPlan.h"
+#include "ComputationalGraph/Operation.h"
+#include "Memory/MemoryManager.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    // offsets are aligned to cache line
+    static const size_t ARENA_ALIGNMENT = 64 / sizeof(float);
+
+    //////////////////////////////////////////////////////////////////////////
+    MemoryPlan::MemoryPlan(const vector<ExecutionStep>& steps, const vector<TensorLike*>& fetches)
+    {
+        unordered_set<TensorLike*> fetched(fetches.begin(), fetches.end());
+
+        auto isCpuOp = [](TensorLike* node)
+        {
+            if (!node->IsOp())
+                return false;
+            auto op = static_cast<Operation*>(node);
+            return op->OpMode() != GPU && !op->IsTrainingOp();
+        };
+
+        for (uint32_t s = 0; s < (uint32_t)steps.size(); ++s)
+        {
+            TensorLike* node = steps[s].node;
+
+            if (!steps[s].backward)
+            {
+                for (auto inputNode : steps[s].inputs ? *steps[s].inputs : node->m_InputNodes)
+                    Use(inputNode->m_Output, s);
+
+                // fetched and frozen outputs have to outlive session run
+                if (isCpuOp(node) && !node->m_AlwaysOffload && !node->m_Frozen && fetched.find(node) == fetched.end())
+                    Define(node->m_Output, s);
+            }
+            else
+            {
+                // gradient computation reads node's output, its inputs and consumers' gradients w.r.t. this node
+                Use(node->m_Output, s);
+                for (auto inputNode : node->m_InputNodes)
+                    Use(inputNode->m_Output, s);
+
+                for (auto consumer : node->m_Consumers)
+                {
+                    auto consumerOp = static_cast<Operation*>(consumer);
+                    for (size_t i = 0; i < consumerOp->m_InputNodes.size(); ++i)
+                    {
+                        if (consumerOp->m_InputNodes[i] == node)
+                            Use(consumerOp->m_InputsGrads[i], s);
+                    }
+                }
+
+                if (isCpuOp(node))
+                {
+                    auto op = static_cast<Operation*>(node);
+                    // operations' output gradients are released as soon as input gradients are computed
+                    Define(op->m_OutputGrad, s);
+                    for (size_t i = 0; i < op->m_InputsGrads.size(); ++i)
+                    {
+                        if (op->m_InputNodes[i]->CareAboutGradient() || op->ForceAllocInputGradNode(i))
+                            Define(op->m_InputsGrads[i], s);
+                    }
+                }
+            }
+        }
+
+        AssignBuffers(steps);
+        AssignOffsets();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    MemoryPlan::~MemoryPlan()
+    {
+        Release();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryPlan::Apply()
+    {
+        if (m_Arena || !m_ArenaLen)
+            return;
+
+        HostMemoryManager::Default().Allocate((void**)&m_Arena, ArenaSize(), "memory_plan_arena");
+
+        for (auto& planned : m_Tensors)
+        {
+            auto& buffer = m_Buffers[planned.buffer];
+            // tensor resized by another order's run since the plan was built doesn't fit, it is left to dynamic allocation
+            if (planned.tensor->Length() > buffer.len)
+                continue;
+            planned.tensor->BindHostMemory(m_Arena + buffer.offset, buffer.len);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryPlan::Release()
+    {
+        if (!m_Arena)
+            return;
+
+        for (auto& planned : m_Tensors)
+            planned.tensor->UnbindHostMemory();
+
+        HostMemoryManager::Default().Free(m_Arena);
+        m_Arena = nullptr;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t MemoryPlan::TensorsSize() const
+    {
+        size_t len = 0;
+        for (auto& planned : m_Tensors)
+            len += planned.len;
+        return len * sizeof(float);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t MemoryPlan::PeakLiveSize() const
+    {
+        uint32_t stepsNum = 0;
+        for (auto& buffer : m_Buffers)
+            stepsNum = max(stepsNum, buffer.last + 1);
+
+        vector<int64_t> delta(stepsNum + 1, 0);
+        for (auto& buffer : m_Buffers)
+        {
+            delta[buffer.first] += (int64_t)buffer.len;
+            delta[buffer.last + 1] -= (int64_t)buffer.len;
+        }
+
+        int64_t live = 0, peak = 0;
+        for (uint32_t s = 0; s < stepsNum; ++s)
+        {
+            live += delta[s];
+            peak = max(peak, live);
+        }
+        return (size_t)peak * sizeof(float);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string MemoryPlan::ToString() const
+    {
+        const float MB = 1024.f * 1024.f;
+        stringstream ss;
+        ss << fixed << setprecision(2) << "Memory plan: " << TensorsNum() << " tensors (" << InPlaceNum() << " in-place), tensors " << TensorsSize() / MB << "MB, peak live " << PeakLiveSize() / MB << "MB, arena " << ArenaSize() / MB << "MB";
+        return ss.str();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryPlan::Define(Tensor& tensor, uint32_t step)
+    {
+        if (!tensor.Length())
+            return;
+
+        auto it = m_TensorIndex.find(&tensor);
+        if (it != m_TensorIndex.end())
+        {
+            // tensor computed multiple times during single run (ie. multiple backward passes), assume it's alive in between
+            auto& planned = m_Tensors[it->second];
+            planned.first = min(planned.first, step);
+            planned.last = max(planned.last, step);
+            return;
+        }
+
+        m_TensorIndex[&tensor] = m_Tensors.size();
+        m_Tensors.push_back({ &tensor, tensor.Length(), step, step, 0 });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryPlan::Use(const Tensor& tensor, uint32_t step)
+    {
+        auto it = m_TensorIndex.find(&tensor);
+        if (it == m_TensorIndex.end())
+            return;
+
+        auto& planned = m_Tensors[it->second];
+        planned.last = max(planned.last, step);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryPlan::AssignBuffers(const vector<ExecutionStep>& steps)
+    {
+        m_Buffers.reserve(m_Tensors.size());
+        for (size_t i = 0; i < m_Tensors.size(); ++i)
+        {
+            auto& planned = m_Tensors[i];
+            planned.buffer = i;
+            m_Buffers.push_back({ planned.len, planned.first, planned.last, 0 });
+        }
+
+        // output can take over memory of input which is used for the last time by its operation
+        for (uint32_t s = 0; s < (uint32_t)steps.size(); ++s)
+        {
+            if (steps[s].backward || !steps[s].node->IsOp() || !IsPlanned(steps[s].node->m_Output))
+                continue;
+
+            auto op = static_cast<Operation*>(steps[s].node);
+            auto& output = m_Tensors[m_TensorIndex[&op->m_Output]];
+            if (output.first != s || output.buffer != m_TensorIndex[&op->m_Output])
+                continue;
+
+            for (size_t i = 0; i < op->m_InputNodes.size(); ++i)
+            {
+                auto& inputTensor = op->m_InputNodes[i]->m_Output;
+                if (!op->SupportsInPlace(i) || !IsPlanned(inputTensor) || inputTensor.GetShape() != op->m_Output.GetShape())
+                    continue;
+
+                auto& input = m_Tensors[m_TensorIndex[&inputTensor]];
+                auto& inputBuffer = m_Buffers[input.buffer];
+                if (inputBuffer.last != s)
+                    continue;
+
+                inputBuffer.len = max(inputBuffer.len, output.len);
+                inputBuffer.last = max(inputBuffer.last, output.last);
+                m_Buffers[output.buffer].len = 0;
+                output.buffer = input.buffer;
+                ++m_InPlaceNum;
+                break;
+            }
+        }
+
+        // drop buffers taken over by in-place outputs
+        vector<size_t> remap(m_Buffers.size());
+        vector<Buffer> buffers;
+        for (size_t i = 0; i < m_Buffers.size(); ++i)
+        {
+            remap[i] = buffers.size();
+            if (m_Buffers[i].len)
+                buffers.push_back(m_Buffers[i]);
+        }
+        for (auto& planned : m_Tensors)
+            planned.buffer = remap[planned.buffer];
+        m_Buffers.swap(buffers);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryPlan::AssignOffsets()
+    {
+        // placing largest buffers first leaves smaller gaps to be filled later on
+        vector<size_t> order(m_Buffers.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return m_Buffers[a].len > m_Buffers[b].len; });
+
+        vector<size_t> placed;
+        m_ArenaLen = 0;
+
+        for (size_t idx : order)
+        {
+            auto& buffer = m_Buffers[idx];
+            size_t alignedLen = (buffer.len + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+
+            vector<pair<size_t, size_t>> taken;
+            for (size_t other : placed)
+            {
+                auto& otherBuffer = m_Buffers[other];
+                if (otherBuffer.first <= buffer.last && buffer.first <= otherBuffer.last)
+                    taken.push_back({ otherBuffer.offset, otherBuffer.offset + otherBuffer.len });
+            }
+            sort(taken.begin(), taken.end());
+
+            // find lowest gap big enough among memory ranges used by buffers alive at the same time
+            size_t offset = 0;
+            for (auto& range : taken)
+            {
+                if (range.first >= offset + alignedLen)
+                    break;
+                offset = max(offset, (range.second + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT);
+            }
+
+            buffer.offset = offset;
+            m_ArenaLen = max(m_ArenaLen, offset + alignedLen);
+            placed.push_back(idx);
+        }
+    }
+}
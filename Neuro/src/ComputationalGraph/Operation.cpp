@@ -1,11 +1,13 @@
 ﻿#include "ComputationalGraph/Operation.h"
 #include "ComputationalGraph/Graph.h"
+#include "ComputationalGraph/GraphOptimizer.h"
 #include "Tensors/Tensor.h"
 #include "Tensors/TensorOpCpu.h"
 #include "Tools.h"
 #include "Debug.h"
 
 #include "Memory/MemoryManager.h"
+#include "Memory/MemoryTrace.h"
 
 namespace Neuro
 {
@@ -53,8 +55,9 @@ namespace Neuro
     }
 
     //////////////////////////////////////////////////////////////////////////
-    const Tensor& Operation::Compute(bool training)
+    const Tensor& Operation::Compute(bool training, FusedKernel* fused)
     {
+        MemoryTrace::OpScope traceScope(m_Name);
         EOpMode oldMode = Tensor::ActiveOp()->OpMode();
         Tensor::SetForcedOpMode(m_OpMode);
 
@@ -68,7 +71,9 @@ namespace Neuro
         if (UndeterminedOutputShape())
             UpdateOutputShape();
 
-        ComputeInternal();
+        // fused kernel may refuse inputs it can't handle, in that case all fused operations are computed one by one
+        if (!fused || !fused->Compute(m_Output, training))
+            ComputeInternal();
 
         m_LastComputeStep = m_Graph->CurrentStep();
         
@@ -98,9 +103,23 @@ namespace Neuro
         return m_Output;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void Operation::ComputeInference(FusedKernel* fused)
+    {
+        m_InputsManuallyConsumed = false;
+        m_Training = false;
+
+        if (UndeterminedOutputShape())
+            UpdateOutputShape();
+
+        if (!fused || !fused->Compute(m_Output, false))
+            ComputeInternal();
+    }
+
     //////////////////////////////////////////////////////////////////////////
     const vector<Tensor*>& Operation::ComputeGradient(const Tensor& grad)
     {
+        MemoryTrace::OpScope traceScope(m_Name);
         EOpMode oldMode = Tensor::ActiveOp()->OpMode();
         Tensor::SetForcedOpMode(m_OpMode);
 
@@ -1,4 +1,5 @@
 #include "ComputationalGraph/Operations/AssignOp.h"
+#include "ComputationalGraph/Graph.h"
 
 namespace Neuro
 {
@@ -13,5 +14,6 @@ namespace Neuro
     void AssignOp::ComputeInternal()
     {
         m_Inputs[1]->CopyTo(m_InputNodes[0]->Output());
+        m_Graph->ParametersChanged();
     }
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "ComputationalGraph/Operations/CrossEntropyOp.h"
+
+namespace Neuro
+{
+    //////////////////////////////////////////////////////////////////////////
+    SoftmaxCrossEntropyOp::SoftmaxCrossEntropyOp(TensorLike* target, TensorLike* logits, const string& name)
+        : Operation({ target, logits }, name.empty() ? "softmax_cross_entropy" : name)
+    {
+        NEURO_ASSERT(target->GetShape() == logits->GetShape(), "Mismatched target and logits shapes.");
+        UpdateOutputShape();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SoftmaxCrossEntropyOp::UpdateOutputShape()
+    {
+        m_Output.Resize(Shape(1, 1, 1, m_InputNodes[1]->GetShape().Batch()));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SoftmaxCrossEntropyOp::ComputeInternal()
+    {
+        auto& target = *m_Inputs[0];
+        auto& logits = *m_Inputs[1];
+
+        m_Output.ResizeBatch(logits.Batch());
+        m_Probabilities.Resize(logits.GetShape());
+        logits.SoftmaxCrossEntropy(target, m_Probabilities, m_Output);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SoftmaxCrossEntropyOp::ComputeGradientInternal(const Tensor& grad)
+    {
+        auto& target = *m_Inputs[0];
+        auto& logits = *m_Inputs[1];
+
+        Tensor* targetGrad = m_InputNodes[0]->CareAboutGradient() ? &m_InputsGrads[0] : nullptr;
+        Tensor* logitsGrad = m_InputNodes[1]->CareAboutGradient() ? &m_InputsGrads[1] : nullptr;
+
+        if (targetGrad || logitsGrad)
+            logits.SoftmaxCrossEntropyGradient(m_Probabilities, target, grad, logitsGrad, targetGrad);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    SigmoidCrossEntropyOp::SigmoidCrossEntropyOp(TensorLike* target, TensorLike* logits, const string& name)
+        : Operation({ target, logits }, name.empty() ? "sigmoid_cross_entropy" : name)
+    {
+        NEURO_ASSERT(target->GetShape() == logits->GetShape(), "Mismatched target and logits shapes.");
+        UpdateOutputShape();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SigmoidCrossEntropyOp::UpdateOutputShape()
+    {
+        m_Output.Resize(m_InputNodes[1]->GetShape());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SigmoidCrossEntropyOp::ComputeInternal()
+    {
+        auto& target = *m_Inputs[0];
+        auto& logits = *m_Inputs[1];
+
+        m_Output.ResizeBatch(logits.Batch());
+        logits.SigmoidCrossEntropy(target, m_Output);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SigmoidCrossEntropyOp::ComputeGradientInternal(const Tensor& grad)
+    {
+        auto& target = *m_Inputs[0];
+        auto& logits = *m_Inputs[1];
+
+        Tensor* targetGrad = m_InputNodes[0]->CareAboutGradient() ? &m_InputsGrads[0] : nullptr;
+        Tensor* logitsGrad = m_InputNodes[1]->CareAboutGradient() ? &m_InputsGrads[1] : nullptr;
+
+        if (targetGrad || logitsGrad)
+            logits.SigmoidCrossEntropyGradient(target, grad, logitsGrad, targetGrad);
+    }
+}
\ No newline at end of file
@@ -1,9 +1,17 @@
+#include <algorithm>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "ComputationalGraph/Predicter.h"
 #include "ComputationalGraph/Session.h"
 #include "ComputationalGraph/Graph.h"
+#include "ComputationalGraph/MemoryPlan.h"
+#include "ComputationalGraph/Operation.h"
+#include "ComputationalGraph/Placeholder.h"
+#include "ComputationalGraph/Variable.h"
 #include "Tensors/Tensor.h"
+#include "Tensors/TensorOpCpu.h"
 
 namespace Neuro
 {
@@ -12,15 +20,100 @@ namespace Neuro
     {
         m_InputPlaceholders = inputPlaceholders;
         m_OutputOps = outputOps;
+        m_Graph = m_OutputOps[0]->GetGraph();
 
         bool isTraining = Graph::Default()->BuildForwardOrder(m_OutputOps, m_Order);
 
         NEURO_ASSERT(!isTraining, "Fetching training operation in predictor.");
 
+        int passes = Session::Default()->GraphOptimization() ? AllPasses : BatchNormFoldingPass;
+        m_OptimizationStats = GraphOptimizer(m_OutputOps, false, passes).Optimize(m_Order, m_FusedKernels);
+
         for (size_t i = 0; i < m_InputPlaceholders.size(); ++i)
             m_Feeds[m_InputPlaceholders[i]] = nullptr;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    Predicter::~Predicter()
+    {
+        // session would keep using released plan
+        if (m_MemoryPlan && Session::Default()->ActiveMemoryPlan() == m_MemoryPlan.get())
+            Session::Default()->ActivateMemoryPlan(nullptr);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool Predicter::Compile()
+    {
+        if (m_Compiled)
+            return true;
+
+        for (auto node : m_Order)
+        {
+            if (node->IsOp() && static_cast<Operation*>(node)->OpMode() == GPU)
+                return false;
+        }
+
+        unordered_set<TensorLike*> fetches(m_OutputOps.begin(), m_OutputOps.end());
+        unordered_set<TensorLike*> frozen;
+        // stripped operations are read through their sources
+        unordered_map<TensorLike*, TensorLike*> sources;
+
+        auto sourceOf = [&](TensorLike* node)
+        {
+            auto it = sources.find(node);
+            return it != sources.end() ? it->second : node;
+        };
+
+        for (auto node : m_Order)
+        {
+            if (node->IsVar())
+                static_cast<Variable*>(node)->Initialize();
+
+            if (node->IsVar() || node->IsConst())
+            {
+                frozen.insert(node);
+                continue;
+            }
+
+            if (!node->IsOp())
+                continue;
+
+            auto op = static_cast<Operation*>(node);
+            auto fused = FindFusedKernel(op);
+            auto& inputNodes = fused ? fused->InputNodes() : op->InputNodes();
+
+            bool canFreeze = !inputNodes.empty() && !op->HasSideEffects() && !op->UndeterminedOutputShape();
+            for (size_t i = 0; canFreeze && i < inputNodes.size(); ++i)
+                canFreeze = frozen.find(inputNodes[i]) != frozen.end();
+
+            if (canFreeze)
+            {
+                frozen.insert(op);
+                op->SetFrozen(true);
+                m_FrozenOps.push_back(op);
+                continue;
+            }
+
+            // fetched outputs have to own their memory
+            if (!fused && op->PassesInputThrough(false) && fetches.find(op) == fetches.end())
+            {
+                auto source = sourceOf(op->InputNodes()[0]);
+                sources[op] = source;
+                m_Program.push_back({ op, nullptr, source->OutputPtr(), op->OpMode(), {} });
+                ++m_StrippedNum;
+                continue;
+            }
+
+            m_Program.push_back({ op, fused, nullptr, op->OpMode(), {} });
+            for (auto inputNode : inputNodes)
+                m_Program.back().inputs.push_back(sourceOf(inputNode));
+        }
+
+        Freeze();
+        m_Compiled = true;
+        return true;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     tensor_ptr_vec_t Predicter::Predict(const const_tensor_ptr_vec_t& inputs)
     {
@@ -28,12 +121,107 @@ namespace Neuro
         for (size_t i = 0; i < m_InputPlaceholders.size(); ++i)
             m_Feeds[m_InputPlaceholders[i]] = inputs[i];
 
-        return Session::Default()->RunInOrder(m_Order, m_OutputOps, m_Feeds, false);
+        if (m_Compiled)
+            return RunCompiled(m_Feeds);
+
+        return Session::Default()->RunInOrder(m_Order, &m_FusedKernels, m_OutputOps, m_Feeds, false);
     }
 
     //////////////////////////////////////////////////////////////////////////
     tensor_ptr_vec_t Predicter::Eval(const map<Placeholder*, const Tensor*>& feeds)
     {
-        return Session::Default()->RunInOrder(m_Order, m_OutputOps, feeds, false);
+        if (m_Compiled)
+            return RunCompiled(feeds);
+
+        return Session::Default()->RunInOrder(m_Order, &m_FusedKernels, m_OutputOps, feeds, false);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    tensor_ptr_vec_t Predicter::RunCompiled(const map<Placeholder*, const Tensor*>& feeds)
+    {
+        uint32_t batch = 0;
+        for (auto feed : feeds)
+        {
+            auto& input = feed.first->Output();
+            input.ResizeBatch(feed.second->Batch());
+            NEURO_ASSERT(feed.second->GetShape() == input.GetShape(), "Mismatched feed shape. Expected: " << input.GetShape().ToString() << " received: " << feed.second->GetShape().ToString());
+            feed.second->CopyTo(input);
+            batch = max(batch, feed.second->Batch());
+        }
+
+        // tensors lengths for a larger batch are known only after it was computed, plan for it is built after this run
+        bool planned = m_MemoryPlan && batch <= m_PlannedBatch;
+        Session::Default()->ActivateMemoryPlan(planned ? m_MemoryPlan.get() : nullptr);
+
+        // frozen outputs own their memory, so they are recomputed only when parameters change
+        if (m_FrozenParametersVersion != m_Graph->ParametersVersion())
+            Freeze();
+
+        EOpMode oldMode = Tensor::ActiveOp()->OpMode();
+        EOpMode mode = oldMode;
+
+        for (auto& instr : m_Program)
+        {
+            if (instr.alias)
+            {
+                auto& output = instr.op->Output();
+                output.UnbindHostMemory();
+                output.ResizeBatch(instr.alias->Batch());
+                output.BindHostMemory(const_cast<float*>(instr.alias->Values()), instr.alias->Length());
+                continue;
+            }
+
+            if (instr.mode != mode)
+            {
+                mode = instr.mode;
+                Tensor::SetForcedOpMode(mode);
+            }
+
+            instr.op->ComputeInference(instr.fused);
+        }
+
+        if (mode != oldMode)
+            Tensor::SetForcedOpMode(oldMode);
+
+        // memory of stripped operations' sources may be reused or released once program is done
+        for (auto& instr : m_Program)
+        {
+            if (instr.alias)
+                instr.op->Output().UnbindHostMemory();
+        }
+
+        if (!planned)
+        {
+            vector<ExecutionStep> steps;
+            for (auto& instr : m_Program)
+            {
+                if (!instr.alias)
+                    steps.push_back({ instr.op, false, &instr.inputs });
+            }
+
+            m_MemoryPlan.reset(new MemoryPlan(steps, m_OutputOps));
+            m_PlannedBatch = batch;
+        }
+
+        vector<Tensor*> result(m_OutputOps.size());
+        for (size_t i = 0; i < m_OutputOps.size(); ++i)
+            result[i] = m_OutputOps[i]->OutputPtr();
+        return result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Predicter::Freeze()
+    {
+        for (auto op : m_FrozenOps)
+            op->Compute(false, FindFusedKernel(op));
+
+        m_FrozenParametersVersion = m_Graph->ParametersVersion();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    FusedKernel* Predicter::FindFusedKernel(TensorLike* node) const
+    {
+        auto it = m_FusedKernels.find(node);
+        return it != m_FusedKernels.end() ? it->second.get() : nullptr;
     }
 }
\ No newline at end of file
@@ -1,9 +1,16 @@
-﻿#include "ComputationalGraph/Session.h"
+﻿#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+#include <omp.h>
+
+#include "ComputationalGraph/Session.h"
 #include "ComputationalGraph/Graph.h"
 #include "ComputationalGraph/Operation.h"
 #include "ComputationalGraph/Placeholder.h"
 #include "ComputationalGraph/Variable.h"
 #include "Tensors/Tensor.h"
+#include "ThreadPool.h"
 #include "Tools.h"
 #include "Debug.h"
 
@@ -21,6 +28,16 @@ namespace Neuro
 {
     Session* Session::s_Default = nullptr;
 
+    //////////////////////////////////////////////////////////////////////////
+    static FusedKernel* FindFusedKernel(const GraphOptimizer::fused_kernels_t* fusedKernels, TensorLike* node)
+    {
+        if (!fusedKernels)
+            return nullptr;
+
+        auto kernelIt = fusedKernels->find(node);
+        return kernelIt != fusedKernels->end() ? kernelIt->second.get() : nullptr;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     Session::Session(Graph* graph)
     {
@@ -58,19 +75,36 @@ namespace Neuro
         {
             OrderCacheData data;
             data.is_training = m_Graph->BuildForwardOrder(fetches, data.order);
+
+            if (m_GraphOptimization)
+            {
+                data.optimization_stats = GraphOptimizer(fetches, data.is_training).Optimize(data.order, data.fused_kernels);
+                SESSION_DEBUG_INFO("##Session: %s\n", data.optimization_stats.ToString().c_str());
+            }
+
             m_OrderCache[fetchesHash] = data;
             orderIt = m_OrderCache.find(fetchesHash);
         }
 
-        return RunInOrder(orderIt->second.order, fetches, feeds, orderIt->second.is_training);
+        return RunInOrder(orderIt->second.order, &orderIt->second.fused_kernels, fetches, feeds, orderIt->second.is_training);
     }
 
     //////////////////////////////////////////////////////////////////////////
     vector<Tensor*> Session::RunInOrder(const vector<TensorLike*>& order, const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds, bool training)
+    {
+        return RunInOrder(order, nullptr, fetches, feeds, training);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    vector<Tensor*> Session::RunInOrder(const vector<TensorLike*>& order, const GraphOptimizer::fused_kernels_t* fusedKernels, const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds, bool training)
     {
         m_Graph->InitVariables();
         m_Graph->IncrementStep();
 
+        // training operations update variables
+        if (training)
+            m_Graph->ParametersChanged();
+
         for (auto feed : feeds)
         {
             SESSION_DEBUG_INFO("##Session: Feeding '%s'...\n", feed.first->Name().c_str());
@@ -79,58 +113,289 @@ namespace Neuro
             feed.second->CopyTo(feed.first->m_Output);
         }
 
-        for (size_t n = 0; n < order.size(); ++n)
+        bool runInParallel = m_ParallelExecution && CanRunInParallel(order);
+
+        vector<ExecutionStep> executionTrace;
+        size_t planKey = (GetFetchesHash(order) * 31 + GetFetchesHash(fetches)) * 2 + (training ? 1 : 0);
+
+        if (m_MemoryPlanning && !runInParallel)
+        {
+            auto planIt = m_MemoryPlans.find(planKey);
+            ActivateMemoryPlan(planIt != m_MemoryPlans.end() ? planIt->second.get() : nullptr);
+
+            // first run of this order is used to figure out tensors lifetimes
+            if (!m_ActiveMemoryPlan)
+                m_Graph->SetExecutionTrace(&executionTrace);
+        }
+        else
+            ActivateMemoryPlan(nullptr);
+
+        if (fusedKernels && fusedKernels->empty())
+            fusedKernels = nullptr;
+
+        if (runInParallel)
+            RunInParallel(order, fusedKernels, fetches, training);
+        else
         {
-            // as of right now there is no functionality using that feature
-            /*if (n + 1 < order.size())
+            for (size_t n = 0; n < order.size(); ++n)
             {
-                auto node = order[n + 1];
-                SESSION_DEBUG_INFO("##Session: Preloading '%s'...\n", node->Name().c_str());
-                node->Prefetch();
-            }*/
+                // as of right now there is no functionality using that feature
+                /*if (n + 1 < order.size())
+                {
+                    auto node = order[n + 1];
+                    SESSION_DEBUG_INFO("##Session: Preloading '%s'...\n", node->Name().c_str());
+                    node->Prefetch();
+                }*/
 
-            auto node = order[n];
+                ComputeNode(order[n], FindFusedKernel(fusedKernels, order[n]), fetches, training);
+            }
+        }
 
-            NVTXProfile p(node->Name().c_str(), 0xFFD67FFF);
+        if (m_Graph->ExecutionTrace())
+        {
+            m_Graph->SetExecutionTrace(nullptr);
+            auto plan = new MemoryPlan(executionTrace, fetches);
+            SESSION_DEBUG_INFO("##Session: %s\n", plan->ToString().c_str());
+            m_MemoryPlans[planKey].reset(plan);
+        }
 
-            bool isFetched = find(fetches.begin(), fetches.end(), node) != fetches.end();
-            node->SetFetched(isFetched);
-            node->Output().ResetRef(isFetched ? 1 : 0); // lock fetches outputs so they don't get completely released 
+        Debug::Step();
+
+        vector<Tensor*> result(fetches.size());
+        for (size_t i = 0; i < fetches.size(); ++i)
+            result[i] = fetches[i]->OutputPtr();
+        return result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Session::ComputeNode(TensorLike* node, FusedKernel* fused, const vector<TensorLike*>& fetches, bool training)
+    {
+        NVTXProfile p(node->Name().c_str(), 0xFFD67FFF);
+
+        if (m_Graph->ExecutionTrace())
+            m_Graph->ExecutionTrace()->push_back({ node, false, fused ? &fused->InputNodes() : nullptr });
+
+        bool isFetched = find(fetches.begin(), fetches.end(), node) != fetches.end();
+        node->SetFetched(isFetched);
+        node->Output().ResetRef(isFetched ? 1 : 0); // lock fetches outputs so they don't get completely released 
             
-            if (node->IsOp())
+        if (node->IsOp())
+        {
+            SESSION_DEBUG_INFO("##Session: Computing '%s'...\n", node->Name().c_str());
+            Operation* op = static_cast<Operation*>(node);
+            op->Compute(training, fused);
+
+            if (Debug::ShouldLogOutput(node->Name()))
+            {
+                for (size_t i = 0; i < op->Inputs().size(); ++i)
+                {
+                    //op->Inputs()[i]->Validate();
+                    op->Inputs()[i]->DebugDumpValues(node->Name() + "_input" + to_string(i) + "_step" + to_string(Debug::GetStep()) + ".log");
+                }
+            }
+        }
+
+        if (Debug::ShouldLogOutput(node->Name()))
+        {
+            //node->Output().Validate();
+            node->Output().DebugDumpValues(node->Name() + "_output0_step" + to_string(Debug::GetStep()) + ".log");
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool Session::CanRunInParallel(const vector<TensorLike*>& order) const
+    {
+        // GPU operations share streams and library handles so they have to be issued one by one
+        for (auto node : order)
+        {
+            if (node->IsOp() && static_cast<Operation*>(node)->OpMode() == GPU)
+                return false;
+        }
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    Session::ParallelSchedule* Session::GetParallelSchedule(const vector<TensorLike*>& order, const GraphOptimizer::fused_kernels_t* fusedKernels)
+    {
+        size_t scheduleKey = GetFetchesHash(order) * 31 + std::hash<const void*>()(fusedKernels);
+        auto scheduleIt = m_ParallelSchedules.find(scheduleKey);
+        if (scheduleIt != m_ParallelSchedules.end())
+            return scheduleIt->second.get();
+
+        const size_t NONE = (size_t)-1;
+
+        unordered_map<TensorLike*, size_t> nodeIndex;
+        for (size_t i = 0; i < order.size(); ++i)
+            nodeIndex[order[i]] = i;
+
+        auto schedule = new ParallelSchedule();
+        schedule->fused.resize(order.size());
+        schedule->consumers.resize(order.size());
+        schedule->dependenciesNum.resize(order.size());
+        schedule->pendingInputs.reset(new atomic<uint32_t>[order.size()]);
+
+        for (size_t i = 0; i < order.size(); ++i)
+            schedule->fused[i] = FindFusedKernel(fusedKernels, order[i]);
+
+        // order is topologically sorted so all dependencies of a node precede it
+        size_t lastBarrier = NONE;
+        size_t lastSideEffect = NONE;
+
+        auto addDependency = [&](size_t producer, size_t consumer)
+        {
+            auto& consumers = schedule->consumers[producer];
+            if (find(consumers.begin(), consumers.end(), consumer) != consumers.end())
+                return;
+            consumers.push_back(consumer);
+            ++schedule->dependenciesNum[consumer];
+        };
+
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            auto node = order[i];
+            auto op = node->IsOp() ? static_cast<Operation*>(node) : nullptr;
+
+            // training operations (ie. minimization) compute gradients and update variables, nothing can run alongside them
+            if (op && op->IsTrainingOp())
+            {
+                for (size_t j = (lastBarrier == NONE ? 0 : lastBarrier); j < i; ++j)
+                    addDependency(j, i);
+                lastBarrier = lastSideEffect = i;
+                continue;
+            }
+
+            for (auto inputNode : schedule->fused[i] ? schedule->fused[i]->InputNodes() : node->InputNodes())
             {
-                SESSION_DEBUG_INFO("##Session: Computing '%s'...\n", node->Name().c_str());
-                Operation* op = static_cast<Operation*>(node);
-                op->Compute(training);
+                auto inputIt = nodeIndex.find(inputNode);
+                if (inputIt != nodeIndex.end())
+                    addDependency(inputIt->second, i);
+            }
+
+            if (lastBarrier != NONE)
+                addDependency(lastBarrier, i);
 
-                if (Debug::ShouldLogOutput(node->Name()))
+            // operations with side effects share global state (random generator, variables), they are chained in order
+            if (op && op->HasSideEffects())
+            {
+                if (lastSideEffect != NONE)
+                    addDependency(lastSideEffect, i);
+                lastSideEffect = i;
+            }
+        }
+
+        m_ParallelSchedules[scheduleKey].reset(schedule);
+        return schedule;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Session::RunInParallel(const vector<TensorLike*>& order, const GraphOptimizer::fused_kernels_t* fusedKernels, const vector<TensorLike*>& fetches, bool training)
+    {
+        auto schedule = GetParallelSchedule(order, fusedKernels);
+        auto& pendingInputs = schedule->pendingInputs;
+
+        for (size_t i = 0; i < order.size(); ++i)
+            pendingInputs[i] = schedule->dependenciesNum[i];
+
+        auto& pool = ThreadPool::Default();
+        atomic<size_t> pendingNodes(order.size());
+        // once any node fails remaining ones are only counted down so the calling thread can rethrow
+        atomic<bool> failed(false);
+        exception_ptr error;
+        mutex errorLock;
+
+        function<void(size_t)> runNode = [&](size_t i)
+        {
+            if (!failed)
+            {
+                // nodes are already spread across pool threads, nested OpenMP teams would oversubscribe cores
+                int ompThreadsNum = omp_get_max_threads();
+                omp_set_num_threads(1);
+
+                try
                 {
-                    for (size_t i = 0; i < op->Inputs().size(); ++i)
-                    {
-                        //op->Inputs()[i]->Validate();
-                        op->Inputs()[i]->DebugDumpValues(node->Name() + "_input" + to_string(i) + "_step" + to_string(Debug::GetStep()) + ".log");
-                    }
+                    ComputeNode(order[i], schedule->fused[i], fetches, training);
                 }
+                catch (...)
+                {
+                    unique_lock<mutex> errorLocker(errorLock);
+                    if (!error)
+                        error = current_exception();
+                    failed = true;
+                }
+
+                omp_set_num_threads(ompThreadsNum);
             }
 
-            if (Debug::ShouldLogOutput(node->Name()))
+            for (size_t consumer : schedule->consumers[i])
             {
-                //node->Output().Validate();
-                node->Output().DebugDumpValues(node->Name() + "_output0_step" + to_string(Debug::GetStep()) + ".log");
+                if (--pendingInputs[consumer] == 0)
+                    pool.Enqueue([&runNode, consumer]() { runNode(consumer); });
             }
+
+            --pendingNodes;
+        };
+
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            if (schedule->dependenciesNum[i] == 0)
+                pool.Enqueue([&runNode, i]() { runNode(i); });
         }
 
-        Debug::Step();
+        // calling thread helps computing nodes until the whole graph is done
+        while (pendingNodes.load() > 0)
+        {
+            if (!pool.RunPendingTask())
+                this_thread::yield();
+        }
 
-        vector<Tensor*> result(fetches.size());
-        for (size_t i = 0; i < fetches.size(); ++i)
-            result[i] = fetches[i]->OutputPtr();
-        return result;
+        if (error)
+            rethrow_exception(error);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    GraphOptimizationStats Session::OptimizationStats(const vector<TensorLike*>& fetches) const
+    {
+        auto orderIt = m_OrderCache.find(GetFetchesHash(fetches));
+        if (orderIt == m_OrderCache.end())
+            return GraphOptimizationStats();
+        return orderIt->second.optimization_stats;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Session::SetMemoryPlanning(bool enabled)
+    {
+        m_MemoryPlanning = enabled;
+
+        if (!enabled)
+        {
+            ActivateMemoryPlan(nullptr);
+            m_MemoryPlans.clear();
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Session::ActivateMemoryPlan(MemoryPlan* plan)
+    {
+        if (m_ActiveMemoryPlan == plan)
+            return;
+
+        // tensors can be bound to single plan at a time
+        if (m_ActiveMemoryPlan)
+            m_ActiveMemoryPlan->Release();
+
+        m_ActiveMemoryPlan = plan;
+
+        if (m_ActiveMemoryPlan)
+            m_ActiveMemoryPlan->Apply();
     }
 
     //////////////////////////////////////////////////////////////////////////
     void Session::Clear()
     {
+        // plans have to be released while tensors are still alive
+        ActivateMemoryPlan(nullptr);
+        m_MemoryPlans.clear();
+        m_ParallelSchedules.clear();
         m_OrderCache.clear();
         m_Graph->Clear();
     }
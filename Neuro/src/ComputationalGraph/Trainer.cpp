@@ -37,4 +37,10 @@ namespace Neuro
 
         return Session::Default()->RunInOrder(m_Order, m_FetchOps, m_Feeds, true);
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    tensor_ptr_vec_t Trainer::Train()
+    {
+        return Session::Default()->RunInOrder(m_Order, m_FetchOps, {}, true);
+    }
 }
\ No newline at end of file
@@ -62,6 +62,16 @@ namespace Neuro
 
         if (m_Initializer)
             m_Initializer->Init(m_Output);
+
+        m_Graph->ParametersChanged();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Variable::ForceInitialized()
+    {
+        // value was loaded from outside
+        m_Initialized = true;
+        m_Graph->ParametersChanged();
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -2,13 +2,16 @@
 #include "Tensors/Tensor.h"
 #include "ComputationalGraph/Placeholder.h"
 #include "Tools.h"
+#include "Stopwatch.h"
 
 namespace Neuro
 {
     //////////////////////////////////////////////////////////////////////////
-    DataPreloader::DataPreloader(const vector<Tensor*>& destination, const vector<ILoader*>& loaders, size_t capacity, bool threadedMode)
-        : m_Destination(destination), m_Loaders(loaders), m_ThreadedMode(threadedMode)
+    DataPreloader::DataPreloader(const vector<Tensor*>& destination, const vector<ILoader*>& loaders, size_t capacity, bool threadedMode, uint32_t workersNum, bool orderedDelivery)
+        : m_Destination(destination), m_Loaders(loaders), m_LoaderNextSeq(loaders.size(), 0), m_ThreadedMode(threadedMode), m_OrderedDelivery(orderedDelivery), m_Stop(false)
     {
+        NEURO_ASSERT(capacity > 0, "Preloader capacity must be positive.");
+
         for (size_t i = 0; i < capacity; ++i)
         {
             vector<Tensor>* data = new vector<Tensor>(destination.size());
@@ -18,22 +21,30 @@ namespace Neuro
         }
 
         if (m_ThreadedMode)
-            m_PreloaderThread = thread(&DataPreloader::PreloadFunc, this);
+        {
+            // there is no point in having more workers than buffers to load into
+            workersNum = (uint32_t)min<size_t>(max<uint32_t>(workersNum, 1), capacity);
+            for (uint32_t i = 0; i < workersNum; ++i)
+                m_Workers.push_back(thread(&DataPreloader::PreloadFunc, this));
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
     DataPreloader::~DataPreloader()
     {
-        m_Stop = true;
+        {
+            unique_lock<mutex> pendingLocker(m_PendingMtx);
+            m_Stop = true;
+        }
         m_PendingCond.notify_all();
-        if (m_ThreadedMode)
-            m_PreloaderThread.join();
+        for (auto& worker : m_Workers)
+            worker.join();
 
         for (auto& tVec : m_Pending)
             delete tVec;
 
         for (auto& tVec : m_Available)
-            delete tVec;
+            delete tVec.second;
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -42,16 +53,24 @@ namespace Neuro
         if (!m_ThreadedMode)
             Preload();
 
+        Stopwatch timer;
+        timer.Start();
+
         vector<Tensor>* data = nullptr;
         {
             NVTXProfile p("Waiting for available data", 0xFF93FF72);
             unique_lock<mutex> availableLocker(m_AvailableMtx);
-            m_AvailableCond.wait(availableLocker, [this]() {return !m_Available.empty(); });
+            m_AvailableCond.wait(availableLocker, [this]() { return m_OrderedDelivery ? m_Available.count(m_NextDeliverySeq) > 0 : !m_Available.empty(); });
 
-            data = m_Available.front();
-            m_Available.pop_front();
+            auto it = m_OrderedDelivery ? m_Available.find(m_NextDeliverySeq) : m_Available.begin();
+            data = it->second;
+            m_Available.erase(it);
+            ++m_NextDeliverySeq;
         }
 
+        m_WaitTime += timer.ElapsedMicroseconds();
+        timer.Restart();
+
         {
             NVTXProfile p("Copying preloaded data to placeholders", 0xFF93FF72);
             // copy data to destination
@@ -62,18 +81,21 @@ namespace Neuro
             }
         }
 
+        m_CopyTime += timer.ElapsedMicroseconds();
+
         {
             NVTXProfile p("Waiting for pending data lock", 0xFF93FF72);
             unique_lock<mutex> pendingLocker(m_PendingMtx);
             m_Pending.push_back(data);
         }
-        m_PendingCond.notify_all();
+        m_PendingCond.notify_one();
     }
 
     //////////////////////////////////////////////////////////////////////////
     void DataPreloader::Preload()
     {
         vector<Tensor>* data = nullptr;
+        size_t seq;
 
         {
             NVTXProfile p("Waiting for pending data", 0xFF93FF72);
@@ -85,6 +107,7 @@ namespace Neuro
 
             data = m_Pending.front();
             m_Pending.pop_front();
+            seq = m_NextLoadSeq++;
         }
 
         {
@@ -92,15 +115,35 @@ namespace Neuro
             // load data
             size_t loadIdx = 0;
             for (size_t i = 0; i < m_Loaders.size(); ++i)
+            {
+                if (m_Loaders[i]->Reentrant())
+                {
+                    loadIdx += (*m_Loaders[i])(*data, loadIdx);
+                    continue;
+                }
+
+                // non-reentrant loaders are called in sequence order so data stream is deterministic regardless of workers number
+                {
+                    unique_lock<mutex> loaderLocker(m_LoaderMtx);
+                    m_LoaderCond.wait(loaderLocker, [&]() { return m_LoaderNextSeq[i] == seq; });
+                }
+
                 loadIdx += (*m_Loaders[i])(*data, loadIdx);
 
+                {
+                    unique_lock<mutex> loaderLocker(m_LoaderMtx);
+                    ++m_LoaderNextSeq[i];
+                }
+                m_LoaderCond.notify_all();
+            }
+
             NEURO_ASSERT(loadIdx == data->size(), "Number or loaded items (" << loadIdx << ") doesn't match number of destinations (" << data->size() << ").");
         }
 
         {
             NVTXProfile p("Waiting for available data lock", 0xFF93FF72);
             unique_lock<mutex> availableLocker(m_AvailableMtx);
-            m_Available.push_back(data);
+            m_Available[seq] = data;
         }
         m_AvailableCond.notify_all();
     }
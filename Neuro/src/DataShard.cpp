@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cstring>
+
+#include "DataShard.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+#include "Tensors/Tensor.h"
+
+namespace Neuro
+{
+    static const char SHARD_MAGIC[8] = { 'N', 'E', 'U', 'R', 'O', 'S', 'H', 'D' };
+    static const uint32_t SHARD_VERSION = 1;
+    // field data is page aligned so it can be mapped at any granularity
+    static const size_t SHARD_DATA_ALIGNMENT = 4096;
+    // number of images decoded at once when converting image directory
+    static const uint32_t IMAGES_CHUNK_SIZE = 256;
+
+#pragma pack(push, 1)
+    struct ShardFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t dataFormat;
+        uint64_t samplesNum;
+        uint32_t fieldsNum;
+        uint32_t reserved;
+    };
+
+    struct ShardFileField
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t depth;
+        uint32_t type;
+        uint64_t dataOffset;
+    };
+#pragma pack(pop)
+
+    //////////////////////////////////////////////////////////////////////////
+    static size_t SampleSizeInBytes(const ShardField& field)
+    {
+        return (size_t)field.shape.Width() * field.shape.Height() * field.shape.Depth() * (field.type == SHARD_UINT8 ? 1 : sizeof(float));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    DataShardWriter::DataShardWriter(const string& filename, const vector<ShardField>& fields, size_t samplesNum, EDataFormat dataFormat)
+        : m_Stream(filename, ios::out | ios::binary), m_Fields(fields), m_SamplesNum(samplesNum)
+    {
+        NEURO_ASSERT(m_Stream, "Failed to create shard '" << filename << "'.");
+
+        ShardFileHeader header = {};
+        memcpy(header.magic, SHARD_MAGIC, sizeof(SHARD_MAGIC));
+        header.version = SHARD_VERSION;
+        header.dataFormat = (uint32_t)dataFormat;
+        header.samplesNum = samplesNum;
+        header.fieldsNum = (uint32_t)fields.size();
+        m_Stream.write((const char*)&header, sizeof(header));
+
+        size_t offset = sizeof(ShardFileHeader) + fields.size() * sizeof(ShardFileField);
+        for (auto& field : fields)
+        {
+            offset = (offset + SHARD_DATA_ALIGNMENT - 1) / SHARD_DATA_ALIGNMENT * SHARD_DATA_ALIGNMENT;
+            m_DataOffsets.push_back(offset);
+
+            ShardFileField fieldHeader = { field.shape.Width(), field.shape.Height(), field.shape.Depth(), (uint32_t)field.type, offset };
+            m_Stream.write((const char*)&fieldHeader, sizeof(fieldHeader));
+
+            offset += samplesNum * SampleSizeInBytes(field);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    DataShardWriter::~DataShardWriter()
+    {
+        if (m_Stream.is_open())
+            Close();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void DataShardWriter::Append(const vector<const Tensor*>& fieldsData)
+    {
+        NEURO_ASSERT(fieldsData.size() == m_Fields.size(), "Expected " << m_Fields.size() << " fields, got " << fieldsData.size() << ".");
+        uint32_t batch = fieldsData[0]->Batch();
+        NEURO_ASSERT(m_WrittenSamplesNum + batch <= m_SamplesNum, "Appending more samples than declared.");
+
+        vector<uint8_t> bytes;
+        for (size_t f = 0; f < m_Fields.size(); ++f)
+        {
+            auto& data = *fieldsData[f];
+            NEURO_ASSERT(data.Batch() == batch, "All fields must have the same number of samples.");
+            NEURO_ASSERT(data.BatchLength() == m_Fields[f].shape.Length, "Sample shape " << data.GetShape().ToString() << " doesn't match field shape " << m_Fields[f].shape.ToString() << ".");
+
+            m_Stream.seekp(m_DataOffsets[f] + m_WrittenSamplesNum * SampleSizeInBytes(m_Fields[f]));
+            if (m_Fields[f].type == SHARD_FLOAT32)
+            {
+                m_Stream.write((const char*)data.Values(), data.Length() * sizeof(float));
+                continue;
+            }
+
+            bytes.resize(data.Length());
+            const float* values = data.Values();
+            for (size_t i = 0; i < bytes.size(); ++i)
+                bytes[i] = (uint8_t)Clip(values[i], 0.f, 255.f);
+            m_Stream.write((const char*)bytes.data(), bytes.size());
+        }
+
+        m_WrittenSamplesNum += batch;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool DataShardWriter::Close()
+    {
+        bool success = (bool)m_Stream && m_WrittenSamplesNum == m_SamplesNum;
+        m_Stream.close();
+        return success;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool SaveShard(const string& filename, const vector<const Tensor*>& fieldsData, const vector<EShardElementType>& types, EDataFormat dataFormat, bool shuffle)
+    {
+        NEURO_ASSERT(fieldsData.size() == types.size(), "Element type has to be specified for every field.");
+
+        vector<ShardField> fields(fieldsData.size());
+        for (size_t f = 0; f < fields.size(); ++f)
+        {
+            fields[f].shape = Shape::From(fieldsData[f]->GetShape(), 1);
+            fields[f].type = types[f];
+        }
+
+        uint32_t samplesNum = fieldsData[0]->Batch();
+        vector<uint32_t> order(samplesNum);
+        for (uint32_t i = 0; i < samplesNum; ++i)
+            order[i] = i;
+        if (shuffle)
+        {
+            for (uint32_t i = samplesNum - 1; i > 0; --i)
+                swap(order[i], order[GlobalRng().Next(i + 1)]);
+        }
+
+        DataShardWriter writer(filename, fields, samplesNum, dataFormat);
+
+        // samples are reordered in chunks, so memory overhead doesn't depend on dataset size
+        const uint32_t CHUNK_SIZE = 1024;
+        vector<Tensor> chunk(fields.size());
+        vector<const Tensor*> chunkPtrs(fields.size());
+        for (uint32_t begin = 0; begin < samplesNum; begin += CHUNK_SIZE)
+        {
+            uint32_t end = min(begin + CHUNK_SIZE, samplesNum);
+            for (size_t f = 0; f < fields.size(); ++f)
+            {
+                chunk[f].Resize(Shape::From(fields[f].shape, end - begin));
+                chunk[f].OverrideHost();
+                for (uint32_t i = begin; i < end; ++i)
+                    fieldsData[f]->CopyBatchTo(order[i], i - begin, chunk[f]);
+                chunkPtrs[f] = &chunk[f];
+            }
+            writer.Append(chunkPtrs);
+        }
+
+        return writer.Close();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ConvertImagesToShard(const string& dir, const string& filename, uint32_t width, uint32_t height, EDataFormat dataFormat, bool shuffle)
+    {
+        auto files = LoadFilesList(dir, shuffle);
+
+        ShardField field;
+        field.shape = dataFormat == NCHW ? Shape(width, height, 3) : Shape(3, width, height);
+        field.type = SHARD_UINT8;
+
+        DataShardWriter writer(filename, { field }, files.size(), dataFormat);
+
+        Tensor images;
+        for (size_t begin = 0; begin < files.size(); begin += IMAGES_CHUNK_SIZE)
+        {
+            uint32_t chunkSize = (uint32_t)min<size_t>(IMAGES_CHUNK_SIZE, files.size() - begin);
+            images.Resize(Shape::From(field.shape, chunkSize));
+            images.OverrideHost();
+
+            ThreadPool::Default().ParallelFor(0, chunkSize, 1, [&](uint32_t chunkBegin, uint32_t chunkEnd)
+            {
+                for (uint32_t i = chunkBegin; i < chunkEnd; ++i)
+                    LoadImage(files[begin + i], images.Values() + i * images.BatchLength(), width, height, 0, 0, dataFormat);
+            });
+
+            writer.Append({ &images });
+        }
+
+        return writer.Close();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ConvertMnistToShard(const string& imagesFile, const string& labelsFile, const string& filename, bool shuffle)
+    {
+        Tensor input, output;
+        LoadMnistData(imagesFile, labelsFile, input, output, false);
+        return SaveShard(filename, { &input, &output }, { SHARD_UINT8, SHARD_FLOAT32 }, NCHW, shuffle);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ConvertCifar10ToShard(const string& imagesFile, const string& filename, bool shuffle)
+    {
+        Tensor input, output;
+        LoadCifar10Data(imagesFile, input, output, false);
+        return SaveShard(filename, { &input, &output }, { SHARD_UINT8, SHARD_FLOAT32 }, NCHW, shuffle);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ConvertCSVToShard(const string& csvFile, int outputsNum, const string& filename, bool outputsOneHotEncoded, bool shuffle)
+    {
+        Tensor input, output;
+        LoadCSVData(csvFile, outputsNum, input, output, outputsOneHotEncoded);
+        return SaveShard(filename, { &input, &output }, { SHARD_FLOAT32, SHARD_FLOAT32 }, NCHW, shuffle);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    DataShard::DataShard(const string& filename)
+    {
+        m_File = make_unique<MappedFile>(filename);
+        m_Data = m_File->Data();
+        m_Size = m_File->Size();
+        NEURO_ASSERT(m_Data, "Failed to open shard '" << filename << "'.");
+        NEURO_ASSERT(m_Size >= sizeof(ShardFileHeader), "Shard '" << filename << "' is truncated.");
+
+        auto& header = *(const ShardFileHeader*)m_Data;
+        NEURO_ASSERT(memcmp(header.magic, SHARD_MAGIC, sizeof(SHARD_MAGIC)) == 0, "'" << filename << "' is not a shard.");
+        NEURO_ASSERT(header.version == SHARD_VERSION, "Unsupported shard version " << header.version << ".");
+        NEURO_ASSERT(m_Size >= sizeof(ShardFileHeader) + header.fieldsNum * sizeof(ShardFileField), "Shard '" << filename << "' is truncated.");
+
+        m_SamplesNum = (size_t)header.samplesNum;
+        m_DataFormat = (EDataFormat)header.dataFormat;
+
+        auto fieldHeaders = (const ShardFileField*)(m_Data + sizeof(ShardFileHeader));
+        for (uint32_t f = 0; f < header.fieldsNum; ++f)
+        {
+            ShardField field;
+            field.shape = Shape(fieldHeaders[f].width, fieldHeaders[f].height, fieldHeaders[f].depth);
+            field.type = (EShardElementType)fieldHeaders[f].type;
+            m_Fields.push_back(field);
+            m_DataOffsets.push_back((size_t)fieldHeaders[f].dataOffset);
+
+            NEURO_ASSERT(m_DataOffsets[f] + m_SamplesNum * FieldSampleSizeInBytes(f) <= m_Size, "Shard '" << filename << "' is truncated.");
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t DataShard::FieldSampleSizeInBytes(size_t fieldIdx) const
+    {
+        return SampleSizeInBytes(m_Fields[fieldIdx]);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    ShardLoader::ShardLoader(const vector<string>& shardFiles, uint32_t batchSize, bool contiguousBatches, float uint8Scale, unsigned int seed)
+        : m_BatchSize(batchSize), m_ContiguousBatches(contiguousBatches), m_Uint8Scale(uint8Scale), m_Rng(seed)
+    {
+        NEURO_ASSERT(!shardFiles.empty(), "No shards to load from.");
+
+        for (auto& file : shardFiles)
+        {
+            auto shard = new DataShard(file);
+            m_Shards.push_back(shard);
+            m_SamplesNum += shard->SamplesNum();
+
+            auto& fields = m_Shards[0]->Fields();
+            NEURO_ASSERT(shard->Fields().size() == fields.size(), "Shard '" << file << "' has different number of fields.");
+            for (size_t f = 0; f < fields.size(); ++f)
+                NEURO_ASSERT(shard->Fields()[f].shape == fields[f].shape && shard->Fields()[f].type == fields[f].type, "Field " << f << " of shard '" << file << "' doesn't match other shards.");
+            NEURO_ASSERT(!contiguousBatches || shard->SamplesNum() >= batchSize, "Shard '" << file << "' has less samples than batch size.");
+            m_StartsNum += StartsNum(shard);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    ShardLoader::~ShardLoader()
+    {
+        DeleteContainer(m_Shards);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t ShardLoader::operator()(vector<Tensor>& dest, size_t loadIdx)
+    {
+        // every sample is identified by its shard and index within it, in contiguous mode only the first one is picked randomly (all
+        // windows of batch size consecutive samples across all shards are equally likely)
+        vector<pair<const DataShard*, size_t>> samples(m_ContiguousBatches ? 1 : m_BatchSize);
+        {
+            lock_guard<mutex> lock(m_RngLock);
+            for (auto& sample : samples)
+            {
+                size_t idx = (size_t)m_Rng.Next((int)m_StartsNum);
+                size_t shardIdx = 0;
+                while (idx >= StartsNum(m_Shards[shardIdx]))
+                    idx -= StartsNum(m_Shards[shardIdx++]);
+                sample = make_pair(m_Shards[shardIdx], idx);
+            }
+        }
+
+        auto& fields = m_Shards[0]->Fields();
+        for (size_t f = 0; f < fields.size(); ++f)
+        {
+            auto& x = dest[loadIdx + f];
+            NEURO_ASSERT(x.BatchLength() == fields[f].shape.Length, "Destination shape " << x.GetShape().ToString() << " doesn't match shard field shape " << fields[f].shape.ToString() << ".");
+            x.ResizeBatch(m_BatchSize);
+
+            const size_t sampleSize = samples[0].first->FieldSampleSizeInBytes(f);
+
+            if (m_ContiguousBatches && fields[f].type == SHARD_FLOAT32)
+            {
+                x.BindHostMemory((float*)(samples[0].first->FieldData(f) + samples[0].second * sampleSize), x.Length());
+                x.OverrideHost();
+                continue;
+            }
+
+            x.OverrideHost();
+            float* values = x.Values();
+            for (uint32_t n = 0; n < m_BatchSize; ++n)
+            {
+                auto& sample = m_ContiguousBatches ? samples[0] : samples[n];
+                size_t sampleIdx = m_ContiguousBatches ? sample.second + n : sample.second;
+                const uint8_t* src = sample.first->FieldData(f) + sampleIdx * sampleSize;
+                float* dst = values + n * x.BatchLength();
+
+                if (fields[f].type == SHARD_FLOAT32)
+                {
+                    memcpy(dst, src, sampleSize);
+                    continue;
+                }
+
+                for (uint32_t i = 0; i < x.BatchLength(); ++i)
+                    dst[i] = src[i] * m_Uint8Scale;
+            }
+        }
+
+        return fields.size();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t ShardLoader::StartsNum(const DataShard* shard) const
+    {
+        return m_ContiguousBatches ? shard->SamplesNum() - m_BatchSize + 1 : shard->SamplesNum();
+    }
+}
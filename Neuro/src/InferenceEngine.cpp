@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "InferenceEngine.h"
+#include "ComputationalGraph/Placeholder.h"
+#include "ComputationalGraph/Predicter.h"
+#include "Models/ModelBase.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    //////////////////////////////////////////////////////////////////////////
+    static vector<Placeholder*> ToPlaceholders(const vector<TensorLike*>& inputs)
+    {
+        vector<Placeholder*> placeholders;
+        for (auto input : inputs)
+            placeholders.push_back(static_cast<Placeholder*>(input));
+        return placeholders;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    InferenceEngine::InferenceEngine(const vector<Placeholder*>& inputPlaceholders, const vector<TensorLike*>& outputOps, uint32_t maxBatchSize, int64_t maxLatencyUs)
+        : m_InputPlaceholders(inputPlaceholders), m_MaxBatchSize(maxBatchSize), m_MaxLatency(maxLatencyUs), m_Stop(false)
+    {
+        NEURO_ASSERT(maxBatchSize > 0, "Max batch size must be positive.");
+
+        m_Predicter = new Predicter(inputPlaceholders, outputOps);
+        m_Predicter->Compile();
+
+        for (auto placeholder : inputPlaceholders)
+        {
+            m_InputShapes.push_back(Shape::From(placeholder->GetShape(), 1));
+            m_BatchInputs.push_back(Tensor(m_InputShapes.back(), placeholder->Name() + "/batch"));
+        }
+
+        m_Worker = thread(&InferenceEngine::WorkerFunc, this);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    InferenceEngine::InferenceEngine(ModelBase* model, uint32_t maxBatchSize, int64_t maxLatencyUs)
+        : InferenceEngine(ToPlaceholders(model->m_Inputs), model->m_Outputs, maxBatchSize, maxLatencyUs)
+    {
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    InferenceEngine::~InferenceEngine()
+    {
+        // requests already queued are still computed
+        {
+            unique_lock<mutex> queueLocker(m_QueueMtx);
+            m_Stop = true;
+        }
+        m_QueueCond.notify_all();
+        m_Worker.join();
+
+        delete m_Predicter;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    future<vector<Tensor>> InferenceEngine::Submit(const const_tensor_ptr_vec_t& inputs)
+    {
+        NEURO_ASSERT(inputs.size() == m_InputPlaceholders.size(), "Mismatched number of inputs, expected " << m_InputPlaceholders.size() << " received " << inputs.size() << ".");
+
+        auto request = new Request();
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            NEURO_ASSERT(inputs[i]->GetShape() == m_InputShapes[i], "Mismatched input shape. Expected: " << m_InputShapes[i].ToString() << " received: " << inputs[i]->GetShape().ToString());
+            request->inputs.push_back(*inputs[i]);
+        }
+
+        auto result = request->outputs.get_future();
+
+        {
+            unique_lock<mutex> queueLocker(m_QueueMtx);
+            // worker may already be gone, so nobody would ever complete this request
+            if (m_Stop)
+            {
+                request->outputs.set_exception(make_exception_ptr(runtime_error("Inference engine is stopping.")));
+                delete request;
+                return result;
+            }
+            request->submitTime = chrono::steady_clock::now();
+            m_Queue.push_back(request);
+        }
+        m_QueueCond.notify_one();
+
+        return result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    vector<Tensor> InferenceEngine::Predict(const const_tensor_ptr_vec_t& inputs)
+    {
+        return Submit(inputs).get();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    InferenceEngineStats InferenceEngine::Stats() const
+    {
+        unique_lock<mutex> queueLocker(m_QueueMtx);
+        return m_Stats;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void InferenceEngine::WorkerFunc()
+    {
+        vector<Request*> batch;
+
+        while (true)
+        {
+            {
+                unique_lock<mutex> queueLocker(m_QueueMtx);
+                m_QueueCond.wait(queueLocker, [this]() { return !m_Queue.empty() || m_Stop; });
+
+                if (m_Queue.empty())
+                    return;
+
+                // keep collecting requests until batch is full or the oldest one can't wait any longer
+                auto deadline = m_Queue.front()->submitTime + chrono::microseconds(m_MaxLatency);
+                m_QueueCond.wait_until(queueLocker, deadline, [this]() { return m_Queue.size() >= m_MaxBatchSize || m_Stop; });
+
+                size_t batchSize = min<size_t>(m_Queue.size(), m_MaxBatchSize);
+                batch.assign(m_Queue.begin(), m_Queue.begin() + batchSize);
+                m_Queue.erase(m_Queue.begin(), m_Queue.begin() + batchSize);
+
+                m_Stats.requests += batchSize;
+                ++m_Stats.batches;
+                if (batchSize == m_MaxBatchSize)
+                    ++m_Stats.fullBatches;
+            }
+
+            RunBatch(batch);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void InferenceEngine::RunBatch(vector<Request*>& batch)
+    {
+        NVTXProfile p("Inference batch", 0xFF93FF72);
+        uint32_t batchSize = (uint32_t)batch.size();
+
+        vector<vector<Tensor>> results(batchSize);
+
+        try
+        {
+            const_tensor_ptr_vec_t inputs(m_BatchInputs.size());
+            for (size_t i = 0; i < m_BatchInputs.size(); ++i)
+            {
+                m_BatchInputs[i].ResizeBatch(batchSize);
+                for (uint32_t b = 0; b < batchSize; ++b)
+                    batch[b]->inputs[i].CopyBatchTo(0, b, m_BatchInputs[i]);
+                inputs[i] = &m_BatchInputs[i];
+            }
+
+            auto outputs = m_Predicter->Predict(inputs);
+
+            for (uint32_t b = 0; b < batchSize; ++b)
+            {
+                for (auto output : outputs)
+                    results[b].push_back(output->GetBatch(b));
+            }
+        }
+        catch (...)
+        {
+            // failure is reported to every request of the batch, worker keeps serving following ones
+            auto error = current_exception();
+            for (auto request : batch)
+            {
+                request->outputs.set_exception(error);
+                delete request;
+            }
+            return;
+        }
+
+        for (uint32_t b = 0; b < batchSize; ++b)
+        {
+            batch[b]->outputs.set_value(move(results[b]));
+            delete batch[b];
+        }
+    }
+}
\ No newline at end of file
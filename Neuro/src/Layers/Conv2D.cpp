@@ -77,8 +77,9 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     vector<TensorLike*> Conv2D::InternalCall(const vector<TensorLike*>& inputs)
     {
-        if (m_UseBias && m_DataFormat == NCHW && m_Activation && m_Activation->Type() == _ReLU)
-            return { conv2d_bias_activation(inputs[0], m_Kernels, m_Stride, m_Padding, m_Bias, m_Activation ? m_Activation->Type() : _Identity, m_Activation ? m_Activation->Alpha() : 0) };
+        // softmax is computed across channels so it cannot be fused
+        if (m_UseBias && m_DataFormat == NCHW && m_Activation && m_Activation->Type() != _Softmax)
+            return { conv2d_bias_activation(inputs[0], m_Kernels, m_Stride, m_Padding, m_Bias, m_Activation->Type(), m_Activation->Alpha()) };
         
         TensorLike* output = conv2d(inputs[0], m_Kernels, m_Stride, m_Padding, m_DataFormat);
         if (m_UseBias)
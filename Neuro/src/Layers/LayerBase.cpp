@@ -5,6 +5,7 @@
 #include "Tensors/Shape.h"
 #include "Tools.h"
 #include "Models/ModelBase.h"
+#include "ComputationalGraph/Graph.h"
 #include "ComputationalGraph/TensorLike.h"
 #include "ComputationalGraph/Variable.h"
 #include "ComputationalGraph/NameScope.h"
@@ -125,6 +126,10 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
 	void LayerBase::CopyParametersTo(LayerBase& target, float tau) const
 	{
+        vector<Variable*> params;
+        target.Parameters(params, false);
+        for (auto param : params)
+            param->GetGraph()->ParametersChanged();
 	}
 
     //////////////////////////////////////////////////////////////////////////
@@ -31,6 +31,49 @@ namespace Neuro
                                      log(subtract(new Constant(1), clippedOutput, "1-y"), "log(1-y)"), "(1-yTrue)×log(1-y)"), "yTrue×log(y)+(1-yTrue)×log(1-y)"));
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    SoftmaxCrossEntropy::SoftmaxCrossEntropy(bool fromLogits)
+        : m_FromLogits(fromLogits)
+    {
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    TensorLike* SoftmaxCrossEntropy::Build(TensorLike* targetOutput, TensorLike* output)
+    {
+        NameScope scope("softmax_cross_entropy");
+        if (!m_FromLogits && !dynamic_cast<SoftmaxOp*>(output))
+        {
+            // logits are not available so cross entropy has to be computed from probabilities
+            cout << "Output '" << output->Name() << "' is not produced by softmax, use linear activation and fromLogits instead.\n";
+            auto clippedOutput = clip(output, _EPSILON, 1 - _EPSILON);
+            return negative(sum(multiply(targetOutput, log(clippedOutput)), _012Axes));
+        }
+
+        // softmax output is still computed for predictions but it's not a part of loss gradient path
+        auto logits = m_FromLogits ? output : output->InputNodes()[0];
+        return softmax_cross_entropy(targetOutput, logits);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    SigmoidCrossEntropy::SigmoidCrossEntropy(bool fromLogits)
+        : m_FromLogits(fromLogits)
+    {
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    TensorLike* SigmoidCrossEntropy::Build(TensorLike* targetOutput, TensorLike* output)
+    {
+        if (!m_FromLogits && !dynamic_cast<SigmoidOp*>(output))
+        {
+            cout << "Output '" << output->Name() << "' is not produced by sigmoid, use linear activation and fromLogits instead.\n";
+            return BinaryCrossEntropy().Build(targetOutput, output);
+        }
+
+        NameScope scope("sigmoid_cross_entropy");
+        auto logits = m_FromLogits ? output : output->InputNodes()[0];
+        return sigmoid_cross_entropy(targetOutput, logits);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     TensorLike* MeanSquareError::Build(TensorLike* targetOutput, TensorLike* output)
     {
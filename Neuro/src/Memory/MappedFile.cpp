@@ -0,0 +1,65 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Memory/MappedFile.h"
+
+namespace Neuro
+{
+    //////////////////////////////////////////////////////////////////////////
+    MappedFile::MappedFile(const string& filename)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        m_FileHandle = file;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+        m_Size = (size_t)fileSize.QuadPart;
+
+        m_MappingHandle = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (!m_MappingHandle)
+            return;
+        m_Data = (uint8_t*)MapViewOfFile(m_MappingHandle, FILE_MAP_COPY, 0, 0, 0);
+#else
+        int file = open(filename.c_str(), O_RDONLY);
+        if (file < 0)
+            return;
+        m_FileHandle = (void*)(intptr_t)(file + 1); // so descriptor 0 is not mistaken for no file
+
+        struct stat fileStat;
+        if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+            return;
+        m_Size = (size_t)fileStat.st_size;
+
+        void* data = mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        m_Data = data == MAP_FAILED ? nullptr : (uint8_t*)data;
+#endif
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    MappedFile::~MappedFile()
+    {
+#ifdef _WIN32
+        if (m_Data)
+            UnmapViewOfFile(m_Data);
+        if (m_MappingHandle)
+            CloseHandle(m_MappingHandle);
+        if (m_FileHandle)
+            CloseHandle(m_FileHandle);
+#else
+        if (m_Data)
+            munmap(m_Data, m_Size);
+        if (m_FileHandle)
+            close((int)(intptr_t)m_FileHandle - 1);
+#endif
+    }
+}
@@ -7,6 +7,8 @@
 #include "Types.h"
 #include "Tools.h"
 #include "Memory/MemoryManager.h"
+#include "Memory/MemoryTrace.h"
+#include "Memory/SizeClassAllocator.h"
 #include "Tensors/Cuda/CudaErrorCheck.h"
 
 //#define ENABLE_MEMORY_LOGS
@@ -61,6 +63,107 @@ namespace Neuro
     {
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    MemoryManagerBase::~MemoryManagerBase()
+    {
+        NEURO_ASSERT(!m_SizeClassAllocator && m_NativeBlocks.empty() && m_DirectAlocations.empty(), "Native memory has to be released by derived memory manager.");
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryManagerBase::ReleaseNativeMemory()
+    {
+        unique_lock<mutex> allocFreeLocker(m_AllocFreeMtx);
+
+        // size class allocator returns its native memory through this manager
+        delete m_SizeClassAllocator;
+        m_SizeClassAllocator = nullptr;
+
+        for (Block* head : { m_UsedBlocks, m_FreeBlocks })
+        {
+            while (head)
+            {
+                Block* next = head->GetNext();
+                delete head;
+                head = next;
+            }
+        }
+        m_UsedBlocks = m_FreeBlocks = nullptr;
+
+        for (auto& nativeBlock : m_NativeBlocks)
+            InternalFree(nativeBlock.ptr);
+        m_NativeBlocks.clear();
+
+        for (auto ptr : m_DirectAlocations)
+            InternalFree(ptr);
+        m_DirectAlocations.clear();
+
+        m_AllocatedMemSize = 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryManagerBase::SetAllocator(EMemAllocator allocator)
+    {
+        unique_lock<mutex> allocFreeLocker(m_AllocFreeMtx);
+
+        NEURO_ASSERT(!m_UsedBlocks && m_DirectAlocations.empty() && (!m_SizeClassAllocator || !m_SizeClassAllocator->AllocatedSize()), "Allocator cannot be changed while memory is allocated.");
+
+        if (allocator == MEM_ALLOCATOR_SIZE_CLASSES && !m_SizeClassAllocator)
+        {
+            m_SizeClassAllocator = new SizeClassAllocator(*this, m_AllocGranularity);
+        }
+        else if (allocator == MEM_ALLOCATOR_BEST_FIT && m_SizeClassAllocator)
+        {
+            m_SizeClassAllocator->ReleaseAll();
+            delete m_SizeClassAllocator;
+            m_SizeClassAllocator = nullptr;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t MemoryManagerBase::AllocatedSize() const
+    {
+        return m_SizeClassAllocator ? m_SizeClassAllocator->AllocatedSize() : m_AllocatedMemSize;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t MemoryManagerBase::AllocatedPeakSize() const
+    {
+        return m_SizeClassAllocator ? m_SizeClassAllocator->AllocatedPeakSize() : m_AllocatedMemPeakSize;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryManagerBase::ResetAllocatedPeakSize()
+    {
+        if (m_SizeClassAllocator)
+        {
+            m_SizeClassAllocator->ResetAllocatedPeakSize();
+            return;
+        }
+
+        unique_lock<mutex> allocFreeLocker(m_AllocFreeMtx);
+        m_AllocatedMemPeakSize = m_AllocatedMemSize;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t MemoryManagerBase::ReservedSize() const
+    {
+        if (m_SizeClassAllocator)
+            return m_SizeClassAllocator->ReservedSize();
+
+        unique_lock<mutex> allocFreeLocker(m_AllocFreeMtx);
+        size_t size = 0;
+        for (auto& nativeBlock : m_NativeBlocks)
+            size += nativeBlock.size;
+        return size;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryManagerBase::RecordAllocEvent(void* ptr, size_t size, bool alloc, const string& annotation)
+    {
+        if (auto trace = m_Trace.load())
+            trace->Record(ptr, size, alloc, annotation);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     EMemStatus MemoryManagerBase::Allocate(void** ptr, size_t size, const string& annotation)
     {
@@ -88,15 +191,29 @@ namespace Neuro
             }
         }
 
+        // size class allocator does its own locking
+        if (m_SizeClassAllocator)
+        {
+            EMemStatus status = m_SizeClassAllocator->Allocate(ptr, size);
+            RecordAllocEvent(*ptr, size, true, annotation);
+#ifdef MEMSET_ALLOCATED_MEMORY
+            if (*ptr)
+                InternalMemset(*ptr, MEMSET_ALLOCATED_MEMORY, size);
+#endif
+            return status;
+        }
+
         unique_lock<mutex> allocFreeLocker(m_AllocFreeMtx);
 
         if (m_MinSizeForDirectAllocation > 0 && size >= m_MinSizeForDirectAllocation)
         {
             InternalAllocate(ptr, size);
             m_DirectAlocations.push_back(*ptr);
+            RecordAllocEvent(*ptr, size, true, annotation);
             return MEM_STATUS_SUCCESS;
         }
 
+        size_t requestedSize = size;
         size = ceilInt(size, m_AllocGranularity);
 
         // Find the best fit.
@@ -135,6 +252,8 @@ namespace Neuro
         // Return the new pointer into memory.
         *ptr = m_UsedBlocks->GetData();
 
+        RecordAllocEvent(*ptr, requestedSize, true, annotation);
+
 #ifdef MEMSET_ALLOCATED_MEMORY
         InternalMemset(m_UsedBlocks->GetData(), MEMSET_ALLOCATED_MEMORY, m_UsedBlocks->GetSize());
 #endif
@@ -165,6 +284,11 @@ namespace Neuro
         if (!ptr)
             return MEM_STATUS_SUCCESS;
 
+        RecordAllocEvent(ptr, 0, false);
+
+        if (m_SizeClassAllocator)
+            return m_SizeClassAllocator->Free(ptr);
+
         unique_lock<mutex> allocFreeLocker(m_AllocFreeMtx);
 
         if (m_MinSizeForDirectAllocation > 0)
@@ -205,6 +329,9 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     EMemStatus MemoryManagerBase::ReleaseAll()
     {
+        if (m_SizeClassAllocator)
+            MEM_CHECK(m_SizeClassAllocator->ReleaseAll());
+
         NEURO_ASSERT(!m_UsedBlocks, "Releasing used memory, it could lead to memory corruption!");
         // Destroy used blocks. It's a kind of panic mode to avoid leaks. NOTE: Do that only with roots!!!
         while (m_UsedBlocks)
@@ -222,6 +349,7 @@ namespace Neuro
             void* data = it->ptr;
             InternalFree(data);
         }
+        m_NativeBlocks.clear();
 
         // We shouldn't have any used block left. Or, it means the user is causing memory leaks!
         return MEM_STATUS_SUCCESS;
@@ -433,6 +561,8 @@ namespace Neuro
         fprintf(file, "%s >>> used=%s, free=%s, peak=%s\n", InternalName(), SizeToString(usedMemory).c_str(), SizeToString(freeMemory).c_str(), SizeToString(m_AllocatedMemPeakSize).c_str());
         MEM_CHECK(PrintList(file, "used", m_UsedBlocks));
         MEM_CHECK(PrintList(file, "free", m_FreeBlocks));
+        if (m_SizeClassAllocator)
+            m_SizeClassAllocator->DumpState(file);
         fprintf(file, "\n");
         return MEM_STATUS_SUCCESS;
     }
@@ -440,7 +570,7 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void MemoryManagerBase::UpdateAnnotation(void* ptr, const string& annotation)
     {
-        if (!ptr)
+        if (!ptr || m_SizeClassAllocator)
             return;
 
         // device lookup
@@ -464,6 +594,12 @@ namespace Neuro
         //CUDA_CHECK(cudaStreamCreate(&m_MemoryStream));
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    DeviceMemoryManager::~DeviceMemoryManager()
+    {
+        ReleaseNativeMemory();
+    }
+
     //////////////////////////////////////////////////////////////////////////
     DeviceMemoryManager& DeviceMemoryManager::Default()
     {
@@ -487,7 +623,10 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void DeviceMemoryManager::InternalFree(void* ptr)
     {
-        CUDA_CHECK(cudaFree(ptr));
+        cudaError_t error = cudaFree(ptr);
+        // default manager can outlive CUDA runtime, memory is released along with the context then
+        if (error != cudaErrorCudartUnloading)
+            CUDA_CHECK(error);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -569,6 +708,12 @@ namespace Neuro
     {
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    HostMemoryManager::~HostMemoryManager()
+    {
+        ReleaseNativeMemory();
+    }
+
     //////////////////////////////////////////////////////////////////////////
     HostMemoryManager& HostMemoryManager::Default()
     {
@@ -601,6 +746,12 @@ namespace Neuro
     {
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    HostPinnedMemoryManager::~HostPinnedMemoryManager()
+    {
+        ReleaseNativeMemory();
+    }
+
     //////////////////////////////////////////////////////////////////////////
     HostPinnedMemoryManager& HostPinnedMemoryManager::Default()
     {
@@ -618,7 +769,10 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void HostPinnedMemoryManager::InternalFree(void* ptr)
     {
-        CUDA_CHECK(cudaFreeHost(ptr));
+        cudaError_t error = cudaFreeHost(ptr);
+        // default manager can outlive CUDA runtime, memory is released along with the context then
+        if (error != cudaErrorCudartUnloading)
+            CUDA_CHECK(error);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "Memory/MemoryTrace.h"
+#include "Memory/MemoryManager.h"
+
+namespace Neuro
+{
+    static atomic<uint32_t> s_NextThreadId(0);
+    static thread_local uint32_t t_ThreadId = s_NextThreadId++;
+    static thread_local MemoryTrace::OpScope* t_OpScope = nullptr;
+    static atomic<uint64_t> s_NextNamesGeneration(1);
+
+    static const char* TRACE_FILE_HEADER = "neuro_memory_trace";
+    static const int TRACE_FILE_VERSION = 1;
+
+    //////////////////////////////////////////////////////////////////////////
+    static string JsonEscape(const string& str)
+    {
+        stringstream ss;
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\')
+                ss << '\\' << c;
+            else if ((unsigned char)c < 0x20)
+                ss << "\\u" << hex << setw(4) << setfill('0') << (int)c << dec;
+            else
+                ss << c;
+        }
+        return ss.str();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string MemTraceReplayStats::ToString() const
+    {
+        stringstream ss;
+        ss << fixed << setprecision(3) << eventsNum << " events, alloc " << allocTime / 1000000.0 << "ms (max " << maxAllocLatency / 1000.0 << "us), free " << freeTime / 1000000.0 << "ms (max " << maxFreeLatency / 1000.0 << "us), peak allocated " << peakAllocatedSize << "B, reserved " << reservedSize << "B, fragmentation " << Fragmentation();
+        return ss.str();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    MemoryTrace::MemoryTrace(size_t maxEventsNum)
+        : m_MaxEventsNum(maxEventsNum), m_Start(chrono::steady_clock::now())
+    {
+        Clear();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryTrace::Record(void* ptr, size_t size, bool alloc, const string& annotation)
+    {
+        __int64 timestamp = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - m_Start).count();
+        auto opScope = t_OpScope;
+
+        lock_guard<mutex> lock(m_Lock);
+
+        uint32_t opNameId = 0;
+        if (opScope)
+        {
+            if (opScope->m_NamesGeneration != m_NamesGeneration)
+            {
+                opScope->m_OpNameId = Intern(opScope->m_OpName);
+                opScope->m_NamesGeneration = m_NamesGeneration;
+            }
+            opNameId = opScope->m_OpNameId;
+        }
+
+        MemAllocEvent e = { timestamp, ptr, size, annotation.empty() ? 0 : Intern(annotation), opNameId, t_ThreadId, alloc };
+
+        if (!m_MaxEventsNum || m_Events.size() < m_MaxEventsNum)
+        {
+            m_Events.push_back(e);
+            return;
+        }
+
+        m_Events[m_FirstEvent] = e;
+        m_FirstEvent = (m_FirstEvent + 1) % m_MaxEventsNum;
+
+        // every event refers to at most two names, waiting until there are twice as many keeps compaction amortized constant
+        if (m_Names.size() > 4 * m_MaxEventsNum + 1)
+            CompactNames();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryTrace::Clear()
+    {
+        lock_guard<mutex> lock(m_Lock);
+        m_Events.clear();
+        m_FirstEvent = 0;
+        // empty string always has id 0
+        ResetNames({ "" });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    vector<MemAllocEvent> MemoryTrace::Events() const
+    {
+        lock_guard<mutex> lock(m_Lock);
+        return EventsInternal();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t MemoryTrace::EventsNum() const
+    {
+        lock_guard<mutex> lock(m_Lock);
+        return m_Events.size();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string MemoryTrace::Name(uint32_t id) const
+    {
+        lock_guard<mutex> lock(m_Lock);
+        return id < m_Names.size() ? m_Names[id] : "";
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t MemoryTrace::NamesNum() const
+    {
+        lock_guard<mutex> lock(m_Lock);
+        return m_Names.size();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool MemoryTrace::Save(const string& filename) const
+    {
+        ofstream stream(filename);
+        if (!stream)
+            return false;
+
+        lock_guard<mutex> lock(m_Lock);
+
+        stream << TRACE_FILE_HEADER << " " << TRACE_FILE_VERSION << "\n";
+        // names are stored with their length as they can contain any characters
+        stream << m_Names.size() << "\n";
+        for (auto& name : m_Names)
+            stream << name.length() << " " << name << "\n";
+
+        auto events = EventsInternal();
+        stream << events.size() << "\n";
+        for (auto& e : events)
+            stream << e.timestamp << " " << (size_t)e.ptr << " " << e.size << " " << e.annotationId << " " << e.opNameId << " " << e.threadId << " " << (e.alloc ? 1 : 0) << "\n";
+
+        return (bool)stream;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool MemoryTrace::Load(const string& filename)
+    {
+        ifstream stream(filename);
+        if (!stream)
+            return false;
+
+        string header;
+        int version;
+        stream >> header >> version;
+        if (header != TRACE_FILE_HEADER || version != TRACE_FILE_VERSION)
+            return false;
+
+        vector<string> names;
+        size_t namesNum;
+        stream >> namesNum;
+        for (size_t i = 0; i < namesNum && stream; ++i)
+        {
+            size_t len;
+            stream >> len;
+            stream.get(); // separator
+            string name(len, '\0');
+            stream.read(&name[0], len);
+            names.push_back(name);
+        }
+
+        vector<MemAllocEvent> events;
+        size_t eventsNum;
+        stream >> eventsNum;
+        for (size_t i = 0; i < eventsNum && stream; ++i)
+        {
+            MemAllocEvent e;
+            size_t ptr;
+            int alloc;
+            stream >> e.timestamp >> ptr >> e.size >> e.annotationId >> e.opNameId >> e.threadId >> alloc;
+            e.ptr = (void*)ptr;
+            e.alloc = alloc != 0;
+            events.push_back(e);
+        }
+
+        if (!stream || names.empty())
+            return false;
+
+        lock_guard<mutex> lock(m_Lock);
+        ResetNames(names);
+        m_Events = events;
+        m_FirstEvent = 0;
+        if (m_MaxEventsNum)
+            m_MaxEventsNum = max(m_MaxEventsNum, m_Events.size());
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool MemoryTrace::ExportChromeTrace(const string& filename) const
+    {
+        ofstream stream(filename);
+        if (!stream)
+            return false;
+
+        lock_guard<mutex> lock(m_Lock);
+        auto events = EventsInternal();
+
+        unordered_map<void*, const MemAllocEvent*> liveBlocks;
+        size_t allocatedSize = 0;
+        bool first = true;
+
+        auto blockName = [&](const MemAllocEvent& e) { return JsonEscape(e.annotationId ? m_Names[e.annotationId] : "unnamed"); };
+
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (auto& e : events)
+        {
+            const MemAllocEvent* allocEvent = &e;
+            if (e.alloc)
+            {
+                liveBlocks[e.ptr] = &e;
+                allocatedSize += e.size;
+            }
+            else
+            {
+                // blocks allocated before trace started are not shown
+                auto it = liveBlocks.find(e.ptr);
+                if (it == liveBlocks.end())
+                    continue;
+                allocEvent = it->second;
+                allocatedSize -= allocEvent->size;
+                liveBlocks.erase(it);
+            }
+
+            stream << (first ? "\n" : ",\n");
+            first = false;
+
+            stream << "{\"name\":\"" << blockName(*allocEvent) << "\",\"cat\":\"memory\",\"ph\":\"" << (e.alloc ? "b" : "e") << "\",\"id\":\"0x" << hex << (size_t)e.ptr << dec << "\",\"ts\":" << e.timestamp << ",\"pid\":0,\"tid\":" << e.threadId;
+            if (e.alloc)
+                stream << ",\"args\":{\"size\":" << e.size << ",\"op\":\"" << JsonEscape(m_Names[e.opNameId]) << "\"}";
+            stream << "},\n";
+            stream << "{\"name\":\"allocated\",\"ph\":\"C\",\"ts\":" << e.timestamp << ",\"pid\":0,\"args\":{\"bytes\":" << allocatedSize << "}}";
+        }
+        stream << "\n]}\n";
+
+        return (bool)stream;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    MemTraceReplayStats MemoryTrace::Replay(MemoryManagerBase& manager, int repeats) const
+    {
+        vector<MemAllocEvent> events;
+        vector<string> names;
+        {
+            lock_guard<mutex> lock(m_Lock);
+            events = EventsInternal();
+            names = m_Names;
+        }
+
+        MemTraceReplayStats stats;
+        unordered_map<void*, void*> replayedPtrs;
+
+        auto timedFree = [&](void* ptr)
+        {
+            auto start = chrono::steady_clock::now();
+            manager.Free(ptr);
+            __int64 latency = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+            stats.freeTime += latency;
+            stats.maxFreeLatency = max(stats.maxFreeLatency, latency);
+        };
+
+        for (int i = 0; i < repeats; ++i)
+        {
+            for (auto& e : events)
+            {
+                if (e.alloc)
+                {
+                    void* ptr = nullptr;
+                    auto start = chrono::steady_clock::now();
+                    manager.Allocate(&ptr, e.size, names[e.annotationId]);
+                    __int64 latency = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+                    stats.allocTime += latency;
+                    stats.maxAllocLatency = max(stats.maxAllocLatency, latency);
+                    replayedPtrs[e.ptr] = ptr;
+                }
+                else
+                {
+                    auto it = replayedPtrs.find(e.ptr);
+                    if (it == replayedPtrs.end())
+                        continue;
+                    timedFree(it->second);
+                    replayedPtrs.erase(it);
+                }
+                ++stats.eventsNum;
+            }
+
+            for (auto& replayed : replayedPtrs)
+                timedFree(replayed.second);
+            replayedPtrs.clear();
+        }
+
+        stats.peakAllocatedSize = manager.AllocatedPeakSize();
+        stats.reservedSize = manager.ReservedSize();
+        return stats;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    MemoryTrace::OpScope::OpScope(const string& opName)
+        : m_OpName(opName), m_Prev(t_OpScope)
+    {
+        t_OpScope = this;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    MemoryTrace::OpScope::~OpScope()
+    {
+        t_OpScope = m_Prev;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t MemoryTrace::Intern(const string& str)
+    {
+        auto it = m_NameIds.find(str);
+        if (it != m_NameIds.end())
+            return it->second;
+
+        uint32_t id = (uint32_t)m_Names.size();
+        m_Names.push_back(str);
+        m_NameIds[str] = id;
+        return id;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryTrace::ResetNames(const vector<string>& names)
+    {
+        m_Names = names;
+        m_NameIds.clear();
+        for (uint32_t i = 0; i < (uint32_t)m_Names.size(); ++i)
+            m_NameIds[m_Names[i]] = i;
+        // ids cached by operation scopes are no longer valid
+        m_NamesGeneration = s_NextNamesGeneration++;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void MemoryTrace::CompactNames()
+    {
+        const uint32_t NONE = (uint32_t)-1;
+
+        vector<uint32_t> newIds(m_Names.size(), NONE);
+        vector<string> names = { "" };
+        newIds[0] = 0;
+
+        auto remap = [&](uint32_t& id)
+        {
+            if (newIds[id] == NONE)
+            {
+                newIds[id] = (uint32_t)names.size();
+                names.push_back(m_Names[id]);
+            }
+            id = newIds[id];
+        };
+
+        for (auto& e : m_Events)
+        {
+            remap(e.annotationId);
+            remap(e.opNameId);
+        }
+
+        ResetNames(names);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    vector<MemAllocEvent> MemoryTrace::EventsInternal() const
+    {
+        vector<MemAllocEvent> events;
+        events.reserve(m_Events.size());
+        events.insert(events.end(), m_Events.begin() + m_FirstEvent, m_Events.end());
+        events.insert(events.end(), m_Events.begin(), m_Events.begin() + m_FirstEvent);
+        return events;
+    }
+}
@@ -0,0 +1,350 @@
+#include <algorithm>
+
+#include "Memory/SizeClassAllocator.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    static atomic<uint64_t> s_NextAllocatorId(1);
+
+    //////////////////////////////////////////////////////////////////////////
+    SizeClassAllocator::SizeClassAllocator(MemoryManagerBase& manager, size_t granularity)
+        : m_Manager(manager), m_Granularity(granularity), m_Id(s_NextAllocatorId++), m_AllocatedSize(0), m_AllocatedPeakSize(0), m_ReservedSize(0), m_Generation(0)
+    {
+        for (size_t units = 1; ; ++units)
+        {
+            size_t classSize;
+            uint32_t classIdx = ClassIndex(units * granularity, granularity, classSize);
+            if (classIdx >= CLASSES_NUM)
+                break;
+            m_Classes[classIdx].size = classSize;
+            units = classSize / granularity;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    SizeClassAllocator::~SizeClassAllocator()
+    {
+        ReleaseNative();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t SizeClassAllocator::ClassIndex(size_t size, size_t granularity, size_t& classSize)
+    {
+        size_t units = max<size_t>(1, (size + granularity - 1) / granularity);
+
+        // first 16 classes are spaced linearly
+        if (units <= 16)
+        {
+            classSize = units * granularity;
+            return (uint32_t)units - 1;
+        }
+
+        // then there are 4 classes per power of two
+        uint32_t p = 0;
+        for (size_t u = units - 1; u > 1; u >>= 1)
+            ++p;
+
+        size_t step = (size_t)1 << (p - 2);
+        size_t rounded = (units + step - 1) / step;
+        classSize = rounded * step * granularity;
+        uint32_t classIdx = 16 + (p - 4) * 4 + (uint32_t)rounded - 5;
+        return classIdx < CLASSES_NUM ? classIdx : CLASSES_NUM;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    EMemStatus SizeClassAllocator::Allocate(void** ptr, size_t size)
+    {
+        size_t classSize;
+        uint32_t classIdx = ClassIndex(size, m_Granularity, classSize);
+
+        if (classIdx == DIRECT_CLASS)
+        {
+            // these are returned to the system by Free, so they can't be tracked along with native allocations backing size classes
+            classSize = (size + m_Granularity - 1) / m_Granularity * m_Granularity;
+            *ptr = nullptr;
+            m_Manager.InternalAllocate(ptr, classSize);
+            if (!*ptr)
+                return MEM_STATUS_OUT_OF_MEMORY;
+
+            m_ReservedSize += classSize;
+            {
+                lock_guard<mutex> lock(m_NativeLock);
+                m_DirectAllocations[*ptr] = classSize;
+            }
+            AddAllocated(classSize);
+            return MEM_STATUS_SUCCESS;
+        }
+
+        if (IsSmallClass(classIdx))
+        {
+            auto& cacheBlocks = LocalCache().freeBlocks[classIdx];
+            if (cacheBlocks.empty())
+                RefillCache(classIdx, cacheBlocks);
+
+            if (cacheBlocks.empty())
+            {
+                *ptr = nullptr;
+                return MEM_STATUS_OUT_OF_MEMORY;
+            }
+
+            *ptr = cacheBlocks.back();
+            cacheBlocks.pop_back();
+        }
+        else
+        {
+            auto& sizeClass = m_Classes[classIdx];
+            *ptr = nullptr;
+            {
+                lock_guard<mutex> lock(sizeClass.lock);
+                if (!sizeClass.freeBlocks.empty())
+                {
+                    *ptr = sizeClass.freeBlocks.back();
+                    sizeClass.freeBlocks.pop_back();
+                }
+            }
+
+            if (!*ptr)
+            {
+                *ptr = NativeAllocate(sizeClass.size);
+                if (!*ptr)
+                    return MEM_STATUS_OUT_OF_MEMORY;
+
+                RegisterBlock(*ptr, classIdx);
+                lock_guard<mutex> lock(sizeClass.lock);
+                ++sizeClass.blocksNum;
+            }
+        }
+
+        AddAllocated(m_Classes[classIdx].size);
+        return MEM_STATUS_SUCCESS;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    EMemStatus SizeClassAllocator::Free(void* ptr)
+    {
+        if (!ptr)
+            return MEM_STATUS_SUCCESS;
+
+        uint32_t classIdx = DIRECT_CLASS;
+        {
+            auto& shard = Shard(ptr);
+            lock_guard<mutex> lock(shard.lock);
+            auto blockIt = shard.blocks.find(ptr);
+            if (blockIt != shard.blocks.end())
+                classIdx = blockIt->second;
+        }
+
+        if (classIdx == DIRECT_CLASS)
+        {
+            size_t size = 0;
+            {
+                lock_guard<mutex> lock(m_NativeLock);
+                auto directIt = m_DirectAllocations.find(ptr);
+                NEURO_ASSERT(directIt != m_DirectAllocations.end(), "Freeing unrecognized pointer");
+                if (directIt == m_DirectAllocations.end())
+                    return MEM_STATUS_INVALID_ARGUMENT;
+                size = directIt->second;
+                m_DirectAllocations.erase(directIt);
+            }
+
+            m_Manager.InternalFree(ptr);
+            m_ReservedSize -= size;
+            m_AllocatedSize -= size;
+            return MEM_STATUS_SUCCESS;
+        }
+
+        m_AllocatedSize -= m_Classes[classIdx].size;
+
+        if (IsSmallClass(classIdx))
+        {
+            auto& cacheBlocks = LocalCache().freeBlocks[classIdx];
+            cacheBlocks.push_back(ptr);
+
+            // return surplus to shared list, so blocks freed by other thread than the one allocating them can be reused
+            uint32_t batch = TransferBatch(classIdx);
+            if (cacheBlocks.size() > 2 * batch)
+            {
+                auto& sizeClass = m_Classes[classIdx];
+                lock_guard<mutex> lock(sizeClass.lock);
+                sizeClass.freeBlocks.insert(sizeClass.freeBlocks.end(), cacheBlocks.end() - batch, cacheBlocks.end());
+                cacheBlocks.resize(cacheBlocks.size() - batch);
+            }
+        }
+        else
+        {
+            auto& sizeClass = m_Classes[classIdx];
+            lock_guard<mutex> lock(sizeClass.lock);
+            sizeClass.freeBlocks.push_back(ptr);
+        }
+
+        return MEM_STATUS_SUCCESS;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    EMemStatus SizeClassAllocator::ReleaseAll()
+    {
+        NEURO_ASSERT(m_AllocatedSize.load() == 0, "Releasing used memory, it could lead to memory corruption!");
+
+        // other threads may be using their caches, each of them will drop its blocks on its next allocation or release
+        ++m_Generation;
+
+        ReleaseNative();
+        return MEM_STATUS_SUCCESS;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SizeClassAllocator::ReleaseNative()
+    {
+        for (auto& sizeClass : m_Classes)
+        {
+            lock_guard<mutex> lock(sizeClass.lock);
+            sizeClass.freeBlocks.clear();
+            sizeClass.blocksNum = 0;
+        }
+
+        for (auto& shard : m_Shards)
+        {
+            lock_guard<mutex> lock(shard.lock);
+            shard.blocks.clear();
+        }
+
+        lock_guard<mutex> lock(m_NativeLock);
+        for (auto ptr : m_NativeAllocations)
+            m_Manager.InternalFree(ptr);
+        for (auto& direct : m_DirectAllocations)
+            m_Manager.InternalFree(direct.first);
+        m_NativeAllocations.clear();
+        m_DirectAllocations.clear();
+        m_ReservedSize = 0;
+        m_AllocatedSize = 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SizeClassAllocator::DumpState(FILE* file) const
+    {
+        fprintf(file, "| size classes: allocated=%zu, peak=%zu, reserved=%zu\n", AllocatedSize(), AllocatedPeakSize(), ReservedSize());
+        for (uint32_t i = 0; i < CLASSES_NUM; ++i)
+        {
+            auto& sizeClass = m_Classes[i];
+            if (sizeClass.blocksNum)
+                fprintf(file, "| | class=%u, size=%zu, blocks=%zu, shared free blocks=%zu\n", i, sizeClass.size, sizeClass.blocksNum, sizeClass.freeBlocks.size());
+        }
+        fprintf(file, "|\n");
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t SizeClassAllocator::TransferBatch(uint32_t classIdx) const
+    {
+        return (uint32_t)max<size_t>(1, min<size_t>(32, SLAB_SIZE / 8 / m_Classes[classIdx].size));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    SizeClassAllocator::ThreadCache& SizeClassAllocator::LocalCache()
+    {
+        // every thread remembers its caches for a few allocators (one per memory manager in practice), allocators are identified by
+        // unique id rather than address so cache of destroyed allocator is never picked up by a new one
+        struct CacheSlot
+        {
+            uint64_t allocatorId;
+            ThreadCache* cache;
+        };
+        static const uint32_t SLOTS_NUM = 8;
+        static thread_local CacheSlot t_Slots[SLOTS_NUM] = {};
+        static thread_local uint32_t t_NextSlot = 0;
+
+        for (auto& slot : t_Slots)
+        {
+            if (slot.allocatorId != m_Id)
+                continue;
+
+            // blocks cached before release point to memory which is already returned to the system
+            uint64_t generation = m_Generation.load();
+            if (slot.cache->generation != generation)
+            {
+                for (auto& blocks : slot.cache->freeBlocks)
+                    blocks.clear();
+                slot.cache->generation = generation;
+            }
+            return *slot.cache;
+        }
+
+        ThreadCache* cache;
+        {
+            lock_guard<mutex> lock(m_CachesLock);
+            m_Caches.push_back(make_unique<ThreadCache>());
+            cache = m_Caches.back().get();
+            cache->generation = m_Generation.load();
+        }
+
+        // evicted cache is still owned by its allocator, blocks cached there will be reclaimed on release
+        auto& slot = t_Slots[t_NextSlot++ % SLOTS_NUM];
+        slot.allocatorId = m_Id;
+        slot.cache = cache;
+        return *cache;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void* SizeClassAllocator::NativeAllocate(size_t size)
+    {
+        void* ptr = nullptr;
+        m_Manager.InternalAllocate(&ptr, size);
+        if (!ptr)
+            return nullptr;
+
+        m_ReservedSize += size;
+        lock_guard<mutex> lock(m_NativeLock);
+        m_NativeAllocations.push_back(ptr);
+        return ptr;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SizeClassAllocator::RegisterBlock(void* ptr, uint32_t classIdx)
+    {
+        auto& shard = Shard(ptr);
+        lock_guard<mutex> lock(shard.lock);
+        shard.blocks[ptr] = classIdx;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SizeClassAllocator::AddAllocated(size_t size)
+    {
+        size_t allocated = (m_AllocatedSize += size);
+        size_t peak = m_AllocatedPeakSize.load();
+        while (allocated > peak && !m_AllocatedPeakSize.compare_exchange_weak(peak, allocated));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void SizeClassAllocator::RefillCache(uint32_t classIdx, vector<void*>& cacheBlocks)
+    {
+        auto& sizeClass = m_Classes[classIdx];
+        uint32_t batch = TransferBatch(classIdx);
+
+        {
+            lock_guard<mutex> lock(sizeClass.lock);
+            size_t count = min<size_t>(batch, sizeClass.freeBlocks.size());
+            cacheBlocks.insert(cacheBlocks.end(), sizeClass.freeBlocks.end() - count, sizeClass.freeBlocks.end());
+            sizeClass.freeBlocks.resize(sizeClass.freeBlocks.size() - count);
+        }
+
+        if (!cacheBlocks.empty())
+            return;
+
+        // carve new slab into blocks, whatever doesn't fit into the cache goes to shared list
+        char* slab = (char*)NativeAllocate(SLAB_SIZE);
+        if (!slab)
+            return;
+
+        size_t blocksNum = SLAB_SIZE / sizeClass.size;
+        for (size_t i = 0; i < blocksNum; ++i)
+            RegisterBlock(slab + i * sizeClass.size, classIdx);
+
+        for (size_t i = 0; i < min<size_t>(batch, blocksNum); ++i)
+            cacheBlocks.push_back(slab + i * sizeClass.size);
+
+        lock_guard<mutex> lock(sizeClass.lock);
+        for (size_t i = batch; i < blocksNum; ++i)
+            sizeClass.freeBlocks.push_back(slab + i * sizeClass.size);
+        sizeClass.blocksNum += blocksNum;
+    }
+}
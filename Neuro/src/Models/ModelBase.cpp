@@ -11,6 +11,9 @@
 #pragma warning(pop)
 
 #include "Models/ModelBase.h"
+#include "BatchGatherer.h"
+#include "DataPreloader.h"
+#include "Tensors/TensorFile.h"
 #include "Optimizers/OptimizerBase.h"
 #include "Loss.h"
 #include "Tools.h"
@@ -249,14 +252,7 @@ namespace Neuro
     tensor_ptr_vec_t ModelBase::Predict(const const_tensor_ptr_vec_t& inputs)
     {
         NVTXProfile p((string("Predict ") + Name()).c_str(), 0xFFC0C0C0);
-        if (!m_Predicter)
-        {
-            vector<Placeholder*> inputs;
-            for_each(m_Inputs.begin(), m_Inputs.end(), [&](TensorLike* input) { inputs.push_back(static_cast<Placeholder*>(input)); });
-            m_Predicter = new Predicter(inputs, m_Outputs);
-        }
-
-        return m_Predicter->Predict(inputs);
+        return GetPredicter()->Predict(inputs);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -266,6 +262,24 @@ namespace Neuro
         return Predict(inputs);
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    bool ModelBase::CompileForInference()
+    {
+        return GetPredicter()->Compile();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    Predicter* ModelBase::GetPredicter()
+    {
+        if (!m_Predicter)
+        {
+            vector<Placeholder*> inputs;
+            for_each(m_Inputs.begin(), m_Inputs.end(), [&](TensorLike* input) { inputs.push_back(static_cast<Placeholder*>(input)); });
+            m_Predicter = new Predicter(inputs, m_Outputs);
+        }
+        return m_Predicter;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     tensor_ptr_vec_t ModelBase::Eval(const vector<TensorLike*>& fetches, const map<Placeholder*, const Tensor*>& feeds)
     {
@@ -444,6 +458,13 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void ModelBase::SaveWeights(const string& filename) const
     {
+        auto extension = std::experimental::filesystem::path(filename).extension();
+        if (extension != ".h5" && extension != ".hdf5")
+        {
+            SaveWeightsBin(filename);
+            return;
+        }
+
         //https://github.com/keras-team/keras/blob/5be4ed3d9e7548dfa9d51d1d045a3f951d11c2b1/keras/engine/saving.py#L733
         H5File file = H5File(filename, H5F_ACC_TRUNC);
         
@@ -503,6 +524,12 @@ namespace Neuro
             return;
         }
 
+        if (TensorFile::IsTensorFile(filename))
+        {
+            LoadWeightsBin(filename, byName);
+            return;
+        }
+
         if (!H5File::isHdf5(filename.c_str()))
         {
             cout << "File '" << filename << "' is not valid HDF5 file.\n";
@@ -655,6 +682,81 @@ namespace Neuro
         stream.close();*/
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::SaveWeightsBin(const string& filename) const
+    {
+        vector<SerializedParameter> params;
+        vector<const Tensor*> tensors;
+        vector<string> names;
+
+        for (auto layer : Layers())
+        {
+            params.clear();
+            layer->SerializedParameters(params);
+
+            for (size_t i = 0; i < params.size(); ++i)
+            {
+                tensors.push_back(params[i].param->OutputPtr());
+                names.push_back(layer->Name() + "/param_" + to_string(i));
+            }
+        }
+
+        bool saved = TensorFile::Save(filename, tensors, names);
+        if (!saved)
+            cout << "Failed to save weights to '" << filename << "'.\n";
+        NEURO_ASSERT(saved, "Failed to save weights to '" << filename << "'.");
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::LoadWeightsBin(const string& filename, bool byName)
+    {
+        auto file = make_shared<TensorFile>(filename);
+        if (!file->IsValid())
+        {
+            cout << "File '" << filename << "' is not valid tensor file. " << file->Error() << "\n";
+            return;
+        }
+
+        if (!m_Built)
+            Build();
+
+        vector<SerializedParameter> params;
+        size_t entryIdx = 0;
+
+        // input layers have no parameters so there is no need to skip them
+        for (auto layer : Layers())
+        {
+            params.clear();
+            layer->SerializedParameters(params);
+
+            if (params.empty())
+                continue;
+
+            if (byName && file->Find(layer->Name() + "/param_0") < 0)
+            {
+                cout << "Weights for layer '" << layer->Name() << "' not found.\n";
+                continue;
+            }
+
+            for (size_t i = 0; i < params.size(); ++i)
+            {
+                auto w = params[i].param->OutputPtr();
+
+                int idx = byName ? file->Find(layer->Name() + "/param_" + to_string(i)) : (int)entryIdx++;
+                NEURO_ASSERT(idx >= 0 && idx < (int)file->TensorsNum(), "Saved parameter " << i << " of layer '" << layer->Name() << "' not found.");
+                NEURO_ASSERT(w->GetShape() == file->GetShape(idx), "Shape of parameter '" << w->Name() << "' doesn't match saved parameter. Found " << file->GetShape(idx).ToString() << " expected " << w->GetShape().ToString() << ".");
+
+                file->Load(idx, *w);
+                params[i].param->ForceInitialized();
+            }
+        }
+
+        if (!byName)
+            NEURO_ASSERT(entryIdx == file->TensorsNum(), "Number of saved parameters doesn't match number of parameters in the model. Found " << file->TensorsNum() << " expected " << entryIdx << ".");
+
+        m_WeightsFiles.push_back(file);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void ModelBase::Parameters(vector<Variable*>& params, bool onlyTrainable) const
     {
@@ -726,22 +828,11 @@ namespace Neuro
         uint32_t validationBatchesNum = validationBatchSize > 0 ? (uint32_t)ceil(validationSamplesCount / (float)validationBatchSize) : 0;
         vector<vector<uint32_t>> trainBatchesIndices(trainBatchesNum);
 
-        vector<const_tensor_ptr_vec_t> validInputsBatches, validOutputsBatches;
-        if (validInputs)
-        {
-            uint32_t i = 0;
-            vector<uint32_t> validationBatchIndices;
-            for (uint32_t b = 0; b < validationBatchesNum; ++b)
-            {
-                uint32_t samplesStartIndex = b * validationBatchSize;
-                uint32_t samplesEndIndex = min((b + 1) * validationBatchSize, validationSamplesCount);
-                validationBatchIndices.resize(samplesEndIndex - samplesStartIndex);
-                iota(validationBatchIndices.begin(), validationBatchIndices.end(), i);
-                i += (uint32_t)validationBatchIndices.size();
-                validInputsBatches.push_back(GenerateBatch(*validInputs, validationBatchIndices));
-                validOutputsBatches.push_back(GenerateBatch(*validOutputs, validationBatchIndices));
-            }
-        }
+        // inputs and outputs are gathered together, batches are assembled in persistent buffers and the next one is prefetched
+        // while training on the current one
+        unique_ptr<BatchGatherer> trainGatherer;
+        if (trainSamplesCount > 1 && trainBatchSize < trainSamplesCount)
+            trainGatherer.reset(new BatchGatherer(MergeVectors({ inputs, outputs }), trainBatchSize));
 
         for (uint32_t e = 1; e <= epochs; ++e)
         {
@@ -772,17 +863,18 @@ namespace Neuro
                 uint32_t samplesInBatch = inputs[0]->Batch();
 
                 float loss, acc = 0;
-                if (trainSamplesCount > 1 && trainBatchSize < trainSamplesCount)
+                if (trainGatherer)
                 {
-                    auto inputsBatch = GenerateBatch(inputs, trainBatchesIndices[b]);
-                    auto outputsBatch = GenerateBatch(outputs, trainBatchesIndices[b]);
+                    auto batch = trainGatherer->Gather(trainBatchesIndices[b]);
+                    if (b + 1 < trainBatchesNum)
+                        trainGatherer->Prefetch(trainBatchesIndices[b + 1]);
+
+                    const_tensor_ptr_vec_t inputsBatch(batch.begin(), batch.begin() + inputs.size());
+                    const_tensor_ptr_vec_t outputsBatch(batch.begin() + inputs.size(), batch.end());
 
                     samplesInBatch = inputsBatch[0]->Batch();
 
                     TrainStep(inputsBatch, outputsBatch, &loss, (m_TrackedMetrics & Accuracy) ? &acc: nullptr);
-
-                    DeleteContainer(inputsBatch);
-                    DeleteContainer(outputsBatch);
                 }
                 else
                     TrainStep(inputs, outputs, &loss, &acc);
@@ -877,10 +969,117 @@ namespace Neuro
                 chartGen ? .Save();*/
         }
 
-        for (size_t b = 0; b < validInputsBatches.size(); ++b)
+        if (m_LogFile && m_LogFile->is_open())
         {
-            DeleteContainer(validInputsBatches[b]);
-            DeleteContainer(validOutputsBatches[b]);
+            m_LogFile->close();
+            delete m_LogFile;
+            m_LogFile = nullptr;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ModelBase::Fit(const vector<ILoader*>& loaders, uint32_t stepsPerEpoch, uint32_t epochs, uint32_t verbose, uint32_t prefetchDepth, uint32_t workersNum)
+    {
+        cout << unitbuf; // disable buffering so progress 'animations' can work
+
+        NEURO_ASSERT(m_Trainer, "Model has to be optimized before training.");
+        NEURO_ASSERT(stepsPerEpoch > 0, "Number of steps per epoch must be positive.");
+
+        // batches are copied straight into placeholders so training step doesn't have to feed anything
+        vector<Tensor*> destination;
+        for (auto placeholder : MergeVectors({ m_Trainer->InputPlaceholders(), m_Trainer->TargetPlaceholders() }))
+            destination.push_back(&placeholder->Output());
+
+        DataPreloader preloader(destination, loaders, max(prefetchDepth, 1u), true, workersNum);
+
+        if (verbose > 0)
+            m_LogFile = new ofstream(FilePrefix() + "_training_data_" + m_Optimizer->ClassName() + "_async.log");
+
+        // how often (in steps) running loss is read for progress bar
+        const uint32_t METRICS_REPORT_INTERVAL = 10;
+
+        const bool trackAccuracy = (m_TrackedMetrics & Accuracy) != 0;
+        const size_t lossIdx = m_Metrics[Loss].second;
+        const size_t accIdx = trackAccuracy ? m_Metrics[Accuracy].second : 0;
+        const float outputsNum = (float)m_Outputs.size();
+
+        // metrics are summed on compute device, reading them requires synchronization so it is done only when they are reported
+        Tensor lossSum(m_Metrics[Loss].first->GetShape(), "loss_sum");
+        Tensor accSum(trackAccuracy ? m_Metrics[Accuracy].first->GetShape() : Shape(1), "accuracy_sum");
+
+        m_TrainingTimings = TrainingTimings();
+        Stopwatch timer;
+
+        for (uint32_t e = 1; e <= epochs; ++e)
+        {
+            if (verbose > 0)
+                LogLine("Epoch " + to_string(e) + "/" + to_string(epochs));
+
+            lossSum.Zero();
+            accSum.Zero();
+
+            TrainingTimings epochTimings;
+            int64_t waitTime = preloader.WaitTime(), copyTime = preloader.CopyTime();
+
+            unique_ptr<Tqdm> progress(verbose == 2 ? new Tqdm(stepsPerEpoch) : nullptr);
+            for (uint32_t s = 0; s < stepsPerEpoch; ++s)
+            {
+                // workers keep loading following batches while this one is trained on
+                preloader.Load();
+
+                timer.Restart();
+                auto results = m_Trainer->Train();
+                results[lossIdx]->Add(lossSum, lossSum);
+                if (trackAccuracy)
+                    results[accIdx]->Add(accSum, accSum);
+                epochTimings.compute += timer.ElapsedMicroseconds();
+
+                if (progress)
+                {
+                    if ((s + 1) % METRICS_REPORT_INTERVAL == 0 || s + 1 == stepsPerEpoch)
+                    {
+                        timer.Restart();
+                        stringstream extString;
+                        extString << setprecision(4) << " - loss: " << lossSum(0) / outputsNum / (s + 1);
+                        progress->SetExtraString(extString.str());
+                        epochTimings.metrics += timer.ElapsedMicroseconds();
+                    }
+                    progress->NextStep();
+                }
+            }
+
+            if (progress)
+                LogLine(progress->Str(), false);
+
+            timer.Restart();
+            float trainLoss = lossSum(0) / outputsNum / stepsPerEpoch;
+            float trainAcc = trackAccuracy ? accSum(0) / stepsPerEpoch : 0;
+            epochTimings.metrics += timer.ElapsedMicroseconds();
+            m_LastTrainError = trainLoss;
+
+            epochTimings.dataWait = preloader.WaitTime() - waitTime;
+            epochTimings.transfer = preloader.CopyTime() - copyTime;
+            epochTimings.steps = stepsPerEpoch;
+
+            m_TrainingTimings.dataWait += epochTimings.dataWait;
+            m_TrainingTimings.transfer += epochTimings.transfer;
+            m_TrainingTimings.compute += epochTimings.compute;
+            m_TrainingTimings.metrics += epochTimings.metrics;
+            m_TrainingTimings.steps += epochTimings.steps;
+
+            if (verbose > 0)
+            {
+                stringstream summary;
+                summary.precision(4);
+
+                if (m_TrackedMetrics & Loss)
+                    summary << " - loss: " << trainLoss;
+                if (trackAccuracy)
+                    summary << " - acc: " << trainAcc;
+                summary << " - " << epochTimings.ToString();
+
+                LogLine(summary.str());
+            }
         }
 
         if (m_LogFile && m_LogFile->is_open())
@@ -891,6 +1090,16 @@ namespace Neuro
         }
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    string TrainingTimings::ToString() const
+    {
+        const float toMs = steps ? 0.001f / steps : 0.f;
+        stringstream ss;
+        ss << fixed << setprecision(2) << "per step: data " << dataWait * toMs << "ms, transfer " << transfer * toMs << "ms, compute "
+           << compute * toMs << "ms, metrics " << metrics * toMs << "ms (" << (InputBound() ? "input" : "compute") << " bound)";
+        return ss.str();
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void ModelBase::MapGraphNetwork(const vector<TensorLike*>& inputs, const vector<TensorLike*>& outputs)
     {
@@ -1057,26 +1266,6 @@ namespace Neuro
         return make_tuple(loss, acc);
     }
 
-    //////////////////////////////////////////////////////////////////////////
-    const_tensor_ptr_vec_t ModelBase::GenerateBatch(const const_tensor_ptr_vec_t& inputs, const vector<uint32_t>& batchIndices)
-    {
-        const_tensor_ptr_vec_t result; // result is a vector of tensors (1 per each input) with multiple (batchIndices.size()) batches in each one of them
-
-        for (uint32_t i = 0; i < inputs.size(); ++i)
-        {
-            uint32_t batchSize = (uint32_t)batchIndices.size();
-
-            auto t = new Tensor(Shape(inputs[i]->Width(), inputs[i]->Height(), inputs[i]->Depth(), batchSize));
-
-            for (uint32_t b = 0; b < batchSize; ++b)
-                inputs[i]->CopyBatchTo(batchIndices[b], b, *t);
-
-            result.push_back(t);
-        }
-
-        return result;
-    }
-
     //////////////////////////////////////////////////////////////////////////
     string ModelBase::FilePrefix() const
     {
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "Tensors/CompactTensor.h"
+#include "Tensors/Tensor.h"
+#include "Tensors/Cpu/CpuKernels.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    // minimum number of values expanded by a single thread
+    static const uint32_t EXPAND_GRAIN_LENGTH = 16384;
+
+    //////////////////////////////////////////////////////////////////////////
+    CompactTensor::CompactTensor(const Shape& shape, ECompactElementType type, float scale, float offset)
+        : m_Shape(shape), m_Type(type), m_Scale(scale), m_Offset(offset)
+    {
+        m_Data.resize((size_t)m_Shape.Length * ElementSize());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    CompactTensor::CompactTensor(const Tensor& t, ECompactElementType type, float scale, float offset)
+        : CompactTensor(t.GetShape(), type, scale, offset)
+    {
+        NEURO_ASSERT(type != COMPACT_UINT8 || scale != 0.f, "Scale must be non-zero.");
+
+        t.CopyToHost();
+        const float* values = t.Values();
+        const uint32_t len = Length();
+
+        ThreadPool::Default().ParallelFor(0, len, EXPAND_GRAIN_LENGTH, [&](uint32_t begin, uint32_t end)
+        {
+            if (m_Type == COMPACT_FLOAT16)
+            {
+                CpuKernels::FloatToHalf(values + begin, end - begin, (uint16_t*)m_Data.data() + begin);
+                return;
+            }
+
+            const float invScale = 1.f / m_Scale;
+            for (uint32_t i = begin; i < end; ++i)
+                m_Data[i] = (uint8_t)Clip(round((values[i] - m_Offset) * invScale), 0.f, 255.f);
+        });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CompactTensor::ExpandSample(uint32_t n, float* dst) const
+    {
+        if (m_Type == COMPACT_UINT8)
+            CpuKernels::Uint8ToFloat(SampleData(n), BatchLength(), m_Scale, m_Offset, dst);
+        else
+            CpuKernels::HalfToFloat((const uint16_t*)SampleData(n), BatchLength(), dst);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CompactTensor::Expand(const vector<uint32_t>& samples, Tensor& target) const
+    {
+        NEURO_ASSERT(target.BatchLength() == BatchLength(), "Target sample length " << target.BatchLength() << " doesn't match " << BatchLength() << ".");
+        target.ResizeBatch((uint32_t)samples.size());
+        target.OverrideHost();
+
+        float* values = target.Values();
+        const uint32_t sampleLen = BatchLength();
+
+        ThreadPool::Default().ParallelFor(0, (uint32_t)samples.size(), max(1u, EXPAND_GRAIN_LENGTH / sampleLen), [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t n = begin; n < end; ++n)
+            {
+                NEURO_ASSERT(samples[n] < Batch(), "Sample " << samples[n] << " is out of range.");
+                ExpandSample(samples[n], values + (size_t)n * sampleLen);
+            }
+        });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CompactTensor::Expand(uint32_t firstSample, uint32_t samplesNum, Tensor& target) const
+    {
+        vector<uint32_t> samples(samplesNum);
+        iota(samples.begin(), samples.end(), firstSample);
+        Expand(samples, target);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    Tensor CompactTensor::ToTensor() const
+    {
+        Tensor result(m_Shape);
+        Expand(0, Batch(), result);
+        return result;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    CompactTensorLoader::CompactTensorLoader(const vector<const CompactTensor*>& sources, uint32_t batchSize, bool shuffle, unsigned int seed)
+        : m_Sources(sources), m_BatchSize(batchSize), m_Shuffle(shuffle), m_Rng(seed)
+    {
+        for (auto source : m_Sources)
+            NEURO_ASSERT(source->Batch() == m_Sources[0]->Batch(), "Number of samples across all sources must match.");
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t CompactTensorLoader::operator()(vector<Tensor>& dest, size_t loadIdx)
+    {
+        const uint32_t samplesNum = m_Sources[0]->Batch();
+
+        vector<uint32_t> samples(m_BatchSize);
+        for (auto& sample : samples)
+        {
+            if (m_Shuffle)
+                sample = (uint32_t)m_Rng.Next((int)samplesNum);
+            else
+            {
+                sample = m_NextSample;
+                m_NextSample = (m_NextSample + 1) % samplesNum;
+            }
+        }
+
+        for (size_t i = 0; i < m_Sources.size(); ++i)
+            m_Sources[i]->Expand(samples, dest[loadIdx + i]);
+
+        return m_Sources.size();
+    }
+}
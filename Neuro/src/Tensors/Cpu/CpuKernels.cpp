@@ -0,0 +1,873 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include "Tensors/Cpu/CpuKernels.h"
+
+// MSVC allows using any intrinsics regardless of /arch setting, other compilers need to be told which functions can use them
+#ifdef _MSC_VER
+#define NEURO_TARGET_AVX2
+#define NEURO_TARGET_AVX512
+#define NEURO_TARGET_F16C
+#else
+#define NEURO_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define NEURO_TARGET_AVX512 __attribute__((target("avx512f")))
+#define NEURO_TARGET_F16C __attribute__((target("avx2,fma,f16c")))
+#endif
+
+namespace Neuro
+{
+    using namespace std;
+
+    //////////////////////////////////////////////////////////////////////////
+    static void CpuId(int info[4], int function, int subfunction)
+    {
+#ifdef _MSC_VER
+        __cpuidex(info, function, subfunction);
+#else
+        __cpuid_count(function, subfunction, info[0], info[1], info[2], info[3]);
+#endif
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static unsigned long long XGetBv()
+    {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        unsigned int eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return ((unsigned long long)edx << 32) | eax;
+#endif
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Checks both CPU capabilities and whether OS saves extended registers on context switch
+    static bool DetectCpuFeature(bool avx512)
+    {
+        int info[4];
+        CpuId(info, 0, 0);
+        if (info[0] < 7)
+            return false;
+
+        CpuId(info, 1, 0);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool fma = (info[2] & (1 << 12)) != 0;
+        if (!osxsave || !fma)
+            return false;
+
+        unsigned long long xcr0 = XGetBv();
+        if ((xcr0 & 0x6) != 0x6) // XMM and YMM state
+            return false;
+
+        CpuId(info, 7, 0);
+        if (!avx512)
+            return (info[1] & (1 << 5)) != 0; // AVX2
+
+        return (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE0) == 0xE0; // AVX512F and opmask/ZMM state
+    }
+
+    // Sgemm follows the usual Goto-style structure: B is packed into KC x NC panel (fits L3/L2), A is packed into MC x KC block (fits L2)
+    // and register-tiled micro kernel computes MR x NR tile of C at a time streaming single KC slice of A and B panels through L1.
+    // Transposition is handled while packing so micro kernels always see contiguous data. Alpha is folded into packed A.
+    static const int GEMM_MC = 120; // has to be a multiple of every kernel's MR
+    static const int GEMM_KC = 256;
+    static const int GEMM_NC = 1024; // has to be a multiple of every kernel's NR
+    // below this amount of multiply-adds threading overhead outweighs any gains
+    static const int GEMM_MT_THRESHOLD = 64 * 64 * 64;
+
+    typedef void(*GemmMicroKernel)(int kc, const float* packedA, const float* packedB, float* c, int ldc);
+
+    struct GemmKernel
+    {
+        int mr;
+        int nr;
+        GemmMicroKernel run;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    static void MicroKernelScalar(int kc, const float* a, const float* b, float* c, int ldc)
+    {
+        const int MR = 4, NR = 8;
+        float acc[MR][NR] = {};
+
+        for (int p = 0; p < kc; ++p, a += MR, b += NR)
+        {
+            for (int i = 0; i < MR; ++i)
+            for (int j = 0; j < NR; ++j)
+                acc[i][j] += a[i] * b[j];
+        }
+
+        for (int i = 0; i < MR; ++i)
+        for (int j = 0; j < NR; ++j)
+            c[i * ldc + j] += acc[i][j];
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    NEURO_TARGET_AVX2 static void MicroKernelAvx2(int kc, const float* a, const float* b, float* c, int ldc)
+    {
+        const int MR = 6;
+        __m256 acc0[MR], acc1[MR];
+        for (int i = 0; i < MR; ++i)
+            acc0[i] = acc1[i] = _mm256_setzero_ps();
+
+        for (int p = 0; p < kc; ++p, a += MR, b += 16)
+        {
+            __m256 b0 = _mm256_loadu_ps(b);
+            __m256 b1 = _mm256_loadu_ps(b + 8);
+
+            for (int i = 0; i < MR; ++i)
+            {
+                __m256 ai = _mm256_broadcast_ss(a + i);
+                acc0[i] = _mm256_fmadd_ps(ai, b0, acc0[i]);
+                acc1[i] = _mm256_fmadd_ps(ai, b1, acc1[i]);
+            }
+        }
+
+        for (int i = 0; i < MR; ++i)
+        {
+            float* cRow = c + i * ldc;
+            _mm256_storeu_ps(cRow, _mm256_add_ps(_mm256_loadu_ps(cRow), acc0[i]));
+            _mm256_storeu_ps(cRow + 8, _mm256_add_ps(_mm256_loadu_ps(cRow + 8), acc1[i]));
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    NEURO_TARGET_AVX512 static void MicroKernelAvx512(int kc, const float* a, const float* b, float* c, int ldc)
+    {
+        const int MR = 6;
+        __m512 acc0[MR], acc1[MR];
+        for (int i = 0; i < MR; ++i)
+            acc0[i] = acc1[i] = _mm512_setzero_ps();
+
+        for (int p = 0; p < kc; ++p, a += MR, b += 32)
+        {
+            __m512 b0 = _mm512_loadu_ps(b);
+            __m512 b1 = _mm512_loadu_ps(b + 16);
+
+            for (int i = 0; i < MR; ++i)
+            {
+                __m512 ai = _mm512_set1_ps(a[i]);
+                acc0[i] = _mm512_fmadd_ps(ai, b0, acc0[i]);
+                acc1[i] = _mm512_fmadd_ps(ai, b1, acc1[i]);
+            }
+        }
+
+        for (int i = 0; i < MR; ++i)
+        {
+            float* cRow = c + i * ldc;
+            _mm512_storeu_ps(cRow, _mm512_add_ps(_mm512_loadu_ps(cRow), acc0[i]));
+            _mm512_storeu_ps(cRow + 16, _mm512_add_ps(_mm512_loadu_ps(cRow + 16), acc1[i]));
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static const GemmKernel& SelectGemmKernel()
+    {
+        static const GemmKernel SCALAR = { 4, 8, MicroKernelScalar };
+        static const GemmKernel AVX2 = { 6, 16, MicroKernelAvx2 };
+        static const GemmKernel AVX512 = { 6, 32, MicroKernelAvx512 };
+
+        static const GemmKernel& kernel = CpuKernels::SupportsAvx512() ? AVX512 : (CpuKernels::SupportsAvx2() ? AVX2 : SCALAR);
+        return kernel;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Packs mc x kc block of op(A) into row panels of height mr (zero padded), each panel stored column by column
+    static void PackA(bool transA, int mc, int kc, float alpha, const float* a, int lda, int mr, bool multiThreaded, float* packedA)
+    {
+        int panelsNum = (mc + mr - 1) / mr;
+
+        #pragma omp parallel for if (multiThreaded && panelsNum > 1 && mc * kc >= GEMM_MT_THRESHOLD / 64)
+        for (int panel = 0; panel < panelsNum; ++panel)
+        {
+            int i0 = panel * mr;
+            int rows = min(mr, mc - i0);
+            float* dst = packedA + (size_t)panel * mr * kc;
+
+            for (int p = 0; p < kc; ++p, dst += mr)
+            {
+                int i = 0;
+                if (!transA)
+                {
+                    for (; i < rows; ++i)
+                        dst[i] = alpha * a[(size_t)(i0 + i) * lda + p];
+                }
+                else
+                {
+                    const float* src = a + (size_t)p * lda + i0;
+                    for (; i < rows; ++i)
+                        dst[i] = alpha * src[i];
+                }
+                for (; i < mr; ++i)
+                    dst[i] = 0.f;
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Packs kc x nc block of op(B) into column panels of width nr (zero padded), each panel stored row by row
+    static void PackB(bool transB, int kc, int nc, const float* b, int ldb, int nr, bool multiThreaded, float* packedB)
+    {
+        int panelsNum = (nc + nr - 1) / nr;
+
+        #pragma omp parallel for if (multiThreaded && panelsNum > 1 && kc * nc >= GEMM_MT_THRESHOLD / 64)
+        for (int panel = 0; panel < panelsNum; ++panel)
+        {
+            int j0 = panel * nr;
+            int cols = min(nr, nc - j0);
+            float* dst = packedB + (size_t)panel * nr * kc;
+
+            for (int p = 0; p < kc; ++p, dst += nr)
+            {
+                int j = 0;
+                if (!transB)
+                {
+                    const float* src = b + (size_t)p * ldb + j0;
+                    for (; j < cols; ++j)
+                        dst[j] = src[j];
+                }
+                else
+                {
+                    for (; j < cols; ++j)
+                        dst[j] = b[(size_t)(j0 + j) * ldb + p];
+                }
+                for (; j < nr; ++j)
+                    dst[j] = 0.f;
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool CpuKernels::SupportsAvx2()
+    {
+        static const bool supported = DetectCpuFeature(false);
+        return supported;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool CpuKernels::SupportsAvx512()
+    {
+        static const bool supported = DetectCpuFeature(true);
+        return supported;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool CpuKernels::SupportsF16C()
+    {
+        static const bool supported = []()
+        {
+            if (!SupportsAvx2())
+                return false;
+            int info[4];
+            CpuId(info, 1, 0);
+            return (info[2] & (1 << 29)) != 0;
+        }();
+        return supported;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static void ApplyEpilogue(const CpuKernels::Epilogue& epilogue, int row, int rows, int cols, float* c, int ldc)
+    {
+        for (int i = 0; i < rows; ++i)
+            CpuKernels::BiasActivation(c + (size_t)i * ldc, cols, epilogue.rowBias ? epilogue.rowBias[row + i] : 0.f, epilogue.activation, epilogue.activationAlpha);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::Sgemm(bool transA, bool transB, int m, int n, int k, float alpha, const float* a, int lda, const float* b, int ldb, float beta, float* c, int ldc, bool allowThreads, const Epilogue* epilogue)
+    {
+        if (m == 0 || n == 0)
+            return;
+
+        if (beta != 1.f)
+        {
+            #pragma omp parallel for if (allowThreads && (size_t)m * n >= GEMM_MT_THRESHOLD / 64)
+            for (int i = 0; i < m; ++i)
+            {
+                float* cRow = c + (size_t)i * ldc;
+                if (beta == 0.f)
+                    fill(cRow, cRow + n, 0.f);
+                else
+                    for (int j = 0; j < n; ++j)
+                        cRow[j] *= beta;
+            }
+        }
+
+        if (alpha == 0.f || k == 0)
+        {
+            if (epilogue)
+                ApplyEpilogue(*epilogue, 0, m, n, c, ldc);
+            return;
+        }
+
+        const GemmKernel& kernel = SelectGemmKernel();
+        const int mr = kernel.mr, nr = kernel.nr;
+        const bool multiThreaded = allowThreads && (double)m * n * k >= GEMM_MT_THRESHOLD;
+
+        vector<float> packedA((size_t)GEMM_MC * GEMM_KC);
+        vector<float> packedB((size_t)GEMM_KC * min(GEMM_NC, (n + nr - 1) / nr * nr));
+
+        for (int jc = 0; jc < n; jc += GEMM_NC)
+        {
+            int nc = min(GEMM_NC, n - jc);
+            int nPanels = (nc + nr - 1) / nr;
+
+            for (int pc = 0; pc < k; pc += GEMM_KC)
+            {
+                int kc = min(GEMM_KC, k - pc);
+                bool lastSlice = pc + kc >= k;
+                PackB(transB, kc, nc, transB ? b + (size_t)jc * ldb + pc : b + (size_t)pc * ldb + jc, ldb, nr, multiThreaded, &packedB[0]);
+
+                for (int ic = 0; ic < m; ic += GEMM_MC)
+                {
+                    int mc = min(GEMM_MC, m - ic);
+                    int mPanels = (mc + mr - 1) / mr;
+                    PackA(transA, mc, kc, alpha, transA ? a + (size_t)pc * lda + ic : a + (size_t)ic * lda + pc, lda, mr, multiThreaded, &packedA[0]);
+
+                    // every thread owns its own column panels of C so there is no need for synchronization
+                    #pragma omp parallel for if (multiThreaded && nPanels > 1)
+                    for (int jr = 0; jr < nPanels; ++jr)
+                    {
+                        int cols = min(nr, nc - jr * nr);
+                        const float* panelB = &packedB[(size_t)jr * nr * kc];
+                        float edge[16 * 32]; // big enough for largest MR x NR tile
+
+                        for (int ir = 0; ir < mPanels; ++ir)
+                        {
+                            int rows = min(mr, mc - ir * mr);
+                            const float* panelA = &packedA[(size_t)ir * mr * kc];
+                            float* cTile = c + (size_t)(ic + ir * mr) * ldc + jc + jr * nr;
+
+                            if (rows == mr && cols == nr)
+                            {
+                                kernel.run(kc, panelA, panelB, cTile, ldc);
+                            }
+                            else
+                            {
+                                // partial tiles are computed into temporary buffer and only valid part is accumulated into C
+                                fill(edge, edge + mr * nr, 0.f);
+                                kernel.run(kc, panelA, panelB, edge, nr);
+                                for (int i = 0; i < rows; ++i)
+                                for (int j = 0; j < cols; ++j)
+                                    cTile[(size_t)i * ldc + j] += edge[i * nr + j];
+                            }
+
+                            if (epilogue && lastSlice)
+                                ApplyEpilogue(*epilogue, ic + ir * mr, rows, cols, cTile, ldc);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::BiasActivation(float* values, int len, float bias, EActivation activation, float activationAlpha)
+    {
+        // formulas have to stay in sync with activations in TensorOpCpu, so fused and unfused paths give the same results
+        switch (activation)
+        {
+        case _Identity:
+            for (int i = 0; i < len; ++i)
+                values[i] += bias;
+            break;
+        case _ReLU:
+            for (int i = 0; i < len; ++i)
+                values[i] = max(0.f, values[i] + bias);
+            break;
+        case _LeakyReLU:
+            for (int i = 0; i < len; ++i)
+            {
+                float x = values[i] + bias;
+                values[i] = x >= 0 ? x : (activationAlpha * x);
+            }
+            break;
+        case _ELU:
+            for (int i = 0; i < len; ++i)
+            {
+                float x = values[i] + bias;
+                values[i] = x >= 0 ? x : activationAlpha * ((float)exp(x) - 1);
+            }
+            break;
+        case _Sigmoid:
+            for (int i = 0; i < len; ++i)
+                values[i] = 1 / (1 + (float)exp(-(values[i] + bias)));
+            break;
+        case _TanH:
+            for (int i = 0; i < len; ++i)
+                values[i] = 2 / (1 + (float)exp(-2 * (values[i] + bias))) - 1;
+            break;
+        default:
+            NEURO_ASSERT(false, "Activation is not supported in bias activation epilogue.");
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Converts as many pixels as possible in blocks of 8. Each 128-bit lane holds 4 pixels, byte shuffle picks requested channels
+    // out of them, so the same code handles 3 and 4 bytes per pixel and any channel order. Returns number of converted pixels.
+    NEURO_TARGET_AVX2 static int PixelRowToFloatAvx2(const uint8_t* src, int width, int bytesPerPixel, const int channelOffsets[3], const float means[3], EDataFormat dataFormat, int channelStride, float* dst)
+    {
+        // every block reads 16 bytes starting at the first and at the fifth pixel
+        const int readLen = 4 * bytesPerPixel + 16;
+        if (width * bytesPerPixel < readLen)
+            return 0;
+        const int blocksNum = (width * bytesPerPixel - readLen) / (8 * bytesPerPixel) + 1;
+
+        if (dataFormat == NCHW)
+        {
+            // every pixel is expanded to 32-bit word with channels in its lower 3 bytes
+            alignas(32) int8_t mask[32];
+            for (int lane = 0; lane < 2; ++lane)
+            for (int p = 0; p < 4; ++p)
+            {
+                for (int c = 0; c < 3; ++c)
+                    mask[lane * 16 + p * 4 + c] = (int8_t)(p * bytesPerPixel + channelOffsets[c]);
+                mask[lane * 16 + p * 4 + 3] = -1;
+            }
+            __m256i shuffle = _mm256_load_si256((const __m256i*)mask);
+            __m256i byteMask = _mm256_set1_epi32(0xFF);
+            __m256 mean0 = _mm256_set1_ps(means[0]), mean1 = _mm256_set1_ps(means[1]), mean2 = _mm256_set1_ps(means[2]);
+
+            for (int b = 0; b < blocksNum; ++b, src += 8 * bytesPerPixel, dst += 8)
+            {
+                __m256i px = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)src)), _mm_loadu_si128((const __m128i*)(src + 4 * bytesPerPixel)), 1);
+                px = _mm256_shuffle_epi8(px, shuffle);
+                _mm256_storeu_ps(dst, _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_and_si256(px, byteMask)), mean0));
+                _mm256_storeu_ps(dst + channelStride, _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 8), byteMask)), mean1));
+                _mm256_storeu_ps(dst + 2 * channelStride, _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(px, 16)), mean2));
+            }
+            return blocksNum * 8;
+        }
+
+        // channels of 4 pixels are packed into 12 bytes, at the top of the first lane and at the bottom of the second one so all
+        // 24 bytes can be extracted with byte shifts
+        alignas(32) int8_t mask[32];
+        for (int i = 0; i < 32; ++i)
+            mask[i] = -1;
+        for (int p = 0; p < 4; ++p)
+        for (int c = 0; c < 3; ++c)
+        {
+            mask[4 + p * 3 + c] = (int8_t)(p * bytesPerPixel + channelOffsets[c]);
+            mask[16 + p * 3 + c] = (int8_t)(p * bytesPerPixel + channelOffsets[c]);
+        }
+        __m256i shuffle = _mm256_load_si256((const __m256i*)mask);
+        __m256 mean0 = _mm256_setr_ps(means[0], means[1], means[2], means[0], means[1], means[2], means[0], means[1]);
+        __m256 mean1 = _mm256_setr_ps(means[2], means[0], means[1], means[2], means[0], means[1], means[2], means[0]);
+        __m256 mean2 = _mm256_setr_ps(means[1], means[2], means[0], means[1], means[2], means[0], means[1], means[2]);
+
+        for (int b = 0; b < blocksNum; ++b, src += 8 * bytesPerPixel, dst += 24)
+        {
+            __m256i px = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)src)), _mm_loadu_si128((const __m128i*)(src + 4 * bytesPerPixel)), 1);
+            px = _mm256_shuffle_epi8(px, shuffle);
+            __m128i lo = _mm256_castsi256_si128(px);
+            __m128i hi = _mm256_extracti128_si256(px, 1);
+            _mm256_storeu_ps(dst, _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 4))), mean0));
+            _mm256_storeu_ps(dst + 8, _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_alignr_epi8(hi, lo, 12))), mean1));
+            _mm256_storeu_ps(dst + 16, _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 4))), mean2));
+        }
+        return blocksNum * 8;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::PixelRowToFloat(const uint8_t* src, int width, int bytesPerPixel, const int channelOffsets[3], const float* channelMeans, EDataFormat dataFormat, int channelStride, float* dst)
+    {
+        NEURO_ASSERT(bytesPerPixel == 3 || bytesPerPixel == 4, "Only 3 and 4 bytes per pixel are supported.");
+        const float noMeans[3] = { 0.f, 0.f, 0.f };
+        const float* means = channelMeans ? channelMeans : noMeans;
+
+        int x = 0;
+        if (SupportsAvx2())
+            x = PixelRowToFloatAvx2(src, width, bytesPerPixel, channelOffsets, means, dataFormat, channelStride, dst);
+
+        const int pixelStride = dataFormat == NCHW ? 1 : 3;
+        if (dataFormat == NHWC)
+            channelStride = 1;
+
+        for (; x < width; ++x)
+        {
+            const uint8_t* pixel = src + x * bytesPerPixel;
+            for (int c = 0; c < 3; ++c)
+                dst[x * pixelStride + c * channelStride] = (float)pixel[channelOffsets[c]] - means[c];
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Returns number of flipped pixels. 4 byte pixels are reversed 8 at a time with cross-lane permutation. 3 byte pixels are
+    // reversed 5 at a time with byte shuffle; reversed pixels are stored starting one byte early (that byte belongs to a pixel
+    // written later on), so both load and store are plain 16 bytes.
+    NEURO_TARGET_AVX2 static int PixelRowFlipAvx2(const uint8_t* src, int width, int bytesPerPixel, uint8_t* dst)
+    {
+        int x = 0;
+        if (bytesPerPixel == 4)
+        {
+            __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+            for (; x + 8 <= width; x += 8)
+            {
+                __m256i px = _mm256_loadu_si256((const __m256i*)(src + x * 4));
+                _mm256_storeu_si256((__m256i*)(dst + (width - x - 8) * 4), _mm256_permutevar8x32_epi32(px, reverse));
+            }
+            return x;
+        }
+
+        alignas(16) int8_t mask[16];
+        mask[0] = -1;
+        for (int p = 0; p < 5; ++p)
+        for (int c = 0; c < 3; ++c)
+            mask[1 + p * 3 + c] = (int8_t)((4 - p) * 3 + c);
+        __m128i shuffle = _mm_load_si128((const __m128i*)mask);
+
+        // the last 5 pixels of destination would require storing before its beginning
+        for (; x + 6 <= width; x += 5)
+        {
+            __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 3));
+            _mm_storeu_si128((__m128i*)(dst + (width - x - 5) * 3 - 1), _mm_shuffle_epi8(px, shuffle));
+        }
+        return x;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::PixelRowFlip(const uint8_t* src, int width, int bytesPerPixel, uint8_t* dst)
+    {
+        NEURO_ASSERT(bytesPerPixel == 3 || bytesPerPixel == 4, "Only 3 and 4 bytes per pixel are supported.");
+
+        int x = 0;
+        if (SupportsAvx2())
+            x = PixelRowFlipAvx2(src, width, bytesPerPixel, dst);
+
+        for (; x < width; ++x)
+        {
+            const uint8_t* pixel = src + x * bytesPerPixel;
+            copy(pixel, pixel + bytesPerPixel, dst + (width - x - 1) * bytesPerPixel);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Returns number of processed bytes. Every block consists of bytesPerPixel groups of 8 bytes, so gains and offsets pattern is
+    // the same for every block.
+    NEURO_TARGET_AVX2 static int PixelRowAffineAvx2(const uint8_t* src, int len, int bytesPerPixel, const float* gains, const float* offsets, uint8_t* dst)
+    {
+        const int blockLen = 8 * bytesPerPixel;
+
+        __m256 gain[4], offset[4];
+        for (int g = 0; g < bytesPerPixel; ++g)
+        {
+            alignas(32) float gainPattern[8], offsetPattern[8];
+            for (int i = 0; i < 8; ++i)
+            {
+                gainPattern[i] = gains[(g * 8 + i) % bytesPerPixel];
+                offsetPattern[i] = offsets[(g * 8 + i) % bytesPerPixel];
+            }
+            gain[g] = _mm256_load_ps(gainPattern);
+            offset[g] = _mm256_load_ps(offsetPattern);
+        }
+
+        int i = 0;
+        for (; i + blockLen <= len; i += blockLen)
+        {
+            for (int g = 0; g < bytesPerPixel; ++g)
+            {
+                __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i + g * 8))));
+                __m256i result = _mm256_cvtps_epi32(_mm256_fmadd_ps(values, gain[g], offset[g]));
+                // saturating packs clamp results to [0, 255]
+                __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+                _mm_storel_epi64((__m128i*)(dst + i + g * 8), _mm_packus_epi16(words, words));
+            }
+        }
+        return i;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::PixelRowAffine(const uint8_t* src, int width, int bytesPerPixel, const float* gains, const float* offsets, uint8_t* dst)
+    {
+        NEURO_ASSERT(bytesPerPixel == 3 || bytesPerPixel == 4, "Only 3 and 4 bytes per pixel are supported.");
+        const int len = width * bytesPerPixel;
+
+        int i = 0;
+        if (SupportsAvx2())
+            i = PixelRowAffineAvx2(src, len, bytesPerPixel, gains, offsets, dst);
+
+        for (; i < len; ++i)
+        {
+            int c = i % bytesPerPixel;
+            dst[i] = (uint8_t)min(max((int)lrintf(src[i] * gains[c] + offsets[c]), 0), 255);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    NEURO_TARGET_AVX2 static int Uint8ToFloatAvx2(const uint8_t* src, int len, float scale, float offset, float* dst)
+    {
+        __m256 scaleVec = _mm256_set1_ps(scale), offsetVec = _mm256_set1_ps(offset);
+        int i = 0;
+        for (; i + 32 <= len; i += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256((const __m256i*)(src + i));
+            __m128i lo = _mm256_castsi256_si128(bytes);
+            __m128i hi = _mm256_extracti128_si256(bytes, 1);
+            _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(lo)), scaleVec, offsetVec));
+            _mm256_storeu_ps(dst + i + 8, _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8))), scaleVec, offsetVec));
+            _mm256_storeu_ps(dst + i + 16, _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(hi)), scaleVec, offsetVec));
+            _mm256_storeu_ps(dst + i + 24, _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8))), scaleVec, offsetVec));
+        }
+        return i;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::Uint8ToFloat(const uint8_t* src, int len, float scale, float offset, float* dst)
+    {
+        int i = 0;
+        if (SupportsAvx2())
+            i = Uint8ToFloatAvx2(src, len, scale, offset, dst);
+
+        for (; i < len; ++i)
+            dst[i] = src[i] * scale + offset;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static float HalfToFloatScalar(uint16_t h)
+    {
+        uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+        uint32_t exponent = (h >> 10) & 0x1F;
+        uint32_t mantissa = h & 0x3FF;
+        uint32_t bits;
+
+        if (exponent == 0x1F) // infinity or NaN (quieted, the same as F16C conversion)
+            bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+        else if (exponent != 0)
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        else if (mantissa == 0)
+            bits = sign;
+        else
+        {
+            // subnormal half is normal float, mantissa is shifted until its implicit bit appears
+            exponent = 113;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // Rounds to nearest even, the same as F16C conversion
+    static uint16_t FloatToHalfScalar(float f)
+    {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+        uint32_t absBits = bits & 0x7FFFFFFF;
+
+        if (absBits >= 0x7F800000) // infinity or NaN (kept quiet)
+            return sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 | ((absBits >> 13) & 0x3FF) : 0);
+        if (absBits >= 0x477FF000) // rounds above the largest half
+            return sign | 0x7C00;
+        if (absBits < 0x38800000) // subnormal half (or zero)
+        {
+            if (absBits < 0x33000000)
+                return sign;
+            uint32_t exponent = absBits >> 23;
+            uint32_t mantissa = (absBits & 0x7FFFFF) | 0x800000;
+            uint32_t shift = 126 - exponent;
+            uint32_t half = mantissa >> shift;
+            uint32_t rest = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (rest > halfway || (rest == halfway && (half & 1)))
+                ++half;
+            return sign | (uint16_t)half;
+        }
+
+        uint32_t half = ((absBits >> 13) - (112 << 10));
+        uint32_t rest = absBits & 0x1FFF;
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+            ++half; // carry into exponent is correct rounding as well
+        return sign | (uint16_t)half;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    NEURO_TARGET_F16C static int HalfToFloatF16C(const uint16_t* src, int len, float* dst)
+    {
+        int i = 0;
+        for (; i + 8 <= len; i += 8)
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+        return i;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    NEURO_TARGET_F16C static int FloatToHalfF16C(const float* src, int len, uint16_t* dst)
+    {
+        int i = 0;
+        for (; i + 8 <= len; i += 8)
+            _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+        return i;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::HalfToFloat(const uint16_t* src, int len, float* dst)
+    {
+        int i = 0;
+        if (SupportsF16C())
+            i = HalfToFloatF16C(src, len, dst);
+
+        for (; i < len; ++i)
+            dst[i] = HalfToFloatScalar(src[i]);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::FloatToHalf(const float* src, int len, uint16_t* dst)
+    {
+        int i = 0;
+        if (SupportsF16C())
+            i = FloatToHalfF16C(src, len, dst);
+
+        for (; i < len; ++i)
+            dst[i] = FloatToHalfScalar(src[i]);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::Im2Col(const float* input, int channels, int height, int width, int kernelHeight, int kernelWidth, int stride, int paddingX, int paddingY, int outHeight, int outWidth, EDataFormat dataFormat, float* col)
+    {
+        int kernelLen = channels * kernelHeight * kernelWidth;
+        int outputLen = outHeight * outWidth;
+
+        if (dataFormat == NCHW)
+        {
+            #pragma omp parallel for
+            for (int row = 0; row < kernelLen; ++row)
+            {
+                int kernelW = row % kernelWidth;
+                int kernelH = (row / kernelWidth) % kernelHeight;
+                int c = row / (kernelWidth * kernelHeight);
+                const float* inputChannel = input + (size_t)c * height * width;
+                float* colRow = col + (size_t)row * outputLen;
+
+                for (int outH = 0; outH < outHeight; ++outH)
+                {
+                    int inH = outH * stride - paddingY + kernelH;
+                    float* colDst = colRow + outH * outWidth;
+
+                    if (inH < 0 || inH >= height)
+                    {
+                        fill(colDst, colDst + outWidth, 0.f);
+                        continue;
+                    }
+
+                    const float* inputRow = inputChannel + inH * width;
+                    for (int outW = 0, inW = kernelW - paddingX; outW < outWidth; ++outW, inW += stride)
+                        colDst[outW] = (inW >= 0 && inW < width) ? inputRow[inW] : 0.f;
+                }
+            }
+        }
+        else
+        {
+            #pragma omp parallel for
+            for (int p = 0; p < outputLen; ++p)
+            {
+                int outW = p % outWidth;
+                int outH = p / outWidth;
+                float* colRow = col + (size_t)p * kernelLen;
+
+                for (int kernelH = 0; kernelH < kernelHeight; ++kernelH)
+                {
+                    int inH = outH * stride - paddingY + kernelH;
+                    for (int kernelW = 0; kernelW < kernelWidth; ++kernelW)
+                    {
+                        int inW = outW * stride - paddingX + kernelW;
+                        float* colDst = colRow + kernelH * kernelWidth + kernelW;
+                        int colStride = kernelHeight * kernelWidth;
+
+                        if (inH < 0 || inH >= height || inW < 0 || inW >= width)
+                        {
+                            for (int c = 0; c < channels; ++c)
+                                colDst[c * colStride] = 0.f;
+                            continue;
+                        }
+
+                        const float* inputPixel = input + ((size_t)inH * width + inW) * channels;
+                        for (int c = 0; c < channels; ++c)
+                            colDst[c * colStride] = inputPixel[c];
+                    }
+                }
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void CpuKernels::Col2Im(const float* col, int channels, int height, int width, int kernelHeight, int kernelWidth, int stride, int paddingX, int paddingY, int outHeight, int outWidth, EDataFormat dataFormat, float* input)
+    {
+        int kernelLen = channels * kernelHeight * kernelWidth;
+        int outputLen = outHeight * outWidth;
+
+        if (dataFormat == NCHW)
+        {
+            // each channel is accumulated by a single thread to avoid races
+            #pragma omp parallel for
+            for (int c = 0; c < channels; ++c)
+            {
+                float* inputChannel = input + (size_t)c * height * width;
+
+                for (int kernelH = 0; kernelH < kernelHeight; ++kernelH)
+                for (int kernelW = 0; kernelW < kernelWidth; ++kernelW)
+                {
+                    const float* colRow = col + (size_t)((c * kernelHeight + kernelH) * kernelWidth + kernelW) * outputLen;
+
+                    for (int outH = 0; outH < outHeight; ++outH)
+                    {
+                        int inH = outH * stride - paddingY + kernelH;
+                        if (inH < 0 || inH >= height)
+                            continue;
+
+                        float* inputRow = inputChannel + inH * width;
+                        const float* colSrc = colRow + outH * outWidth;
+                        for (int outW = 0, inW = kernelW - paddingX; outW < outWidth; ++outW, inW += stride)
+                        {
+                            if (inW >= 0 && inW < width)
+                                inputRow[inW] += colSrc[outW];
+                        }
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (int p = 0; p < outputLen; ++p)
+            {
+                int outW = p % outWidth;
+                int outH = p / outWidth;
+                const float* colRow = col + (size_t)p * kernelLen;
+
+                for (int kernelH = 0; kernelH < kernelHeight; ++kernelH)
+                {
+                    int inH = outH * stride - paddingY + kernelH;
+                    if (inH < 0 || inH >= height)
+                        continue;
+
+                    for (int kernelW = 0; kernelW < kernelWidth; ++kernelW)
+                    {
+                        int inW = outW * stride - paddingX + kernelW;
+                        if (inW < 0 || inW >= width)
+                            continue;
+
+                        float* inputPixel = input + ((size_t)inH * width + inW) * channels;
+                        const float* colSrc = colRow + kernelH * kernelWidth + kernelW;
+                        int colStride = kernelHeight * kernelWidth;
+
+                        for (int c = 0; c < channels; ++c)
+                            inputPixel[c] += colSrc[c * colStride];
+                    }
+                }
+            }
+        }
+    }
+}
@@ -102,6 +102,9 @@ namespace Neuro
             other.m_DeviceDataPtr = nullptr;
             m_DataPtr = other.m_DataPtr;
             other.m_DataPtr = nullptr;
+            m_BoundDataPtr = other.m_BoundDataPtr;
+            m_BoundCapacity = other.m_BoundCapacity;
+            other.m_BoundDataPtr = nullptr;
             m_OffloadEvent = other.m_OffloadEvent;
             other.m_OffloadEvent = nullptr;
             NEURO_ASSERT(!other.m_OffloadRequested, "Moving while offload in progress, this may not end well...");
@@ -161,7 +164,7 @@ namespace Neuro
     void Storage::Resize(size_t size)
     {
         STORAGE_DEBUG_INFO("Resizing '%s' from %zu to %zu (alloc size %zu)", m_Name.c_str(), m_Size, size, m_AllocSize);
-        if (size < m_AllocSize)
+        if (size <= m_AllocSize)
         {
             STORAGE_DEBUG_INFO_NO_TS(" <<< no reallocation required.\n");
             m_Size = size;
@@ -219,7 +222,12 @@ namespace Neuro
             return;
         }
         STORAGE_DEBUG_INFO_NO_TS("<<< allocating.\n");
-        if (m_Type & ST_Offloadable)
+        if (m_BoundDataPtr && m_AllocSize > m_BoundCapacity)
+            m_BoundDataPtr = nullptr;
+
+        if (m_BoundDataPtr)
+            const_cast<Storage*>(this)->m_DataPtr = m_BoundDataPtr;
+        else if (m_Type & ST_Offloadable)
             HostPinnedMemoryManager::Default().Allocate((void**)&m_DataPtr, AllocSizeInBytes(), m_Name);
         else
             HostMemoryManager::Default().Allocate((void**)&m_DataPtr, AllocSizeInBytes(), m_Name);
@@ -251,15 +259,51 @@ namespace Neuro
             return;
         }
         STORAGE_DEBUG_INFO_NO_TS("<<< release incoming.\n");
-        if (m_Type & ST_Offloadable)
-            HostPinnedMemoryManager::Default().Free(m_DataPtr);
-        else
-            HostMemoryManager::Default().Free(m_DataPtr);
+        // bound memory is owned by someone else
+        if (m_DataPtr != m_BoundDataPtr)
+        {
+            if (m_Type & ST_Offloadable)
+                HostPinnedMemoryManager::Default().Free(m_DataPtr);
+            else
+                HostMemoryManager::Default().Free(m_DataPtr);
+        }
         
         m_DataPtr = nullptr;
         m_DataLocation = None;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void Storage::BindHostMemory(float* ptr, size_t capacity)
+    {
+        NEURO_ASSERT(!(m_Type & ST_Offloadable), "Binding host memory of offloadable storage is not supported.");
+        NEURO_ASSERT(!m_DeviceDataPtr, "Binding host memory of storage allocated on device is not supported.");
+        NEURO_ASSERT(m_Size <= capacity, "Bound memory is too small.");
+
+        // current content is not preserved
+        if (m_DataPtr)
+            FreeOnHost();
+        m_DataLocation = None;
+
+        m_BoundDataPtr = ptr;
+        m_BoundCapacity = capacity;
+        m_AllocSize = m_Size;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Storage::UnbindHostMemory()
+    {
+        if (!m_BoundDataPtr)
+            return;
+
+        if (m_DataPtr == m_BoundDataPtr)
+        {
+            m_DataPtr = nullptr;
+            m_DataLocation = None;
+        }
+        m_BoundDataPtr = nullptr;
+        m_BoundCapacity = 0;
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void Storage::AllocateOnDevice() const
     {
@@ -12,8 +12,10 @@
 #include "Tensors/TensorOpCpu.h"
 #include "Tensors/TensorOpCpuMt.h"
 #include "Tensors/TensorOpCpuMkl.h"
+#include "Tensors/TensorOpCpuIm2Col.h"
 #include "Tensors/TensorOpGpu.h"
 #include "Tensors/TensorFormatter.h"
+#include "Tensors/TensorFile.h"
 #include "Random.h"
 #include "Tools.h"
 
@@ -25,10 +27,12 @@ namespace Neuro
 	TensorOpCpu* Tensor::g_OpCpu = new TensorOpCpu();
     TensorOpCpu* Tensor::g_OpCpuMt = nullptr;
     TensorOpCpu* Tensor::g_OpCpuMkl = nullptr;
+    TensorOpCpu* Tensor::g_OpCpuIm2Col = nullptr;
     TensorOpCpu* Tensor::g_OpGpu = nullptr;
 
     TensorOpCpu* Tensor::g_DefaultOp = nullptr;
-    TensorOpCpu* Tensor::g_ForcedOp = nullptr;
+    // forced op mode is per thread, so operations computed concurrently by session can each force their own mode
+    static thread_local TensorOpCpu* g_ForcedOp = nullptr;
 
     //////////////////////////////////////////////////////////////////////////
     Tensor::Tensor(const Shape& shape, const string& name, EStorageType storageType)
@@ -172,6 +176,12 @@ namespace Neuro
         g_ForcedOp = nullptr;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    bool Tensor::HasForcedOpMode()
+    {
+        return g_ForcedOp != nullptr;
+    }
+
 	//////////////////////////////////////////////////////////////////////////
 	void Tensor::SetOpMode(EOpMode mode)
 	{
@@ -2052,26 +2062,17 @@ namespace Neuro
 
     void Tensor::SaveBin(ostream& stream) const
     {
-        /*m_Shape.SaveBin(stream);
-        size_t valuesNum = m_Storage.UsedSize();
-        stream.write((const char*)&valuesNum, sizeof(valuesNum));
-        stream.write((const char*)&m_Storage.Data()[0], valuesNum * sizeof(float));
-        size_t nameLen = m_Name.length();
-        stream.write((const char*)&nameLen, sizeof(nameLen));
-        stream.write(m_Name.c_str(), nameLen);*/
+        TensorFile::Write(stream, { this });
     }
 
+    //////////////////////////////////////////////////////////////////////////
     void Tensor::LoadBin(istream& stream)
     {
-        /*m_Shape.LoadBin(stream);
-        m_Storage.Resize(m_Shape.Length);
-        size_t valuesNum = 0;
-        stream.read((char*)&valuesNum, sizeof(valuesNum));
-        stream.read((char*)m_Storage.Data(), valuesNum * sizeof(float));
-        size_t nameLen = 0;
-        stream.read((char*)&nameLen, sizeof(nameLen));
-        m_Name.resize(nameLen);
-        stream.read(&m_Name[0], nameLen);*/
+        auto tensors = TensorFile::Read(stream);
+        NEURO_ASSERT(tensors.size() == 1, "Stream doesn't contain valid tensor.");
+        Resize(tensors[0].GetShape());
+        tensors[0].CopyTo(*this);
+        m_Name = tensors[0].Name();
     }
 
 	//////////////////////////////////////////////////////////////////////////
@@ -2487,6 +2488,39 @@ namespace Neuro
         Op()->SoftmaxGradient(output, outputGradient, inputGradient);
 	}
 
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::SoftmaxCrossEntropy(const Tensor& target, Tensor& probabilities, Tensor& loss) const
+    {
+        NEURO_ASSERT(m_Shape == target.GetShape(), "Target shape doesn't match logits shape.");
+        NEURO_ASSERT(m_Shape == probabilities.GetShape(), "Probabilities shape doesn't match logits shape.");
+        NEURO_ASSERT(loss.GetShape() == Shape(1, 1, 1, Batch()), "Loss shape doesn't match logits batch.");
+        Op()->SoftmaxCrossEntropy(*this, target, probabilities, loss);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::SoftmaxCrossEntropyGradient(const Tensor& probabilities, const Tensor& target, const Tensor& lossGradient, Tensor* logitsGradient, Tensor* targetGradient) const
+    {
+        NEURO_ASSERT(!logitsGradient || logitsGradient->GetShape() == m_Shape, "Logits gradient shape doesn't match logits shape.");
+        NEURO_ASSERT(!targetGradient || targetGradient->GetShape() == m_Shape, "Target gradient shape doesn't match logits shape.");
+        Op()->SoftmaxCrossEntropyGradient(*this, probabilities, target, lossGradient, logitsGradient, targetGradient);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::SigmoidCrossEntropy(const Tensor& target, Tensor& loss) const
+    {
+        NEURO_ASSERT(m_Shape == target.GetShape(), "Target shape doesn't match logits shape.");
+        NEURO_ASSERT(m_Shape == loss.GetShape(), "Loss shape doesn't match logits shape.");
+        Op()->SigmoidCrossEntropy(*this, target, loss);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::SigmoidCrossEntropyGradient(const Tensor& target, const Tensor& lossGradient, Tensor* logitsGradient, Tensor* targetGradient) const
+    {
+        NEURO_ASSERT(!logitsGradient || logitsGradient->GetShape() == m_Shape, "Logits gradient shape doesn't match logits shape.");
+        NEURO_ASSERT(!targetGradient || targetGradient->GetShape() == m_Shape, "Target gradient shape doesn't match logits shape.");
+        Op()->SigmoidCrossEntropyGradient(*this, target, lossGradient, logitsGradient, targetGradient);
+    }
+
 	//////////////////////////////////////////////////////////////////////////
 	void Tensor::CopyToDevice() const
 	{
@@ -2597,6 +2631,18 @@ namespace Neuro
         m_Storage.Release();
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::BindHostMemory(float* ptr, size_t capacity)
+    {
+        m_Storage.BindHostMemory(ptr, capacity);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void Tensor::UnbindHostMemory()
+    {
+        m_Storage.UnbindHostMemory();
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void Tensor::OverrideHost()
     {
@@ -2708,6 +2754,8 @@ namespace Neuro
 			return g_OpCpuMt = (g_OpCpuMt ? g_OpCpuMt : new TensorOpCpuMt());
         case EOpMode::CPU_MKL:
             return g_OpCpuMkl = (g_OpCpuMkl ? g_OpCpuMkl : new TensorOpCpuMkl());
+        case EOpMode::CPU_IM2COL:
+            return g_OpCpuIm2Col = (g_OpCpuIm2Col ? g_OpCpuIm2Col : new TensorOpCpuIm2Col());
         case EOpMode::GPU:
 			return g_OpGpu = (g_OpGpu ? g_OpGpu : new TensorOpGpu());
 		}
@@ -0,0 +1,356 @@
+#include <cstring>
+#include <fstream>
+
+#include "Tensors/TensorFile.h"
+#include "Tensors/Tensor.h"
+#include "Memory/MappedFile.h"
+#include "ThreadPool.h"
+#include "Tools.h"
+
+namespace Neuro
+{
+    static const char TENSOR_FILE_MAGIC[8] = { 'N', 'E', 'U', 'R', 'O', 'T', 'N', 'S' };
+    // checksum is computed independently for chunks of this size so it can be done in parallel
+    static const size_t HASH_CHUNK_SIZE = 1 << 20;
+    static const uint64_t HASH_OFFSET = 0xcbf29ce484222325ull;
+    static const uint64_t HASH_PRIME = 0x100000001b3ull;
+
+#pragma pack(push, 1)
+    struct TensorFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t tensorsNum;
+        // table follows header immediately, data region starts at data offset (relative to the beginning of the file)
+        uint64_t tableSize;
+        uint64_t dataOffset;
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+#pragma pack(pop)
+
+    //////////////////////////////////////////////////////////////////////////
+    static size_t AlignOffset(size_t offset)
+    {
+        return (offset + TensorFile::DATA_ALIGNMENT - 1) / TensorFile::DATA_ALIGNMENT * TensorFile::DATA_ALIGNMENT;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static uint64_t Mix(uint64_t h, uint64_t value)
+    {
+        return (h ^ value) * HASH_PRIME;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // FNV-1a over 64-bit words with 4 independent lanes, so consecutive multiplications don't depend on each other
+    static uint64_t HashChunk(const uint8_t* data, size_t size)
+    {
+        uint64_t lanes[4] = { HASH_OFFSET, HASH_OFFSET + 1, HASH_OFFSET + 2, HASH_OFFSET + 3 };
+        uint64_t words[4];
+
+        size_t i = 0;
+        for (; i + sizeof(words) <= size; i += sizeof(words))
+        {
+            memcpy(words, data + i, sizeof(words));
+            lanes[0] = Mix(lanes[0], words[0]);
+            lanes[1] = Mix(lanes[1], words[1]);
+            lanes[2] = Mix(lanes[2], words[2]);
+            lanes[3] = Mix(lanes[3], words[3]);
+        }
+
+        uint64_t h = HASH_OFFSET;
+        for (; i < size; ++i)
+            h = Mix(h, data[i]);
+        for (auto lane : lanes)
+            h = Mix(h, lane);
+        return h;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint64_t TensorFile::HashBytes(const void* data, size_t size)
+    {
+        const uint8_t* bytes = (const uint8_t*)data;
+        vector<uint64_t> chunkHashes((size + HASH_CHUNK_SIZE - 1) / HASH_CHUNK_SIZE);
+
+        ThreadPool::Default().ParallelFor(0, (uint32_t)chunkHashes.size(), 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t c = begin; c < end; ++c)
+            {
+                size_t offset = c * HASH_CHUNK_SIZE;
+                chunkHashes[c] = HashChunk(bytes + offset, min(HASH_CHUNK_SIZE, size - offset));
+            }
+        });
+
+        uint64_t h = Mix(HASH_OFFSET, size);
+        for (auto chunkHash : chunkHashes)
+            h = Mix(h, chunkHash);
+        return h;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static uint64_t Checksum(const uint8_t* table, size_t tableSize, const vector<pair<const void*, size_t>>& tensorsData)
+    {
+        uint64_t h = TensorFile::HashBytes(table, tableSize);
+        for (auto& data : tensorsData)
+            h = Mix(h, TensorFile::HashBytes(data.first, data.second));
+        return h;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static string ValidateHeader(const TensorFileHeader& header)
+    {
+        if (memcmp(header.magic, TENSOR_FILE_MAGIC, sizeof(TENSOR_FILE_MAGIC)) != 0)
+            return "Not a tensor file.";
+        if (header.version != TensorFile::VERSION)
+            return "Unsupported tensor file version " + to_string(header.version) + ".";
+        if (header.dataOffset < sizeof(TensorFileHeader) + header.tableSize)
+            return "Data region overlaps entries table.";
+        return "";
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorFile::Write(ostream& stream, const vector<const Tensor*>& tensors, const vector<string>& names)
+    {
+        NEURO_ASSERT(names.empty() || names.size() == tensors.size(), "Expected " << tensors.size() << " names, got " << names.size() << ".");
+
+        vector<uint8_t> table;
+        vector<pair<const void*, size_t>> tensorsData;
+        vector<uint64_t> offsets;
+        uint64_t dataSize = 0;
+
+        auto append = [&](const void* data, size_t size) { table.insert(table.end(), (const uint8_t*)data, (const uint8_t*)data + size); };
+
+        for (size_t i = 0; i < tensors.size(); ++i)
+        {
+            auto t = tensors[i];
+            t->CopyToHost();
+
+            const string& name = names.empty() ? t->Name() : names[i];
+            uint32_t nameLen = (uint32_t)name.length();
+            uint64_t offset = AlignOffset(dataSize);
+
+            append(&nameLen, sizeof(nameLen));
+            append(name.data(), nameLen);
+            append(t->GetShape().Dimensions, sizeof(t->GetShape().Dimensions));
+            append(&offset, sizeof(offset));
+
+            tensorsData.push_back({ t->Values(), t->Length() * sizeof(float) });
+            offsets.push_back(offset);
+            dataSize = offset + t->Length() * sizeof(float);
+        }
+
+        TensorFileHeader header = {};
+        memcpy(header.magic, TENSOR_FILE_MAGIC, sizeof(TENSOR_FILE_MAGIC));
+        header.version = VERSION;
+        header.tensorsNum = (uint32_t)tensors.size();
+        header.tableSize = table.size();
+        header.dataOffset = AlignOffset(sizeof(header) + table.size());
+        header.dataSize = dataSize;
+        header.checksum = Checksum(table.data(), table.size(), tensorsData);
+
+        static const char padding[DATA_ALIGNMENT] = {};
+
+        stream.write((const char*)&header, sizeof(header));
+        stream.write((const char*)table.data(), table.size());
+        stream.write(padding, header.dataOffset - sizeof(header) - table.size());
+
+        uint64_t position = 0;
+        for (size_t i = 0; i < tensorsData.size(); ++i)
+        {
+            stream.write(padding, offsets[i] - position);
+            stream.write((const char*)tensorsData[i].first, tensorsData[i].second);
+            position = offsets[i] + tensorsData[i].second;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool TensorFile::Save(const string& filename, const vector<const Tensor*>& tensors, const vector<string>& names)
+    {
+        ofstream stream(filename, ios::out | ios::binary);
+        if (!stream)
+            return false;
+
+        Write(stream, tensors, names);
+        return (bool)stream;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    string TensorFile::ParseTable(const uint8_t* table, uint64_t tableSize, uint32_t tensorsNum, uint64_t dataSize, vector<Entry>& entries)
+    {
+        // every entry takes at least its length, dimensions and offset
+        if ((uint64_t)tensorsNum * (sizeof(uint32_t) * 5 + sizeof(uint64_t)) > tableSize)
+            return "Entries table is truncated.";
+
+        entries.resize(tensorsNum);
+
+        uint64_t position = 0;
+        uint64_t dataEnd = 0;
+        auto read = [&](void* dest, size_t size)
+        {
+            if (position + size > tableSize)
+                return false;
+            memcpy(dest, table + position, size);
+            position += size;
+            return true;
+        };
+
+        for (auto& entry : entries)
+        {
+            uint32_t nameLen = 0;
+            uint32_t dims[4];
+            if (!read(&nameLen, sizeof(nameLen)) || position + nameLen > tableSize)
+                return "Entries table is truncated.";
+            entry.name.assign((const char*)table + position, nameLen);
+            position += nameLen;
+            if (!read(dims, sizeof(dims)) || !read(&entry.offset, sizeof(entry.offset)))
+                return "Entries table is truncated.";
+
+            entry.shape = Shape(dims[0], dims[1], dims[2], dims[3]);
+            // entries are stored in order of their data so it can be read sequentially from a stream
+            if (entry.offset < dataEnd || entry.offset % DATA_ALIGNMENT != 0)
+                return "Invalid data offset of tensor '" + entry.name + "'.";
+            dataEnd = entry.offset + (uint64_t)entry.shape.Length * sizeof(float);
+            if (dataEnd > dataSize)
+                return "Data of tensor '" + entry.name + "' is out of bounds.";
+        }
+
+        return "";
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    vector<Tensor> TensorFile::Read(istream& stream, bool verifyChecksum)
+    {
+        TensorFileHeader header;
+        if (!stream.read((char*)&header, sizeof(header)) || !ValidateHeader(header).empty())
+            return {};
+
+        vector<uint8_t> table(header.tableSize);
+        vector<Entry> entries;
+        if (!stream.read((char*)table.data(), table.size()) || !ParseTable(table.data(), table.size(), header.tensorsNum, header.dataSize, entries).empty())
+            return {};
+
+        stream.ignore(header.dataOffset - sizeof(header) - table.size());
+
+        vector<Tensor> tensors;
+        vector<pair<const void*, size_t>> tensorsData;
+        tensors.reserve(entries.size());
+
+        uint64_t position = 0;
+        for (auto& entry : entries)
+        {
+            stream.ignore(entry.offset - position);
+            tensors.emplace_back(entry.shape, entry.name);
+            auto& t = tensors.back();
+            t.OverrideHost();
+            stream.read((char*)t.Values(), t.Length() * sizeof(float));
+            tensorsData.push_back({ t.Values(), t.Length() * sizeof(float) });
+            position = entry.offset + t.Length() * sizeof(float);
+        }
+
+        if (!stream || (verifyChecksum && Checksum(table.data(), table.size(), tensorsData) != header.checksum))
+            return {};
+
+        return tensors;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool TensorFile::IsTensorFile(const string& filename)
+    {
+        ifstream stream(filename, ios::in | ios::binary);
+        char magic[sizeof(TENSOR_FILE_MAGIC)];
+        return stream.read(magic, sizeof(magic)) && memcmp(magic, TENSOR_FILE_MAGIC, sizeof(magic)) == 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    TensorFile::TensorFile(const string& filename, bool verifyChecksum)
+    {
+        m_File = make_unique<MappedFile>(filename);
+        if (!m_File->Data())
+        {
+            m_Error = "Failed to map file '" + filename + "'.";
+            return;
+        }
+
+        TensorFileHeader header;
+        if (m_File->Size() < sizeof(header))
+        {
+            m_Error = "Not a tensor file.";
+            return;
+        }
+
+        memcpy(&header, m_File->Data(), sizeof(header));
+        m_Error = ValidateHeader(header);
+        if (!m_Error.empty())
+            return;
+
+        if (header.dataOffset + header.dataSize > m_File->Size())
+        {
+            m_Error = "File is truncated.";
+            return;
+        }
+
+        const uint8_t* table = m_File->Data() + sizeof(header);
+        m_Error = ParseTable(table, header.tableSize, header.tensorsNum, header.dataSize, m_Entries);
+        if (!m_Error.empty())
+        {
+            m_Entries.clear();
+            return;
+        }
+
+        m_Data = m_File->Data() + header.dataOffset;
+
+        if (verifyChecksum)
+        {
+            vector<pair<const void*, size_t>> tensorsData;
+            for (size_t i = 0; i < m_Entries.size(); ++i)
+                tensorsData.push_back({ Data(i), m_Entries[i].shape.Length * sizeof(float) });
+
+            if (Checksum(table, header.tableSize, tensorsData) != header.checksum)
+            {
+                m_Error = "Checksum mismatch.";
+                m_Entries.clear();
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    TensorFile::~TensorFile()
+    {
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    const float* TensorFile::Data(size_t idx) const
+    {
+        return (const float*)(m_Data + m_Entries[idx].offset);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    int TensorFile::Find(const string& name) const
+    {
+        for (size_t i = 0; i < m_Entries.size(); ++i)
+        {
+            if (m_Entries[i].name == name)
+                return (int)i;
+        }
+        return -1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorFile::Load(size_t idx, Tensor& target, bool zeroCopy) const
+    {
+        NEURO_ASSERT(IsValid(), m_Error);
+        auto& entry = m_Entries[idx];
+
+        target.Resize(entry.shape);
+
+        if (zeroCopy && target.CanBindHostMemory())
+        {
+            target.BindHostMemory(const_cast<float*>(Data(idx)), entry.shape.Length);
+            target.OverrideHost();
+            return;
+        }
+
+        target.OverrideHost();
+        memcpy(target.Values(), Data(idx), entry.shape.Length * sizeof(float));
+    }
+}
@@ -4,6 +4,8 @@
 #include "Tools.h"
 #include "Tensors/TensorOpCpu.h"
 #include "Tensors/Tensor.h"
+#include "Tensors/Cpu/BroadcastPlan.h"
+#include "Tensors/Cpu/CpuKernels.h"
 
 namespace Neuro
 {
@@ -31,47 +33,7 @@ namespace Neuro
 		t2.CopyToHost();
 		output.OverrideHost();
 
-        if (t1.GetShape() == t2.GetShape())
-        {
-            auto t1Values = t1.Values();
-            auto t2Values = t2.Values();
-            auto outputValues = output.Values();
-
-            #pragma omp parallel for
-            for (int i = 0; i < (int)output.Length(); ++i)
-                outputValues[i] = alpha * t1Values[i] + beta * t2Values[i];
-            
-            return;
-        }
-
-        #pragma omp parallel for
-        for (int n = 0; n < (int)max(t1.Batch(), t2.Batch()); ++n)
-        {
-            uint32_t t1N = n % t1.Batch();
-            uint32_t t2N = n % t2.Batch();
-
-            #pragma omp parallel for
-            for (int d = 0; d < (int)max(t1.Depth(), t2.Depth()); ++d)
-            {
-                uint32_t t1D = d % t1.Depth();
-                uint32_t t2D = d % t2.Depth();
-
-                #pragma omp parallel for
-                for (int h = 0; h < (int)max(t1.Height(), t2.Height()); ++h)
-                {
-                    uint32_t t1H = h % t1.Height();
-                    uint32_t t2H = h % t2.Height();
-
-                    for (uint32_t w = 0; w < max(t1.Width(), t2.Width()); ++w)
-                    {
-                        uint32_t t1W = w % t1.Width();
-                        uint32_t t2W = w % t2.Width();
-
-                        output(w, (uint32_t)h, (uint32_t)d, (uint32_t)n) = alpha * t1(t1W, t1H, t1D, t1N) + beta * t2(t2W, t2H, t2D, t2N);
-                    }
-                }
-            }
-        }
+        BroadcastElementwise(t1.Values(), t2.Values(), output.Values(), BroadcastPlan(t1.GetShape(), t2.GetShape(), output.GetShape()), [=](float x, float y) { return alpha * x + beta * y; });
 	}
 
     //////////////////////////////////////////////////////////////////////////
@@ -86,43 +48,35 @@ namespace Neuro
         a.CopyToHost();
 		b.CopyToHost();
         output.OverrideHost();
-		output.Zero();
-
-        const Tensor* finalA = &a;
-        const Tensor* finalB = &b;
-
-        Tensor transpA;
-        Tensor transpB;
-
-        //directly transposing before multiplying is faster due to cache utilization
-        if (transposeA)
-        {
-            transpA = a.Transpose();
-            finalA = &transpA;
-        }
 
-        if (transposeB)
-        {
-            transpB = b.Transpose();
-            finalB = &transpB;
-        }
+        // transposition is handled during packing inside Sgemm so there is no need for transposed copies
+        int M = transposeA ? a.Width() : a.Height();
+        int N = transposeB ? b.Height() : b.Width();
+        int K = transposeA ? a.Height() : a.Width();
 
-        uint32_t N = finalA->Height();
-        uint32_t M = finalB->Width();
-        uint32_t K = finalA->Width();
-
-        #pragma omp parallel for
-        for (int n = 0; n < (int)output.Batch(); ++n)
+        // Sgemm is multi-threaded internally
+        for (uint32_t n = 0; n < output.Batch(); ++n)
 		{
-            uint32_t t1N = min((uint32_t)n, finalA->Batch() - 1);
-            uint32_t t2N = min((uint32_t)n, finalB->Batch() - 1);
+            uint32_t aN = min(n, a.Batch() - 1);
+            uint32_t bN = min(n, b.Batch() - 1);
 
-            #pragma omp parallel for
-			for (int d = 0; d < (int)finalA->Depth(); ++d)
-			for (uint32_t i = 0; i < N; ++i)
-			for (uint32_t j = 0; j < M; ++j)
-			for (uint32_t k = 0; k < K; ++k)
-                output(j, i, (uint32_t)d, (uint32_t)n) += (*finalA)(k, i, (uint32_t)d, t1N) * (*finalB)(j, k, (uint32_t)d, t2N);
+			for (uint32_t d = 0; d < a.Depth(); ++d)
+            {
+                CpuKernels::Sgemm(
+                    transposeA,
+                    transposeB,
+                    M,
+                    N,
+                    K,
+                    1.f,
+                    a.Values() + d * a.GetShape().Dim0Dim1 + aN * a.BatchLength(),
+                    a.Width(),
+                    b.Values() + d * b.GetShape().Dim0Dim1 + bN * b.BatchLength(),
+                    b.Width(),
+                    0.f,
+                    output.Values() + d * output.GetShape().Dim0Dim1 + n * output.BatchLength(),
+                    output.Width());
+            }
 		}
 	}
 
@@ -139,47 +93,7 @@ namespace Neuro
         t2.CopyToHost();
         output.OverrideHost();
 
-        if (t1.GetShape() == t2.GetShape())
-        {
-            auto t1Values = t1.Values();
-            auto t2Values = t2.Values();
-            auto outputValues = output.Values();
-
-            #pragma omp parallel for
-            for (int i = 0; i < (int)output.Length(); ++i)
-                outputValues[i] = alpha * t1Values[i] * beta * t2Values[i];
-            
-            return;
-        }
-
-        #pragma omp parallel for
-        for (int n = 0; n < (int)max(t1.Batch(), t2.Batch()); ++n)
-        {
-            uint32_t t1N = n % t1.Batch();
-            uint32_t t2N = n % t2.Batch();
-
-            #pragma omp parallel for
-            for (int d = 0; d < (int)max(t1.Depth(), t2.Depth()); ++d)
-            {
-                uint32_t t1D = d % t1.Depth();
-                uint32_t t2D = d % t2.Depth();
-
-                #pragma omp parallel for
-                for (int h = 0; h < (int)max(t1.Height(), t2.Height()); ++h)
-                {
-                    uint32_t t1H = h % t1.Height();
-                    uint32_t t2H = h % t2.Height();
-
-                    for (uint32_t w = 0; w < max(t1.Width(), t2.Width()); ++w)
-                    {
-                        uint32_t t1W = w % t1.Width();
-                        uint32_t t2W = w % t2.Width();
-
-                        output(w, (uint32_t)h, (uint32_t)d, (uint32_t)n) = alpha * t1(t1W, t1H, t1D, t1N) * beta * t2(t2W, t2H, t2D, t2N);
-                    }
-                }
-            }
-        }
+        BroadcastElementwise(t1.Values(), t2.Values(), output.Values(), BroadcastPlan(t1.GetShape(), t2.GetShape(), output.GetShape()), [=](float x, float y) { return alpha * x * beta * y; });
 	}
 
     //////////////////////////////////////////////////////////////////////////
@@ -227,44 +141,7 @@ namespace Neuro
         t2.CopyToHost();
         output.OverrideHost();
 
-        if (t1.GetShape() == t2.GetShape())
-        {
-            auto t1Values = t1.Values();
-            auto t2Values = t2.Values();
-            auto outputValues = output.Values();
-
-            #pragma omp parallel for
-            for (int i = 0; i < (int)output.Length(); ++i)
-                outputValues[i] = alpha * t1Values[i] / (beta * t2Values[i]);
-            
-            return;
-        }
-
-        for (uint32_t n = 0; n < max(t1.Batch(), t2.Batch()); ++n)
-        {
-            uint32_t t1N = n % t1.Batch();
-            uint32_t t2N = n % t2.Batch();
-
-            for (uint32_t d = 0; d < max(t1.Depth(), t2.Depth()); ++d)
-            {
-                uint32_t t1D = d % t1.Depth();
-                uint32_t t2D = d % t2.Depth();
-
-                for (uint32_t h = 0; h < max(t1.Height(), t2.Height()); ++h)
-                {
-                    uint32_t t1H = h % t1.Height();
-                    uint32_t t2H = h % t2.Height();
-
-                    for (uint32_t w = 0; w < max(t1.Width(), t2.Width()); ++w)
-                    {
-                        uint32_t t1W = w % t1.Width();
-                        uint32_t t2W = w % t2.Width();
-
-                        output(w, h, d, n) = (alpha * t1(t1W, t1H, t1D, t1N)) / (beta * t2(t2W, t2H, t2D, t2N));
-                    }
-                }
-            }
-        }
+        BroadcastElementwise(t1.Values(), t2.Values(), output.Values(), BroadcastPlan(t1.GetShape(), t2.GetShape(), output.GetShape()), [=](float x, float y) { return (alpha * x) / (beta * y); });
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -776,31 +653,7 @@ namespace Neuro
         t2.CopyToHost();
         output.OverrideHost();
 
-        for (uint32_t n = 0; n < max(t1.Batch(), t2.Batch()); ++n)
-        {
-            uint32_t t1N = n % t1.Batch();
-            uint32_t t2N = n % t2.Batch();
-
-            for (uint32_t d = 0; d < max(t1.Depth(), t2.Depth()); ++d)
-            {
-                uint32_t t1D = d % t1.Depth();
-                uint32_t t2D = d % t2.Depth();
-
-                for (uint32_t h = 0; h < max(t1.Height(), t2.Height()); ++h)
-                {
-                    uint32_t t1H = h % t1.Height();
-                    uint32_t t2H = h % t2.Height();
-
-                    for (uint32_t w = 0; w < max(t1.Width(), t2.Width()); ++w)
-                    {
-                        uint32_t t1W = w % t1.Width();
-                        uint32_t t2W = w % t2.Width();
-
-                        output(w, h, d, n) = func(t1(t1W, t1H, t1D, t1N), t2(t2W, t2H, t2D, t2N));
-                    }
-                }
-            }
-        }
+        BroadcastElementwise(t1.Values(), t2.Values(), output.Values(), BroadcastPlan(t1.GetShape(), t2.GetShape(), output.GetShape()), [&](float x, float y) { return func(x, y); });
 	}
 
     //////////////////////////////////////////////////////////////////////////
@@ -891,13 +744,159 @@ namespace Neuro
 		output.CopyToHost();
 		outputGradient.CopyToHost();
         inputGradient.OverrideHost();
-        inputGradient.Zero();
 
-		Tensor outputReshaped = output.Reshaped(Shape(1, Shape::Auto, 1, output.Batch()));
-		Tensor jacob = outputReshaped.DiagFlat().Sub(outputReshaped.MatMul(outputReshaped.Transpose()));
-        outputGradient.MatMul(jacob, inputGradient);
+        // product with jacobian diag(p) - p*p' is computed without materializing it: p * (grad - dot(p, grad))
+        const uint32_t len = output.BatchLength();
+        auto outputValues = output.Values();
+        auto outputGradientValues = outputGradient.Values();
+        auto inputGradientValues = inputGradient.Values();
+
+        for (uint32_t n = 0; n < output.Batch(); ++n)
+        {
+            const uint32_t offset = n * len;
+
+            float dot = 0;
+            for (uint32_t i = offset; i < offset + len; ++i)
+                dot += outputValues[i] * outputGradientValues[i];
+
+            for (uint32_t i = offset; i < offset + len; ++i)
+                inputGradientValues[i] = outputValues[i] * (outputGradientValues[i] - dot);
+        }
 	}
 
+    //////////////////////////////////////////////////////////////////////////
+    static float LogSumExp(const float* values, uint32_t len, float& maxValue, float& expSum)
+    {
+        maxValue = values[0];
+        for (uint32_t i = 1; i < len; ++i)
+            maxValue = max(maxValue, values[i]);
+
+        expSum = 0;
+        for (uint32_t i = 0; i < len; ++i)
+            expSum += (float)exp(values[i] - maxValue);
+
+        return maxValue + (float)log(expSum);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpu::SoftmaxCrossEntropy(const Tensor& logits, const Tensor& target, Tensor& probabilities, Tensor& loss) const
+    {
+        logits.CopyToHost();
+        target.CopyToHost();
+        probabilities.OverrideHost();
+        loss.OverrideHost();
+
+        const uint32_t len = logits.BatchLength();
+        auto logitsValues = logits.Values();
+        auto targetValues = target.Values();
+        auto probabilitiesValues = probabilities.Values();
+        auto lossValues = loss.Values();
+
+        for (uint32_t n = 0; n < logits.Batch(); ++n)
+        {
+            const uint32_t offset = n * len;
+            float maxValue, expSum;
+            float lse = LogSumExp(logitsValues + offset, len, maxValue, expSum);
+
+            // log(softmax(x)) = x - lse never underflows to log(0)
+            float nll = 0;
+            for (uint32_t i = offset; i < offset + len; ++i)
+            {
+                probabilitiesValues[i] = (float)exp(logitsValues[i] - maxValue) / expSum;
+                nll -= targetValues[i] * (logitsValues[i] - lse);
+            }
+
+            lossValues[n] = nll;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpu::SoftmaxCrossEntropyGradient(const Tensor& logits, const Tensor& probabilities, const Tensor& target, const Tensor& lossGradient, Tensor* logitsGradient, Tensor* targetGradient) const
+    {
+        logits.CopyToHost();
+        probabilities.CopyToHost();
+        target.CopyToHost();
+        lossGradient.CopyToHost();
+
+        const uint32_t len = logits.BatchLength();
+        auto logitsValues = logits.Values();
+        auto probabilitiesValues = probabilities.Values();
+        auto targetValues = target.Values();
+        auto lossGradientValues = lossGradient.Values();
+
+        if (logitsGradient)
+        {
+            logitsGradient->OverrideHost();
+            auto logitsGradientValues = logitsGradient->Values();
+
+            for (uint32_t n = 0; n < logits.Batch(); ++n)
+            {
+                const uint32_t offset = n * len;
+
+                // target doesn't have to sum up to 1
+                float targetSum = 0;
+                for (uint32_t i = offset; i < offset + len; ++i)
+                    targetSum += targetValues[i];
+
+                for (uint32_t i = offset; i < offset + len; ++i)
+                    logitsGradientValues[i] = (probabilitiesValues[i] * targetSum - targetValues[i]) * lossGradientValues[n];
+            }
+        }
+
+        if (targetGradient)
+        {
+            targetGradient->OverrideHost();
+            auto targetGradientValues = targetGradient->Values();
+
+            for (uint32_t n = 0; n < logits.Batch(); ++n)
+            {
+                const uint32_t offset = n * len;
+                float maxValue, expSum;
+                float lse = LogSumExp(logitsValues + offset, len, maxValue, expSum);
+
+                for (uint32_t i = offset; i < offset + len; ++i)
+                    targetGradientValues[i] = (lse - logitsValues[i]) * lossGradientValues[n];
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpu::SigmoidCrossEntropy(const Tensor& logits, const Tensor& target, Tensor& loss) const
+    {
+        // log(1 + exp(-|x|)) never overflows and is equal to -log(sigmoid(x)) - max(-x, 0)
+        logits.Map([&](float x, float t) { return max(x, 0.f) - x * t + (float)log(1 + exp(-::fabs(x))); }, target, loss);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpu::SigmoidCrossEntropyGradient(const Tensor& logits, const Tensor& target, const Tensor& lossGradient, Tensor* logitsGradient, Tensor* targetGradient) const
+    {
+        logits.CopyToHost();
+        target.CopyToHost();
+        lossGradient.CopyToHost();
+
+        auto logitsValues = logits.Values();
+        auto targetValues = target.Values();
+        auto lossGradientValues = lossGradient.Values();
+
+        if (logitsGradient)
+        {
+            logitsGradient->OverrideHost();
+            auto logitsGradientValues = logitsGradient->Values();
+
+            for (uint32_t i = 0; i < logits.Length(); ++i)
+                logitsGradientValues[i] = (1 / (1 + (float)exp(-logitsValues[i])) - targetValues[i]) * lossGradientValues[i];
+        }
+
+        if (targetGradient)
+        {
+            targetGradient->OverrideHost();
+            auto targetGradientValues = targetGradient->Values();
+
+            for (uint32_t i = 0; i < logits.Length(); ++i)
+                targetGradientValues[i] = -logitsValues[i] * lossGradientValues[i];
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void TensorOpCpu::ExtractSubTensor2D(const Tensor& input, uint32_t widthOffset, uint32_t heightOffset, Tensor& output) const
     {
@@ -1054,11 +1053,32 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void TensorOpCpu::Conv2DBiasActivation(const Tensor& input, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, const Tensor& bias, EActivation activation, float activationAlpha, Tensor& output)
     {
-        NEURO_ASSERT(paddingX == paddingY, "");
-        input.Conv2D(kernels, stride, paddingX, NCHW, output);
-        output.Add(bias, output);
-        if (activation != _Identity)
-            output.Activation(activation, activationAlpha, output);
+        input.CopyToHost();
+        kernels.CopyToHost();
+        bias.CopyToHost();
+        output.OverrideHost();
+
+        const int planeLen = (int)(output.Width() * output.Height());
+
+        for (int n = 0; n < (int)input.Batch(); ++n)
+        for (int outD = 0; outD < (int)kernels.Batch(); ++outD)
+        {
+            for (int h = -(int)paddingY, outH = 0; outH < (int)output.Height(); h += (int)stride, ++outH)
+            for (int w = -(int)paddingX, outW = 0; outW < (int)output.Width(); w += (int)stride, ++outW)
+            {
+                float val = 0;
+
+                for (int kernelD = 0; kernelD < (int)kernels.Depth(); ++kernelD)
+                for (int kernelH = 0; kernelH < (int)kernels.Height(); ++kernelH)
+                for (int kernelW = 0; kernelW < (int)kernels.Width(); ++kernelW)
+                    val += input.TryGet(0, w + kernelW, h + kernelH, kernelD, n) * kernels(kernelW, kernelH, kernelD, outD);
+
+                output(outW, outH, outD, n) = val;
+            }
+
+            // output plane is still in cache, so bias and activation don't need separate passes over the whole output
+            CpuKernels::BiasActivation(&output(0, 0, outD, n), planeLen, bias.Values()[outD], activation, activationAlpha);
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,130 @@
+#include "Tensors/TensorOpCpuIm2Col.h"
+#include "Tensors/Cpu/CpuKernels.h"
+
+namespace Neuro
+{
+    struct ConvDims
+    {
+        ConvDims(const Shape& inputShape, const Shape& outputShape, const Shape& kernelsShape, EDataFormat dataFormat)
+        {
+            channels = dataFormat == NCHW ? inputShape.Depth() : inputShape.Len(0);
+            width = dataFormat == NCHW ? inputShape.Width() : inputShape.Len(1);
+            height = dataFormat == NCHW ? inputShape.Height() : inputShape.Len(2);
+            outWidth = dataFormat == NCHW ? outputShape.Width() : outputShape.Len(1);
+            outHeight = dataFormat == NCHW ? outputShape.Height() : outputShape.Len(2);
+            kernelWidth = kernelsShape.Width();
+            kernelHeight = kernelsShape.Height();
+            kernelsNum = kernelsShape.Batch();
+            kernelLen = kernelsShape.Dim0Dim1Dim2;
+            outputLen = outWidth * outHeight;
+        }
+
+        int channels, width, height;
+        int outWidth, outHeight;
+        int kernelWidth, kernelHeight, kernelsNum;
+        int kernelLen, outputLen;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpuIm2Col::Conv2D(const Tensor& input, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, EDataFormat dataFormat, Tensor& output) const
+    {
+        input.CopyToHost();
+        kernels.CopyToHost();
+        output.OverrideHost();
+
+        ConvDims dims(input.GetShape(), output.GetShape(), kernels.GetShape(), dataFormat);
+        Tensor col(Shape(dims.kernelLen * dims.outputLen), "im2col");
+        float* colValues = col.Values();
+
+        for (uint32_t n = 0; n < input.Batch(); ++n)
+        {
+            const float* inputValues = input.Values() + n * input.BatchLength();
+            float* outputValues = output.Values() + n * output.BatchLength();
+
+            CpuKernels::Im2Col(inputValues, dims.channels, dims.height, dims.width, dims.kernelHeight, dims.kernelWidth, (int)stride, (int)paddingX, (int)paddingY, dims.outHeight, dims.outWidth, dataFormat, colValues);
+
+            if (dataFormat == NCHW)
+                CpuKernels::Sgemm(false, false, dims.kernelsNum, dims.outputLen, dims.kernelLen, 1.f, kernels.Values(), dims.kernelLen, colValues, dims.outputLen, 0.f, outputValues, dims.outputLen);
+            else
+                CpuKernels::Sgemm(false, true, dims.outputLen, dims.kernelsNum, dims.kernelLen, 1.f, colValues, dims.kernelLen, kernels.Values(), dims.kernelLen, 0.f, outputValues, dims.kernelsNum);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpuIm2Col::Conv2DBiasActivation(const Tensor& input, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, const Tensor& bias, EActivation activation, float activationAlpha, Tensor& output)
+    {
+        input.CopyToHost();
+        kernels.CopyToHost();
+        bias.CopyToHost();
+        output.OverrideHost();
+
+        ConvDims dims(input.GetShape(), output.GetShape(), kernels.GetShape(), NCHW);
+        Tensor col(Shape(dims.kernelLen * dims.outputLen), "im2col");
+        float* colValues = col.Values();
+
+        // output rows correspond to output channels, so bias is applied per row
+        CpuKernels::Epilogue epilogue = { bias.Values(), activation, activationAlpha };
+
+        for (uint32_t n = 0; n < input.Batch(); ++n)
+        {
+            const float* inputValues = input.Values() + n * input.BatchLength();
+            float* outputValues = output.Values() + n * output.BatchLength();
+
+            CpuKernels::Im2Col(inputValues, dims.channels, dims.height, dims.width, dims.kernelHeight, dims.kernelWidth, (int)stride, (int)paddingX, (int)paddingY, dims.outHeight, dims.outWidth, NCHW, colValues);
+            CpuKernels::Sgemm(false, false, dims.kernelsNum, dims.outputLen, dims.kernelLen, 1.f, kernels.Values(), dims.kernelLen, colValues, dims.outputLen, 0.f, outputValues, dims.outputLen, true, &epilogue);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpuIm2Col::Conv2DInputGradient(const Tensor& gradient, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, EDataFormat dataFormat, Tensor& inputGradient) const
+    {
+        gradient.CopyToHost();
+        kernels.CopyToHost();
+        inputGradient.OverrideHost();
+        inputGradient.Zero();
+
+        ConvDims dims(inputGradient.GetShape(), gradient.GetShape(), kernels.GetShape(), dataFormat);
+        Tensor col(Shape(dims.kernelLen * dims.outputLen), "col2im");
+        float* colValues = col.Values();
+
+        for (uint32_t n = 0; n < gradient.Batch(); ++n)
+        {
+            const float* gradientValues = gradient.Values() + n * gradient.BatchLength();
+            float* inputGradientValues = inputGradient.Values() + n * inputGradient.BatchLength();
+
+            if (dataFormat == NCHW)
+                CpuKernels::Sgemm(true, false, dims.kernelLen, dims.outputLen, dims.kernelsNum, 1.f, kernels.Values(), dims.kernelLen, gradientValues, dims.outputLen, 0.f, colValues, dims.outputLen);
+            else
+                CpuKernels::Sgemm(false, false, dims.outputLen, dims.kernelLen, dims.kernelsNum, 1.f, gradientValues, dims.kernelsNum, kernels.Values(), dims.kernelLen, 0.f, colValues, dims.kernelLen);
+
+            CpuKernels::Col2Im(colValues, dims.channels, dims.height, dims.width, dims.kernelHeight, dims.kernelWidth, (int)stride, (int)paddingX, (int)paddingY, dims.outHeight, dims.outWidth, dataFormat, inputGradientValues);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpuIm2Col::Conv2DKernelsGradient(const Tensor& input, const Tensor& gradient, uint32_t stride, uint32_t paddingX, uint32_t paddingY, EDataFormat dataFormat, Tensor& kernelsGradient) const
+    {
+        input.CopyToHost();
+        gradient.CopyToHost();
+        kernelsGradient.OverrideHost();
+        kernelsGradient.Zero();
+
+        ConvDims dims(input.GetShape(), gradient.GetShape(), kernelsGradient.GetShape(), dataFormat);
+        Tensor col(Shape(dims.kernelLen * dims.outputLen), "im2col");
+        float* colValues = col.Values();
+
+        for (uint32_t n = 0; n < gradient.Batch(); ++n)
+        {
+            const float* inputValues = input.Values() + n * input.BatchLength();
+            const float* gradientValues = gradient.Values() + n * gradient.BatchLength();
+
+            CpuKernels::Im2Col(inputValues, dims.channels, dims.height, dims.width, dims.kernelHeight, dims.kernelWidth, (int)stride, (int)paddingX, (int)paddingY, dims.outHeight, dims.outWidth, dataFormat, colValues);
+
+            // gradients from all samples in batch are accumulated
+            if (dataFormat == NCHW)
+                CpuKernels::Sgemm(false, true, dims.kernelsNum, dims.kernelLen, dims.outputLen, 1.f, gradientValues, dims.outputLen, colValues, dims.outputLen, 1.f, kernelsGradient.Values(), dims.kernelLen);
+            else
+                CpuKernels::Sgemm(true, false, dims.kernelsNum, dims.kernelLen, dims.outputLen, 1.f, gradientValues, dims.kernelsNum, colValues, dims.kernelLen, 1.f, kernelsGradient.Values(), dims.kernelLen);
+        }
+    }
+}
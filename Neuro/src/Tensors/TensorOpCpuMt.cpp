@@ -1,10 +1,15 @@
-﻿#include <ppl.h>
+﻿#include <algorithm>
 
+#include "ThreadPool.h"
 #include "Tensors/TensorOpCpuMt.h"
+#include "Tensors/Cpu/BroadcastPlan.h"
+#include "Tensors/Cpu/CpuKernels.h"
 
 namespace Neuro
 {
-    using namespace concurrency;
+    using namespace std;
+
+    uint32_t TensorOpCpuMt::s_GrainSize = 4096;
 
     //////////////////////////////////////////////////////////////////////////
     void TensorOpCpuMt::Add(float alpha, const Tensor& t1, float beta, const Tensor& t2, Tensor& output) const
@@ -13,57 +18,67 @@ namespace Neuro
         t2.CopyToHost();
         output.OverrideHost();
 
-        parallel_for((uint32_t)0, max(t1.Batch(), t2.Batch()), [&](uint32_t n)
-        {
-            uint32_t t1N = n % t1.Batch();
-            uint32_t t2N = n % t2.Batch();
-
-            parallel_for((uint32_t)0, max(t1.Depth(), t2.Depth()), [&](uint32_t d)
-            {
-                uint32_t t1D = d % t1.Depth();
-                uint32_t t2D = d % t2.Depth();
-
-                parallel_for((uint32_t)0, max(t1.Height(), t2.Height()), [&](uint32_t h)
-                {
-                    uint32_t t1H = h % t1.Height();
-                    uint32_t t2H = h % t2.Height();
-
-                    parallel_for((uint32_t)0, max(t1.Width(), t2.Width()), [&](uint32_t w)
-                    {
-                        uint32_t t1W = w % t1.Width();
-                        uint32_t t2W = w % t2.Width();
+        auto t1Values = t1.Values();
+        auto t2Values = t2.Values();
+        auto outputValues = output.Values();
 
-                        output(w, h, d, n) = alpha * t1(t1W, t1H, t1D, t1N) + beta * t2(t2W, t2H, t2D, t2N);
-                    });
-                });
-            });
+        BroadcastPlan plan(t1.GetShape(), t2.GetShape(), output.GetShape());
+        ThreadPool::Default().ParallelFor(0, plan.TasksNum, max(1u, s_GrainSize / plan.ChunkLen), [&](uint32_t begin, uint32_t end)
+        {
+            BroadcastElementwise(t1Values, t2Values, outputValues, plan, begin, end, [=](float x, float y) { return alpha * x + beta * y; });
         });
     }
 
     //////////////////////////////////////////////////////////////////////////
     void TensorOpCpuMt::MatMul(const Tensor& t1, bool transposeT1, const Tensor& t2, bool transposeT2, Tensor& output) const
     {
-        NEURO_ASSERT(!transposeT1, "");
-        NEURO_ASSERT(!transposeT2, "");
-
         t1.CopyToHost();
         t2.CopyToHost();
         output.OverrideHost();
-        output.Zero();
 
-        parallel_for((uint32_t)0, output.Batch(), [&](uint32_t n)
-        {
-            uint32_t t1N = min(n, t1.Batch() - 1);
-            uint32_t t2N = min(n, t2.Batch() - 1);
+        int m = transposeT1 ? t1.Width() : t1.Height();
+        int n = transposeT2 ? t2.Height() : t2.Width();
+        int k = transposeT1 ? t1.Height() : t1.Width();
+        uint32_t matricesNum = output.Batch() * t1.Depth();
 
-            parallel_for((uint32_t)0, t1.Depth(), [&](uint32_t d)
+        auto multiplyMatrix = [&](uint32_t i, bool allowThreads)
+        {
+            uint32_t b = i / t1.Depth();
+            uint32_t d = i % t1.Depth();
+            uint32_t t1B = min(b, t1.Batch() - 1);
+            uint32_t t2B = min(b, t2.Batch() - 1);
+
+            CpuKernels::Sgemm(
+                transposeT1,
+                transposeT2,
+                m,
+                n,
+                k,
+                1.f,
+                t1.Values() + d * t1.GetShape().Dim0Dim1 + t1B * t1.BatchLength(),
+                t1.Width(),
+                t2.Values() + d * t2.GetShape().Dim0Dim1 + t2B * t2.BatchLength(),
+                t2.Width(),
+                0.f,
+                output.Values() + d * output.GetShape().Dim0Dim1 + b * output.BatchLength(),
+                output.Width(),
+                allowThreads);
+        };
+
+        // with enough matrices every thread gets whole matrices to multiply, otherwise let Sgemm split single matrix across threads
+        if (matricesNum >= ThreadPool::Default().ThreadsNum())
+        {
+            ThreadPool::Default().ParallelFor(0, matricesNum, 1, [&](uint32_t begin, uint32_t end)
             {
-                for (uint32_t h = 0; h < t1.Height(); ++h)
-                for (uint32_t w = 0; w < t2.Width(); ++w)
-                for (uint32_t i = 0; i < t1.Width(); ++i)
-                    output(w, h, d, n) += t1.Get(i, h, d, t1N) * t2.Get(w, i, d, t2N);
+                for (uint32_t i = begin; i < end; ++i)
+                    multiplyMatrix(i, false);
             });
-        });
+        }
+        else
+        {
+            for (uint32_t i = 0; i < matricesNum; ++i)
+                multiplyMatrix(i, true);
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -71,32 +86,16 @@ namespace Neuro
     {
         t1.CopyToHost();
         t2.CopyToHost();
-        output.OverrideHost();        
-
-        parallel_for((uint32_t)0, max(t1.Batch(), t2.Batch()), [&](uint32_t n)
-        {
-            uint32_t t1N = n % t1.Batch();
-            uint32_t t2N = n % t2.Batch();
-
-            parallel_for((uint32_t)0, max(t1.Depth(), t2.Depth()), [&](uint32_t d)
-            {
-                uint32_t t1D = d % t1.Depth();
-                uint32_t t2D = d % t2.Depth();
-
-                parallel_for((uint32_t)0, max(t1.Height(), t2.Height()), [&](uint32_t h)
-                {
-                    uint32_t t1H = h % t1.Height();
-                    uint32_t t2H = h % t2.Height();
+        output.OverrideHost();
 
-                    parallel_for((uint32_t)0, max(t1.Width(), t2.Width()), [&](uint32_t w)
-                    {
-                        uint32_t t1W = w % t1.Width();
-                        uint32_t t2W = w % t2.Width();
+        auto t1Values = t1.Values();
+        auto t2Values = t2.Values();
+        auto outputValues = output.Values();
 
-                        output(w, h, d, n) = alpha * t1(t1W, t1H, t1D, t1N) * beta * t2(t2W, t2H, t2D, t2N);
-                    });
-                });
-            });
+        BroadcastPlan plan(t1.GetShape(), t2.GetShape(), output.GetShape());
+        ThreadPool::Default().ParallelFor(0, plan.TasksNum, max(1u, s_GrainSize / plan.ChunkLen), [&](uint32_t begin, uint32_t end)
+        {
+            BroadcastElementwise(t1Values, t2Values, outputValues, plan, begin, end, [=](float x, float y) { return alpha * x * beta * y; });
         });
     }
 
@@ -109,49 +108,84 @@ namespace Neuro
         auto inputValues = input.Values();
         auto outputValues = output.Values();
 
-        parallel_for((uint32_t)0, input.Length(), [&](uint32_t i)
+        ThreadPool::Default().ParallelFor(0, input.Length(), s_GrainSize, [&](uint32_t begin, uint32_t end)
         {
-            outputValues[i] = inputValues[i] / v;
+            for (uint32_t i = begin; i < end; ++i)
+                outputValues[i] = inputValues[i] / v;
         });
     }
 
     //////////////////////////////////////////////////////////////////////////
     void TensorOpCpuMt::Sum(const Tensor& input, EAxis axis, Tensor& output) const
     {
-        return __super::Sum(input, axis, output);
-        //output.Zero();
-        //input.CopyToHost();
-        //output.OverrideHost();
-        //output.Zero();
-
-        //auto& inputValues = input.GetValues();
-        //auto& outputValues = output.GetValues();
-
-        //if (axis == EAxis::Sample)
-        //{
-        //    uint32_t batchMin = batch < 0 ? 0 : batch;
-        //    uint32_t batchMax = batch < 0 ? input.Batch() : (batch + 1);
-        //    uint32_t batchLen = input.BatchLength();
-
-        //    parallel_for(batchMin, batchMax, [&](uint32_t n) {
-        //    for (uint32_t i = 0, idx = n * batchLen; i < batchLen; ++i, ++idx)
-        //        outputValues[n - batchMin] += inputValues[idx];
-        //    });
-        //}
-        //else if (axis == EAxis::Batch)
-        //{
-        //    uint32_t batchLen = input.BatchLength();
-
-        //    parallel_for((uint32_t)0, input.BatchLength(), [&](uint32_t f) {
-        //    for (uint32_t n = 0; n < input.Batch(); ++n)
-        //        outputValues[f] += inputValues[f + n * input.BatchLength()];
-        //    });
-        //}
-        //else //if (axis == EAxis::Global)
-        //{
-        //    for (uint32_t i = 0; i < input.Length(); ++i)
-        //        outputValues[0] += inputValues[i];
-        //}
+        input.CopyToHost();
+        output.OverrideHost();
+
+        auto inputValues = input.Values();
+        auto outputValues = output.Values();
+        auto& pool = ThreadPool::Default();
+
+        if (axis == GlobalAxis)
+        {
+            // every chunk produces partial sum, those are added up at the end
+            uint32_t chunksNum = min(pool.ThreadsNum() * 4, max(1u, input.Length() / s_GrainSize));
+            uint32_t chunkLen = (input.Length() + chunksNum - 1) / chunksNum;
+            vector<float> partialSums(chunksNum, 0.f);
+
+            pool.ParallelFor(0, chunksNum, 1, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t chunk = begin; chunk < end; ++chunk)
+                {
+                    float sum = 0;
+                    for (uint32_t i = chunk * chunkLen; i < min(input.Length(), (chunk + 1) * chunkLen); ++i)
+                        sum += inputValues[i];
+                    partialSums[chunk] = sum;
+                }
+            });
+
+            float sum = 0;
+            for (float partialSum : partialSums)
+                sum += partialSum;
+            outputValues[0] = sum;
+            return;
+        }
+
+        // every output element is produced by a single thread, so there is no need for synchronization
+        bool reduceW = axis == WidthAxis || axis == _01Axes || axis == _012Axes || axis == _013Axes;
+        bool reduceH = axis == HeightAxis || axis == _01Axes || axis == _012Axes || axis == _013Axes || axis == _123Axes;
+        bool reduceD = axis == DepthAxis || axis == _012Axes || axis == _123Axes;
+        bool reduceN = axis == BatchAxis || axis == _013Axes || axis == _123Axes;
+        uint32_t reducedLen = input.Length() / output.Length();
+        auto& inputShape = input.GetShape();
+        auto& outputShape = output.GetShape();
+
+        pool.ParallelFor(0, output.Length(), max(1u, s_GrainSize / reducedLen), [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                uint32_t outW = i % outputShape.Width();
+                uint32_t outH = (i / outputShape.Dim0) % outputShape.Height();
+                uint32_t outD = (i / outputShape.Dim0Dim1) % outputShape.Depth();
+                uint32_t outN = i / outputShape.Dim0Dim1Dim2;
+
+                float sum = 0;
+                for (uint32_t n = reduceN ? 0 : outN; n < (reduceN ? inputShape.Batch() : outN + 1); ++n)
+                for (uint32_t d = reduceD ? 0 : outD; d < (reduceD ? inputShape.Depth() : outD + 1); ++d)
+                for (uint32_t h = reduceH ? 0 : outH; h < (reduceH ? inputShape.Height() : outH + 1); ++h)
+                {
+                    const float* row = inputValues + inputShape.GetIndex(0u, h, d, n);
+                    if (reduceW)
+                    {
+                        for (uint32_t w = 0; w < inputShape.Width(); ++w)
+                            sum += row[w];
+                    }
+                    else
+                        sum += row[outW];
+                }
+
+                outputValues[i] = sum;
+            }
+        });
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -160,12 +194,29 @@ namespace Neuro
         input.CopyToHost();
         output.OverrideHost();
 
-        parallel_for((uint32_t)0, input.Batch(), [&](uint32_t n) {
-        parallel_for((uint32_t)0, input.Depth(), [&](uint32_t d) {
-        for (uint32_t h = 0; h < input.Height(); ++h)
-        for (uint32_t w = 0; w < input.Width(); ++w)
-            output(h, w, d, n) = input(w, h, d, n);
-        });
+        // transposition is done in square tiles so that both reads and writes stay within cache
+        const uint32_t TILE = 32;
+        uint32_t width = input.Width(), height = input.Height();
+        uint32_t tilesW = (width + TILE - 1) / TILE;
+        uint32_t tilesH = (height + TILE - 1) / TILE;
+        uint32_t matricesNum = input.Batch() * input.Depth();
+        auto inputValues = input.Values();
+        auto outputValues = output.Values();
+
+        ThreadPool::Default().ParallelFor(0, matricesNum * tilesH * tilesW, max(1u, s_GrainSize / (TILE * TILE)), [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t tile = begin; tile < end; ++tile)
+            {
+                uint32_t matrix = tile / (tilesH * tilesW);
+                uint32_t h0 = ((tile / tilesW) % tilesH) * TILE;
+                uint32_t w0 = (tile % tilesW) * TILE;
+                const float* src = inputValues + (size_t)matrix * width * height;
+                float* dst = outputValues + (size_t)matrix * width * height;
+
+                for (uint32_t h = h0; h < min(h0 + TILE, height); ++h)
+                for (uint32_t w = w0; w < min(w0 + TILE, width); ++w)
+                    dst[w * height + h] = src[h * width + w];
+            }
         });
     }
 
@@ -178,8 +229,9 @@ namespace Neuro
 
         if (dataFormat == NCHW)
         {
-		    parallel_for(0, (int)input.Batch(), [&](int n) {
-            parallel_for(0, (int)kernels.Batch(), [&](int outD) {
+		    ThreadPool::Default().ParallelFor(0, input.Batch() * kernels.Batch(), 1, [&](uint32_t begin, uint32_t end) {
+            for (int i = (int)begin; i < (int)end; ++i) {
+            int n = i / (int)kernels.Batch(), outD = i % (int)kernels.Batch();
 		    for (int h = -(int)paddingY, outH = 0; outH < (int)output.Height(); h += (int)stride, ++outH)
 		    for (int w = -(int)paddingX, outW = 0; outW < (int)output.Width(); w += (int)stride, ++outW)
 		    {
@@ -192,13 +244,13 @@ namespace Neuro
 
 			    output(outW, outH, outD, n) = val;
 		    }
-            });
-            });
+            }});
         }
         else
         {
-            parallel_for(0, (int)input.Batch(), [&](int n) {
-            parallel_for(0, (int)kernels.Batch(), [&](int outD) {
+            ThreadPool::Default().ParallelFor(0, input.Batch() * kernels.Batch(), 1, [&](uint32_t begin, uint32_t end) {
+            for (int i = (int)begin; i < (int)end; ++i) {
+            int n = i / (int)kernels.Batch(), outD = i % (int)kernels.Batch();
             for (int h = -(int)paddingY, outH = 0; outH < (int)output.Len(2); h += (int)stride, ++outH)
 		    for (int w = -(int)paddingX, outW = 0; outW < (int)output.Len(1); w += (int)stride, ++outW)
 		    {
@@ -211,11 +263,41 @@ namespace Neuro
 
 			    output(outD, outW, outH, n) = val;
 		    }
-            });
-            });
+            }});
         }
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void TensorOpCpuMt::Conv2DBiasActivation(const Tensor& input, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, const Tensor& bias, EActivation activation, float activationAlpha, Tensor& output)
+    {
+        input.CopyToHost();
+        kernels.CopyToHost();
+        bias.CopyToHost();
+        output.OverrideHost();
+
+        const int planeLen = (int)(output.Width() * output.Height());
+
+        ThreadPool::Default().ParallelFor(0, input.Batch() * kernels.Batch(), 1, [&](uint32_t begin, uint32_t end) {
+        for (int i = (int)begin; i < (int)end; ++i)
+        {
+            int n = i / (int)kernels.Batch(), outD = i % (int)kernels.Batch();
+            for (int h = -(int)paddingY, outH = 0; outH < (int)output.Height(); h += (int)stride, ++outH)
+            for (int w = -(int)paddingX, outW = 0; outW < (int)output.Width(); w += (int)stride, ++outW)
+            {
+                float val = 0;
+
+                for (int kernelD = 0; kernelD < (int)kernels.Depth(); ++kernelD)
+                for (int kernelH = 0; kernelH < (int)kernels.Height(); ++kernelH)
+                for (int kernelW = 0; kernelW < (int)kernels.Width(); ++kernelW)
+                    val += input.TryGet(0, w + kernelW, h + kernelH, kernelD, n) * kernels(kernelW, kernelH, kernelD, outD);
+
+                output(outW, outH, outD, n) = val;
+            }
+
+            CpuKernels::BiasActivation(&output(0, 0, outD, n), planeLen, bias.Values()[outD], activation, activationAlpha);
+        }});
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void TensorOpCpuMt::Conv2DInputGradient(const Tensor& gradient, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, EDataFormat dataFormat, Tensor& inputGradient) const
     {
@@ -226,7 +308,8 @@ namespace Neuro
 
         if (dataFormat == NCHW)
         {
-            parallel_for(0, (int)gradient.Batch(), [&](int outN) {
+            ThreadPool::Default().ParallelFor(0, gradient.Batch(), 1, [&](uint32_t begin, uint32_t end) {
+            for (int outN = (int)begin; outN < (int)end; ++outN)
             for (int outD = 0; outD < (int)gradient.Depth(); ++outD)
             for (int outH = 0, h = -(int)paddingY; outH < (int)gradient.Height(); h += (int)stride, ++outH)
             for (int outW = 0, w = -(int)paddingX; outW < (int)gradient.Width(); w += (int)stride, ++outW)
@@ -250,7 +333,8 @@ namespace Neuro
         }
         else
         {
-            parallel_for(0, (int)gradient.Batch(), [&](int outN) {
+            ThreadPool::Default().ParallelFor(0, gradient.Batch(), 1, [&](uint32_t begin, uint32_t end) {
+            for (int outN = (int)begin; outN < (int)end; ++outN)
             for (int outD = 0; outD < (int)gradient.Len(0); ++outD)
             for (int outH = 0, h = -(int)paddingY; outH < (int)gradient.Len(2); h += (int)stride, ++outH)
             for (int outW = 0, w = -(int)paddingX; outW < (int)gradient.Len(1); w += (int)stride, ++outW)
@@ -284,7 +368,8 @@ namespace Neuro
 
         if (dataFormat == NCHW)
         {
-            parallel_for(0, (int)gradient.Depth(), [&](int outD) {
+            ThreadPool::Default().ParallelFor(0, gradient.Depth(), 1, [&](uint32_t begin, uint32_t end) {
+            for (int outD = (int)begin; outD < (int)end; ++outD)
             for (int outN = 0; outN < (int)gradient.Batch(); ++outN)
             for (int outH = 0, h = -(int)paddingY; outH < (int)gradient.Height(); h += (int)stride, ++outH)
             for (int outW = 0, w = -(int)paddingX; outW < (int)gradient.Width(); w += (int)stride, ++outW)
@@ -308,7 +393,8 @@ namespace Neuro
         }
         else
         {
-            parallel_for(0, (int)gradient.Len(0), [&](int outD) {
+            ThreadPool::Default().ParallelFor(0, gradient.Len(0), 1, [&](uint32_t begin, uint32_t end) {
+            for (int outD = (int)begin; outD < (int)end; ++outD)
             for (int outN = 0; outN < (int)gradient.Batch(); ++outN)
             for (int outH = 0, h = -(int)paddingY; outH < (int)gradient.Len(2); h += (int)stride, ++outH)
             for (int outW = 0, w = -(int)paddingX; outW < (int)gradient.Len(1); w += (int)stride, ++outW)
@@ -340,8 +426,9 @@ namespace Neuro
 
         if (dataFormat == NCHW)
         {
-            parallel_for(0, (int)input.Batch(), [&](int outN) {
-            parallel_for(0, (int)input.Depth(), [&](int outD) {
+            ThreadPool::Default().ParallelFor(0, input.Batch() * input.Depth(), 1, [&](uint32_t begin, uint32_t end) {
+            for (int i = (int)begin; i < (int)end; ++i) {
+            int outN = i / (int)input.Depth(), outD = i % (int)input.Depth();
 		    for (int outH = 0, h = -(int)paddingY; outH < (int)output.Height(); h += (int)stride, ++outH)
 		    for (int outW = 0, w = -(int)paddingX; outW < (int)output.Width(); w += (int)stride, ++outW)
 		    {
@@ -365,13 +452,13 @@ namespace Neuro
 				    output(outW, outH, outD, outN) = sum / (filterSize * filterSize);
 			    }
 		    }
-            });
-            });
+            }});
         }
         else
         {
-            parallel_for(0, (int)input.Batch(), [&](int outN) {
-            parallel_for(0, (int)input.Len(0), [&](int outD) {
+            ThreadPool::Default().ParallelFor(0, input.Batch() * input.Len(0), 1, [&](uint32_t begin, uint32_t end) {
+            for (int i = (int)begin; i < (int)end; ++i) {
+            int outN = i / (int)input.Len(0), outD = i % (int)input.Len(0);
             for (int outH = 0, h = -(int)paddingY; outH < (int)output.Len(2); h += (int)stride, ++outH)
 		    for (int outW = 0, w = -(int)paddingX; outW < (int)output.Len(1); w += (int)stride, ++outW)
 		    {
@@ -395,8 +482,7 @@ namespace Neuro
 				    output(outD, outW, outH, outN) = sum / (filterSize * filterSize);
 			    }
 		    }
-            });
-            });
+            }});
         }
     }
 
@@ -411,8 +497,9 @@ namespace Neuro
 
         if (dataFormat == NCHW)
         {
-            parallel_for(0, (int)output.Batch(), [&](int outN) {
-            parallel_for(0, (int)output.Depth(), [&](int outD) {
+            ThreadPool::Default().ParallelFor(0, output.Batch() * output.Depth(), 1, [&](uint32_t begin, uint32_t end) {
+            for (int i = (int)begin; i < (int)end; ++i) {
+            int outN = i / (int)output.Depth(), outD = i % (int)output.Depth();
 		    for (int outH = 0, h = -(int)paddingY; outH < (int)output.Height(); ++outH, h += (int)stride)
 		    for (int outW = 0, w = -(int)paddingX; outW < (int)output.Width(); ++outW, w += (int)stride)
 		    {
@@ -447,13 +534,13 @@ namespace Neuro
 				    }
 			    }
 		    }
-            });
-            });
+            }});
         }
         else
         {
-            parallel_for(0, (int)output.Batch(), [&](int outN) {
-            parallel_for(0, (int)output.Len(0), [&](int outD) {
+            ThreadPool::Default().ParallelFor(0, output.Batch() * output.Len(0), 1, [&](uint32_t begin, uint32_t end) {
+            for (int i = (int)begin; i < (int)end; ++i) {
+            int outN = i / (int)output.Len(0), outD = i % (int)output.Len(0);
 		    for (int outH = 0, h = -(int)paddingY; outH < (int)output.Len(2); ++outH, h += (int)stride)
 		    for (int outW = 0, w = -(int)paddingX; outW < (int)output.Len(1); ++outW, w += (int)stride)
 		    {
@@ -488,28 +575,30 @@ namespace Neuro
 				    }
 			    }
             }
-            });
-            });
+            }});
         }
     }
 
     //////////////////////////////////////////////////////////////////////////
     void TensorOpCpuMt::UpSample2D(const Tensor& t, uint32_t scaleFactor, Tensor& output) const
     {
-        output.CopyToHost();
+        t.CopyToHost();
         output.OverrideHost();
 
-        parallel_for((uint32_t)0, t.Batch(), [&](uint32_t n) {
-        parallel_for((uint32_t)0, t.Depth(), [&](uint32_t d) {
-        for (uint32_t h = 0; h < t.Height(); ++h)
-        for (uint32_t w = 0; w < t.Width(); ++w)
+        uint32_t planeLen = t.Width() * t.Height() * scaleFactor * scaleFactor;
+        ThreadPool::Default().ParallelFor(0, t.Batch() * t.Depth(), max(1u, s_GrainSize / planeLen), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
         {
-            for (uint32_t outH = h * scaleFactor; outH < (h + 1) * scaleFactor; ++outH)
-            for (uint32_t outW = w * scaleFactor; outW < (w + 1) * scaleFactor; ++outW)
-                output(outW, outH, d, n) = t(w, h, d, n);
-        }
-        });
-        });
+            uint32_t n = i / t.Depth(), d = i % t.Depth();
+
+            for (uint32_t h = 0; h < t.Height(); ++h)
+            for (uint32_t w = 0; w < t.Width(); ++w)
+            {
+                for (uint32_t outH = h * scaleFactor; outH < (h + 1) * scaleFactor; ++outH)
+                for (uint32_t outW = w * scaleFactor; outW < (w + 1) * scaleFactor; ++outW)
+                    output(outW, outH, d, n) = t(w, h, d, n);
+            }
+        }});
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -519,13 +608,16 @@ namespace Neuro
         inputGradient.OverrideHost();
         inputGradient.Zero();
 
-        parallel_for((uint32_t)0, outputGradient.Batch(), [&](uint32_t n) {
-        parallel_for((uint32_t)0, outputGradient.Depth(), [&](uint32_t d) {
-        for (uint32_t h = 0; h < outputGradient.Height(); ++h)
-        for (uint32_t w = 0; w < outputGradient.Width(); ++w)
-            inputGradient(w / scaleFactor, h / scaleFactor, d, n) += outputGradient(w, h, d, n);
-        });
-        });
+        uint32_t planeLen = outputGradient.Width() * outputGradient.Height();
+        ThreadPool::Default().ParallelFor(0, outputGradient.Batch() * outputGradient.Depth(), max(1u, s_GrainSize / planeLen), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            uint32_t n = i / outputGradient.Depth(), d = i % outputGradient.Depth();
+
+            for (uint32_t h = 0; h < outputGradient.Height(); ++h)
+            for (uint32_t w = 0; w < outputGradient.Width(); ++w)
+                inputGradient(w / scaleFactor, h / scaleFactor, d, n) += outputGradient(w, h, d, n);
+        }});
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -537,9 +629,10 @@ namespace Neuro
         auto inputValues = input.Values();
         auto outputValues = output.Values();
 
-        parallel_for(0, (int)input.Length(), [&](int i)
+        ThreadPool::Default().ParallelFor(0, input.Length(), s_GrainSize, [&](uint32_t begin, uint32_t end)
         {
-            outputValues[i] = func(inputValues[i]);
+            for (uint32_t i = begin; i < end; ++i)
+                outputValues[i] = func(inputValues[i]);
         });
     }
 
@@ -550,30 +643,14 @@ namespace Neuro
         t2.CopyToHost();
         output.OverrideHost();
 
-        parallel_for((uint32_t)0, max(t1.Batch(), t2.Batch()), [&](uint32_t n)
-        {
-            uint32_t t1N = n % t1.Batch();
-            uint32_t t2N = n % t2.Batch();
-
-            parallel_for((uint32_t)0, max(t1.Depth(), t2.Depth()), [&](uint32_t d)
-            {
-                uint32_t t1D = d % t1.Depth();
-                uint32_t t2D = d % t2.Depth();
-
-                parallel_for((uint32_t)0, max(t1.Height(), t2.Height()), [&](uint32_t h)
-                {
-                    uint32_t t1H = h % t1.Height();
-                    uint32_t t2H = h % t2.Height();
-
-                    parallel_for((uint32_t)0, max(t1.Width(), t2.Width()), [&](uint32_t w)
-                    {
-                        uint32_t t1W = w % t1.Width();
-                        uint32_t t2W = w % t2.Width();
+        auto t1Values = t1.Values();
+        auto t2Values = t2.Values();
+        auto outputValues = output.Values();
 
-                        output(w, h, d, n) = func(t1(t1W, t1H, t1D, t1N), t2(t2W, t2H, t2D, t2N));
-                    });
-                });
-            });
+        BroadcastPlan plan(t1.GetShape(), t2.GetShape(), output.GetShape());
+        ThreadPool::Default().ParallelFor(0, plan.TasksNum, max(1u, s_GrainSize / plan.ChunkLen), [&](uint32_t begin, uint32_t end)
+        {
+            BroadcastElementwise(t1Values, t2Values, outputValues, plan, begin, end, [&](float x, float y) { return func(x, y); });
         });
     }
 }
@@ -674,6 +674,17 @@ namespace Neuro
     void TensorOpGpu::Conv2DBiasActivation(const Tensor& input, const Tensor& kernels, uint32_t stride, uint32_t paddingX, uint32_t paddingY, const Tensor& bias, EActivation activation, float activationAlpha, Tensor& output)
     {
         NVTXProfile nvtxProfile(__FUNCTION__, 0xFF004A7F);
+
+        // cuDNN fused convolution supports only ReLU activation
+        if (activation != _ReLU)
+        {
+            Conv2D(input, kernels, stride, paddingX, paddingY, NCHW, output);
+            output.Add(bias, output);
+            if (activation != _Identity)
+                output.Activation(activation, activationAlpha, output);
+            return;
+        }
+
         input.CopyToDevice();
         kernels.CopyToDevice();
         bias.CopyToDevice();
@@ -0,0 +1,220 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+namespace Neuro
+{
+    // queue owned by current thread, external threads don't own any queue
+    static thread_local ThreadPool* t_OwnerPool = nullptr;
+    static thread_local uint32_t t_QueueIdx = 0;
+
+    //////////////////////////////////////////////////////////////////////////
+    ThreadPool::ThreadPool(uint32_t threadsNum)
+        : m_QueuedChunks(0), m_NextQueue(0)
+    {
+        if (threadsNum == 0)
+            threadsNum = max(1u, thread::hardware_concurrency());
+
+        // last queue is shared by all external threads calling ParallelFor
+        for (uint32_t i = 0; i < threadsNum; ++i)
+            m_Queues.push_back(make_unique<WorkQueue>());
+
+        for (uint32_t i = 0; i < threadsNum - 1; ++i)
+            m_Workers.push_back(thread(&ThreadPool::WorkerLoop, this, i));
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    ThreadPool::~ThreadPool()
+    {
+        {
+            unique_lock<mutex> lock(m_WakeLock);
+            m_Stop = true;
+        }
+        m_WakeCondition.notify_all();
+
+        for (auto& worker : m_Workers)
+            worker.join();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    ThreadPool& ThreadPool::Default()
+    {
+        // intentionally never destroyed, joining threads while unloading dll can deadlock
+        static ThreadPool* pool = new ThreadPool();
+        return *pool;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ThreadPool::ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const function<void(uint32_t, uint32_t)>& body)
+    {
+        if (end <= begin)
+            return;
+
+        uint32_t len = end - begin;
+        grainSize = max(1u, grainSize);
+        // a few chunks per thread give stealing something to balance uneven chunks with
+        uint32_t chunksNum = min((len + grainSize - 1) / grainSize, ThreadsNum() * 4);
+
+        if (chunksNum <= 1 || m_Workers.empty())
+        {
+            body(begin, end);
+            return;
+        }
+
+        uint32_t chunkLen = (len + chunksNum - 1) / chunksNum;
+        chunksNum = (len + chunkLen - 1) / chunkLen;
+
+        Job job;
+        job.body = &body;
+        job.pendingChunks = chunksNum;
+
+        {
+            // counter has to be increased before chunks are pushed, otherwise worker popping a chunk could decrease it below zero;
+            // taking the lock guarantees no worker misses the notification between checking counter and going to sleep
+            lock_guard<mutex> lock(m_WakeLock);
+            m_QueuedChunks += chunksNum;
+        }
+
+        // distribute chunks evenly across all queues so workers can start without stealing
+        uint32_t queuesNum = (uint32_t)m_Queues.size();
+        uint32_t firstQueue = m_NextQueue.fetch_add(1) % queuesNum;
+        for (uint32_t i = 0; i < chunksNum; ++i)
+            Push((firstQueue + i) % queuesNum, { &job, begin + i * chunkLen, min(end, begin + (i + 1) * chunkLen) });
+
+        m_WakeCondition.notify_all();
+
+        // job lives on this stack frame so it can't be left before all of its chunks are processed, even when some of them failed
+        uint32_t queueIdx = CurrentQueue();
+        while (job.pendingChunks.load() > 0)
+        {
+            if (!TryRunChunk(queueIdx))
+                this_thread::yield();
+        }
+
+        if (job.error)
+            rethrow_exception(job.error);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ThreadPool::Enqueue(const function<void()>& task)
+    {
+        Job* job = new Job();
+        job->ownedBody = [task](uint32_t, uint32_t) { task(); };
+        job->body = &job->ownedBody;
+        job->owned = true;
+
+        if (m_Workers.empty())
+        {
+            task();
+            delete job;
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(m_WakeLock);
+            ++m_QueuedChunks;
+        }
+
+        Push(CurrentQueue(), { job, 0, 1 });
+        m_WakeCondition.notify_one();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ThreadPool::RunPendingTask()
+    {
+        return TryRunChunk(CurrentQueue());
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ThreadPool::Push(uint32_t queueIdx, const Chunk& chunk)
+    {
+        auto& queue = *m_Queues[queueIdx];
+        lock_guard<mutex> lock(queue.lock);
+        queue.chunks.push_back(chunk);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    uint32_t ThreadPool::CurrentQueue() const
+    {
+        return t_OwnerPool == this ? t_QueueIdx : (uint32_t)m_Queues.size() - 1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ThreadPool::WorkerLoop(uint32_t queueIdx)
+    {
+        t_OwnerPool = this;
+        t_QueueIdx = queueIdx;
+
+        while (true)
+        {
+            if (TryRunChunk(queueIdx))
+                continue;
+
+            unique_lock<mutex> lock(m_WakeLock);
+            m_WakeCondition.wait(lock, [&]() { return m_Stop || m_QueuedChunks.load() > 0; });
+            if (m_Stop)
+                return;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ThreadPool::TryRunChunk(uint32_t queueIdx)
+    {
+        Chunk chunk;
+        if (!TryPop(queueIdx, false, chunk))
+        {
+            bool stolen = false;
+            for (uint32_t i = 1; i < (uint32_t)m_Queues.size() && !stolen; ++i)
+                stolen = TryPop((queueIdx + i) % (uint32_t)m_Queues.size(), true, chunk);
+
+            if (!stolen)
+                return false;
+        }
+
+        --m_QueuedChunks;
+
+        if (chunk.job->owned)
+        {
+            // there is nobody to rethrow to, enqueued tasks are required to handle their own errors
+            unique_ptr<Job> job(chunk.job);
+            (*job->body)(chunk.begin, chunk.end);
+            return true;
+        }
+
+        // exception is rethrown by thread which called ParallelFor once all chunks are done
+        try
+        {
+            (*chunk.job->body)(chunk.begin, chunk.end);
+        }
+        catch (...)
+        {
+            lock_guard<mutex> lock(chunk.job->errorLock);
+            if (!chunk.job->error)
+                chunk.job->error = current_exception();
+        }
+
+        --chunk.job->pendingChunks;
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    bool ThreadPool::TryPop(uint32_t queueIdx, bool steal, Chunk& chunk)
+    {
+        auto& queue = *m_Queues[queueIdx];
+        lock_guard<mutex> lock(queue.lock);
+        if (queue.chunks.empty())
+            return false;
+
+        if (steal)
+        {
+            chunk = queue.chunks.back();
+            queue.chunks.pop_back();
+        }
+        else
+        {
+            chunk = queue.chunks.front();
+            queue.chunks.pop_front();
+        }
+        return true;
+    }
+}
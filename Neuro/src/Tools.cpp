@@ -6,14 +6,22 @@
 #include <sstream>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <climits>
+#include <cstring>
+#include <unordered_map>
 #include <stdarg.h>
 #include <experimental/filesystem>
 #include <FreeImage.h>
 #include <nvToolsExt.h>
 
 #include "Tools.h"
+#include "CSVLoader.h"
 #include "Tensors/Tensor.h"
+#include "Tensors/CompactTensor.h"
 #include "ComputationalGraph/Variable.h"
+#include "ThreadPool.h"
+#include "Tensors/Cpu/CpuKernels.h"
 
 namespace fs = std::experimental::filesystem;
 
@@ -69,13 +77,8 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     static void ImageLibInit()
     {
-        static bool imgLibInitialized = false;
-
-        if (!imgLibInitialized)
-        {
-            FreeImage_Initialise();
-            imgLibInitialized = true;
-        }
+        // images can be loaded from multiple preloader threads at once, initialization of function-local static is thread-safe
+        static bool imgLibInitialized = (FreeImage_Initialise(), true);
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -421,6 +424,54 @@ namespace Neuro
         }
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    void LoadMnistData(const string& imagesFile, const string& labelsFile, CompactTensor& input, CompactTensor& output, bool normalize, int maxImages)
+    {
+        auto imagesBuffer = LoadBinFileContents(imagesFile);
+        auto labelsBuffer = LoadBinFileContents(labelsFile);
+        const uint32_t* imagesHeader = reinterpret_cast<uint32_t*>(imagesBuffer.get());
+        const uint32_t* labelsHeader = reinterpret_cast<uint32_t*>(labelsBuffer.get());
+
+        uint32_t numImages = EndianSwap(imagesHeader[1]);
+        uint32_t imgWidth = EndianSwap(imagesHeader[2]);
+        uint32_t imgHeight = EndianSwap(imagesHeader[3]);
+        int outputsNum = (int)EndianSwap(labelsHeader[0]) - 2039;
+
+        maxImages = maxImages < 0 ? numImages : min<int>(maxImages, numImages);
+
+        // pixels are stored row by row exactly like in tensor
+        input = CompactTensor(Shape(imgWidth, imgHeight, 1, maxImages), COMPACT_UINT8, normalize ? 1 / 255.f : 1.f);
+        memcpy(input.Data(), imagesBuffer.get() + 16, input.SizeInBytes());
+
+        output = CompactTensor(Shape(outputsNum, 1, 1, maxImages), COMPACT_UINT8);
+        fill(output.Data(), output.Data() + output.SizeInBytes(), 0);
+        const uint8_t* labels = reinterpret_cast<uint8_t*>(labelsBuffer.get() + 8);
+        for (uint32_t i = 0; i < (uint32_t)maxImages; ++i)
+            output.SampleData(i)[labels[i]] = 1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void LoadCifar10Data(const string& imagesFile, CompactTensor& input, CompactTensor& output, bool normalize, int maxImages)
+    {
+        size_t fileLen = 0;
+        auto buffer = LoadBinFileContents(imagesFile, &fileLen);
+
+        uint32_t numImages = (uint32_t)fileLen / 3073;
+        maxImages = maxImages < 0 ? numImages : min<int>(maxImages, numImages);
+
+        input = CompactTensor(Shape(32, 32, 3, maxImages), COMPACT_UINT8, normalize ? 1 / 255.f : 1.f);
+        output = CompactTensor(Shape(10, 1, 1, maxImages), COMPACT_UINT8);
+        fill(output.Data(), output.Data() + output.SizeInBytes(), 0);
+
+        // every record is label followed by red, green and blue planes which matches tensor layout
+        for (uint32_t i = 0; i < (uint32_t)maxImages; ++i)
+        {
+            const uint8_t* record = reinterpret_cast<uint8_t*>(buffer.get() + i * 3073);
+            output.SampleData(i)[record[0]] = 1;
+            memcpy(input.SampleData(i), record + 1, 3072);
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////
     void SaveCifar10Data(const string& imagesFile, const Tensor& input, const Tensor& output)
     {
@@ -491,50 +542,16 @@ namespace Neuro
     //////////////////////////////////////////////////////////////////////////
     void LoadCSVData(const string& filename, int outputsNum, Tensor& input, Tensor& output, bool outputsOneHotEncoded, int maxLines)
     {
-        ifstream infile(filename.c_str());
-        string line;
-
-        vector<float> inputValues;
-        vector<float> outputValues;
-        uint32_t batches = 0;
-        uint32_t inputBatchSize = 0;
-
-        while (getline(infile, line))
-        {
-            if (maxLines >= 0 && batches >= (uint32_t)maxLines)
-                break;
-
-            if (line.empty())
-                continue;
-
-            auto tmp = Split(line, ",");
-
-            ++batches;
-            inputBatchSize = (int)tmp.size() - (outputsOneHotEncoded ? 1 : outputsNum);
-
-            for (int i = 0; i < (int)inputBatchSize; ++i)
-                inputValues.push_back((float)atof(tmp[i].c_str()));
+        CSVOptions options;
+        options.outputsOneHotEncoded = outputsOneHotEncoded;
 
-            for (int i = 0; i < (outputsOneHotEncoded ? 1 : outputsNum); ++i)
-            {
-                float v = (float)atof(tmp[inputBatchSize + i].c_str());
-
-                if (outputsOneHotEncoded)
-                {
-                    for (int e = 0; e < outputsNum; ++e)
-                        outputValues.push_back(e == (int)v ? 1.f : 0.f);
-                }
-                else
-                    outputValues.push_back(v);
-            }
-        }
-
-        input = Tensor(inputValues, Shape(inputBatchSize, 1, 1, batches));
-        output = Tensor(outputValues, Shape(outputsNum, 1, 1, batches));
+        CSVFile file(filename, outputsNum, options);
+        NEURO_ASSERT(file.IsValid(), "Failed to open '" << filename << "'.");
+        file.Load(input, output, maxLines);
     }
 
     //////////////////////////////////////////////////////////////////////////
-    FIBITMAP* LoadResizedImage(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, uint32_t& sizeX, uint32_t& sizeY)
+    FIBITMAP* LoadResizedImage(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, Random& rng, uint32_t& sizeX, uint32_t& sizeY)
     {
         ImageLibInit();
 
@@ -560,8 +577,8 @@ namespace Neuro
         if ((cropSizeX || cropSizeY) && (targetWidth > cropSizeX || targetHeight > cropSizeY))
         {
             // copy random-part
-            auto left = targetWidth > cropSizeX ? GlobalRng().Next(targetWidth - cropSizeX) : 0;
-            auto top = targetHeight > cropSizeY ? GlobalRng().Next(targetHeight - cropSizeY) : 0;
+            auto left = targetWidth > cropSizeX ? rng.Next(targetWidth - cropSizeX) : 0;
+            auto top = targetHeight > cropSizeY ? rng.Next(targetHeight - cropSizeY) : 0;
             auto croppedImage = FreeImage_Copy(image, left, top, min(left + cropSizeX, targetWidth), min(top + cropSizeY, targetHeight));
             FreeImage_Unload(image);
             image = croppedImage;
@@ -575,50 +592,63 @@ namespace Neuro
     }
 
     //////////////////////////////////////////////////////////////////////////
-    void LoadImageInternal(FIBITMAP* image, const Shape& shape, EDataFormat targetFormat, float* buffer)
+    void LoadImageInternal(FIBITMAP* image, const Shape& shape, EDataFormat targetFormat, float* buffer, const float* channelMeans = nullptr, bool swapChannels = false)
     {
         NEURO_ASSERT((targetFormat == NCHW && shape.Depth() == 3) || (targetFormat == NHWC && shape.Width() == 3), "Mismatched depth.");
-        RGBQUAD color;
+        const uint32_t width = targetFormat == NCHW ? shape.Width() : shape.Height();
+        const uint32_t height = targetFormat == NCHW ? shape.Height() : shape.Depth();
 
-        uint32_t idx = 0;
-        for (uint32_t h = 0; h < shape.Height(); ++h)
-        for (uint32_t w = 0; w < shape.Width(); ++w)
+        // palletized, grayscale and high bit depth images are converted upfront so rows can be read directly
+        FIBITMAP* converted = nullptr;
+        uint32_t bpp = FreeImage_GetBPP(image);
+        if (bpp != 24 && bpp != 32)
         {
-            FreeImage_GetPixelColor(image, (unsigned int)w, shape.Height() - (unsigned int)h - 1, &color);
+            converted = FreeImage_ConvertTo24Bits(image);
+            NEURO_ASSERT(converted, "Unsupported image format.");
+            image = converted;
+            bpp = 24;
+        }
 
-            if (targetFormat == NCHW)
-            {
-                buffer[shape.GetIndex(w, h, 0u)] = (float)color.rgbRed;
-                buffer[shape.GetIndex(w, h, 1u)] = (float)color.rgbGreen;
-                buffer[shape.GetIndex(w, h, 2u)] = (float)color.rgbBlue;
-            }
-            else
-            {
-                buffer[idx++] = (float)color.rgbRed;
-                buffer[idx++] = (float)color.rgbGreen;
-                buffer[idx++] = (float)color.rgbBlue;
-            }
+        int channelOffsets[3] = { FI_RGBA_RED, FI_RGBA_GREEN, FI_RGBA_BLUE };
+        float means[3] = { 0.f, 0.f, 0.f };
+        if (channelMeans)
+            copy(channelMeans, channelMeans + 3, means);
+        if (swapChannels)
+        {
+            swap(channelOffsets[0], channelOffsets[2]);
+            swap(means[0], means[2]);
         }
+
+        // FreeImage stores rows bottom-up
+        for (uint32_t h = 0; h < height; ++h)
+        {
+            const uint8_t* row = FreeImage_GetScanLine(image, height - h - 1);
+            float* dst = buffer + h * width * (targetFormat == NCHW ? 1 : 3);
+            CpuKernels::PixelRowToFloat(row, width, bpp / 8, channelOffsets, channelMeans ? means : nullptr, targetFormat, width * height, dst);
+        }
+
+        if (converted)
+            FreeImage_Unload(converted);
     }
 
     //////////////////////////////////////////////////////////////////////////
-    void LoadImage(const string& filename, float* buffer, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, EDataFormat targetFormat)
+    void LoadImage(const string& filename, float* buffer, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, EDataFormat targetFormat, const float* channelMeans, bool swapChannels)
     {
         uint32_t sizeX, sizeY;
-        FIBITMAP* image = LoadResizedImage(filename, targetSizeX, targetSizeY, cropSizeX, cropSizeY, sizeX, sizeY);
+        FIBITMAP* image = LoadResizedImage(filename, targetSizeX, targetSizeY, cropSizeX, cropSizeY, GlobalRng(), sizeX, sizeY);
         Shape imageShape = targetFormat == NCHW ? Shape(sizeX, sizeY, 3) : Shape(3, sizeX, sizeY);
-        LoadImageInternal(image, imageShape, targetFormat, buffer);
+        LoadImageInternal(image, imageShape, targetFormat, buffer, channelMeans, swapChannels);
         FreeImage_Unload(image);
     }
 
     //////////////////////////////////////////////////////////////////////////
-    Tensor LoadImage(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, EDataFormat targetFormat)
+    Tensor LoadImage(const string& filename, uint32_t targetSizeX, uint32_t targetSizeY, uint32_t cropSizeX, uint32_t cropSizeY, EDataFormat targetFormat, const float* channelMeans, bool swapChannels)
     {
         uint32_t sizeX, sizeY;
-        FIBITMAP* image = LoadResizedImage(filename, targetSizeX, targetSizeY, cropSizeX, cropSizeY, sizeX, sizeY);
+        FIBITMAP* image = LoadResizedImage(filename, targetSizeX, targetSizeY, cropSizeX, cropSizeY, GlobalRng(), sizeX, sizeY);
         Shape imageShape = targetFormat == NCHW ? Shape(sizeX, sizeY, 3) : Shape(3, sizeX, sizeY);
         Tensor result(imageShape);
-        LoadImageInternal(image, imageShape, targetFormat, &result.Values()[0]);
+        LoadImageInternal(image, imageShape, targetFormat, &result.Values()[0], channelMeans, swapChannels);
         FreeImage_Unload(image);
         return result;
     }
@@ -660,57 +690,26 @@ namespace Neuro
         FreeImage_Unload(image);
     }
 
-    struct PixelData
-    {
-        uint8_t r;
-        uint8_t g;
-        uint8_t b;
-        uint8_t a;
-    };
-
-    //////////////////////////////////////////////////////////////////////////
     Tensor LoadImage(uint8_t* imageBuffer, uint32_t width, uint32_t height, EPixelFormat format)
     {
+        NEURO_ASSERT(format == RGB || format == BGR || format == RGBA, "Unsupported pixel format.");
         Tensor output(Shape(width, height, 3));
         output.OverrideHost();
-        
-        PixelData pixel;
 
-        for (uint32_t h = 0; h < height; ++h)
-        for (uint32_t w = 0; w < width; ++w)
-        {
-            if (format == RGB)
-            {
-                pixel.r = *(imageBuffer++);
-                pixel.g = *(imageBuffer++);
-                pixel.b = *(imageBuffer++);
-            }
-            else if (format == BGR)
-            {
-                pixel.b = *(imageBuffer++);
-                pixel.g = *(imageBuffer++);
-                pixel.r = *(imageBuffer++);
-            }
-            else if (format == RGBA)
-            {
-                pixel.r = *(imageBuffer++);
-                pixel.g = *(imageBuffer++);
-                pixel.b = *(imageBuffer++);
-                pixel.a = *(imageBuffer++);
-            }
-            else
-                NEURO_ASSERT(false, "Unsupported pixel format.");
+        const int bytesPerPixel = format == RGBA ? 4 : 3;
+        const int rgbOffsets[3] = { 0, 1, 2 };
+        const int bgrOffsets[3] = { 2, 1, 0 };
 
-            output.Set((float)pixel.r, w, h, 0);
-            output.Set((float)pixel.g, w, h, 1);
-            output.Set((float)pixel.b, w, h, 2);
-        }
+        for (uint32_t h = 0; h < height; ++h)
+            CpuKernels::PixelRowToFloat(imageBuffer + h * width * bytesPerPixel, width, bytesPerPixel, format == BGR ? bgrOffsets : rgbOffsets, nullptr, NCHW, width * height, output.Values() + h * width);
 
         return output;
     }
 
     //////////////////////////////////////////////////////////////////////////
-    bool IsImageFileValid(const string& filename)
+    // Reads image dimensions, when fullDecode is false only header is read (for formats supporting it) so file can still turn out
+    // to be broken later on
+    static bool ReadImageInfo(const string& filename, bool fullDecode, uint32_t& width, uint32_t& height)
     {
         ImageLibInit();
 
@@ -718,7 +717,9 @@ namespace Neuro
         try
         {
             auto format = FreeImage_GetFileType(filename.c_str());
-            image = FreeImage_Load(format, filename.c_str());
+            if (format == FIF_UNKNOWN)
+                return false;
+            image = FreeImage_Load(format, filename.c_str(), fullDecode ? 0 : FIF_LOAD_NOPIXELS);
         }
         catch (...)
         {
@@ -728,11 +729,20 @@ namespace Neuro
         if (!image)
             return false;
 
+        width = FreeImage_GetWidth(image);
+        height = FreeImage_GetHeight(image);
         FreeImage_Unload(image);
 
         return true;
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    bool IsImageFileValid(const string& filename)
+    {
+        uint32_t width, height;
+        return ReadImageInfo(filename, true, width, height);
+    }
+
     //////////////////////////////////////////////////////////////////////////
     Shape GetShapeForMinSize(const Shape& shape, uint32_t minSize)
     {
@@ -749,73 +759,183 @@ namespace Neuro
         return Shape(maxSize, uint32_t(float(shape.Height()) / shape.Width() * maxSize), shape.Depth());
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    static int64_t FileModificationTime(const string& filename)
+    {
+        error_code ec;
+        return (int64_t)fs::last_write_time(filename, ec).time_since_epoch().count();
+    }
+
+    struct ListedImageDims
+    {
+        int64_t mtime;
+        Shape dims;
+    };
+
+    // dimensions of validated images from the most recent LoadFilesList call for every directory, listing directory again replaces
+    // its entries so removed files don't accumulate
+    static mutex g_ImageDimsMtx;
+    static unordered_map<string, unordered_map<string, ListedImageDims>> g_ImageDims;
+
     //////////////////////////////////////////////////////////////////////////
     Shape GetImageDims(const string& filename)
     {
-        ImageLibInit();
+        {
+            lock_guard<mutex> lock(g_ImageDimsMtx);
+            for (const auto& dirDims : g_ImageDims)
+            {
+                auto it = dirDims.second.find(filename);
+                // file could have been modified since it was listed
+                if (it != dirDims.second.end() && it->second.mtime == FileModificationTime(filename))
+                    return it->second.dims;
+            }
+        }
 
-        auto format = FreeImage_GetFileType(filename.c_str());
-        assert(format != FIF_UNKNOWN);
+        uint32_t width, height;
+        bool isImage = ReadImageInfo(filename, false, width, height);
+        NEURO_ASSERT(isImage, "Failed to read image '" << filename << "'.");
 
-        FIBITMAP* image = FreeImage_Load(format, filename.c_str());
-        assert(image);
+        return Shape(width, height, 3);
+    }
 
-        Shape shape(FreeImage_GetWidth(image), FreeImage_GetHeight(image), 3);
-            
-        FreeImage_Unload(image);
-        
-        return shape;
+    static const string FILES_CACHE_HEADER = "#neuro_files_cache 2";
+    // validation results are appended to cache after every chunk, so interrupted scan doesn't have to start over
+    static const uint32_t FILES_CACHE_FLUSH_CHUNK = 1024;
+
+    enum EFileState
+    {
+        FileNotValidated = 0,
+        FileValid = 1,
+        FileInvalid = 2,
+    };
+
+    struct FilesListEntry
+    {
+        string path;
+        int64_t mtime = 0;
+        EFileState state = FileNotValidated;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        bool inspected = false;
+    };
+
+    //////////////////////////////////////////////////////////////////////////
+    // Returns false when there is no cache or it was written by older version (plain list of files without modification times)
+    static bool ReadFilesListCache(const string& filename, unordered_map<string, FilesListEntry>& entries)
+    {
+        ifstream cache(filename);
+        string line;
+
+        if (!getline(cache, line) || line != FILES_CACHE_HEADER)
+            return false;
+
+        // when scan was interrupted the same file can be listed more than once, the last entry is the most recent one
+        while (getline(cache, line))
+        {
+            // line format: mtime state width height path
+            FilesListEntry entry;
+            int state;
+            stringstream ss(line);
+            ss >> entry.mtime >> state >> entry.width >> entry.height;
+            ss.get();
+            if (!ss || !getline(ss, entry.path))
+                continue;
+
+            entry.state = (EFileState)state;
+            entries[entry.path] = entry;
+        }
+
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    static void WriteFilesListCacheEntries(ostream& cache, vector<FilesListEntry>::const_iterator begin, vector<FilesListEntry>::const_iterator end, bool inspectedOnly)
+    {
+        for (auto it = begin; it != end; ++it)
+        {
+            if (!inspectedOnly || it->inspected)
+                cache << it->mtime << ' ' << (int)it->state << ' ' << it->width << ' ' << it->height << ' ' << it->path << "\n";
+        }
+        cache.flush();
     }
 
     //////////////////////////////////////////////////////////////////////////
     vector<string> LoadFilesList(const string& dir, bool shuffle, bool useCache, bool validate)
     {
-        vector<string> files;
-        ifstream contentCache = ifstream(dir + "_cache");
+        const string cacheFilename = dir + "_cache";
 
-        if (!useCache)
-            contentCache.close();
+        unordered_map<string, FilesListEntry> cached;
+        bool cacheValid = useCache && ReadFilesListCache(cacheFilename, cached);
 
-        if (contentCache && useCache)
+        vector<FilesListEntry> entries;
+        for (const auto& dirEntry : fs::directory_iterator(dir))
         {
-            string entry;
-            while (getline(contentCache, entry))
-                files.push_back(entry);
-            contentCache.close();
+            string path = dirEntry.path().generic_string();
+            auto it = cached.find(path);
+            entries.push_back(it != cached.end() ? it->second : FilesListEntry());
+            entries.back().path = path;
         }
-        else
-        {
-            auto contentCache = ofstream(dir + "_cache");
 
-            // build content files list
-            for (const auto& entry : fs::directory_iterator(dir))
-            {
-                string filename = entry.path().generic_string();
-                files.push_back(filename);
-                if (!validate)
-                    contentCache << files.back() << endl;
-            }
+        if (validate)
+        {
+            // new entries are appended to existing cache, otherwise it is started over
+            ofstream cache(cacheFilename, cacheValid ? ios::app : ios::trunc);
+            if (!cacheValid)
+                cache << FILES_CACHE_HEADER << "\n";
 
-            if (validate)
+            // only files modified since they were validated are decoded again
+            for (uint32_t chunkBegin = 0; chunkBegin < (uint32_t)entries.size(); chunkBegin += FILES_CACHE_FLUSH_CHUNK)
             {
-                vector<string> validFiles;
+                uint32_t chunkEnd = min(chunkBegin + FILES_CACHE_FLUSH_CHUNK, (uint32_t)entries.size());
 
-                //Tqdm progress(files.size(), 20);
-                for (size_t i = 0; i < files.size(); ++i/*, progress.NextStep()*/)
+                ThreadPool::Default().ParallelFor(chunkBegin, chunkEnd, 16, [&](uint32_t begin, uint32_t end)
                 {
-                    if (!IsImageFileValid(files[i]))
+                    for (uint32_t i = begin; i < end; ++i)
                     {
-                        cout << "Detected invalid image file '" << files[i] << "'" << endl;
-                        continue;
+                        auto& entry = entries[i];
+                        int64_t mtime = FileModificationTime(entry.path);
+                        if (entry.state != FileNotValidated && entry.mtime == mtime)
+                            continue;
+
+                        entry.mtime = mtime;
+                        entry.inspected = true;
+                        entry.state = ReadImageInfo(entry.path, true, entry.width, entry.height) ? FileValid : FileInvalid;
                     }
-                    validFiles.push_back(files[i]);
-                    contentCache << files.back() << endl;
-                }
+                });
 
-                files = validFiles;
+                WriteFilesListCacheEntries(cache, entries.begin() + chunkBegin, entries.begin() + chunkEnd, true);
             }
+        }
 
-            contentCache.close();
+        vector<string> files;
+        files.reserve(entries.size());
+        unordered_map<string, ListedImageDims> dirDims;
+        for (const auto& entry : entries)
+        {
+            // files found invalid by earlier validation are skipped even when listing only
+            if (entry.state == FileInvalid)
+            {
+                if (entry.inspected)
+                    cout << "Detected invalid image file '" << entry.path << "'" << endl;
+                continue;
+            }
+
+            files.push_back(entry.path);
+            if (validate)
+                dirDims[entry.path] = { entry.mtime, Shape(entry.width, entry.height, 3) };
+        }
+
+        if (validate)
+        {
+            lock_guard<mutex> lock(g_ImageDimsMtx);
+            g_ImageDims[dir] = move(dirDims);
+        }
+
+        // rewriting whole cache drops removed files and entries superseded by appended ones
+        {
+            ofstream cache(cacheFilename);
+            cache << FILES_CACHE_HEADER << "\n";
+            WriteFilesListCacheEntries(cache, entries.begin(), entries.end(), false);
         }
 
         if (shuffle)
@@ -1132,8 +1252,161 @@ namespace Neuro
         auto& x = dest[loadIdx];
         x.ResizeBatch(m_BatchSize);
         x.OverrideHost();
-        for (uint32_t j = 0; j < x.Batch(); ++j)
-            LoadImage(m_Files[GlobalRng().Next((int)m_Files.size())], x.Values() + j * x.BatchLength(), x.Width() * m_UpScaleFactor, x.Height() * m_UpScaleFactor, x.Width(), x.Height());
+
+        // random choices are made upfront so the batch is the same no matter how decoding is scheduled, every sample gets its
+        // own generator for cropping as global one cannot be shared between threads
+        vector<uint32_t> fileIdx(x.Batch());
+        vector<unsigned int> cropSeed(x.Batch());
+        {
+            // image loaders can be called from multiple preloader workers at once
+            static mutex rngLock;
+            lock_guard<mutex> lock(rngLock);
+            for (uint32_t j = 0; j < x.Batch(); ++j)
+            {
+                fileIdx[j] = (uint32_t)GlobalRng().Next((int)m_Files.size());
+                cropSeed[j] = (unsigned int)GlobalRng().Next(INT_MAX);
+            }
+        }
+
+        ImageLibInit();
+        ThreadPool::Default().ParallelFor(0, x.Batch(), 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t j = begin; j < end; ++j)
+            {
+                Random rng(cropSeed[j]);
+                uint32_t sizeX, sizeY;
+                FIBITMAP* image = LoadResizedImage(m_Files[fileIdx[j]], x.Width() * m_UpScaleFactor, x.Height() * m_UpScaleFactor, x.Width(), x.Height(), rng, sizeX, sizeY);
+                LoadImageInternal(image, Shape(sizeX, sizeY, 3), NCHW, x.Values() + j * x.BatchLength(), m_ChannelMeans.empty() ? nullptr : m_ChannelMeans.data(), m_SwapChannels);
+                FreeImage_Unload(image);
+            }
+        });
+
+        x.CopyToDevice();
+        return 1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    void ImageAugmentation::Apply(const string& filename, uint32_t width, uint32_t height, Random& rng, float* output) const
+    {
+        ImageLibInit();
+
+        auto format = FreeImage_GetFileType(filename.c_str());
+        NEURO_ASSERT(format != FIF_UNKNOWN, "Unrecognized format while opening '" << filename << "'");
+
+        FIBITMAP* image = FreeImage_Load(format, filename.c_str());
+        NEURO_ASSERT(image, "Failed to open '" << filename << "'");
+
+        // palletized, grayscale and high bit depth images are converted upfront so rows can be processed directly
+        uint32_t bpp = FreeImage_GetBPP(image);
+        if (bpp != 24 && bpp != 32)
+        {
+            FIBITMAP* converted = FreeImage_ConvertTo24Bits(image);
+            FreeImage_Unload(image);
+            NEURO_ASSERT(converted, "Unsupported image format.");
+            image = converted;
+            bpp = 24;
+        }
+        const int bytesPerPixel = bpp / 8;
+
+        // smallest scale at which image covers the output, multiplied by jitter
+        uint32_t imgWidth = FreeImage_GetWidth(image);
+        uint32_t imgHeight = FreeImage_GetHeight(image);
+        float scale = max(width / (float)imgWidth, height / (float)imgHeight) * (m_MaxScale > m_MinScale ? rng.NextFloat(m_MinScale, m_MaxScale) : m_MinScale);
+        uint32_t scaledWidth = max(width, (uint32_t)round(imgWidth * scale));
+        uint32_t scaledHeight = max(height, (uint32_t)round(imgHeight * scale));
+
+        if (scaledWidth != imgWidth || scaledHeight != imgHeight)
+        {
+            FIBITMAP* resized = FreeImage_Rescale(image, scaledWidth, scaledHeight);
+            FreeImage_Unload(image);
+            image = resized;
+        }
+
+        // crop doesn't require copying, rows are simply read from offset
+        uint32_t left = m_RandomCrop ? rng.Next(scaledWidth - width + 1) : (scaledWidth - width) / 2;
+        uint32_t top = m_RandomCrop ? rng.Next(scaledHeight - height + 1) : (scaledHeight - height) / 2;
+
+        bool flip = m_FlipProbability > 0 && rng.NextFloat() < m_FlipProbability;
+
+        // color jitter is a per channel linear transformation, contrast is changed around the middle of values range
+        const int rgbOffsets[3] = { FI_RGBA_RED, FI_RGBA_GREEN, FI_RGBA_BLUE };
+        bool jitterColor = m_Brightness > 0 || m_Contrast > 0 || m_Color > 0;
+        float gains[4] = { 1.f, 1.f, 1.f, 1.f };
+        float offsets[4] = { 0.f, 0.f, 0.f, 0.f };
+        if (jitterColor)
+        {
+            float contrast = m_Contrast > 0 ? rng.NextFloat(1 - m_Contrast, 1 + m_Contrast) : 1.f;
+            float brightness = m_Brightness > 0 ? rng.NextFloat(-m_Brightness, m_Brightness) : 0.f;
+            for (int c = 0; c < 3; ++c)
+            {
+                float color = m_Color > 0 ? rng.NextFloat(1 - m_Color, 1 + m_Color) : 1.f;
+                gains[rgbOffsets[c]] = contrast * color;
+                offsets[rgbOffsets[c]] = (128.f * (1 - contrast) + brightness) * color;
+            }
+        }
+
+        int channelOffsets[3] = { rgbOffsets[0], rgbOffsets[1], rgbOffsets[2] };
+        float means[3] = { 0.f, 0.f, 0.f };
+        if (!m_ChannelMeans.empty())
+            copy(m_ChannelMeans.begin(), m_ChannelMeans.end(), means);
+        if (m_SwapChannels)
+        {
+            swap(channelOffsets[0], channelOffsets[2]);
+            swap(means[0], means[2]);
+        }
+
+        vector<uint8_t> row((flip || jitterColor) ? width * bytesPerPixel : 0);
+
+        // FreeImage stores rows bottom-up
+        for (uint32_t h = 0; h < height; ++h)
+        {
+            const uint8_t* src = FreeImage_GetScanLine(image, scaledHeight - (top + h) - 1) + left * bytesPerPixel;
+            if (flip)
+            {
+                CpuKernels::PixelRowFlip(src, width, bytesPerPixel, row.data());
+                src = row.data();
+            }
+            if (jitterColor)
+            {
+                CpuKernels::PixelRowAffine(src, width, bytesPerPixel, gains, offsets, row.data());
+                src = row.data();
+            }
+            CpuKernels::PixelRowToFloat(src, width, bytesPerPixel, channelOffsets, m_ChannelMeans.empty() ? nullptr : means, NCHW, width * height, output + h * width);
+        }
+
+        FreeImage_Unload(image);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    size_t AugmentedImageLoader::operator()(vector<Tensor>& dest, size_t loadIdx)
+    {
+        auto& x = dest[loadIdx];
+        NEURO_ASSERT(x.Depth() == 3, "Destination must have depth 3.");
+        x.ResizeBatch(m_BatchSize);
+        x.OverrideHost();
+
+        // random choices are made upfront so the batch is the same no matter how decoding is scheduled
+        vector<uint32_t> fileIdx(x.Batch());
+        vector<unsigned int> seed(x.Batch());
+        {
+            static mutex rngLock;
+            lock_guard<mutex> lock(rngLock);
+            for (uint32_t j = 0; j < x.Batch(); ++j)
+            {
+                fileIdx[j] = (uint32_t)GlobalRng().Next((int)m_Files.size());
+                seed[j] = (unsigned int)GlobalRng().Next(INT_MAX);
+            }
+        }
+
+        ThreadPool::Default().ParallelFor(0, x.Batch(), 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t j = begin; j < end; ++j)
+            {
+                Random rng(seed[j]);
+                m_Augmentation.Apply(m_Files[fileIdx[j]], x.Width(), x.Height(), rng, x.Values() + j * x.BatchLength());
+            }
+        });
+
         x.CopyToDevice();
         return 1;
     }